@@ -0,0 +1,34 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "../test/curl_mock.h"
+#include "../test/alloc_counter.h"
+
+int main() {
+  if (!allocCounterAvailable()) {
+    printf("Heap use is not measured in sanitizer builds\n");
+  }
+  setupMocks();
+
+  checkForUpdatesBenchmark();
+  contextBenchmark();
+  logBenchmark();
+  reportBatchBenchmark();
+  reportDeadbandBenchmark();
+  reportEncodingBenchmark();
+  reportFormatBenchmark();
+  reportQueueBenchmark();
+  retryBenchmark();
+  timestampBenchmark();
+  urlBenchmark();
+
+  cleanupMocks();
+  return 0;
+}
@@ -0,0 +1,52 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_BENCHMARK_H
+#define GAUS_BENCHMARK_H
+
+#include <chrono>
+#include <cstdio>
+
+//Print one line of benchmark results
+#define BENCHMARK_RESULT(name, fmt, ...) printf("%-48s " fmt "\n", name, __VA_ARGS__)
+
+//Time fn over iterations calls, returning the mean duration of a call in microseconds
+template<typename Fn>
+double benchmarkMicroseconds(int iterations, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    fn();
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+void checkForUpdatesBenchmark();
+
+void contextBenchmark();
+
+void logBenchmark();
+
+void reportBatchBenchmark();
+
+void reportDeadbandBenchmark();
+
+void reportEncodingBenchmark();
+
+void reportFormatBenchmark();
+
+void reportQueueBenchmark();
+
+void retryBenchmark();
+
+void timestampBenchmark();
+
+void urlBenchmark();
+
+#endif //GAUS_BENCHMARK_H
@@ -0,0 +1,152 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "../test/alloc_counter.h"
+#include "../test/curl_mock.h"
+#include "gaus/gaus_client.h"
+
+//Access gaus internals
+extern "C" {
+#include "../src/libgaus/gaus.h"
+#include "../src/libgaus/request.h"
+}
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define UPDATE_COUNT 100
+#define RESPONSE_CHUNK_SIZE 1024
+#define ITERATIONS 200
+
+static std::string fakeUpdatesResponse(int updateCount) {
+  std::string update = "{\"metadata\": {\"hint\": \"overnight\", \"mandatory\": \"false\"},"
+                       "\"size\": 1048576,"
+                       "\"updateType\": \"firmware\","
+                       "\"packageType\": \"file\","
+                       "\"md5\": \"0123456789abcdef0123456789abcdef\","
+                       "\"updateId\": \"0123456789abcdef0123456789abcdef\","
+                       "\"version\": \"1.2.3\","
+                       "\"downloadUrl\": \"https://example.gaus.com/download/0123456789abcdef0123456789abcdef\"}";
+  std::string response = "{\"updates\": [" + update;
+  for (int i = 1; i < updateCount; i++) {
+    response += ", " + update;
+  }
+  return response + "]}";
+}
+
+static void freeUpdates(unsigned int updateCount, gaus_update_t *updates) {
+  for (unsigned int i = 0; i < updateCount; i++) {
+    for (unsigned int j = 0; j < updates[i].metadata_count; j++) {
+      free(updates[i].metadata[j].key);
+      free(updates[i].metadata[j].value);
+    }
+    free(updates[i].metadata);
+    free(updates[i].update_type);
+    free(updates[i].package_type);
+    free(updates[i].md5);
+    free(updates[i].update_id);
+    free(updates[i].version);
+    free(updates[i].download_url);
+  }
+  free(updates);
+}
+
+//Get the reply into memory as a whole and parse it afterwards, as gaus_check_for_updates used to.
+static void getBuffered(const char *url) {
+  long statusCode = 200;
+  json_error_t error;
+  char *raw = request_get_as_string(gaus_global_state.client, url, "fakeToken", NULL, &statusCode);
+  json_t *root = json_loads(raw, JSON_DECODE_ANY, &error);
+  free(raw);
+  json_decref(root);
+}
+
+static void getStreamed(const char *url) {
+  long statusCode = 200;
+  json_t *root = NULL;
+  request_get_as_json(gaus_global_state.client, url, "fakeToken", NULL, NULL, &root, &statusCode);
+  json_decref(root);
+}
+
+static void checkForUpdates(gaus_session_t *session, gaus_filter_set_t *filterSet) {
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  gaus_error_t *error = gaus_check_for_updates_with_filter_set(session, filterSet, &updateCount, &updates);
+  if (error) {
+    printf("gaus_check_for_updates failed: %s\n", error->description);
+    gaus_error_release(error);
+  }
+  if (gaus_global_state.update_layout == GAUS_UPDATE_LAYOUT_ONE_BLOCK) {
+    gaus_updates_free(updates);
+  } else {
+    freeUpdates(updateCount, updates);
+  }
+}
+
+template<typename Fn>
+static void report(const char *name, Fn fn) {
+  //Warm up once so one-time allocations (the shared handle's buffers etc) are not counted
+  fn();
+  allocCounterStart();
+  fn();
+  AllocStats stats = allocCounterStop();
+  double micros = benchmarkMicroseconds(ITERATIONS, fn);
+  BENCHMARK_RESULT(name, "peak heap %7zu B  %5zu allocs  %8.1f us", stats.peakBytes, stats.allocations, micros);
+}
+
+void checkForUpdatesBenchmark() {
+  const char *url = "fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/check-for-updates";
+  gaus_session_t session = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+
+  resetCurlMockHistory();
+  std::string response = fakeUpdatesResponse(UPDATE_COUNT);
+  free(fakeResponse);
+  fakeResponse = strdup(response.c_str());
+  fakeResponseChunkSize = RESPONSE_CHUNK_SIZE;
+  gaus_global_init("fakeServerUrl", NULL);
+
+  printf("check for updates: %d updates, %zu byte reply in %d byte chunks\n", UPDATE_COUNT, response.size(),
+         RESPONSE_CHUNK_SIZE);
+  report("get reply, then json_loads", [url]() { getBuffered(url); });
+  report("json parsed while reply arrives", [url]() { getStreamed(url); });
+  report("gaus_check_for_updates", [&session]() { checkForUpdates(&session, NULL); });
+  gaus_global_cleanup();
+  gaus_initialization_options_t options = {};
+  options.update_layout = GAUS_UPDATE_LAYOUT_ONE_BLOCK;
+  gaus_global_init("fakeServerUrl", &options);
+  report("gaus_check_for_updates, updates in one block", [&session]() { checkForUpdates(&session, NULL); });
+  gaus_global_cleanup();
+  gaus_global_init("fakeServerUrl", NULL);
+
+  //Polls mostly find nothing new: compare a reply without updates to a 304 for the ETag of that reply
+  gaus_filter_set_t *filterSet = NULL;
+  gaus_filter_set_create(0, NULL, &filterSet);
+  free(fakeResponse);
+  fakeResponse = strdup("{\"updates\": []}");
+  fakeResponseHeaders = {"ETag: \"0123456789abcdef\""};
+  report("gaus_check_for_updates, no updates", [&session]() { checkForUpdates(&session, NULL); });
+  checkForUpdates(&session, filterSet);
+  free(fakeResponse);
+  fakeResponse = strdup("");
+  fakeStatusCode = 304;
+  report("gaus_check_for_updates, not modified (304)", [&session, filterSet]() {
+    checkForUpdates(&session, filterSet);
+  });
+  gaus_filter_set_free(filterSet);
+
+  gaus_global_cleanup();
+  //The mocks keep a copy of every request made
+  resetCurlMockHistory();
+}
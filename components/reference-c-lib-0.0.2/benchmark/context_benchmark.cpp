@@ -0,0 +1,153 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "../test/curl_mock.h"
+#include "../test/local_server.h"
+#include "gaus/gaus_client.h"
+
+//Access gaus internals
+#include "../src/libgaus/curl_wrapper.h"
+#include "../src/libgaus/dns_cache.h"
+#include "../src/libgaus/stats.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define SERVER_LATENCY_MS 5
+#define CALLS_PER_THREAD 40
+#define BOOKKEEPING_CALLS_PER_THREAD 200000
+#define BOOKKEEPING_URL "https://gaus.example.com/api/check-for-updates"
+
+//Each of threads checks for updates CALLS_PER_THREAD times, with a context of its own or else through the global one
+static void checkForUpdatesFromThreads(LocalServer *server, unsigned int threads, bool ownContexts) {
+  std::vector<gaus_context_t *> contexts(threads, static_cast<gaus_context_t *>(NULL));
+  std::vector<gaus_session_t> sessions(threads, gaus_session_t{NULL, NULL, NULL});
+  std::vector<std::thread> running;
+  unsigned long failures = 0;
+
+  for (unsigned int i = 0; i < threads; i++) {
+    char *deviceAccess = NULL;
+    char *deviceSecret = NULL;
+    unsigned int pollInterval = 0;
+    std::string deviceId = "device-" + std::to_string(i);
+    gaus_error_t *error = NULL;
+    if ((ownContexts && (error = gaus_context_create(server->url().c_str(), NULL, &contexts[i])))
+        || (error = gaus_context_register(contexts[i], "access", "secret", deviceId.c_str(), &deviceAccess,
+                                          &deviceSecret, &pollInterval, NULL))
+        || (error = gaus_context_authenticate(contexts[i], deviceAccess, deviceSecret, &sessions[i], NULL))) {
+      printf("Setting up a device failed: %s\n", error->description);
+      gaus_error_release(error);
+      failures++;
+    }
+    free(deviceAccess);
+    free(deviceSecret);
+  }
+
+  unsigned long connections = server->connectionCount();
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < threads; i++) {
+    running.emplace_back([&contexts, &sessions, i]() {
+      for (int call = 0; call < CALLS_PER_THREAD; call++) {
+        unsigned int updateCount = 0;
+        gaus_update_t *updates = NULL;
+        gaus_error_release(gaus_context_check_for_updates(contexts[i], &sessions[i], NULL, &updateCount, &updates,
+                                                          NULL));
+      }
+    });
+  }
+  for (std::thread &thread : running) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::string name = std::to_string(threads) + (threads == 1 ? " thread, " : " threads, ")
+                     + (ownContexts ? "a context each" : "global context");
+  BENCHMARK_RESULT(name.c_str(), "%8.0f calls/s  %3lu new connections%s", threads * CALLS_PER_THREAD / elapsed.count(),
+                   server->connectionCount() - connections, failures ? "  (setup failed)" : "");
+  for (unsigned int i = 0; i < threads; i++) {
+    gaus_context_free(contexts[i]);
+    free(sessions[i].device_guid);
+    free(sessions[i].product_guid);
+    free(sessions[i].token);
+  }
+}
+
+static int loadAddress(void *user_data, unsigned char *buffer, size_t *length) {
+  (void) user_data;
+  std::string stored = "gaus-dns-1 gaus.example.com 443 192.0.2.1 " + std::to_string(time(NULL) + 3600);
+  memcpy(buffer, stored.data(), stored.size());
+  *length = stored.size();
+  return 0;
+}
+
+static int saveAddress(void *user_data, const unsigned char *buffer, size_t length) {
+  (void) user_data;
+  (void) buffer;
+  (void) length;
+  return 0;
+}
+
+//What every request does to state shared by all contexts (pinning the cached address and recording statistics),
+//without the request itself, so that it is not hidden behind the latency of the server
+static void bookkeepingFromThreads(unsigned int threads) {
+  std::vector<std::thread> running;
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < threads; i++) {
+    running.emplace_back([]() {
+      CURL *curl = gaus_curl_easy_init();
+      DnsPin pin;
+      for (int call = 0; call < BOOKKEEPING_CALLS_PER_THREAD; call++) {
+        dns_cache_prepare(curl, BOOKKEEPING_URL, &pin);
+        stats_record(curl, BOOKKEEPING_URL, CURLE_OK);
+        dns_cache_finish(curl, &pin, CURLE_OK);
+      }
+      gaus_curl_easy_cleanup(curl);
+    });
+  }
+  for (std::thread &thread : running) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::string name = std::to_string(threads) + (threads == 1 ? " thread, bookkeeping" : " threads, bookkeeping");
+  BENCHMARK_RESULT(name.c_str(), "%8.0f calls/s", threads * BOOKKEEPING_CALLS_PER_THREAD / elapsed.count());
+}
+
+void contextBenchmark() {
+  //Real curl against a server on the loopback interface, the latency of which threads can overlap
+  cleanupMocks();
+  LocalServer server(SERVER_LATENCY_MS);
+  if (!server.listening() || gaus_global_init(server.url().c_str(), NULL)) {
+    printf("context: no loopback server, skipped\n");
+    setupMocks();
+    return;
+  }
+
+  printf("context: %d checks for updates per thread, server replies after %d ms\n", CALLS_PER_THREAD,
+         SERVER_LATENCY_MS);
+  for (unsigned int threads = 1; threads <= 8; threads *= 2) {
+    checkForUpdatesFromThreads(&server, threads, false);
+    checkForUpdatesFromThreads(&server, threads, true);
+  }
+  gaus_global_cleanup();
+
+  gaus_dns_cache_store_t store = {NULL, loadAddress, saveAddress};
+  dns_cache_init(BOOKKEEPING_URL, NULL, &store, 0);
+  printf("context: shared state touched per call, %d calls per thread\n", BOOKKEEPING_CALLS_PER_THREAD);
+  for (unsigned int threads = 1; threads <= 8; threads *= 2) {
+    bookkeepingFromThreads(threads);
+  }
+  dns_cache_cleanup();
+  setupMocks();
+}
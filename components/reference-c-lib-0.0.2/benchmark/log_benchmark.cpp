@@ -0,0 +1,74 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+
+//Access gaus internals
+#include "../src/libgaus/log.h"
+
+#include <cstdio>
+#include <string>
+
+#define ITERATIONS 100000
+//Lines logged into the ring before it is given time to be written out, so none are dropped
+#define RING_LINES 4096
+#define RING_ROUNDS 50
+
+static const char *levelNames[] = {"debug", "info", "notice", "warning", "error"};
+
+static void logAtLevel(const char *how, int level) {
+  std::string name = std::string(levelNames[level]) + ", " + how;
+  double micros = benchmarkMicroseconds(ITERATIONS, [&]() {
+    logging(level, "request: Attempt %u failed, retrying in %lu ms", 2u, 1000ul);
+  });
+  BENCHMARK_RESULT(name.c_str(), "%8.3f us", micros);
+}
+
+static void logIntoRing(int level) {
+  std::string name = std::string(levelNames[level]) + ", into the ring";
+  double micros = 0;
+  for (int round = 0; round < RING_ROUNDS; round++) {
+    log_start_async(RING_LINES);
+    micros += benchmarkMicroseconds(RING_LINES / 2, [&]() {
+      logging(level, "request: Attempt %u failed, retrying in %lu ms", 2u, 1000ul);
+    });
+    log_stop_async();
+  }
+  BENCHMARK_RESULT(name.c_str(), "%8.3f us", micros / RING_ROUNDS);
+}
+
+#undef GAUS_LOG_FLOOR
+#define GAUS_LOG_FLOOR L_INFO
+
+static void logBelowFloor() {
+  double micros = benchmarkMicroseconds(ITERATIONS, [&]() {
+    logging(L_DEBUG, "request: Attempt %u failed, retrying in %lu ms", 2u, 1000ul);
+  });
+  BENCHMARK_RESULT("debug, below the floor of the build", "%8.3f us", micros);
+}
+
+void logBenchmark() {
+  FILE *devNull = fopen("/dev/null", "w");
+  if (!devNull) {
+    return;
+  }
+  set_log_stream(devNull);
+  set_loglevel(L_INFO);
+
+  printf("log: the cost of a line to the logging thread, written to /dev/null\n");
+  logBelowFloor();
+  logAtLevel("below the level", L_DEBUG);
+  for (int level : {L_INFO, L_WARNING, L_ERROR}) {
+    logAtLevel("written by the logging thread", level);
+    logIntoRing(level);
+  }
+
+  set_log_stream(NULL);
+  fclose(devNull);
+}
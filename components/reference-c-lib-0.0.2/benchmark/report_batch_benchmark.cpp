@@ -0,0 +1,103 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "../test/curl_mock.h"
+#include "gaus/gaus_client.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+//An hour of the demo: a temperature and a humidity report every two seconds
+#define SAMPLES 1800
+
+static void reportDone(gaus_error_t *error, void *) {
+  if (error) {
+    printf("report failed: %s\n", error->description);
+    gaus_error_release(error);
+  }
+}
+
+//Report every sample on its own, or through gaus_report_enqueue in batches of up to maxReports (0 for up to 8 KB)
+static void reportSamples(const char *name, bool batched, unsigned int maxReports) {
+  gaus_session_t session = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("2018-11-15T13:00:00.000Z")};
+  gaus_initialization_options_t initOptions = {};
+  initOptions.report_batch.max_reports = maxReports;
+  char ts[32];
+  gaus_v_float_t temperature[1] = {{const_cast<char *>("temperature"), 0}};
+  gaus_v_float_t humidity[1] = {{const_cast<char *>("humidity"), 0}};
+  gaus_report_t reports[2] = {};
+  for (int i = 0; i < 2; i++) {
+    reports[i].report_type = GAUS_REPORT_GENERIC;
+    reports[i].report.generic.type = const_cast<char *>(i ? "Humidity" : "Temperature");
+    reports[i].report.generic.ts = ts;
+    reports[i].report.generic.v_float_count = 1;
+    reports[i].report.generic.v_floats = i ? humidity : temperature;
+  }
+
+  resetCurlMockHistory();
+  gaus_global_init("fakeServerUrl", &initOptions);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < SAMPLES; i++) {
+    snprintf(ts, sizeof(ts), "2018-11-15T12:%02d:%02d.000Z", i / 30 % 60, i * 2 % 60);
+    temperature[0].value = 20.0f + i % 10;
+    humidity[0].value = 40.0f + i % 20;
+    gaus_error_t *error = batched ? gaus_report_enqueue(&session, NULL, &header, 2, reports)
+                                       : gaus_report_async(&session, 0, NULL, &header, 2, reports, reportDone, NULL);
+    unsigned int pending = 1;
+    while (!error && pending) {
+      error = gaus_client_poll(0, &pending);
+    }
+    if (error) {
+      printf("reporting failed: %s\n", error->description);
+      gaus_error_release(error);
+      break;
+    }
+  }
+  if (batched) {
+    //The last batch is not full yet
+    gaus_error_t *error = gaus_report_flush();
+    unsigned int pending = 1;
+    while (!error && pending) {
+      error = gaus_client_poll(0, &pending);
+    }
+    if (error) {
+      printf("flushing failed: %s\n", error->description);
+      gaus_error_release(error);
+    }
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+  size_t bodyBytes = 0;
+  size_t headerBytes = 0;
+  for (const CurlOptionsData &request : curlPerformData) {
+    bodyBytes += request.CURLOPT_POSTFIELDS.size();
+    for (const std::string &line : request.CURLOPT_HEADER) {
+      headerBytes += line.size() + 2;
+    }
+  }
+  BENCHMARK_RESULT(name, "%5zu POSTs  %7zu body bytes  %6zu header bytes  %6.1f us/sample",
+                   curlPerformData.size(), bodyBytes, headerBytes, elapsed.count() / SAMPLES);
+  gaus_global_cleanup();
+  resetCurlMockHistory();
+}
+
+void reportBatchBenchmark() {
+  printf("report batching: %d samples of two reports\n", SAMPLES);
+  reportSamples("gaus_report_async per sample", false, 0);
+  reportSamples("gaus_report_enqueue, 20 reports per batch", true, 20);
+  reportSamples("gaus_report_enqueue, 60 reports per batch", true, 60);
+  reportSamples("gaus_report_enqueue, 8 KB batches", true, 0);
+}
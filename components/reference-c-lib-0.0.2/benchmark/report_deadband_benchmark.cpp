@@ -0,0 +1,112 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "gaus/gaus_client.h"
+
+//Access gaus internals
+extern "C" {
+#include "../src/libgaus/report.h"
+#include "../src/libgaus/report_deadband.h"
+}
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+//An hour of the demo reading the DHT11 every 2 seconds
+#define SAMPLES 1800
+#define SAMPLE_MS 2000
+
+struct Reading {
+  float temperature;
+  float humidity;
+};
+
+//Readings of a room slowly warming up, in the whole degrees and percents of the DHT11, flickering at each step
+static std::vector<Reading> readings() {
+  std::vector<Reading> readings;
+  uint32_t seed = 1;
+  for (int i = 0; i < SAMPLES; i++) {
+    seed = seed * 1103515245u + 12345u;
+    float noise = ((seed >> 16) % 1000) / 1000.0f - 0.5f;
+    float temperature = 21.0f + 3.0f * i / SAMPLES + 0.6f * noise;
+    float humidity = 40.0f + 5.0f * std::sin(i * 6.283f / SAMPLES) + 1.5f * noise;
+    readings.push_back({std::round(temperature), std::round(humidity)});
+  }
+  return readings;
+}
+
+static void measure(const char *name, unsigned int rule_count, const gaus_report_deadband_rule_t *rules) {
+  const gaus_report_deadband_options_t options = {rule_count, rules};
+  std::vector<Reading> series = readings();
+  gaus_report_header_t header = {const_cast<char *>("2018-11-15T12:00:22.000Z")};
+  size_t reports = 0;
+  size_t bytes = 0;
+  size_t requests = 0;
+  std::chrono::duration<double, std::micro> filtering(0);
+
+  gaus_error_t *error = report_deadband_init(&options);
+  for (int i = 0; !error && i < SAMPLES; i++) {
+    gaus_v_float_t temperature[1] = {{const_cast<char *>("temperature"), series[i].temperature}};
+    gaus_v_float_t humidity[1] = {{const_cast<char *>("humidity"), series[i].humidity}};
+    gaus_report_t climate[2] = {};
+    climate[0].report_type = GAUS_REPORT_GENERIC;
+    climate[0].report.generic.type = const_cast<char *>("Temperature");
+    climate[0].report.generic.ts = header.ts;
+    climate[0].report.generic.v_float_count = 1;
+    climate[0].report.generic.v_floats = temperature;
+    climate[1] = climate[0];
+    climate[1].report.generic.type = const_cast<char *>("Humidity");
+    climate[1].report.generic.v_floats = humidity;
+
+    unsigned int send_count = 0;
+    const gaus_report_t *send = NULL;
+    DeadbandUpdate *update = NULL;
+    auto start = std::chrono::steady_clock::now();
+    error = report_deadband_filter(2, climate, (uint64_t) i * SAMPLE_MS, &send_count, &send, &update);
+    report_deadband_commit(update);
+    filtering += std::chrono::steady_clock::now() - start;
+    if (!error && send_count) {
+      char *body = NULL;
+      size_t length = 0;
+      error = report_encode_body(&header, send_count, send, GAUS_REPORT_FORMAT_JSON, &body, &length);
+      free(body);
+      reports += send_count;
+      bytes += length;
+      requests++;
+    }
+    report_deadband_release(send, climate);
+  }
+  report_deadband_cleanup();
+
+  if (error) {
+    printf("%s: %s\n", name, error->description);
+    gaus_error_release(error);
+    return;
+  }
+  BENCHMARK_RESULT(name, "%5zu requests  %5zu reports  %7zu B  %6.3f us", requests, reports, bytes,
+                   filtering.count() / SAMPLES);
+}
+
+void reportDeadbandBenchmark() {
+  gaus_report_deadband_rule_t rules[2] = {
+      {"Temperature", "temperature", 1.0f, 15 * 60 * 1000, 0},
+      {"Humidity", "humidity", 1.0f, 15 * 60 * 1000, 0}
+  };
+
+  printf("report deadband: an hour of DHT11 readings every %d ms, as json\n", SAMPLE_MS);
+  measure("every sample", 0, NULL);
+  measure("deadband 1, heartbeat 15 min", 2, rules);
+  rules[0].deadband = rules[1].deadband = 2.0f;
+  measure("deadband 2, heartbeat 15 min", 2, rules);
+  rules[0].summary = rules[1].summary = 1;
+  measure("deadband 2, heartbeat 15 min, summary", 2, rules);
+}
@@ -0,0 +1,119 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "../test/alloc_counter.h"
+#include "gaus/gaus_client.h"
+
+//Access gaus internals
+extern "C" {
+#include "../src/libgaus/report.h"
+}
+
+#include <jansson.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#define ITERATIONS 20000
+
+//{name: value, ...} built the way libgaus did before report_encode wrote json directly, one json_pack per value
+template<typename Value>
+static json_t *legacyValues(const char *format, unsigned int count, const Value *values) {
+  json_t *object = json_object();
+  for (unsigned int i = 0; i < count; i++) {
+    json_t *value = json_pack(format, values[i].name, values[i].value);
+    json_object_update_missing(object, value);
+    json_decref(value);
+  }
+  return object;
+}
+
+//The json tree libgaus built for a generic report before report_encode, serialized with json_dumps
+static char *legacyEncodeGeneric(const gaus_report_t *report) {
+  const gaus_report_event_generic_t *generic = &report->report.generic;
+  json_t *json = json_object();
+  size_t size = snprintf(NULL, 0, "event.generic.%s", generic->type) + 1;
+  char *type = static_cast<char *>(malloc(size));
+  snprintf(type, size, "event.generic.%s", generic->type);
+  json_object_set_new(json, "type", json_string(type));
+  json_object_set_new(json, "ts", json_string(generic->ts));
+  json_object_set_new(json, "v_ints", legacyValues("{s:i}", generic->v_int_count, generic->v_ints));
+  json_object_set_new(json, "v_floats", legacyValues("{s:f}", generic->v_float_count, generic->v_floats));
+  json_object_set_new(json, "v_strings", legacyValues("{s:s}", generic->v_string_count, generic->v_strings));
+  char *encoded = json_dumps(json, JSON_COMPACT);
+  json_decref(json);
+  free(type);
+  return encoded;
+}
+
+template<typename Fn>
+static void report(const char *name, Fn fn) {
+  fn();
+  allocCounterStart();
+  fn();
+  AllocStats stats = allocCounterStop();
+  double micros = benchmarkMicroseconds(ITERATIONS, fn);
+  BENCHMARK_RESULT(name, "peak heap %7zu B  %5zu allocs  %8.3f us", stats.peakBytes, stats.allocations, micros);
+}
+
+static void compareEncoders(const char *title, const gaus_report_t *generic) {
+  char *legacy = legacyEncodeGeneric(generic);
+  char *encoded = NULL;
+  gaus_error_t *error = report_encode(generic, &encoded);
+  printf("%s, %zu bytes%s\n", title, encoded ? strlen(encoded) : 0,
+         error || !legacy || strcmp(legacy, encoded) != 0 ? " (OUTPUT DIFFERS)" : "");
+  free(legacy);
+  free(encoded);
+  if (error) {
+    gaus_error_release(error);
+  }
+
+  report("json tree + json_dumps (before)", [&]() {
+    free(legacyEncodeGeneric(generic));
+  });
+  report("report_encode (json_writer)", [&]() {
+    char *json = NULL;
+    gaus_error_t *status = report_encode(generic, &json);
+    free(json);
+    if (status) {
+      gaus_error_release(status);
+    }
+  });
+}
+
+void reportEncodingBenchmark() {
+  gaus_v_float_t demoFloats[1] = {{const_cast<char *>("temperature"), 21.5f}};
+  gaus_report_t demo = {};
+  demo.report_type = GAUS_REPORT_GENERIC;
+  demo.report.generic.type = const_cast<char *>("Temperature");
+  demo.report.generic.ts = const_cast<char *>("2018-11-15T12:00:22.000Z");
+  demo.report.generic.v_float_count = 1;
+  demo.report.generic.v_floats = demoFloats;
+
+  gaus_v_int_t ints[4] = {{const_cast<char *>("rssi"), -67}, {const_cast<char *>("heap"), 123456},
+                          {const_cast<char *>("uptime"), 86400}, {const_cast<char *>("resets"), 3}};
+  gaus_v_float_t floats[4] = {{const_cast<char *>("temperature"), 21.5f}, {const_cast<char *>("humidity"), 40.25f},
+                              {const_cast<char *>("voltage"), 3.3f}, {const_cast<char *>("current"), 0.125f}};
+  gaus_v_string_t strings[4] = {{const_cast<char *>("firmware"), const_cast<char *>("1.2.3")},
+                                {const_cast<char *>("location"), const_cast<char *>("lab \"B\"")},
+                                {const_cast<char *>("state"), const_cast<char *>("idle")},
+                                {const_cast<char *>("reason"), const_cast<char *>("timer")}};
+  gaus_report_t rich = demo;
+  rich.report.generic.type = const_cast<char *>("Telemetry");
+  rich.report.generic.v_int_count = 4;
+  rich.report.generic.v_ints = ints;
+  rich.report.generic.v_float_count = 4;
+  rich.report.generic.v_floats = floats;
+  rich.report.generic.v_string_count = 4;
+  rich.report.generic.v_strings = strings;
+
+  compareEncoders("report encoding: demo temperature report", &demo);
+  compareEncoders("report encoding: 4 ints, 4 floats, 4 strings", &rich);
+}
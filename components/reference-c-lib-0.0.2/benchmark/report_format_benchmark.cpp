@@ -0,0 +1,108 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "../test/alloc_counter.h"
+#include "../test/cbor_decode.h"
+#include "gaus/gaus_client.h"
+
+//Access gaus internals
+extern "C" {
+#include "../src/libgaus/report.h"
+}
+
+#include <jansson.h>
+
+#include <cstdlib>
+#include <string>
+
+#define ITERATIONS 20000
+
+static void encode(const gaus_report_header_t *header, unsigned int count, const gaus_report_t *reports,
+                   gaus_report_format_t format, std::string *body) {
+  char *data = NULL;
+  size_t length = 0;
+  gaus_error_t *error = report_encode_body(header, count, reports, format, &data, &length);
+  if (body) {
+    body->assign(data ? data : "", length);
+  }
+  free(data);
+  if (error) {
+    gaus_error_release(error);
+  }
+}
+
+static void measure(const char *name, const gaus_report_header_t *header, unsigned int count,
+                    const gaus_report_t *reports, gaus_report_format_t format, size_t size) {
+  auto fn = [&]() {
+    encode(header, count, reports, format, NULL);
+  };
+  fn();
+  allocCounterStart();
+  fn();
+  AllocStats stats = allocCounterStop();
+  double micros = benchmarkMicroseconds(ITERATIONS, fn);
+  BENCHMARK_RESULT(name, "%5zu B  %5zu allocs  %8.3f us", size, stats.allocations, micros);
+}
+
+//Sizes and encode times of a body in both formats, checking the cbor decodes to the json
+static void compareFormats(const char *title, const gaus_report_header_t *header, unsigned int count,
+                           const gaus_report_t *reports) {
+  std::string json;
+  std::string cbor;
+  encode(header, count, reports, GAUS_REPORT_FORMAT_JSON, &json);
+  encode(header, count, reports, GAUS_REPORT_FORMAT_CBOR, &cbor);
+
+  json_t *decoded = cborDecode(cbor);
+  char *roundTrip = decoded ? json_dumps(decoded, JSON_COMPACT | JSON_PRESERVE_ORDER) : NULL;
+  printf("%s, cbor is %.0f%% of json%s\n", title, json.empty() ? 0.0 : 100.0 * cbor.size() / json.size(),
+         !roundTrip || json != roundTrip ? " (ROUND TRIP DIFFERS)" : "");
+  free(roundTrip);
+  json_decref(decoded);
+
+  measure("application/json", header, count, reports, GAUS_REPORT_FORMAT_JSON, json.size());
+  measure("application/cbor", header, count, reports, GAUS_REPORT_FORMAT_CBOR, cbor.size());
+}
+
+void reportFormatBenchmark() {
+  //The reports of main/gaus_report.c
+  gaus_report_header_t header = {const_cast<char *>("2018-11-15T12:00:22.000Z")};
+  gaus_v_float_t temperature[1] = {{const_cast<char *>("temperature"), 23.0f}};
+  gaus_v_float_t humidity[1] = {{const_cast<char *>("humidity"), 41.0f}};
+  gaus_report_t climate[2] = {};
+  climate[0].report_type = GAUS_REPORT_GENERIC;
+  climate[0].report.generic.type = const_cast<char *>("Temperature");
+  climate[0].report.generic.ts = header.ts;
+  climate[0].report.generic.v_float_count = 1;
+  climate[0].report.generic.v_floats = temperature;
+  climate[1] = climate[0];
+  climate[1].report.generic.type = const_cast<char *>("Humidity");
+  climate[1].report.generic.v_floats = humidity;
+
+  gaus_v_string_t strings[4] = {{const_cast<char *>("phase"), const_cast<char *>("install")},
+                                {const_cast<char *>("status"), const_cast<char *>("success")},
+                                {const_cast<char *>("logLine"), const_cast<char *>("Installed new firmware version.")},
+                                {const_cast<char *>("updateId"),
+                                 const_cast<char *>("2c1ef3a4-5b6d-4e7f-8a9b-0c1d2e3f4a5b")}};
+  gaus_report_t status = {};
+  status.report_type = GAUS_REPORT_UPDATE;
+  status.report.update_status.type = const_cast<char *>("Status");
+  status.report.update_status.ts = header.ts;
+  status.report.update_status.v_string_count = 4;
+  status.report.update_status.v_strings = strings;
+
+  //A reading that half precision can not hold, as the DHT11 rarely gives
+  gaus_v_float_t precise[1] = {{const_cast<char *>("temperature"), 23.4f}};
+  gaus_report_t fraction = climate[0];
+  fraction.report.generic.v_floats = precise;
+
+  compareFormats("report format: demo temperature and humidity", &header, 2, climate);
+  compareFormats("report format: demo status", &header, 1, &status);
+  compareFormats("report format: temperature of 23.4", &header, 1, &fraction);
+}
@@ -0,0 +1,126 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "../test/curl_mock.h"
+#include "gaus/gaus_client.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+#define BACKLOG 2000
+#define SECTOR_SIZE 4096
+#define STORE_SIZE (128 * SECTOR_SIZE)
+
+static std::vector<unsigned char> flash(STORE_SIZE, 0xFF);
+
+static int flashRead(void *, size_t offset, unsigned char *buffer, size_t length) {
+  memcpy(buffer, flash.data() + offset, length);
+  return 0;
+}
+
+static int flashWrite(void *, size_t offset, const unsigned char *buffer, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    flash[offset + i] &= buffer[i];
+  }
+  return 0;
+}
+
+static int flashErase(void *, size_t offset, size_t length) {
+  memset(flash.data() + offset, 0xFF, length);
+  return 0;
+}
+
+//Queue a backlog of temperature reports, as left by an outage, returning the time per report in microseconds
+static double queueBacklog() {
+  char ts[32];
+  gaus_v_float_t floats[1] = {{const_cast<char *>("temperature"), 0}};
+  gaus_report_t report = {};
+  report.report_type = GAUS_REPORT_GENERIC;
+  report.report.generic.type = const_cast<char *>("Temperature");
+  report.report.generic.ts = ts;
+  report.report.generic.v_float_count = 1;
+  report.report.generic.v_floats = floats;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BACKLOG; i++) {
+    snprintf(ts, sizeof(ts), "2018-11-15T12:%02d:%02d.000Z", i / 30 % 60, i * 2 % 60);
+    floats[0].value = 20.0f + i % 10;
+    gaus_error_t *error = gaus_report_queue_push(1, &report);
+    if (error) {
+      printf("gaus_report_queue_push failed: %s\n", error->description);
+      gaus_error_release(error);
+    }
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / BACKLOG;
+}
+
+static void drainBacklog(const char *name, const gaus_report_queue_store_t *store, size_t batchBytes) {
+  gaus_session_t session = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("2018-11-15T13:00:00.000Z")};
+  gaus_report_queue_drain_options_t options = {batchBytes, 0, {0, 0, 0}};
+  gaus_initialization_options_t initOptions = {};
+  initOptions.report_queue_store = store;
+
+  resetCurlMockHistory();
+  gaus_global_init("fakeServerUrl", &initOptions);
+  double pushMicros = queueBacklog();
+
+  auto start = std::chrono::steady_clock::now();
+  unsigned int pending = 0;
+  do {
+    gaus_error_t *error = gaus_report_queue_drain(&session, NULL, &header, &options);
+    if (!error) {
+      error = gaus_client_poll(0, &pending);
+    }
+    if (error) {
+      printf("draining failed: %s\n", error->description);
+      gaus_error_release(error);
+      break;
+    }
+  } while (pending || gaus_get_report_queue_stats().pending);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  size_t bytes = 0;
+  for (const CurlOptionsData &batch : curlPerformData) {
+    bytes += batch.CURLOPT_POSTFIELDS.size();
+  }
+  gaus_report_queue_stats_t stats = gaus_get_report_queue_stats();
+  BENCHMARK_RESULT(name, "push %5.1f us/report  drain %7.0f reports/s %6.2f MB/s  %4lu POSTs for %lu reports",
+                   pushMicros, stats.sent / elapsed.count(), bytes / elapsed.count() / 1e6, stats.batches, stats.sent);
+  gaus_global_cleanup();
+  resetCurlMockHistory();
+}
+
+void reportQueueBenchmark() {
+  gaus_report_queue_store_t memoryStore = {NULL, STORE_SIZE, SECTOR_SIZE, flashRead, flashWrite, flashErase};
+  char path[] = "/tmp/gaus_report_queue_benchmark_XXXXXX";
+  int fd = mkstemp(path);
+  gaus_report_queue_store_t fileStore = {path, STORE_SIZE, SECTOR_SIZE, gaus_report_queue_file_read,
+                                         gaus_report_queue_file_write, gaus_report_queue_file_erase};
+
+  printf("report queue: backlog of %d reports, %d KB store\n", BACKLOG, STORE_SIZE / 1024);
+  drainBacklog("flash in memory, 4 KB batches", &memoryStore, 4096);
+  drainBacklog("flash in memory, 16 KB batches", &memoryStore, 16384);
+  drainBacklog("flash in memory, 64 KB batches", &memoryStore, 65536);
+  if (fd != -1) {
+    close(fd);
+    drainBacklog("file, 16 KB batches", &fileStore, 16384);
+    remove(path);
+  }
+}
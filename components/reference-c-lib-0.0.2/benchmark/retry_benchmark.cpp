@@ -0,0 +1,84 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "gaus/gaus_client.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+#include <vector>
+
+#define DEVICES 1000
+//The server is down for the first OUTAGE_MS, then serves at most CAPACITY requests a second, failing the rest with 503
+#define OUTAGE_MS 60000
+#define CAPACITY 200
+#define BUCKET_MS 10000
+#define BUCKETS 18
+
+struct LoadCurve {
+  std::vector<int> requests;
+  int peakPerSecond; //Once the server is back
+  int rejected;
+  unsigned long allConnectedMs;
+};
+
+//Simulate a fleet that lost its server at time 0, each device retrying after delay(failures) until it gets through.
+static LoadCurve simulate(std::function<unsigned long(unsigned int)> delay) {
+  typedef std::pair<unsigned long, unsigned int> Attempt; //time, failures so far
+  std::priority_queue<Attempt, std::vector<Attempt>, std::greater<Attempt>> attempts;
+  std::map<unsigned long, int> perSecond;
+  LoadCurve curve = {std::vector<int>(BUCKETS), 0, 0, 0};
+
+  for (int i = 0; i < DEVICES; i++) {
+    attempts.push(Attempt(0, 0));
+  }
+  while (!attempts.empty()) {
+    Attempt attempt = attempts.top();
+    attempts.pop();
+    int &served = perSecond[attempt.first / 1000];
+    served++;
+    if (attempt.first / BUCKET_MS < BUCKETS) {
+      curve.requests[attempt.first / BUCKET_MS]++;
+    }
+    if (attempt.first >= OUTAGE_MS) {
+      curve.peakPerSecond = std::max(curve.peakPerSecond, served);
+      if (served <= CAPACITY) {
+        curve.allConnectedMs = attempt.first;
+        continue;
+      }
+      curve.rejected++;
+    }
+    attempts.push(Attempt(attempt.first + delay(attempt.second + 1), attempt.second + 1));
+  }
+  return curve;
+}
+
+static void report(const char *name, const LoadCurve &curve) {
+  char buckets[BUCKETS * 7 + 1] = "";
+  for (int i = 0; i < BUCKETS; i++) {
+    snprintf(buckets + i * 7, 8, " %6d", curve.requests[i]);
+  }
+  BENCHMARK_RESULT(name, "peak %4d req/s  %4d rejected  all connected after %5.1f s  requests per %d s:%s",
+                   curve.peakPerSecond, curve.rejected, curve.allConnectedMs / 1000.0, BUCKET_MS / 1000, buckets);
+}
+
+void retryBenchmark() {
+  gaus_retry_policy_t policy = {0, 1000, 60000};
+
+  report("fixed 10 s interval", simulate([](unsigned int) { return 10000UL; }));
+  report("exponential, no jitter", simulate([](unsigned int failures) {
+    return std::min(60000UL, 1000UL << std::min(failures - 1, 16U));
+  }));
+  report("gaus_retry_delay_ms (full jitter)", simulate([&](unsigned int failures) {
+    //Never retry in the same millisecond
+    return std::max(1UL, gaus_retry_delay_ms(&policy, failures));
+  }));
+}
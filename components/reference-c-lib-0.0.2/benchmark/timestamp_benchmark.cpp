@@ -0,0 +1,64 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "gaus/gaus_client.h"
+
+//Access gaus internals
+extern "C" {
+#include "../src/libgaus/timestamp.h"
+}
+
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+
+#define ITERATIONS 1000000
+
+//Keep the compiler from dropping the timestamps
+static volatile char sink;
+
+void timestampBenchmark() {
+  char buffer[GAUS_TIMESTAMP_SIZE];
+
+  printf("timestamp: a report timestamp as made for every sample\n");
+  double micros = benchmarkMicroseconds(ITERATIONS, [&]() {
+    time_t now = 0;
+    time(&now);
+    strftime(buffer, sizeof(buffer), "%FT%T.000Z", gmtime(&now));
+    sink = buffer[GAUS_TIMESTAMP_SIZE - 3];
+  });
+  BENCHMARK_RESULT("time, gmtime and strftime without milliseconds", "%8.3f us", micros);
+
+  micros = benchmarkMicroseconds(ITERATIONS, [&]() {
+    struct timespec now;
+    struct tm tm;
+    char date[20];
+    clock_gettime(CLOCK_REALTIME, &now);
+    gmtime_r(&now.tv_sec, &tm);
+    strftime(date, sizeof(date), "%FT%T", &tm);
+    snprintf(buffer, sizeof(buffer), "%s.%03dZ", date, static_cast<int>(now.tv_nsec / 1000000));
+    sink = buffer[GAUS_TIMESTAMP_SIZE - 3];
+  });
+  BENCHMARK_RESULT("strftime with milliseconds", "%8.3f us", micros);
+
+  micros = benchmarkMicroseconds(ITERATIONS, [&]() {
+    gaus_timestamp(buffer);
+    sink = buffer[GAUS_TIMESTAMP_SIZE - 3];
+  });
+  BENCHMARK_RESULT("gaus_timestamp", "%8.3f us", micros);
+
+  //A sample every 2 s, so the seconds change every call and the hour every 1800 calls
+  int64_t ms = 1542283222000;
+  micros = benchmarkMicroseconds(ITERATIONS, [&]() {
+    timestamp_format(ms += 2001, buffer);
+    sink = buffer[GAUS_TIMESTAMP_SIZE - 3];
+  });
+  BENCHMARK_RESULT("formatting only, a sample every 2 s", "%8.3f us", micros);
+}
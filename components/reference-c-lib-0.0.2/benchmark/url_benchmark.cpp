@@ -0,0 +1,121 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "benchmark.h"
+#include "../test/alloc_counter.h"
+#include "gaus/gaus_client.h"
+
+//Access gaus internals
+extern "C" {
+#include "../src/libgaus/url.h"
+}
+
+#include <curl/curl.h>
+
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+
+#define ITERATIONS 100000
+#define LEGACY_URL_MAX_LENGTH 256
+
+static inline void write_char_safe(char *base, size_t *offset, size_t len, char ch) {
+  if (base != NULL && *offset + 1 < len) {
+    base[*offset] = ch;
+  }
+  (*offset)++;
+}
+
+//The url builder libgaus used before url_create, escaping through a curl handle of its own into a fixed size buffer.
+static int legacyCreateUrl(char *dest, size_t dest_len, const char *fmt, ...) {
+  va_list ap;
+  const char *str;
+  char *encoded;
+  bool in_specifier = false;
+  size_t pos = 0;
+
+  CURL *curl = curl_easy_init();
+  if (!curl) {
+    return -1;
+  }
+
+  va_start(ap, fmt);
+  while (*fmt) {
+    if (!in_specifier) {
+      if (*fmt == '%') {
+        in_specifier = true;
+      } else {
+        write_char_safe(dest, &pos, dest_len, *fmt);
+      }
+    } else {
+      switch (*fmt) {
+        case 'e':
+          str = va_arg(ap, const char *);
+          encoded = curl_easy_escape(curl, str, strlen(str));
+          for (str = encoded; *str; str++) {
+            write_char_safe(dest, &pos, dest_len, *str);
+          }
+          curl_free(encoded);
+          break;
+        case 's':
+          for (str = va_arg(ap, const char *); *str; str++) {
+            write_char_safe(dest, &pos, dest_len, *str);
+          }
+          break;
+        default:
+          write_char_safe(dest, &pos, dest_len, *fmt);
+          break;
+      }
+      in_specifier = false;
+    }
+    fmt++;
+  }
+  curl_easy_cleanup(curl);
+  dest[pos + 1 < dest_len ? pos : dest_len - 1] = '\0';
+  va_end(ap);
+  return pos;
+}
+
+template<typename Fn>
+static void report(const char *name, Fn fn) {
+  //Warm up once so the cached prefix and curl's one-time setup are not counted
+  fn();
+  allocCounterStart();
+  fn();
+  AllocStats stats = allocCounterStop();
+  double micros = benchmarkMicroseconds(ITERATIONS, fn);
+  BENCHMARK_RESULT(name, "peak heap %7zu B  %5zu allocs  %8.3f us", stats.peakBytes, stats.allocations, micros);
+}
+
+void urlBenchmark() {
+  const char *server = "https://fake.gaus.server.example.com:8443/api/v1";
+  const char *query = "?firmware-version=1.2.3&location=lab";
+  gaus_session_t session = {
+      const_cast<char *>("0123456789abcdef-device"),
+      const_cast<char *>("0123456789abcdef-product"),
+      const_cast<char *>("fakeToken")
+  };
+  UrlPrefixCache cache;
+  url_prefix_cache_init(&cache);
+
+  printf("report url: %s/device/%s/%s/report%s\n", server, session.product_guid, session.device_guid, query);
+  report("create_url (curl_easy_escape, fixed buffer)", [&]() {
+    char url[LEGACY_URL_MAX_LENGTH];
+    legacyCreateUrl(url, sizeof(url), "%s/device/%e/%e/report%s", server, session.product_guid,
+                    session.device_guid, query);
+  });
+  report("url_create", [&]() {
+    free(url_create("%s/device/%e/%e/report%s", server, session.product_guid, session.device_guid, query));
+  });
+  report("url_create_for_device (cached prefix)", [&]() {
+    free(url_create_for_device(&cache, server, &session, "/report", query));
+  });
+
+  url_prefix_cache_cleanup(&cache);
+}
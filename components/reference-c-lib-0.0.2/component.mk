@@ -1,5 +1,6 @@
 COMPONENT_SRCDIRS:=src/libgaus
 COMPONENT_PRIV_INCLUDEDIRS:=src/include
 COMPONENT_ADD_INCLUDEDIRS=src/include
-CFLAGS+=-DHAVE_CONFIG_H -DBUILDING_LIBGAUS -DGAUS_USE_RAWLOG
+# Debug lines are never shown on the device, so they are left out of the build
+CFLAGS+=-DHAVE_CONFIG_H -DBUILDING_LIBGAUS -DGAUS_USE_RAWLOG -DGAUS_USE_MBEDTLS -DGAUS_LOG_FLOOR=L_INFO
 
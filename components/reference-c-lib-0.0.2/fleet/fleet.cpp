@@ -0,0 +1,635 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//Simulates a fleet of devices, each running the cycle of the demo: register, authenticate, then check for updates
+//every poll interval and report the temperature and humidity sampled since the last report every report interval.
+//
+//Devices are spread over worker threads, each calling gaus through a context of its own, and their first calls are
+//spread over an interval so they do not poll in lockstep.  Unless --server is given, the loopback server of the
+//unittests is run in a child process, so the CPU and memory measured are those of the client alone.
+//
+//Prints a latency histogram per call, requests per second, how late calls were made compared to their schedule
+//(a sign the worker threads are saturated) and the client CPU and memory per simulated device.
+#include "../test/local_server.h"
+#include "gaus/gaus_client.h"
+
+//Access gaus internals
+extern "C" {
+#include "../src/libgaus/log.h"
+}
+
+#include <getopt.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//A histogram splits each power of two microseconds into HISTOGRAM_STEPS buckets, so a percentile read from it is
+//within 1 / HISTOGRAM_STEPS of the truth, up to 2^HISTOGRAM_OCTAVES microseconds
+#define HISTOGRAM_STEP_BITS 3
+#define HISTOGRAM_STEPS (1U << HISTOGRAM_STEP_BITS)
+#define HISTOGRAM_OCTAVES 36
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_OCTAVES - HISTOGRAM_STEP_BITS + 1) * HISTOGRAM_STEPS)
+#define HISTOGRAM_BAR_WIDTH 40
+//Room in the report arena for the header and for each sample, two readings
+#define REPORT_ARENA_BASE_BYTES 256
+#define REPORT_ARENA_SAMPLE_BYTES 512
+
+typedef std::chrono::steady_clock Clock;
+
+class FleetOptions {
+public:
+  unsigned int devices = {100};
+  unsigned int threads = {8};
+  unsigned int durationS = {10};
+  unsigned int pollIntervalMs = {5000}; //0 for the poll interval the server gave at registration
+  unsigned int sampleIntervalMs = {1000};
+  unsigned int reportIntervalMs = {5000};
+  unsigned int latencyMs = {0};
+  std::string server; //Empty for the loopback server
+};
+
+//Durations in microseconds
+class Histogram {
+public:
+  unsigned long count = {0};
+  unsigned long errors = {0};
+  unsigned long long sum = {0};
+  unsigned long long max = {0};
+  unsigned long buckets[HISTOGRAM_BUCKETS] = {};
+
+  //Durations below HISTOGRAM_STEPS have a bucket each, others go by their top HISTOGRAM_STEP_BITS + 1 bits
+  static unsigned int bucket(unsigned long long micros) {
+    unsigned int octave = HISTOGRAM_STEP_BITS;
+    if (micros < HISTOGRAM_STEPS) {
+      return static_cast<unsigned int>(micros);
+    }
+    while (octave < HISTOGRAM_OCTAVES - 1 && (micros >> (octave + 1)) != 0) {
+      octave++;
+    }
+    unsigned int step = std::min((micros >> (octave - HISTOGRAM_STEP_BITS)) - HISTOGRAM_STEPS,
+                                 HISTOGRAM_STEPS - 1ULL);
+    return (octave - HISTOGRAM_STEP_BITS + 1) * HISTOGRAM_STEPS + step;
+  }
+
+  //The shortest duration counted in bucket, the bucket after it starts where it ends
+  static unsigned long long lowerBound(unsigned int bucket) {
+    if (bucket < HISTOGRAM_STEPS) {
+      return bucket;
+    }
+    unsigned int octave = bucket / HISTOGRAM_STEPS + HISTOGRAM_STEP_BITS - 1;
+    return (HISTOGRAM_STEPS + bucket % HISTOGRAM_STEPS) * (1ULL << (octave - HISTOGRAM_STEP_BITS));
+  }
+
+  void add(unsigned long long micros) {
+    buckets[bucket(micros)]++;
+    count++;
+    sum += micros;
+    max = std::max(max, micros);
+  }
+
+  void merge(const Histogram &other) {
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+      buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    errors += other.errors;
+    sum += other.sum;
+    max = std::max(max, other.max);
+  }
+
+  //The duration the fraction of durations did not exceed, interpolated within its bucket
+  unsigned long long percentile(double fraction) const {
+    double wanted = fraction * count;
+    unsigned long seen = 0;
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+      if (buckets[i] > 0 && seen + buckets[i] >= wanted) {
+        unsigned long long lower = lowerBound(i);
+        unsigned long long upper = i + 1 < HISTOGRAM_BUCKETS ? lowerBound(i + 1) : max + 1;
+        double within = std::max(wanted - seen, 0.0) / buckets[i];
+        return std::min(lower + static_cast<unsigned long long>(within * (upper - lower)), max);
+      }
+      seen += buckets[i];
+    }
+    return max;
+  }
+};
+
+enum Call {
+  CALL_REGISTER,
+  CALL_AUTHENTICATE,
+  CALL_CHECK_FOR_UPDATES,
+  CALL_REPORT,
+  CALL_COUNT
+};
+
+static const char *const callNames[CALL_COUNT] = {"register", "authenticate", "check for updates", "report"};
+
+class Sample {
+public:
+  char ts[GAUS_TIMESTAMP_SIZE];
+  float temperature;
+  float humidity;
+};
+
+class Device {
+public:
+  std::string id;
+  char *access = {NULL};
+  char *secret = {NULL};
+  unsigned int pollIntervalMs = {0};
+  gaus_session_t session = {NULL, NULL, NULL};
+  bool ready = {false}; //Registered and authenticated
+  Clock::time_point nextCheck;
+  Clock::time_point nextSample;
+  Clock::time_point nextReport;
+  std::vector<Sample> samples; //Taken since the last report
+
+  Clock::time_point nextEvent() const {
+    return std::min(nextCheck, std::min(nextSample, nextReport));
+  }
+};
+
+class Worker {
+public:
+  gaus_context_t *context = {NULL};
+  std::vector<Device> devices;
+  gaus_report_builder_t builder;
+  unsigned int maxSamples = {0}; //Most samples kept between reports, what the builder has room for
+  Histogram calls[CALL_COUNT];
+  Histogram lag; //How late calls were made, compared to their schedule
+  std::mt19937 random;
+};
+
+static unsigned long long microsSince(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+static double seconds(const timeval &time) {
+  return time.tv_sec + time.tv_usec / 1e6;
+}
+
+static double cpuSeconds() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+//Resident memory of the process in bytes
+static long residentBytes() {
+  long pages = 0;
+  long resident = 0;
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (statm) {
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(statm);
+  }
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+//Make a call, counting it under call, true if it succeeded
+static bool timeCall(Worker *worker, Call call, const std::function<gaus_error_t *()> &fn) {
+  Clock::time_point start = Clock::now();
+  gaus_error_t *error = fn();
+  worker->calls[call].add(microsSince(start));
+  if (error) {
+    worker->calls[call].errors++;
+    gaus_error_release(error);
+    return false;
+  }
+  return true;
+}
+
+static void setUp(Worker *worker) {
+  for (Device &device : worker->devices) {
+    device.ready =
+        timeCall(worker, CALL_REGISTER, [worker, &device]() {
+          return gaus_context_register(worker->context, "fleetProductAccess", "fleetProductSecret",
+                                       device.id.c_str(), &device.access, &device.secret, &device.pollIntervalMs,
+                                       NULL);
+        })
+        && timeCall(worker, CALL_AUTHENTICATE, [worker, &device]() {
+          return gaus_context_authenticate(worker->context, device.access, device.secret, &device.session, NULL);
+        });
+    device.pollIntervalMs *= 1000;
+  }
+}
+
+static void sample(Worker *worker, Device *device) {
+  std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+  if (device->samples.size() >= worker->maxSamples) {
+    //Fallen too far behind on reports, keep the latest
+    device->samples.erase(device->samples.begin());
+  }
+  Sample taken;
+  gaus_timestamp(taken.ts);
+  taken.temperature = 21.0f + noise(worker->random);
+  taken.humidity = 40.0f + noise(worker->random);
+  device->samples.push_back(taken);
+}
+
+static void report(Worker *worker, Device *device) {
+  const gaus_report_header_t *header = NULL;
+  unsigned int reportCount = 0;
+  const gaus_report_t *reports = NULL;
+
+  if (device->samples.empty()) {
+    return;
+  }
+  gaus_report_builder_reset(&worker->builder);
+  gaus_report_builder_header(&worker->builder, device->samples.back().ts);
+  for (const Sample &taken : device->samples) {
+    gaus_report_builder_begin(&worker->builder, GAUS_REPORT_GENERIC, "Temperature", taken.ts, 0, 1, 0);
+    gaus_report_builder_float(&worker->builder, "temperature", taken.temperature);
+    gaus_report_builder_begin(&worker->builder, GAUS_REPORT_GENERIC, "Humidity", taken.ts, 0, 1, 0);
+    gaus_report_builder_float(&worker->builder, "humidity", taken.humidity);
+  }
+  timeCall(worker, CALL_REPORT, [worker, device, &header, &reportCount, &reports]() {
+    gaus_error_t *error = gaus_report_builder_finish(&worker->builder, &header, &reportCount, &reports);
+    return error ? error : gaus_context_report(worker->context, &device->session, NULL, header, reportCount, reports,
+                                               NULL);
+  });
+  device->samples.clear();
+}
+
+static void checkForUpdates(Worker *worker, Device *device) {
+  timeCall(worker, CALL_CHECK_FOR_UPDATES, [worker, device]() {
+    unsigned int updateCount = 0;
+    gaus_update_t *updates = NULL;
+    gaus_error_t *error = gaus_context_check_for_updates(worker->context, &device->session, NULL, &updateCount,
+                                                         &updates, NULL);
+    //The loopback server never offers updates, a real one may
+    for (unsigned int i = 0; i < updateCount; i++) {
+      for (unsigned int j = 0; j < updates[i].metadata_count; j++) {
+        free(updates[i].metadata[j].key);
+        free(updates[i].metadata[j].value);
+      }
+      free(updates[i].metadata);
+      free(updates[i].update_type);
+      free(updates[i].package_type);
+      free(updates[i].md5);
+      free(updates[i].update_id);
+      free(updates[i].version);
+      free(updates[i].download_url);
+    }
+    free(updates);
+    return error;
+  });
+}
+
+//The next time of a periodic event that was due, without bursting to catch up if it fell behind
+static Clock::time_point next(Clock::time_point due, unsigned int intervalMs, Clock::time_point now) {
+  return std::max(due + std::chrono::milliseconds(intervalMs), now);
+}
+
+static void run(Worker *worker, const FleetOptions &options, Clock::time_point start, Clock::time_point end) {
+  typedef std::pair<Clock::time_point, size_t> Event;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+
+  for (size_t i = 0; i < worker->devices.size(); i++) {
+    Device &device = worker->devices[i];
+    if (!device.ready) {
+      continue;
+    }
+    unsigned int pollIntervalMs = options.pollIntervalMs ? options.pollIntervalMs : device.pollIntervalMs;
+    device.pollIntervalMs = std::max(pollIntervalMs, 1U);
+    //Spread the first calls of the fleet over their intervals
+    device.nextCheck = start + std::chrono::milliseconds(worker->random() % device.pollIntervalMs);
+    device.nextSample = start + std::chrono::milliseconds(worker->random() % options.sampleIntervalMs);
+    device.nextReport = start + std::chrono::milliseconds(worker->random() % options.reportIntervalMs);
+    events.push(Event(device.nextEvent(), i));
+  }
+
+  while (!events.empty() && events.top().first < end) {
+    Event event = events.top();
+    events.pop();
+    std::this_thread::sleep_until(event.first);
+    Device &device = worker->devices[event.second];
+    Clock::time_point now = Clock::now();
+    worker->lag.add(std::chrono::duration_cast<std::chrono::microseconds>(now - event.first).count());
+    if (device.nextSample <= now) {
+      sample(worker, &device);
+      device.nextSample = next(device.nextSample, options.sampleIntervalMs, now);
+    }
+    if (device.nextCheck <= now) {
+      checkForUpdates(worker, &device);
+      device.nextCheck = next(device.nextCheck, device.pollIntervalMs, Clock::now());
+    }
+    if (device.nextReport <= now) {
+      report(worker, &device);
+      device.nextReport = next(device.nextReport, options.reportIntervalMs, Clock::now());
+    }
+    events.push(Event(device.nextEvent(), event.second));
+  }
+}
+
+//Run the loopback server in a child process, returning its url, or an empty string if it could not be started.
+//It stops once control is closed, writing what it answered to results first.
+static std::string startServer(unsigned int latencyMs, pid_t *child, int *control, int *results) {
+  int urlPipe[2];
+  int controlPipe[2];
+  int resultPipe[2];
+  char url[64] = "";
+
+  if (pipe(urlPipe) != 0 || pipe(controlPipe) != 0 || pipe(resultPipe) != 0) {
+    return "";
+  }
+  if ((*child = fork()) == 0) {
+    close(urlPipe[0]);
+    close(controlPipe[1]);
+    close(resultPipe[0]);
+    {
+      LocalServer server(latencyMs);
+      std::string serverUrl = server.url() + "\n";
+      if (write(urlPipe[1], serverUrl.c_str(), serverUrl.size()) < 0) {
+        _exit(1);
+      }
+      close(urlPipe[1]);
+      char ignored;
+      while (read(controlPipe[0], &ignored, 1) > 0) {
+      }
+      unsigned long answered[2] = {server.requestCount(), server.connectionCount()};
+      if (write(resultPipe[1], answered, sizeof(answered)) < 0) {
+        _exit(1);
+      }
+    }
+    _exit(0);
+  }
+  close(urlPipe[1]);
+  close(controlPipe[0]);
+  close(resultPipe[1]);
+  ssize_t length = *child > 0 ? read(urlPipe[0], url, sizeof(url) - 1) : -1;
+  close(urlPipe[0]);
+  *control = controlPipe[1];
+  *results = resultPipe[0];
+  if (length <= 1) {
+    return "";
+  }
+  url[length - 1] = '\0';
+  return url;
+}
+
+static void printDuration(const char *label, unsigned long long micros) {
+  if (micros < 1000) {
+    printf("  %s %5llu us", label, micros);
+  } else {
+    printf("  %s %5.1f ms", label, micros / 1000.0);
+  }
+}
+
+//Print the count, rate and percentiles of histogram, and with bars its shape by powers of two
+static void printHistogram(const char *name, const char *counted, const Histogram &histogram, double elapsedS,
+                           bool bars) {
+  if (histogram.count == 0) {
+    return;
+  }
+  printf("%-18s %8lu %-6s %6lu errors %9.1f/s", name, histogram.count, counted, histogram.errors,
+         histogram.count / elapsedS);
+  printDuration("mean", histogram.sum / histogram.count);
+  printDuration("p50", histogram.percentile(0.5));
+  printDuration("p90", histogram.percentile(0.9));
+  printDuration("p99", histogram.percentile(0.99));
+  printDuration("max", histogram.max);
+  printf("\n");
+  if (!bars) {
+    return;
+  }
+  //A row for each bit length of a duration, the first one for 0
+  std::vector<unsigned long> rows(HISTOGRAM_OCTAVES + 1, 0);
+  for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    unsigned long long lower = Histogram::lowerBound(i);
+    unsigned int row = 0;
+    while (lower >> row) {
+      row++;
+    }
+    rows[row] += histogram.buckets[i];
+  }
+  unsigned long most = *std::max_element(rows.begin(), rows.end());
+  for (unsigned int row = 0; row < rows.size(); row++) {
+    if (rows[row] == 0) {
+      continue;
+    }
+    int width = static_cast<int>((rows[row] * HISTOGRAM_BAR_WIDTH + most - 1) / most);
+    printf("  %10llu us < %10llu us  %-*s %lu\n", row ? 1ULL << (row - 1) : 0ULL, 1ULL << row, HISTOGRAM_BAR_WIDTH,
+           std::string(width, '#').c_str(), rows[row]);
+  }
+}
+
+static void usage(const char *program) {
+  printf("Usage: %s [options]\n"
+         "  --devices N           devices to simulate (100)\n"
+         "  --threads N           worker threads, each with a gaus context of its own (8)\n"
+         "  --duration S          seconds to run the fleet after setting it up (10)\n"
+         "  --poll-interval MS    between checks for updates, 0 for the one given at registration (5000)\n"
+         "  --sample-interval MS  between temperature and humidity samples (1000)\n"
+         "  --report-interval MS  between reports of the samples taken meanwhile (5000)\n"
+         "  --latency MS          the loopback server waits this long before every reply (0)\n"
+         "  --server URL          run against this server instead of the loopback one\n", program);
+}
+
+static bool parseOptions(int argc, char **argv, FleetOptions *options) {
+  static const struct option longOptions[] = {
+      {"devices",         required_argument, NULL, 'd'},
+      {"threads",         required_argument, NULL, 't'},
+      {"duration",        required_argument, NULL, 'D'},
+      {"poll-interval",   required_argument, NULL, 'p'},
+      {"sample-interval", required_argument, NULL, 's'},
+      {"report-interval", required_argument, NULL, 'r'},
+      {"latency",         required_argument, NULL, 'l'},
+      {"server",          required_argument, NULL, 'S'},
+      {"help",            no_argument,       NULL, 'h'},
+      {NULL, 0,                              NULL, 0}
+  };
+  int option;
+
+  while ((option = getopt_long(argc, argv, "d:t:D:p:s:r:l:S:h", longOptions, NULL)) != -1) {
+    unsigned int value = optarg ? static_cast<unsigned int>(strtoul(optarg, NULL, 10)) : 0;
+    switch (option) {
+      case 'd': options->devices = value; break;
+      case 't': options->threads = value; break;
+      case 'D': options->durationS = value; break;
+      case 'p': options->pollIntervalMs = value; break;
+      case 's': options->sampleIntervalMs = value; break;
+      case 'r': options->reportIntervalMs = value; break;
+      case 'l': options->latencyMs = value; break;
+      case 'S': options->server = optarg; break;
+      default: return false;
+    }
+  }
+  if (options->devices == 0 || options->threads == 0 || options->sampleIntervalMs == 0
+      || options->reportIntervalMs == 0) {
+    printf("devices, threads and the sample and report intervals must not be 0\n");
+    return false;
+  }
+  options->threads = std::min(options->threads, options->devices);
+  return true;
+}
+
+//Run the devices that are ready for options.durationS and print what it took
+static void runFleet(std::vector<Worker> &workers, const FleetOptions &options, unsigned int ready,
+                     unsigned int pollIntervalMs, long contextsBytes, long deviceBytes) {
+  std::vector<std::thread> threads;
+  double cpuStart = cpuSeconds();
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::seconds(options.durationS);
+  for (Worker &worker : workers) {
+    threads.emplace_back(run, &worker, std::cref(options), start, end);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  double elapsedS = microsSince(start) / 1e6;
+  double cpuS = cpuSeconds() - cpuStart;
+
+  Histogram total[CALL_COUNT];
+  Histogram lag;
+  unsigned long calls = 0;
+  for (Worker &worker : workers) {
+    for (unsigned int call = 0; call < CALL_COUNT; call++) {
+      total[call].merge(worker.calls[call]);
+    }
+    lag.merge(worker.lag);
+  }
+  printf("\n");
+  for (unsigned int call = CALL_CHECK_FOR_UPDATES; call < CALL_COUNT; call++) {
+    printHistogram(callNames[call], "calls", total[call], elapsedS, true);
+    calls += total[call].count;
+  }
+  printHistogram("schedule lag", "events", lag, elapsedS, true);
+  printf("\nrequests: %.1f/s over %.2f s, the schedule asks for %.1f/s\n", calls / elapsedS, elapsedS,
+         ready * 1e3 / pollIntervalMs + ready * 1e3 / options.reportIntervalMs);
+  printf("client cpu: %.2f s, %.1f%% of a core, %.1f us per call, %.3f ms per device per second\n", cpuS,
+         100.0 * cpuS / elapsedS, calls ? 1e6 * cpuS / calls : 0.0, 1e3 * cpuS / elapsedS / ready);
+  printf("client memory: %ld kB resident for gaus and %u contexts, %ld B more per device after setup, "
+         "%ld kB resident at the end\n", contextsBytes / 1024, options.threads, deviceBytes, residentBytes() / 1024);
+}
+
+int main(int argc, char **argv) {
+  FleetOptions options;
+  pid_t child = 0;
+  int control = -1;
+  int results = -1;
+
+  if (!parseOptions(argc, argv, &options)) {
+    usage(argv[0]);
+    return 1;
+  }
+  //Before any thread is started, so the child can be forked safely
+  std::string url = options.server;
+  if (url.empty() && (url = startServer(options.latencyMs, &child, &control, &results)).empty()) {
+    printf("Unable to start the loopback server\n");
+    return 1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  long baseResident = residentBytes();
+  gaus_error_t *error = gaus_global_init(url.c_str(), NULL);
+  //Failed calls are counted, logging more than their errors would only slow the fleet down
+  set_loglevel(L_ERROR);
+  set_log_stream(stderr);
+  std::vector<Worker> workers(options.threads);
+  for (unsigned int i = 0; !error && i < workers.size(); i++) {
+    Worker &worker = workers[i];
+    worker.random.seed(i);
+    worker.maxSamples = options.reportIntervalMs / options.sampleIntervalMs + 1;
+    if (!(error = gaus_context_create(url.c_str(), NULL, &worker.context))) {
+      error = gaus_report_builder_init(&worker.builder, NULL,
+                                       REPORT_ARENA_BASE_BYTES + worker.maxSamples * REPORT_ARENA_SAMPLE_BYTES);
+    }
+  }
+  if (error) {
+    printf("Unable to set up gaus: %s\n", error->description);
+    gaus_error_release(error);
+    return 1;
+  }
+  for (unsigned int i = 0; i < options.devices; i++) {
+    Device device;
+    device.id = "fleet-device-" + std::to_string(i);
+    workers[i % workers.size()].devices.push_back(device);
+  }
+  long contextsResident = residentBytes();
+
+  printf("fleet: %u devices on %u threads against %s%s\n", options.devices, options.threads, url.c_str(),
+         options.server.empty() ? " (loopback)" : "");
+  Clock::time_point setupStart = Clock::now();
+  std::vector<std::thread> threads;
+  for (Worker &worker : workers) {
+    threads.emplace_back(setUp, &worker);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  double setupS = microsSince(setupStart) / 1e6;
+  Histogram setup[CALL_COUNT];
+  for (Worker &worker : workers) {
+    for (unsigned int call = 0; call < CALL_COUNT; call++) {
+      setup[call].merge(worker.calls[call]);
+      worker.calls[call] = Histogram();
+    }
+  }
+  long devicesResident = residentBytes();
+  unsigned int ready = 0;
+  unsigned int pollIntervalMs = options.pollIntervalMs;
+  for (Worker &worker : workers) {
+    for (Device &device : worker.devices) {
+      if (device.ready) {
+        ready++;
+        //The server gives every device the same one
+        pollIntervalMs = pollIntervalMs ? pollIntervalMs : std::max(device.pollIntervalMs, 1U);
+      }
+    }
+  }
+  printf("\nsetup: %u of %u devices registered and authenticated in %.2f s\n", ready, options.devices, setupS);
+  printHistogram(callNames[CALL_REGISTER], "calls", setup[CALL_REGISTER], setupS, false);
+  printHistogram(callNames[CALL_AUTHENTICATE], "calls", setup[CALL_AUTHENTICATE], setupS, false);
+
+  if (ready > 0) {
+    printf("\nrunning for %u s: checking for updates every %u ms, sampling every %u ms, reporting every %u ms\n",
+           options.durationS, pollIntervalMs, options.sampleIntervalMs, options.reportIntervalMs);
+    runFleet(workers, options, ready, pollIntervalMs, contextsResident - baseResident,
+             (devicesResident - contextsResident) / static_cast<long>(options.devices));
+  }
+
+  for (Worker &worker : workers) {
+    for (Device &device : worker.devices) {
+      free(device.access);
+      free(device.secret);
+      free(device.session.device_guid);
+      free(device.session.product_guid);
+      free(device.session.token);
+    }
+    gaus_report_builder_free(&worker.builder);
+    gaus_context_free(worker.context);
+  }
+  gaus_global_cleanup();
+
+  if (child > 0) {
+    unsigned long answered[2] = {0, 0};
+    close(control);
+    if (read(results, answered, sizeof(answered)) == sizeof(answered)) {
+      printf("loopback server: %lu requests answered on %lu connections\n", answered[0], answered[1]);
+    }
+    close(results);
+    waitpid(child, NULL, 0);
+  }
+  return ready > 0 ? 0 : 1;
+}
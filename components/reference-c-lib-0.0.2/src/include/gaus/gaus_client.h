@@ -66,11 +66,50 @@ gaus_version_t gaus_client_library_version(void);
  * \param[in] options: A weak pointer to gaus_initialization_options_t may be passed in specifying what options to
  *   initialize the library with. If default options are desired pass in NULL.
  * \return gaus_error_t* A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
- *   for freeing this memory if non null.
+ *   for releasing it with ::gaus_error_release if non null.
  *
  *************************************************************/
 gaus_error_t *gaus_global_init(const char *serverUrl, const gaus_initialization_options_t *options);
 
+/*************************************************************//**
+ *
+ * \brief Create a context, calling a gaus server independently of other threads
+ *
+ * Calls given the context use serverUrl with its own connection, and the proxy, call options, report format and
+ * update layout of options, instead of those given to ::gaus_global_init.  What lives for the whole process (the TLS
+ * session store, the DNS cache, report deadbands, queues and batches, and the asynchronous calls) stays shared.  Give
+ * each thread calling gaus a context of its own so they never wait for each other's connection.
+ *
+ * Only the four blocking calls taking a context honour it: ::gaus_context_register, ::gaus_context_authenticate,
+ * ::gaus_context_check_for_updates and ::gaus_context_report.  ::gaus_check_for_updates_async, ::gaus_report_async,
+ * ::gaus_report_enqueue, ::gaus_report_queue_drain and ::gaus_client_poll always call the server given to
+ * ::gaus_global_init, with its connection and options, whichever context the calling thread otherwise uses.
+ *
+ * Can only be called after ::gaus_global_init, and the context must be freed with ::gaus_context_free before
+ * ::gaus_global_cleanup.
+ *
+ * \param[in] serverUrl: A weak pointer to a null terminated url.  For example "http://example.gaus.com"
+ * \param[in] options: A weak pointer to the options of the context, only proxy, call_options, report_format and
+ *   update_layout are used.  NULL for the defaults.
+ * \param[out] context: Set to a strong pointer to the new context, to free with ::gaus_context_free.
+ * \return gaus_error_t* A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
+ *   for releasing it with ::gaus_error_release if non null.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_context_create(const char *serverUrl, const gaus_initialization_options_t *options, gaus_context_t **context);
+
+/*************************************************************//**
+ *
+ * \brief Free a context created by ::gaus_context_create
+ *
+ * No call may be using the context anymore.
+ *
+ * \param[in] context: A strong pointer to the context to free, or `NULL` which is ignored.
+ *
+ *************************************************************/
+void gaus_context_free(gaus_context_t *context);
+
 /*************************************************************//**
  *
  * \brief Register a new device
@@ -102,20 +141,53 @@ gaus_error_t *gaus_global_init(const char *serverUrl, const gaus_initialization_
  *   ::gaus_register does not allocate any memory for this single int so the pointer must point to a valid integer
  *   location.
  * \return gaus_error_t* A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
- *   for freeing this memory if non null.
+ *   for releasing it with ::gaus_error_release if non null.
  *
  *************************************************************/
 gaus_error_t *gaus_register(const char *product_access, const char *product_secret, const char *device_id,
                             char **device_access, char **device_secret, unsigned int *poll_interval_seconds);
 
+/*************************************************************//**
+ *
+ * \brief Register a device, within time limits
+ *
+ * The same as ::gaus_register, bounded by options.
+ *
+ * \param[in] options: A weak pointer to the limits for this call, or `NULL` for those given to ::gaus_global_init.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_register_with_options(const char *product_access, const char *product_secret, const char *device_id,
+                           char **device_access, char **device_secret, unsigned int *poll_interval_seconds,
+                           const gaus_call_options_t *options);
+
+/*************************************************************//**
+ *
+ * \brief Register a device with a context
+ *
+ * The same as ::gaus_register_with_options, calling the server of context.
+ *
+ * \param[in] context: A weak pointer to the context to call, or `NULL` for the one set up by ::gaus_global_init.
+ * \param[in] options: A weak pointer to the limits for this call, or `NULL` for those the context was created
+ *   with.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_context_register(gaus_context_t *context, const char *product_access, const char *product_secret,
+                      const char *device_id, char **device_access, char **device_secret,
+                      unsigned int *poll_interval_seconds, const gaus_call_options_t *options);
+
 
 /*************************************************************//**
  *
  * \brief Authenticate a device
  *
  * Start a new session with Gaus.  This blocking synchronous call gets the \c ::gaus_session_t needed for future
- * communication with the gaus backend.  All future calls will be expected to provide this session, in the event that
- * the session expires this function should be called again.
+ * communication with the gaus backend.  All future calls will be expected to provide this session.
+ *
+ * The credentials and a copy of the token are kept until ::gaus_global_cleanup, so that once the session expires the
+ * synchronous calls taking it renew it by themselves (see gaus_session_t::token).  Asynchronous calls fail with http error 401 instead, after which this function should be
+ * called again (or a synchronous call be made).
  *
  * Out parameters are only valid if return value is `NULL`.  To prevent memory leaks out parameters (and their contents)
  * should always be freed by the caller.
@@ -129,10 +201,69 @@ gaus_error_t *gaus_register(const char *product_access, const char *product_secr
  *   caller is responsible for freeing the contents of session.
  *
  * \return gaus_error_t A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
- *   for freeing this memory if non null.
+ *   for releasing it with ::gaus_error_release if non null.
  *************************************************************/
 gaus_error_t *gaus_authenticate(const char *device_access, const char *device_secret, gaus_session_t *session);
 
+/*************************************************************//**
+ *
+ * \brief Authenticate a device, within time limits
+ *
+ * The same as ::gaus_authenticate, bounded by options.
+ *
+ * \param[in] options: A weak pointer to the limits for this call, or `NULL` for those given to ::gaus_global_init.
+ *
+ *************************************************************/
+gaus_error_t *gaus_authenticate_with_options(const char *device_access, const char *device_secret,
+                                             gaus_session_t *session, const gaus_call_options_t *options);
+
+/*************************************************************//**
+ *
+ * \brief Authenticate a device with a context
+ *
+ * The same as ::gaus_authenticate_with_options, calling the server of context.  Calls renewing the session once it
+ * expires call the server of their own context.
+ *
+ * \param[in] context: A weak pointer to the context to call, or `NULL` for the one set up by ::gaus_global_init.
+ * \param[in] options: A weak pointer to the limits for this call, or `NULL` for those the context was created
+ *   with.
+ *
+ *************************************************************/
+gaus_error_t *gaus_context_authenticate(gaus_context_t *context, const char *device_access, const char *device_secret,
+                                        gaus_session_t *session, const gaus_call_options_t *options);
+
+
+/*************************************************************//**
+ *
+ * \brief Compile filters into a filter set
+ *
+ * Builds the query string for filters once, names and values are percent-encoded.  The filter set can then be passed
+ * to ::gaus_check_for_updates_with_filter_set and ::gaus_report_with_filter_set (and their asynchronous versions) for
+ * as long as the filters stay the same.
+ *
+ * \param[in] filter_count: An integer specifying the number of filters in the filters parameter.
+ * \param[in] filters: A weak pointer to an array of filters to be used to build the query string parameters.  They are
+ *   copied, so they may be freed as soon as this call returns.
+ * \param[out] filter_set: Set to a strong pointer to the new filter set.  The caller is responsible for freeing it
+ *   with ::gaus_filter_set_free.
+ *
+ * \return gaus_error_t A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
+ *   for releasing it with ::gaus_error_release if non null.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_filter_set_create(unsigned int filter_count, const gaus_header_filter_t *filters, gaus_filter_set_t **filter_set);
+
+
+/*************************************************************//**
+ *
+ * \brief Free a filter set created by ::gaus_filter_set_create
+ *
+ * \param[in] filter_set: A strong pointer to the filter set, may be `NULL`.
+ *
+ *************************************************************/
+void gaus_filter_set_free(gaus_filter_set_t *filter_set);
+
 
 /*************************************************************//**
  *
@@ -145,6 +276,9 @@ gaus_error_t *gaus_authenticate(const char *device_access, const char *device_se
  * should always be freed by the caller.
  *
  * \param[in] session: A weak pointer to a session generated by gaus backend during \c ::gaus_authenticate call.
+ *   If the server refuses its token as expired, the device is authenticated again and the check repeated once.  The
+ *   new token is kept by libgaus and sent by later calls for the device (see gaus_session_t::token), session itself is
+ *   left as is.
  * \param[in] filter_count: An integer specifying the number of filters in the filters parameter.
  * \param[in] filters: A weak pointer to an array of filters to be used to build the query string parameters.
  * \param[out] update_count: A strong pointer an int with the number of updates contained in updates.  Caller is
@@ -153,10 +287,11 @@ gaus_error_t *gaus_authenticate(const char *device_access, const char *device_se
  * \param[out] updates: A strong pointer to an array of gaus_update_t updates.  Each of these updates should be
  *   processed by the caller.  \c::gaus_check_for_updates assumes that no memory is currently allocated and will allocate
  *   memory as required to store the updates.  The caller is responsible for freeing both the array of updates, and its
- *   members.
+ *   members, or only calling ::gaus_updates_free with the #GAUS_UPDATE_LAYOUT_ONE_BLOCK
+ *   gaus_initialization_options_t::update_layout.
  *
  * \return gaus_error_t A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
- *   for freeing this memory if non null.
+ *   for releasing it with ::gaus_error_release if non null.
  *
  *************************************************************/
 gaus_error_t *
@@ -164,14 +299,75 @@ gaus_check_for_updates(const gaus_session_t *session, unsigned int filter_count,
                        unsigned int *update_count, gaus_update_t **updates);
 
 
+/*************************************************************//**
+ *
+ * \brief Check Gaus for updates using a compiled filter set
+ *
+ * The same as ::gaus_check_for_updates, with the filters taken from filter_set.
+ *
+ * If the last check with filter_set found no updates, this check is made conditional on the ETag (or Last-Modified)
+ * of that reply.  When the server replies "304 Not Modified" there is nothing to download or parse, update_count is
+ * set to 0 and updates to `NULL`.  Use a filter set without filters (rather than `NULL`) to get this without filters.
+ *
+ * \param[in] filter_set: A weak pointer to a filter set created by ::gaus_filter_set_create, or `NULL` for no filters.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_check_for_updates_with_filter_set(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                       unsigned int *update_count, gaus_update_t **updates);
+
+/*************************************************************//**
+ *
+ * \brief Check Gaus for updates using a compiled filter set, within time limits
+ *
+ * The same as ::gaus_check_for_updates_with_filter_set, bounded by options.
+ *
+ * \param[in] options: A weak pointer to the limits for this call, or `NULL` for those given to ::gaus_global_init.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_check_for_updates_with_options(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                    unsigned int *update_count, gaus_update_t **updates,
+                                    const gaus_call_options_t *options);
+
+/*************************************************************//**
+ *
+ * \brief Check Gaus for updates with a context
+ *
+ * The same as ::gaus_check_for_updates_with_options, calling the server of context.  The updates are laid out as
+ * the gaus_initialization_options_t::update_layout the context was created with.
+ *
+ * \param[in] context: A weak pointer to the context to call, or `NULL` for the one set up by ::gaus_global_init.
+ * \param[in] options: A weak pointer to the limits for this call, or `NULL` for those the context was created
+ *   with.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_context_check_for_updates(gaus_context_t *context, const gaus_session_t *session,
+                               const gaus_filter_set_t *filter_set, unsigned int *update_count, gaus_update_t **updates,
+                               const gaus_call_options_t *options);
+
+/*************************************************************//**
+ *
+ * \brief Free the updates of a check for updates made with the #GAUS_UPDATE_LAYOUT_ONE_BLOCK
+ * gaus_initialization_options_t::update_layout
+ *
+ * \param[in] updates: A strong pointer to the updates, their metadata and strings included, or `NULL`.
+ *
+ *************************************************************/
+void gaus_updates_free(gaus_update_t *updates);
+
+
 /*************************************************************//**
  *
  * \brief Report an update to gaus.
  *
  * This is a synchronous blocking call.  It is used to make a report to the gaus system.
+ * If gaus_initialization_options_t::report_deadband holds back every report nothing is sent.
  *
  * Parameters:
- * \param[in] session: A weak pointer to a \c ::gaus_session_t generated by gaus backend during \c ::gaus_authenticate call.
+ * \param[in] session: A weak pointer to a \c ::gaus_session_t generated by gaus backend during
+ *   \c ::gaus_authenticate call.  Renewed like in ::gaus_check_for_updates if it expired.
  * \param[in] filter_count: An integer specifying the number of filters in the filters parameter.
  * \param[in] filters: A weak pointer to an array of filters to be used to build the query string parameters.
  * \param[in] header: A weak pointer to a \c ::gaus_report_header_t containing the header for this data.
@@ -179,11 +375,486 @@ gaus_check_for_updates(const gaus_session_t *session, unsigned int filter_count,
  *   This is a tagged union and as such both the gaus_report_t::report_type and one of the relevant members.
  *
  * \return gaus_error_t A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
- *   for freeing this memory if non null.
+ *   for releasing it with ::gaus_error_release if non null.
  *************************************************************/
 gaus_error_t *gaus_report(const gaus_session_t *session, unsigned int filter_count, const gaus_header_filter_t *filters,
                           const gaus_report_header_t *header, unsigned int report_count, const gaus_report_t *reports);
 
+/*************************************************************//**
+ *
+ * \brief Report to gaus using a compiled filter set
+ *
+ * The same as ::gaus_report, with the filters taken from filter_set.
+ *
+ * \param[in] filter_set: A weak pointer to a filter set created by ::gaus_filter_set_create, or `NULL` for no filters.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_report_with_filter_set(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                            const gaus_report_header_t *header, unsigned int report_count,
+                            const gaus_report_t *reports);
+
+/*************************************************************//**
+ *
+ * \brief Report to gaus using a compiled filter set, within time limits
+ *
+ * The same as ::gaus_report_with_filter_set, bounded by options.
+ *
+ * \param[in] options: A weak pointer to the limits for this call, or `NULL` for those given to ::gaus_global_init.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_report_with_options(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                         const gaus_report_header_t *header, unsigned int report_count, const gaus_report_t *reports,
+                         const gaus_call_options_t *options);
+
+/*************************************************************//**
+ *
+ * \brief Report to gaus with a context
+ *
+ * The same as ::gaus_report_with_options, calling the server of context in the report format of context.
+ *
+ * \param[in] context: A weak pointer to the context to call, or `NULL` for the one set up by ::gaus_global_init.
+ * \param[in] options: A weak pointer to the limits for this call, or `NULL` for those the context was created
+ *   with.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_context_report(gaus_context_t *context, const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                    const gaus_report_header_t *header, unsigned int report_count, const gaus_report_t *reports,
+                    const gaus_call_options_t *options);
+
+/*************************************************************//**
+ *
+ * \brief Check Gaus for updates without blocking
+ *
+ * Queues the same request as ::gaus_check_for_updates and returns immediately, the request is carried out by
+ * ::gaus_client_poll.  Several asynchronous requests may be in flight at once, sharing connections to the server.
+ *
+ * The asynchronous API is not thread safe: all asynchronous calls, including ::gaus_client_poll, must be made from the
+ * same thread (e.g. the task talking to gaus).  Callbacks are called from within ::gaus_client_poll and may start new
+ * asynchronous requests, but must not call ::gaus_client_poll themselves.
+ *
+ * \param[in] session: A weak pointer to a session generated by gaus backend during \c ::gaus_authenticate call.  It is
+ *   only used during this call, if it expired callback is called with http error 401 (see ::gaus_authenticate).
+ * \param[in] filter_count: An integer specifying the number of filters in the filters parameter.
+ * \param[in] filters: A weak pointer to an array of filters to be used to build the query string parameters.
+ * \param[in] callback: Called exactly once with the result if this call returns `NULL`.
+ * \param[in] user_data: Passed as is to callback.
+ *
+ * \return gaus_error_t A strong pointer to an error describing why the request could not be started, or `NULL`.  The
+ *   callback is not called if non null, the caller is responsible for releasing it with ::gaus_error_release.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_check_for_updates_async(const gaus_session_t *session, unsigned int filter_count,
+                             const gaus_header_filter_t *filters, gaus_check_for_updates_callback_t callback,
+                             void *user_data);
+
+/*************************************************************//**
+ *
+ * \brief Check Gaus for updates using a compiled filter set without blocking
+ *
+ * The same as ::gaus_check_for_updates_async, with the filters taken from filter_set.
+ *
+ * \param[in] filter_set: A weak pointer to a filter set created by ::gaus_filter_set_create, or `NULL` for no filters.
+ *   It is only used during this call.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_check_for_updates_with_filter_set_async(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                             gaus_check_for_updates_callback_t callback, void *user_data);
+
+/*************************************************************//**
+ *
+ * \brief Report to gaus without blocking
+ *
+ * Queues the same request as ::gaus_report and returns immediately, the request is carried out by ::gaus_client_poll.
+ * See ::gaus_check_for_updates_async for the threading rules of the asynchronous API.
+ * If gaus_initialization_options_t::report_deadband holds back every report nothing is sent, and callback is called
+ * with `NULL` before this returns.
+ *
+ * Parameters:
+ * \param[in] session: A weak pointer to a \c ::gaus_session_t generated by gaus backend during
+ *   \c ::gaus_authenticate call.  It is only used during this call, if it expired callback is called with http error
+ *   401.
+ * \param[in] filter_count: An integer specifying the number of filters in the filters parameter.
+ * \param[in] filters: A weak pointer to an array of filters to be used to build the query string parameters.
+ * \param[in] header: A weak pointer to a \c ::gaus_report_header_t containing the header for this data.
+ * \param[in] reports: A weak pointer to an array of \c ::gaus_report_ts containing the data that you wish to report.
+ *   The reports are encoded during this call, so they may be freed as soon as it returns.
+ * \param[in] callback: Called exactly once with the result if this call returns `NULL`.
+ * \param[in] user_data: Passed as is to callback.
+ *
+ * \return gaus_error_t A strong pointer to an error describing why the request could not be started, or `NULL`.  The
+ *   callback is not called if non null, the caller is responsible for releasing it with ::gaus_error_release.
+ *************************************************************/
+gaus_error_t *
+gaus_report_async(const gaus_session_t *session, unsigned int filter_count, const gaus_header_filter_t *filters,
+                  const gaus_report_header_t *header, unsigned int report_count, const gaus_report_t *reports,
+                  gaus_report_callback_t callback, void *user_data);
+
+/*************************************************************//**
+ *
+ * \brief Report to gaus using a compiled filter set without blocking
+ *
+ * The same as ::gaus_report_async, with the filters taken from filter_set.
+ *
+ * \param[in] filter_set: A weak pointer to a filter set created by ::gaus_filter_set_create, or `NULL` for no filters.
+ *   It is only used during this call.
+ *
+ *************************************************************/
+gaus_error_t *
+gaus_report_with_filter_set_async(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                  const gaus_report_header_t *header, unsigned int report_count,
+                                  const gaus_report_t *reports, gaus_report_callback_t callback, void *user_data);
+
+/*************************************************************//**
+ *
+ * \brief Report to gaus as part of a batch
+ *
+ * Adds reports to a batch held in memory instead of sending them right away.  The batch is sent as a single report
+ * (see ::gaus_report_async) once it reaches gaus_report_batch_options_t::max_bytes or
+ * gaus_report_batch_options_t::max_reports, or by ::gaus_client_poll once its first report is
+ * gaus_report_batch_options_t::max_age_ms old.  Sending many small reports together saves a request per report,
+ * keeping the radio off for longer.  The batch is sent with the header given along with its first report, while the
+ * reports keep their own timestamps.
+ *
+ * Reports for another session or filter set start a new batch, sending the one collected so far.  If a batch fails
+ * for any reason but the server refusing it for good (a 4xx status other than 401, 408 and 429), or is still held
+ * when ::gaus_global_cleanup is called, its reports are moved to the queue of ::gaus_report_queue_push when there is
+ * one.  Otherwise they are lost, which is logged.
+ *
+ * Batches are sent like the other asynchronous calls, so this must be called from the thread calling
+ * ::gaus_client_poll.
+ *
+ * \param[in] session: A weak pointer to the session to report for, only used during this call.
+ * \param[in] filter_set: A weak pointer to the filters to send with the batch, or `NULL`.  Only used during this call.
+ * \param[in] header: A weak pointer to the header to send with the batch if these are its first reports.
+ * \param[in] report_count: The number of reports in reports.
+ * \param[in] reports: A weak pointer to an array of \c ::gaus_report_ts to add, encoded right away.
+ *
+ * \return gaus_error_t A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
+ *   for releasing it with ::gaus_error_release if non null.  Reports before the one that failed are added.
+ *
+ *************************************************************/
+gaus_error_t *gaus_report_enqueue(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                  const gaus_report_header_t *header, unsigned int report_count,
+                                  const gaus_report_t *reports);
+
+/*************************************************************//**
+ *
+ * \brief Send the batch collected by ::gaus_report_enqueue now
+ *
+ * E.g. before going to deep sleep.  The batch is sent asynchronously, carried out by ::gaus_client_poll.  Does nothing
+ * if no reports are held.
+ *
+ * \return gaus_error_t A strong pointer to an error describing why the batch could not be started, or `NULL`.  The
+ *   caller is responsible for releasing it with ::gaus_error_release if non null.
+ *
+ *************************************************************/
+gaus_error_t *gaus_report_flush(void);
+
+/*************************************************************//**
+ *
+ * \brief Queue reports in the gaus_initialization_options_t::report_queue_store until ::gaus_report_queue_drain
+ * sends them
+ *
+ * Unlike ::gaus_report, nothing is sent yet and reports are kept through network outages and restarts.  Every report
+ * keeps its own gaus_report_event_generic_t::ts (or that of its other type), so when it was made is not lost.  Once
+ * the queue is full, the oldest reports are dropped to make room.
+ *
+ * \param[in] report_count: The number of reports in reports.
+ * \param[in] reports: A weak pointer to an array of \c ::gaus_report_ts to queue, encoded right away.
+ *
+ * \return gaus_error_t A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
+ *   for releasing it with ::gaus_error_release if non null.  Reports before the one that failed are queued.
+ *
+ *************************************************************/
+gaus_error_t *gaus_report_queue_push(unsigned int report_count, const gaus_report_t *reports);
+
+/*************************************************************//**
+ *
+ * \brief Start sending the oldest queued reports as one batch
+ *
+ * Starts an asynchronous report (see ::gaus_report_async) holding as many of the oldest queued reports as options
+ * allow, carried out by ::gaus_client_poll.  Reports are removed from the queue once the server accepted them, or
+ * refused them for good (a 4xx status other than 401, 408 and 429).  After any other failure they are sent again.
+ *
+ * Does nothing while a batch is in flight, the queue is empty, the rate limit of options has not let enough time pass
+ * or a failed batch is being waited out, so it is meant to be called regularly, e.g. next to ::gaus_client_poll.
+ * Reports are only removed once the reply arrived, so a restart in between sends them again.
+ *
+ * \param[in] session: A weak pointer to the session to report for.
+ * \param[in] filter_set: A weak pointer to the filters to send with the batch, or NULL.
+ * \param[in] header: A weak pointer to the header of the batch.
+ * \param[in] options: A weak pointer to how to send, or NULL for batches of
+ *   #GAUS_REPORT_QUEUE_DEFAULT_BATCH_BYTES without limits.
+ *
+ * \return gaus_error_t A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
+ *   for releasing it with ::gaus_error_release if non null.
+ *
+ *************************************************************/
+gaus_error_t *gaus_report_queue_drain(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                      const gaus_report_header_t *header,
+                                      const gaus_report_queue_drain_options_t *options);
+
+/*************************************************************//**
+ *
+ * \brief Get counters describing the report queue
+ *
+ * \return gaus_report_queue_stats_t: The state of the queue and what happened to reports since ::gaus_global_init.
+ *
+ *************************************************************/
+gaus_report_queue_stats_t gaus_get_report_queue_stats(void);
+
+/*************************************************************//**
+ *
+ * \brief Start building reports in a single arena
+ *
+ * Rather than allocating each name, value and array of a report, copy them into the arena with
+ * ::gaus_report_builder_begin and friends, get the reports with ::gaus_report_builder_finish and pass them to
+ * ::gaus_report or any other report call.  ::gaus_report_builder_reset then frees them all at once, so the heap is not
+ * fragmented by the small allocations of every report.
+ *
+ * A call that does not fit in the arena, or is invalid, fails the builder and the calls after it are ignored until it
+ * is reset.  Only ::gaus_report_builder_finish then returns an error, so the calls in between need no checks.
+ *
+ * \param[out] builder: A weak pointer to the builder to start.
+ * \param[in] arena: A weak pointer to the arena of size bytes, which must outlive the builder.  `NULL` to allocate it
+ *   once here, to be reused by every reset until ::gaus_report_builder_free.
+ * \param[in] size: The size of the arena in bytes.
+ *
+ * \return gaus_error_t A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
+ *   for releasing it with ::gaus_error_release if non null.
+ *
+ *************************************************************/
+gaus_error_t *gaus_report_builder_init(gaus_report_builder_t *builder, void *arena, size_t size);
+
+/*************************************************************//**
+ *
+ * \brief Set the header of the reports to a copy of ts
+ *
+ *************************************************************/
+void gaus_report_builder_header(gaus_report_builder_t *builder, const char *ts);
+
+/*************************************************************//**
+ *
+ * \brief Add a report with room for the given number of values
+ *
+ * The values are then added in order by ::gaus_report_builder_int, ::gaus_report_builder_float and
+ * ::gaus_report_builder_string.  Only ::GAUS_REPORT_GENERIC and ::GAUS_REPORT_UPDATE reports can be built, as these
+ * are the ones gaus accepts.
+ *
+ * \param[in,out] builder: A weak pointer to the builder.
+ * \param[in] report_type: The type of report.
+ * \param[in] type: The null terminated type of the report, e.g. "Temperature", copied into the arena.
+ * \param[in] ts: The null terminated timestamp of the report, copied into the arena.
+ * \param[in] v_int_count: The most v_ints the report may hold.
+ * \param[in] v_float_count: The most v_floats the report may hold.
+ * \param[in] v_string_count: The most v_strings the report may hold.
+ *
+ *************************************************************/
+void gaus_report_builder_begin(gaus_report_builder_t *builder, gaus_report_type_t report_type, const char *type,
+                               const char *ts, unsigned int v_int_count, unsigned int v_float_count,
+                               unsigned int v_string_count);
+
+/*************************************************************//**
+ *
+ * \brief Add a v_int to the last report begun, copying its name
+ *
+ *************************************************************/
+void gaus_report_builder_int(gaus_report_builder_t *builder, const char *name, int value);
+
+/*************************************************************//**
+ *
+ * \brief Add a v_float to the last report begun, copying its name
+ *
+ *************************************************************/
+void gaus_report_builder_float(gaus_report_builder_t *builder, const char *name, float value);
+
+/*************************************************************//**
+ *
+ * \brief Add a v_string to the last report begun, copying its name and value
+ *
+ *************************************************************/
+void gaus_report_builder_string(gaus_report_builder_t *builder, const char *name, const char *value);
+
+/*************************************************************//**
+ *
+ * \brief Get the reports built
+ *
+ * \param[in] builder: A weak pointer to the builder.
+ * \param[out] header: Set to a weak pointer to the header, valid until the builder is reset.
+ * \param[out] report_count: Set to the number of reports.
+ * \param[out] reports: Set to a weak pointer to the array of reports, valid until the builder is reset.
+ *
+ * \return gaus_error_t A strong pointer to an error describing why building failed, or `NULL`.  The caller is
+ *   responsible for releasing it with ::gaus_error_release if non null.
+ *
+ *************************************************************/
+gaus_error_t *gaus_report_builder_finish(const gaus_report_builder_t *builder, const gaus_report_header_t **header,
+                                         unsigned int *report_count, const gaus_report_t **reports);
+
+/*************************************************************//**
+ *
+ * \brief Release all reports built, keeping the arena to build the next ones
+ *
+ *************************************************************/
+void gaus_report_builder_reset(gaus_report_builder_t *builder);
+
+/*************************************************************//**
+ *
+ * \brief Free the arena allocated by ::gaus_report_builder_init, if any
+ *
+ *************************************************************/
+void gaus_report_builder_free(gaus_report_builder_t *builder);
+
+/*************************************************************//**
+ *
+ * \brief Carry out pending asynchronous requests
+ *
+ * Makes progress on all requests started by the asynchronous calls, waiting at most timeout_ms for network activity,
+ * and calls the callbacks of the requests that finished.  Call it regularly (e.g. from the main loop of the task
+ * talking to gaus) for as long as requests are pending.  A timeout_ms of 0 never blocks.
+ *
+ * Requests still pending when ::gaus_global_cleanup is called have their callbacks called with an error.  A batch of
+ * ::gaus_report_enqueue that reached its age is sent first, the batch still being collected does not count as pending.
+ *
+ * \param[in] timeout_ms: The longest time to wait for network activity, in milliseconds.
+ * \param[out] pending: If not NULL, set to the number of requests still in flight after this call.
+ *
+ * \return gaus_error_t A strong pointer to an error describing what went wrong, or `NULL`.  The caller is responsible
+ *   for releasing it with ::gaus_error_release if non null.
+ *
+ *************************************************************/
+gaus_error_t *gaus_client_poll(int timeout_ms, unsigned int *pending);
+
+/*************************************************************//**
+ *
+ * \brief Get counters describing TLS handshakes made with the gaus server
+ *
+ * Can be used to see how often a full handshake was avoided by resuming a session persisted by the
+ * gaus_initialization_options_t::tls_session_store.  Counters are reset by ::gaus_global_init.
+ *
+ * \return gaus_tls_session_stats_t: The handshake counters since ::gaus_global_init.
+ *
+ *************************************************************/
+gaus_tls_session_stats_t gaus_get_tls_session_stats(void);
+
+/*************************************************************//**
+ *
+ * \brief Get timing and transfer statistics of the requests made to the gaus server
+ *
+ * Tells DNS, connect, TLS and server latency apart for each endpoint, e.g. to be sent in a report to gaus.  Statistics
+ * are reset by ::gaus_global_init.
+ *
+ * \return gaus_stats_t: The statistics since ::gaus_global_init.
+ *
+ *************************************************************/
+gaus_stats_t gaus_get_stats(void);
+
+/*************************************************************//**
+ *
+ * \brief Get the name of an endpoint, e.g. "check-for-updates"
+ *
+ * \param[in] endpoint: The endpoint.
+ *
+ * \return const char*: A weak pointer to a null terminated name, or `NULL` if endpoint is not a ::gaus_endpoint_t.
+ *
+ *************************************************************/
+const char *gaus_endpoint_name(gaus_endpoint_t endpoint);
+
+/*************************************************************//**
+ *
+ * \brief Get a random wait before retrying something that failed, following policy
+ *
+ * The wait libgaus itself makes between attempts of a request (see ::gaus_retry_policy_t).  Use it to spread out
+ * retries of whole tasks, such as reconnecting to gaus after an outage, across a fleet of devices.
+ *
+ * \param[in] policy: A weak pointer to the policy to follow.
+ * \param[in] failures: How many times in a row the task failed so far, at least 1.
+ *
+ * \return unsigned long: The time to wait in milliseconds, between 0 and `policy->base_delay_ms * 2^(failures - 1)`
+ *   (at most `policy->max_delay_ms`).
+ *
+ *************************************************************/
+unsigned long gaus_retry_delay_ms(const gaus_retry_policy_t *policy, unsigned int failures);
+
+/*************************************************************//**
+ *
+ * \brief Get the current time as a report timestamp, with milliseconds
+ *
+ * Formats the wall clock as ISO 8601 in UTC, e.g. "2018-11-15T12:00:22.123Z", as the ts of reports and their headers
+ * expect.  The time is taken from the monotonic clock plus its offset from the wall clock, which is sampled again
+ * every minute so setting the wall clock (e.g. by SNTP) is followed.  Only the digits that changed since the last
+ * call are formatted, the date once an hour, so this is cheap enough to call for every sample.  Can be called
+ * without ::gaus_global_init and from any thread.
+ *
+ * \param[out] buffer: A weak pointer to at least #GAUS_TIMESTAMP_SIZE bytes, set to the null terminated timestamp.
+ *
+ *************************************************************/
+void gaus_timestamp(char *buffer);
+
+/*************************************************************//**
+ *
+ * \brief Release an error returned by a gaus_* call or passed to a callback
+ *
+ * Errors are taken from a small fixed pool when their description fits, so raising one does not touch the heap,
+ * and only come from the heap once the pool is exhausted.  If not even the heap has room, a shared error describing
+ * that is returned instead.  Errors must therefore be released with this function rather than free.  Can be called
+ * without ::gaus_global_init and from any thread.
+ *
+ * \param[in] error: A strong pointer to the error to release, or `NULL` which is ignored.
+ *
+ *************************************************************/
+void gaus_error_release(gaus_error_t *error);
+
+/*************************************************************//**
+ *
+ * \brief A gaus_tls_session_store_t::load implementation reading the session from a file
+ *
+ * Use together with ::gaus_tls_session_file_save, setting gaus_tls_session_store_t::user_data to a null terminated
+ * path of the file to use.
+ *
+ *************************************************************/
+int gaus_tls_session_file_load(void *path, unsigned char *buffer, size_t *length);
+
+/*************************************************************//**
+ *
+ * \brief A gaus_tls_session_store_t::save implementation writing the session to a file
+ *
+ * Use together with ::gaus_tls_session_file_load, setting gaus_tls_session_store_t::user_data to a null terminated
+ * path of the file to use.
+ *
+ *************************************************************/
+int gaus_tls_session_file_save(void *path, const unsigned char *buffer, size_t length);
+
+/*************************************************************//**
+ *
+ * \brief A gaus_report_queue_store_t::read implementation reading from a file
+ *
+ * Use together with ::gaus_report_queue_file_write and ::gaus_report_queue_file_erase, setting
+ * gaus_report_queue_store_t::user_data to a null terminated path of the file to use.  The file is created as needed,
+ * what lies beyond its end reads as erased.
+ *
+ *************************************************************/
+int gaus_report_queue_file_read(void *path, size_t offset, unsigned char *buffer, size_t length);
+
+/*************************************************************//**
+ *
+ * \brief A gaus_report_queue_store_t::write implementation writing to a file, see ::gaus_report_queue_file_read
+ *
+ *************************************************************/
+int gaus_report_queue_file_write(void *path, size_t offset, const unsigned char *buffer, size_t length);
+
+/*************************************************************//**
+ *
+ * \brief A gaus_report_queue_store_t::erase implementation filling a file with 0xFF, see ::gaus_report_queue_file_read
+ *
+ *************************************************************/
+int gaus_report_queue_file_erase(void *path, size_t offset, size_t length);
+
 /*************************************************************//**
  *
  * \brief Cleanup the gaus library
@@ -10,6 +10,8 @@
 #ifndef UPDATE_CLIENT_C_GAUS_CLIENT_RESPONSE_TYPES_H
 #define UPDATE_CLIENT_C_GAUS_CLIENT_RESPONSE_TYPES_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -275,6 +277,35 @@ typedef struct {
   char *ts;
 } gaus_report_header_t;
 
+/*************************************************************//**
+ *
+ * \brief The size of a timestamp made by ::gaus_timestamp, e.g. "2018-11-15T12:00:22.123Z", with its null.
+ *
+ *************************************************************/
+#define GAUS_TIMESTAMP_SIZE 25
+
+/*************************************************************//**
+ *
+ * \brief Reports laid out in a single arena, see ::gaus_report_builder_init.
+ *
+ * The reports are packed from the start of the arena, their values and strings from its end, so building them takes
+ * no allocations and ::gaus_report_builder_reset releases them all at once.  Its members are private to the builder.
+ *
+ *************************************************************/
+typedef struct {
+  char *arena;                 //!< The arena
+  size_t size;                 //!< The size of the arena in bytes
+  int owned;                   //!< Non-zero if the arena was allocated by ::gaus_report_builder_init
+  gaus_report_t *reports;      //!< The reports begun, at the start of the arena
+  unsigned int report_count;   //!< The number of reports begun
+  char *values;                //!< Start of the values and strings, which grow down from the end of the arena
+  unsigned int v_int_room;     //!< How many more v_ints the last report begun has room for
+  unsigned int v_float_room;   //!< How many more v_floats the last report begun has room for
+  unsigned int v_string_room;  //!< How many more v_strings the last report begun has room for
+  gaus_report_header_t header; //!< The header, with its ts in the arena
+  const char *failure;         //!< Why building failed, `NULL` while it did not
+} gaus_report_builder_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,6 +10,8 @@
 #ifndef UPDATE_CLIENT_C_GAUS_CLIENT_TYPES_H
 #define UPDATE_CLIENT_C_GAUS_CLIENT_TYPES_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -36,13 +38,24 @@ typedef enum {
   /*!
    * An unknown error occurred while attempting to process your request.  Check gaus_error_t::description for details.
    */
-      GAUS_UNKNOWN_ERROR  //!<
+      GAUS_UNKNOWN_ERROR,
+  /*!
+   * The call did not complete within gaus_call_options_t::timeout_ms, or no connection to the server could be made
+   * within gaus_call_options_t::connect_timeout_ms.
+   */
+      GAUS_TIMEOUT_ERROR,
+  /*!
+   * The call was cancelled through its gaus_call_options_t::cancel token.
+   */
+      GAUS_CANCELLED_ERROR
 } gaus_error_type_t;
 
 /*************************************************************//**
  *
  * \brief The error type returned to all gaus_* calls return in the event of an error.
  *
+ * Errors must be released with ::gaus_error_release, never freed.
+ *
  *************************************************************/
 typedef struct {
   /*!
@@ -66,6 +79,413 @@ typedef struct {
 } gaus_error_t;
 
 
+/*************************************************************//**
+ *
+ * \brief The largest serialized TLS session that will be handed to a gaus_tls_session_store_t.
+ *
+ *************************************************************/
+#define GAUS_TLS_SESSION_MAX_SIZE 128
+
+/*************************************************************//**
+ *
+ * \brief A pluggable store used to persist the negotiated TLS session between restarts.
+ *
+ * After a successful handshake with the gaus server the negotiated session is serialized and handed to
+ * gaus_tls_session_store_t::save.  On the first connection after ::gaus_global_init the session is read back with
+ * gaus_tls_session_store_t::load and offered to the server so that a full handshake can be avoided.
+ *
+ * The serialized session contains the session master secret, so the store should be protected accordingly (for
+ * example by using encrypted NVS on ESP32).
+ *
+ * Session export and resumption is only supported when libgaus is built against mbedTLS (`GAUS_USE_MBEDTLS`), with
+ * other TLS backends the store is never called.
+ *
+ *************************************************************/
+typedef struct {
+  /*!
+   * A weak pointer passed as is to gaus_tls_session_store_t::load and gaus_tls_session_store_t::save.
+   * */
+  void *user_data;
+  /*!
+   * Read a previously saved session into buffer.  On entry *length holds the size of buffer, on success it must be set
+   * to the number of bytes read.  Return 0 on success, anything else if no session is available.
+   * */
+  int (*load)(void *user_data, unsigned char *buffer, size_t *length);
+  /*!
+   * Persist length bytes of buffer, replacing any previously saved session.  Return 0 on success.
+   * */
+  int (*save)(void *user_data, const unsigned char *buffer, size_t length);
+} gaus_tls_session_store_t;
+
+/*************************************************************//**
+ *
+ * \brief How long the address of the gaus server is trusted once resolved, unless set by
+ * gaus_initialization_options_t::dns_ttl_s.
+ *
+ *************************************************************/
+#define GAUS_DNS_CACHE_DEFAULT_TTL_S 300
+
+/*************************************************************//**
+ *
+ * \brief The largest serialized address that will be handed to a gaus_dns_cache_store_t.
+ *
+ *************************************************************/
+#define GAUS_DNS_CACHE_MAX_SIZE 128
+
+/*************************************************************//**
+ *
+ * \brief A pluggable store used to persist the resolved address of the gaus server between restarts.
+ *
+ * Each time the host name of the gaus server is resolved, the address is serialized together with its expiry and
+ * handed to gaus_dns_cache_store_t::save.  ::gaus_global_init reads it back with gaus_dns_cache_store_t::load, so the
+ * first request after a restart can connect without waiting for DNS while the address has not expired.
+ *
+ * The expiry is kept in wall clock time, so the clock should be set (e.g. by SNTP) before ::gaus_global_init.
+ *
+ *************************************************************/
+typedef struct {
+  /*!
+   * A weak pointer passed as is to gaus_dns_cache_store_t::load and gaus_dns_cache_store_t::save.
+   * */
+  void *user_data;
+  /*!
+   * Read a previously saved address into buffer.  On entry *length holds the size of buffer, on success it must be set
+   * to the number of bytes read.  Return 0 on success, anything else if no address is available.
+   * */
+  int (*load)(void *user_data, unsigned char *buffer, size_t *length);
+  /*!
+   * Persist length bytes of buffer, replacing any previously saved address.  Return 0 on success.
+   * */
+  int (*save)(void *user_data, const unsigned char *buffer, size_t length);
+} gaus_dns_cache_store_t;
+
+/*************************************************************//**
+ *
+ * \brief Counters describing how TLS handshakes with the gaus server were made, see ::gaus_get_tls_session_stats.
+ *
+ *************************************************************/
+typedef struct {
+  unsigned int handshakes; //!< The number of new TLS connections made to the gaus server
+  unsigned int resumed;    //!< The number of those handshakes that resumed a previous session
+} gaus_tls_session_stats_t;
+
+/*************************************************************//**
+ *
+ * \brief The gaus server endpoints requests are counted for in ::gaus_stats_t.
+ *
+ *************************************************************/
+typedef enum {
+  GAUS_ENDPOINT_REGISTER = 0,      //!< Requests made by ::gaus_register
+  GAUS_ENDPOINT_AUTHENTICATE,      //!< Requests made by ::gaus_authenticate
+  GAUS_ENDPOINT_CHECK_FOR_UPDATES, //!< Requests made by ::gaus_check_for_updates and its variants
+  GAUS_ENDPOINT_REPORT,            //!< Requests made by ::gaus_report and its variants
+  GAUS_ENDPOINT_OTHER,             //!< Any other request, e.g. downloading an update
+  GAUS_ENDPOINT_COUNT              //!< The number of endpoints, not an endpoint itself
+} gaus_endpoint_t;
+
+/*************************************************************//**
+ *
+ * \brief Summary of one measurement over the most recent requests to an endpoint, see ::gaus_endpoint_stats_t.
+ *
+ *************************************************************/
+typedef struct {
+  unsigned long min;  //!< The smallest value
+  unsigned long max;  //!< The largest value
+  unsigned long mean; //!< The mean value, rounded down
+  unsigned long p95;  //!< The 95th percentile (nearest rank)
+} gaus_stat_summary_t;
+
+/*************************************************************//**
+ *
+ * \brief Timing and transfer statistics for requests to one endpoint, see ::gaus_get_stats.
+ *
+ * count and failures cover all requests since ::gaus_global_init.  The summaries only cover the most recent requests
+ * that got a reply (at most `GAUS_STATS_WINDOW` of them, 32 unless defined otherwise when building libgaus) and are
+ * all 0 if there are none.  Times are measured by curl from the start of the request, in microseconds, so they add
+ * up: name_lookup_us <= connect_us <= tls_connect_us <= start_transfer_us <= total_us.  A reused connection has a
+ * connect and tls_connect time of 0.
+ *
+ *************************************************************/
+typedef struct {
+  unsigned int count;                     //!< The number of requests made
+  unsigned int failures;                  //!< The number of those requests that got no reply, e.g. timed out
+  gaus_stat_summary_t name_lookup_us;     //!< Time until the DNS lookup completed
+  gaus_stat_summary_t connect_us;         //!< Time until the TCP connection was made
+  gaus_stat_summary_t tls_connect_us;     //!< Time until the TLS handshake completed
+  gaus_stat_summary_t start_transfer_us;  //!< Time until the first byte of the reply arrived
+  gaus_stat_summary_t total_us;           //!< Time until the request completed
+  gaus_stat_summary_t bytes_up;           //!< Bytes sent, excluding headers
+  gaus_stat_summary_t bytes_down;         //!< Bytes received, excluding headers
+} gaus_endpoint_stats_t;
+
+/*************************************************************//**
+ *
+ * \brief Timing and transfer statistics for each endpoint, see ::gaus_get_stats.
+ *
+ *************************************************************/
+typedef struct {
+  gaus_endpoint_stats_t endpoints[GAUS_ENDPOINT_COUNT]; //!< Statistics indexed by ::gaus_endpoint_t
+} gaus_stats_t;
+
+/*************************************************************//**
+ *
+ * \brief A token to cancel calls from another thread, see gaus_call_options_t::cancel.
+ *
+ *************************************************************/
+typedef struct {
+  /*!
+   * Set to non-zero to make every call using this token give up with ::GAUS_CANCELLED_ERROR.  A call notices this
+   * within about a second.  Set it back to 0 before reusing the token.
+   * */
+  volatile int cancelled;
+} gaus_cancel_token_t;
+
+/*************************************************************//**
+ *
+ * \brief How a call repeats requests that failed for a reason that may pass, see gaus_call_options_t::retry.
+ *
+ * Requests are only repeated if doing so is harmless, that is when checking for updates.  Transport errors (no
+ * connection, connection reset, ...) and replies with status 408, 429 or 5xx are retried, any other failure is not.
+ *
+ * Before attempt n + 1 the call waits a random time between 0 and `base_delay_ms * 2^(n - 1)` (capped at
+ * `max_delay_ms`), on top of the time the server asked for in a Retry-After header.  The randomness keeps devices
+ * that failed at the same time from all retrying at the same time.  The call gives up early rather than waiting past
+ * its deadline, or if the server asks for a wait longer than `max_delay_ms`.
+ *
+ *************************************************************/
+typedef struct {
+  unsigned int max_attempts;   //!< Attempts per request including the first, 0 or 1 to not retry
+  unsigned long base_delay_ms; //!< The longest wait before the first retry
+  unsigned long max_delay_ms;  //!< The longest wait before any retry, 0 for no limit
+} gaus_retry_policy_t;
+
+/*************************************************************//**
+ *
+ * \brief Limits on how long a single call may block, see the `*_with_options` calls.
+ *
+ * A call running out of time fails with ::GAUS_TIMEOUT_ERROR.  All timeouts are in milliseconds, 0 means no limit
+ * other than the defaults of curl.
+ *
+ *************************************************************/
+typedef struct {
+  /*!
+   * The longest time to wait for a new connection (including the TLS handshake) to the server.
+   * */
+  unsigned long connect_timeout_ms;
+  /*!
+   * The longest time the call may take as a whole, its deadline.
+   * */
+  unsigned long timeout_ms;
+  /*!
+   * A weak pointer to a token to cancel the call with, or NULL.  It must stay valid until the call returns.
+   * */
+  const gaus_cancel_token_t *cancel;
+  /*!
+   * How failed requests are retried within the limits above, all 0 to not retry.
+   * */
+  gaus_retry_policy_t retry;
+} gaus_call_options_t;
+
+/*************************************************************//**
+ *
+ * \brief The most a batch sent by ::gaus_report_queue_drain holds, unless set by
+ * gaus_report_queue_drain_options_t::batch_bytes.
+ *
+ *************************************************************/
+#define GAUS_REPORT_QUEUE_DEFAULT_BATCH_BYTES 16384
+
+/*************************************************************//**
+ *
+ * \brief Storage for the reports queued by ::gaus_report_queue_push, so they survive being offline and restarts.
+ *
+ * The store is size bytes of memory that behaves like NOR flash: it is split into sectors of sector_size bytes that
+ * are erased as a whole, setting every byte to 0xFF, and writes only ever clear bits of erased bytes.  A flash
+ * partition can be used as is, a file may be used through ::gaus_report_queue_file_read and friends.  The queue is a
+ * ring over the sectors, so once it is full the oldest sector of reports is dropped to make room for new ones.  A
+ * single report must fit in a sector.
+ *
+ * All offsets are relative to the start of the store.  Every function returns 0 on success.
+ *
+ *************************************************************/
+typedef struct {
+  /*!
+   * A weak pointer passed as is to the functions of the store.
+   * */
+  void *user_data;
+  /*!
+   * The size of the store in bytes, a multiple of sector_size holding at least two sectors.
+   * */
+  size_t size;
+  /*!
+   * The size of an erasable sector in bytes, e.g. 4096 for the flash of an ESP32.
+   * */
+  size_t sector_size;
+  /*!
+   * Read length bytes at offset into buffer.
+   * */
+  int (*read)(void *user_data, size_t offset, unsigned char *buffer, size_t length);
+  /*!
+   * Write length bytes of buffer at offset.  Only called for bytes that are erased, or to clear more of their bits.
+   * */
+  int (*write)(void *user_data, size_t offset, const unsigned char *buffer, size_t length);
+  /*!
+   * Erase the length bytes at offset, both multiples of sector_size.
+   * */
+  int (*erase)(void *user_data, size_t offset, size_t length);
+} gaus_report_queue_store_t;
+
+/*************************************************************//**
+ *
+ * \brief How ::gaus_report_queue_drain uploads queued reports.
+ *
+ *************************************************************/
+typedef struct {
+  /*!
+   * The most bytes a batch may hold, 0 for #GAUS_REPORT_QUEUE_DEFAULT_BATCH_BYTES.  A report that is larger on its own
+   * is sent by itself.
+   * */
+  size_t batch_bytes;
+  /*!
+   * The average upload rate to stay below in bytes per second, 0 for no limit.  Up to batch_bytes may be sent at once,
+   * so a backlog is sent a batch at a time with pauses in between, leaving the link to other requests.
+   * */
+  unsigned long bytes_per_s;
+  /*!
+   * How long to wait before sending again after a batch failed, only the delays are used.  All 0 to try again on the
+   * next call.
+   * */
+  gaus_retry_policy_t retry;
+} gaus_report_queue_drain_options_t;
+
+/*************************************************************//**
+ *
+ * \brief Counters describing the report queue, see ::gaus_get_report_queue_stats.
+ *
+ *************************************************************/
+typedef struct {
+  unsigned int pending;         //!< Reports queued and not sent yet
+  unsigned long queued;         //!< Reports queued since ::gaus_global_init
+  unsigned long sent;           //!< Reports the server accepted since ::gaus_global_init
+  unsigned long dropped;        //!< Reports dropped unsent to make room since ::gaus_global_init
+  unsigned long rejected;       //!< Reports dropped since ::gaus_global_init because the server refused them
+  unsigned long batches;        //!< Batches the server accepted since ::gaus_global_init
+  unsigned long failed_batches; //!< Batches that failed and will be sent again since ::gaus_global_init
+} gaus_report_queue_stats_t;
+
+/*************************************************************//**
+ *
+ * \brief The most bytes a batch of ::gaus_report_enqueue holds, unless set by gaus_report_batch_options_t::max_bytes.
+ *
+ *************************************************************/
+#define GAUS_REPORT_BATCH_DEFAULT_BYTES 8192
+
+/*************************************************************//**
+ *
+ * \brief How long a batch of ::gaus_report_enqueue is held, unless set by gaus_report_batch_options_t::max_age_ms.
+ *
+ *************************************************************/
+#define GAUS_REPORT_BATCH_DEFAULT_AGE_MS 60000
+
+/*************************************************************//**
+ *
+ * \brief When a batch of reports collected by ::gaus_report_enqueue is sent.
+ *
+ * A batch is sent as soon as any limit is reached, so every report waits at most max_age_ms.
+ *
+ *************************************************************/
+typedef struct {
+  /*!
+   * The most bytes the body of a batch may hold, 0 for #GAUS_REPORT_BATCH_DEFAULT_BYTES.  A report that is larger on
+   * its own is sent by itself.
+   * */
+  size_t max_bytes;
+  /*!
+   * The most reports a batch may hold, 0 for no limit beyond max_bytes.
+   * */
+  unsigned int max_reports;
+  /*!
+   * How long the first report of a batch may wait before the batch is sent by ::gaus_client_poll, in milliseconds.
+   * 0 for #GAUS_REPORT_BATCH_DEFAULT_AGE_MS.
+   * */
+  unsigned long max_age_ms;
+} gaus_report_batch_options_t;
+
+/*************************************************************//**
+ *
+ * \brief The encoding of the report bodies sent by ::gaus_report and ::gaus_report_async.
+ *
+ *************************************************************/
+typedef enum {
+  /*!
+   * application/json, understood by every server.
+   */
+      GAUS_REPORT_FORMAT_JSON = 0,
+  /*!
+   * application/cbor (RFC 7049), the same version/header/data structure in a smaller body that takes less time to
+   * encode.  Only for servers that accept it: once the server replies 415 Unsupported Media Type all reports are sent
+   * as json until ::gaus_global_cleanup.  Batches of ::gaus_report_enqueue and the report queue are always sent as
+   * json.
+   */
+      GAUS_REPORT_FORMAT_CBOR
+} gaus_report_format_t;
+
+/*************************************************************//**
+ *
+ * \brief When a value of generic reports is sent, see gaus_report_deadband_options_t.
+ *
+ * The value called name in the v_floats of generic reports of type is only sent when it moved by deadband from the
+ * value last sent, or once heartbeat_ms passed since it was last sent.  The first value is always sent.
+ *
+ *************************************************************/
+typedef struct {
+  const char *type;           //!< The gaus_report_event_generic_t::type of the reports, e.g. "Temperature"
+  const char *name;           //!< The name of the value among their v_floats, e.g. "temperature"
+  float deadband;             //!< How far the value must move to be sent, 0 to send every change
+  unsigned long heartbeat_ms; //!< Longest time an unchanged value is held back, 0 to hold it back for good
+  /*!
+   * Non-zero to send what was held back along with the next value sent: its least (name_min), greatest (name_max)
+   * and mean (name_mean) value among the v_floats, and how many values were held back (name_count) among the v_ints.
+   * Nothing is added if no value was held back.
+   * */
+  int summary;
+} gaus_report_deadband_rule_t;
+
+/*************************************************************//**
+ *
+ * \brief Report by exception: which values of generic reports are held back while they do not change.
+ *
+ * A generic report is held back when each of its v_floats is held back by its rule, and it has no v_ints or
+ * v_strings.  Otherwise it is sent whole, which counts as sending each of its values.  Reports of other types are
+ * always sent.  This applies to ::gaus_report, ::gaus_report_async, ::gaus_report_enqueue and ::gaus_report_queue_push
+ * alike.  A value only counts as sent once the call sending it succeeds, so one that fails to be sent (along with what
+ * it summarizes) is sent by the next report of it.
+ *
+ *************************************************************/
+typedef struct {
+  unsigned int rule_count;                  //!< The number of rules, 0 to send every report
+  const gaus_report_deadband_rule_t *rules; //!< A weak pointer to the rules, copied by ::gaus_global_init
+} gaus_report_deadband_options_t;
+
+/*************************************************************//**
+ *
+ * \brief How the updates found by a check for updates are allocated, see
+ * gaus_initialization_options_t::update_layout.
+ *
+ *************************************************************/
+typedef enum {
+  /*!
+   * The array of updates, each metadata array and each string are allocated separately, and all of them must be freed
+   * by the caller one by one.
+   */
+      GAUS_UPDATE_LAYOUT_SEPARATE = 0,
+  /*!
+   * The updates, their metadata and their strings are laid out in one block, sized before it is filled, which is
+   * freed with ::gaus_updates_free.  Takes a single allocation however many updates and metadata there are, and the
+   * updates are `NULL` if the check failed.
+   */
+      GAUS_UPDATE_LAYOUT_ONE_BLOCK
+} gaus_update_layout_t;
+
 /*************************************************************//**
  *
  * \brief The options object passed into ::gaus_global_init to specify options
@@ -80,6 +500,70 @@ typedef struct {
    * "".  If default proxy options desired you can pass in NULL.
    * */
   const char *proxy;
+  /*!
+   *
+   * A weak pointer to a gaus_tls_session_store_t used to persist TLS sessions between restarts, or NULL to only reuse
+   * sessions within this process.  The store is copied, but gaus_tls_session_store_t::user_data must stay valid until
+   * ::gaus_global_cleanup.
+   * */
+  const gaus_tls_session_store_t *tls_session_store;
+  /*!
+   *
+   * The limits for calls made without their own gaus_call_options_t, including all asynchronous calls.  Timeouts are
+   * measured from the start of each call, gaus_call_options_t::cancel must stay valid until ::gaus_global_cleanup.
+   * */
+  gaus_call_options_t call_options;
+  /*!
+   *
+   * A weak pointer to a gaus_dns_cache_store_t used to persist the address of the gaus server between restarts, or NULL
+   * to only keep it within this process.  The store is copied, but gaus_dns_cache_store_t::user_data must stay valid
+   * until ::gaus_global_cleanup.
+   * */
+  const gaus_dns_cache_store_t *dns_cache_store;
+  /*!
+   *
+   * How long the address of the gaus server is used without resolving its name again, in seconds.  0 for
+   * #GAUS_DNS_CACHE_DEFAULT_TTL_S.  A fresh address is looked up by ::gaus_client_poll during the last quarter of
+   * this time, so requests keep connecting without a lookup.
+   * */
+  unsigned long dns_ttl_s;
+  /*!
+   *
+   * A weak pointer to a gaus_report_queue_store_t keeping the reports of ::gaus_report_queue_push, or NULL to not queue
+   * reports.  Reports left in the store are picked up again.  The store is copied, but
+   * gaus_report_queue_store_t::user_data must stay valid until ::gaus_global_cleanup.
+   * */
+  const gaus_report_queue_store_t *report_queue_store;
+  /*!
+   *
+   * When the reports collected by ::gaus_report_enqueue are sent, all 0 for the defaults.
+   * */
+  gaus_report_batch_options_t report_batch;
+  /*!
+   *
+   * The encoding of the reports sent by ::gaus_report and ::gaus_report_async, #GAUS_REPORT_FORMAT_JSON (0) unless the
+   * server is known to accept #GAUS_REPORT_FORMAT_CBOR.
+   * */
+  gaus_report_format_t report_format;
+  /*!
+   *
+   * Which values of generic reports are only sent when they change, all 0 to send every report.
+   * */
+  gaus_report_deadband_options_t report_deadband;
+  /*!
+   *
+   * How the updates of ::gaus_check_for_updates and the other checks for updates are allocated,
+   * #GAUS_UPDATE_LAYOUT_SEPARATE (0) for each part on its own as before.
+   * */
+  gaus_update_layout_t update_layout;
+  /*!
+   *
+   * How many lines of the library's log are kept for a background thread to write out, 0 to write each line on the
+   * thread logging it as before.  Logging then only formats the line into memory, so it doesn't hold up calls, and
+   * lines logged while all of them are waiting to be written out are dropped.  The thread stops with
+   * ::gaus_global_cleanup, after writing out the lines left.
+   * */
+  unsigned int log_ring_lines;
 } gaus_initialization_options_t;
 
 /*************************************************************//**
@@ -96,8 +580,11 @@ typedef struct {
   /*! A strong pointer to a null terminated productGUID, this is generated by the gaus
    *  backend during the \c gaus_authenticate call.  It is shared by all devices in a common product line. */
   char *product_guid;
-  /*! A weak pointer to a null terminated token.  This is specific to the current session, and was retrieved from the
-   *  \c ::gaus_authenticate call.  This is added to the `Authorization: Bearer` of requests.
+  /*! A strong pointer to a null terminated token.  This is specific to the current session, and was retrieved from the
+   *  \c ::gaus_authenticate call.  This is added to the `Authorization: Bearer` of requests, unless libgaus holds a
+   *  newer token for the device: libgaus keeps its own copy of the token of each device authenticated by
+   *  ::gaus_authenticate and renews that copy once it expires, never changing or freeing this one.  Copies of a session
+   *  thus all get the renewed token.
    */
   char *token;
 } gaus_session_t;
@@ -216,6 +703,60 @@ typedef struct {
   char *filter_value;
 } gaus_header_filter_t;
 
+/*************************************************************//**
+ *
+ * \brief A set of filters compiled once into an encoded query string.
+ *
+ * Created by ::gaus_filter_set_create and freed with ::gaus_filter_set_free.  Filters are usually constant for the
+ * life of the process, compiling them once saves rebuilding the query string on every request.  A filter set may be
+ * shared by any number of calls and threads.
+ *
+ * A filter set also remembers the ETag (or Last-Modified) of the last check for updates that found no updates, so the
+ * next check can be answered with "not modified" by the server instead of a full reply.
+ *
+ *************************************************************/
+typedef struct gaus_filter_set gaus_filter_set_t;
+
+/*************************************************************//**
+ *
+ * \brief A gaus server with its own connection and settings.
+ *
+ * Created by ::gaus_context_create and freed with ::gaus_context_free.  Calls without a context use the one set up
+ * by ::gaus_global_init.  Each context keeps its own connection to its server, so threads calling with a context of
+ * their own neither wait for nor reconnect after each other.  A context never changes once created, apart from
+ * falling back to json reports, so calls read it without taking a lock.  Only the blocking calls taking a context use
+ * it, see ::gaus_context_create.
+ *
+ *************************************************************/
+typedef struct gaus_context gaus_context_t;
+
+/*************************************************************//**
+ *
+ * \brief Callback receiving the result of ::gaus_report_async.
+ *
+ * \param[in] error: A strong pointer to an error describing what went wrong, or `NULL`.  The callback is responsible
+ *   for releasing it with ::gaus_error_release if non null.
+ * \param[in] user_data: The user_data passed to ::gaus_report_async.
+ *
+ *************************************************************/
+typedef void (*gaus_report_callback_t)(gaus_error_t *error, void *user_data);
+
+/*************************************************************//**
+ *
+ * \brief Callback receiving the result of ::gaus_check_for_updates_async.
+ *
+ * \param[in] error: A strong pointer to an error describing what went wrong, or `NULL`.  The callback is responsible
+ *   for releasing it with ::gaus_error_release if non null.
+ * \param[in] update_count: The number of updates contained in updates.
+ * \param[in] updates: A strong pointer to an array of gaus_update_t updates, as returned by ::gaus_check_for_updates.
+ *   The callback is responsible for freeing both the array of updates, and its members (see
+ *   gaus_initialization_options_t::update_layout).
+ * \param[in] user_data: The user_data passed to ::gaus_check_for_updates_async.
+ *
+ *************************************************************/
+typedef void (*gaus_check_for_updates_callback_t)(gaus_error_t *error, unsigned int update_count,
+                                                  gaus_update_t *updates, void *user_data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,258 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "async.h"
+#include "curl_wrapper.h"
+#include "dns_cache.h"
+#include "gaus.h"
+#include "gaus/gaus_client.h"
+#include "log.h"
+#include "report_batch.h"
+#include "request.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct async_request {
+  RequestContext context;
+  RequestDeadline deadline;
+  InMemoryResponse response;
+  char *url;
+  char *payload;
+  async_request_done_t done;
+  void *user_data;
+  struct async_request *next;
+} async_request_t;
+
+static CURL *acquire_idle_handle(gaus_client_t *client) {
+  if (client->idle_handle_count > 0) {
+    CURL *curl = client->idle_handles[--client->idle_handle_count];
+    gaus_curl_easy_reset(curl);
+    return curl;
+  }
+  return gaus_curl_easy_init();
+}
+
+static void release_idle_handle(gaus_client_t *client, CURL *curl) {
+  if (client->idle_handle_count < GAUS_CLIENT_MAX_IDLE_HANDLES) {
+    client->idle_handles[client->idle_handle_count++] = curl;
+  } else {
+    gaus_curl_easy_cleanup(curl);
+  }
+}
+
+static unsigned int count_pending(const gaus_client_t *client) {
+  unsigned int count = 0;
+  for (const async_request_t *request = client->pending; request; request = request->next) {
+    count++;
+  }
+  return count;
+}
+
+/* Unlink a request from the pending list, finish it and hand the result to its callback */
+static void complete_request(gaus_client_t *client, async_request_t *request, CURLcode transfer_status) {
+  long status_code = 200; //Initialize to a default passing value unless request says otherwise.
+  CURL *curl = request->context.curl;
+
+  for (async_request_t **link = &client->pending; *link; link = &(*link)->next) {
+    if (*link == request) {
+      *link = request->next;
+      break;
+    }
+  }
+
+  gaus_curl_multi_remove_handle(client->multi, curl);
+  int result = request_finish(&request->context, transfer_status, &status_code);
+  if (result != 0 && request->response.pos > 0) {
+    logging(L_ERROR, "%s", request->response.data);
+  }
+  release_idle_handle(client, curl);
+
+  //The request is unlinked already, so the callback is free to start new requests.
+  request->done(result, status_code, result == 0 ? request->response.data : NULL, request->url, &request->deadline,
+                request->user_data);
+
+  free(request->response.data);
+  free(request->url);
+  free(request->payload);
+  free(request);
+}
+
+int async_request_start(gaus_client_t *client, char *url, const char *auth_token, char *payload,
+                        async_request_done_t done, void *user_data) {
+  return async_request_start_body(client, url, auth_token, payload, payload ? strlen(payload) : 0, NULL, done,
+                                  user_data);
+}
+
+int async_request_start_body(gaus_client_t *client, char *url, const char *auth_token, char *payload, size_t length,
+                             const char *content_type_header, async_request_done_t done, void *user_data) {
+  RequestBody body = {.data = payload, .length = length, .content_type_header = content_type_header};
+  async_request_t *request = NULL;
+  CURL *curl = NULL;
+
+  if (!client->multi && !(client->multi = gaus_curl_multi_init())) {
+    logging(L_ERROR, "request error: Failed to initialize curl multi");
+    goto error;
+  }
+
+  if (!(request = calloc(1, sizeof(async_request_t)))) {
+    logging(L_ERROR, "request error: Unable to allocate request");
+    goto error;
+  }
+
+  if (!(curl = acquire_idle_handle(client))) {
+    logging(L_ERROR, "request error: Failed to initialize curl");
+    goto error;
+  }
+
+  request_deadline_start(&request->deadline, NULL);
+  if (request_setup(curl, &request->context, &client->async_headers, url, auth_token, payload ? &body : NULL, NULL,
+                    &request->deadline, in_memory_response_writer, &request->response) != 0) {
+    goto error;
+  }
+  if (client->proxy) {
+    gaus_curl_easy_setopt(curl, CURLOPT_PROXY, client->proxy);
+  }
+
+  if (gaus_curl_multi_add_handle(client->multi, curl) != CURLM_OK) {
+    long status_code = 0;
+    logging(L_ERROR, "request error: Failed to add request for %s", url);
+    request_finish(&request->context, CURLE_FAILED_INIT, &status_code);
+    goto error;
+  }
+
+  request->url = url;
+  request->payload = payload;
+  request->done = done;
+  request->user_data = user_data;
+  request->next = client->pending;
+  client->pending = request;
+  return 0;
+
+  error:
+  if (curl) {
+    release_idle_handle(client, curl);
+  }
+  free(request);
+  free(url);
+  free(payload);
+  return -1;
+}
+
+/* Look up the address of the server again on the multi handle if it is about to expire, without holding up requests */
+static void start_dns_refresh(gaus_client_t *client) {
+  CURL *curl = NULL;
+
+  if (client->dns_refresh || !dns_cache_refresh_due() || (!client->multi && !(client->multi = gaus_curl_multi_init()))
+      || !(curl = acquire_idle_handle(client))) {
+    goto error;
+  }
+  if (!dns_cache_refresh(curl, &client->dns_refresh_pin)) {
+    goto error;
+  }
+  if (gaus_curl_multi_add_handle(client->multi, curl) != CURLM_OK) {
+    dns_cache_finish(curl, &client->dns_refresh_pin, CURLE_FAILED_INIT);
+    goto error;
+  }
+  client->dns_refresh = curl;
+  return;
+
+  error:
+  if (curl) {
+    release_idle_handle(client, curl);
+  }
+}
+
+static void finish_dns_refresh(gaus_client_t *client, CURLcode transfer_status) {
+  CURL *curl = client->dns_refresh;
+
+  client->dns_refresh = NULL;
+  gaus_curl_multi_remove_handle(client->multi, curl);
+  dns_cache_finish(curl, &client->dns_refresh_pin, transfer_status);
+  //Drop the connection, it was only made to resolve the name and curl cannot reuse it for requests
+  gaus_curl_easy_cleanup(curl);
+}
+
+gaus_error_t *async_poll(gaus_client_t *client, int timeout_ms, unsigned int *pending) {
+  gaus_error_t *status = NULL;
+  int running = 0;
+  int queued = 0;
+  CURLMsg *message = NULL;
+
+  start_dns_refresh(client);
+  if (!client->pending && !client->dns_refresh) {
+    goto out;
+  }
+
+  if (gaus_curl_multi_perform(client->multi, &running) != CURLM_OK) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Failed to perform pending requests");
+    goto out;
+  }
+
+  if (running > 0 && timeout_ms > 0) {
+    if (gaus_curl_multi_wait(client->multi, NULL, 0, timeout_ms, NULL) != CURLM_OK
+        || gaus_curl_multi_perform(client->multi, &running) != CURLM_OK) {
+      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Failed to wait for pending requests");
+      goto out;
+    }
+  }
+
+  while ((message = gaus_curl_multi_info_read(client->multi, &queued))) {
+    if (message->msg != CURLMSG_DONE) {
+      continue;
+    }
+    //The message is invalidated when its handle is removed, so find the request before completing it.
+    CURL *curl = message->easy_handle;
+    CURLcode transfer_status = message->data.result;
+    if (curl == client->dns_refresh) {
+      finish_dns_refresh(client, transfer_status);
+      continue;
+    }
+    for (async_request_t *request = client->pending; request; request = request->next) {
+      if (request->context.curl == curl) {
+        complete_request(client, request, transfer_status);
+        break;
+      }
+    }
+  }
+
+  out:
+  if (pending) {
+    *pending = count_pending(client);
+  }
+  return status;
+}
+
+void async_cleanup(gaus_client_t *client) {
+  if (client->dns_refresh) {
+    finish_dns_refresh(client, CURLE_ABORTED_BY_CALLBACK);
+  }
+  while (client->pending) {
+    complete_request(client, client->pending, CURLE_ABORTED_BY_CALLBACK);
+  }
+  while (client->idle_handle_count > 0) {
+    gaus_curl_easy_cleanup(client->idle_handles[--client->idle_handle_count]);
+  }
+  if (client->multi) {
+    gaus_curl_multi_cleanup(client->multi);
+    client->multi = NULL;
+  }
+  request_headers_cleanup(&client->async_headers);
+}
+
+gaus_error_t *gaus_client_poll(int timeout_ms, unsigned int *pending) {
+  if (!gaus_global_state.globalInitalized) {
+    if (pending) {
+      *pending = 0;
+    }
+    return gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Polled without initializing");
+  }
+  report_batch_poll();
+  return async_poll(gaus_global_state.client, timeout_ms, pending);
+}
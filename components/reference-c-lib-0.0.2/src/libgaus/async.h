@@ -0,0 +1,52 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_ASYNC_H
+#define GAUS_ASYNC_H
+
+#include "client.h"
+#include "request.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Called once an asynchronous request is done.
+ *
+ * result is 0 if the server replied with 200, in which case response holds the body (it is NULL if the body was
+ * empty).  status_code is the http status of the reply, it is left at 200 if the server never replied.  deadline tells
+ * whether the request ran out of time.  response and deadline are only valid for the duration of the call.
+ */
+typedef void (*async_request_done_t)(int result, long status_code, const char *response, const char *url,
+                                     const RequestDeadline *deadline, void *user_data);
+
+/* Start a request on the client's multi handle, it is carried out by subsequent calls to async_poll.
+ *
+ * A GET is made if payload is NULL, otherwise payload is POSTed as json.  Ownership of url and payload is always taken,
+ * they are freed once the request is done or if starting it fails.  The request is limited by the call options given
+ * to gaus_global_init, from the time it is started.  Returns 0 if the request was started, done will then be called
+ * exactly once from async_poll or async_cleanup.  payload is only freed once done returned, so done may still read it.
+ */
+int async_request_start(gaus_client_t *client, char *url, const char *auth_token, char *payload,
+                        async_request_done_t done, void *user_data);
+
+/* Like async_request_start, but POSTs length bytes of payload with content_type_header (see RequestBody) */
+int async_request_start_body(gaus_client_t *client, char *url, const char *auth_token, char *payload, size_t length,
+                             const char *content_type_header, async_request_done_t done, void *user_data);
+
+/* Drive all pending requests, waiting at most timeout_ms for network activity. */
+gaus_error_t *async_poll(gaus_client_t *client, int timeout_ms, unsigned int *pending);
+
+/* Abort all pending requests (calling their done callbacks) and release the multi handle and idle handles. */
+void async_cleanup(gaus_client_t *client);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_ASYNC_H
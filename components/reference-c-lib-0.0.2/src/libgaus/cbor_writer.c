@@ -0,0 +1,206 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "cbor_writer.h"
+#include "utf8.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Major types of RFC 7049 section 2.1
+#define CBOR_UNSIGNED 0
+#define CBOR_NEGATIVE 1
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_SIMPLE 7
+
+//Additional information of a major type 7 head, telling the size of the float that follows
+#define CBOR_HALF 25
+#define CBOR_SINGLE 26
+
+void cbor_writer_init(cbor_writer_t *writer, size_t capacity) {
+  writer->length = 0;
+  writer->failed = false;
+  writer->capacity = capacity;
+  if (!(writer->data = capacity ? malloc(capacity) : NULL)) {
+    writer->capacity = 0;
+  }
+}
+
+/* Make room for length more bytes, returns false (failing writer) if impossible */
+static bool reserve(cbor_writer_t *writer, size_t length) {
+  if (writer->failed) {
+    return false;
+  }
+  size_t needed = writer->length + length;
+  if (needed <= writer->capacity) {
+    return true;
+  }
+  size_t capacity = writer->capacity ? writer->capacity * 2 : 64;
+  if (capacity < needed) {
+    capacity = needed;
+  }
+  uint8_t *data = realloc(writer->data, capacity);
+  if (!data) {
+    writer->failed = true;
+    return false;
+  }
+  writer->data = data;
+  writer->capacity = capacity;
+  return true;
+}
+
+/* Append value big endian in size bytes, room for them must have been reserved */
+static void put_big_endian(cbor_writer_t *writer, uint64_t value, size_t size) {
+  for (size_t i = size; i > 0; i--) {
+    writer->data[writer->length++] = (uint8_t) (value >> (8 * (i - 1)));
+  }
+}
+
+/* Append the head of an item of major type, with value in the fewest bytes it fits in */
+static void write_head(cbor_writer_t *writer, uint8_t major, uint64_t value) {
+  uint8_t additional;
+  size_t size;
+
+  if (value < 24) {
+    additional = (uint8_t) value;
+    size = 0;
+  } else if (value <= UINT8_MAX) {
+    additional = 24;
+    size = 1;
+  } else if (value <= UINT16_MAX) {
+    additional = 25;
+    size = 2;
+  } else if (value <= UINT32_MAX) {
+    additional = 26;
+    size = 4;
+  } else {
+    additional = 27;
+    size = 8;
+  }
+  if (reserve(writer, 1 + size)) {
+    writer->data[writer->length++] = (uint8_t) (major << 5 | additional);
+    put_big_endian(writer, value, size);
+  }
+}
+
+void cbor_writer_map(cbor_writer_t *writer, size_t count) {
+  write_head(writer, CBOR_MAP, count);
+}
+
+void cbor_writer_array(cbor_writer_t *writer, size_t count) {
+  write_head(writer, CBOR_ARRAY, count);
+}
+
+void cbor_writer_string(cbor_writer_t *writer, const char *value) {
+  cbor_writer_string_prefixed(writer, "", value);
+}
+
+void cbor_writer_string_prefixed(cbor_writer_t *writer, const char *prefix, const char *value) {
+  if (!value || !utf8_valid(prefix) || !utf8_valid(value)) {
+    writer->failed = true;
+    return;
+  }
+  size_t prefix_length = strlen(prefix);
+  size_t value_length = strlen(value);
+  write_head(writer, CBOR_TEXT, prefix_length + value_length);
+  if (reserve(writer, prefix_length + value_length)) {
+    memcpy(writer->data + writer->length, prefix, prefix_length);
+    memcpy(writer->data + writer->length + prefix_length, value, value_length);
+    writer->length += prefix_length + value_length;
+  }
+}
+
+void cbor_writer_integer(cbor_writer_t *writer, long long value) {
+  if (value >= 0) {
+    write_head(writer, CBOR_UNSIGNED, (uint64_t) value);
+  } else {
+    //-1 - value can not overflow, unlike -value
+    write_head(writer, CBOR_NEGATIVE, (uint64_t) (-1 - value));
+  }
+}
+
+/* The half precision bits of a finite single precision float, false if half precision can not hold it exactly */
+static bool half_bits(uint32_t single, uint16_t *half) {
+  uint16_t sign = (uint16_t) ((single >> 16) & 0x8000);
+  int exponent = (int) ((single >> 23) & 0xFF) - 127;
+  uint32_t mantissa = single & 0x7FFFFF;
+
+  if ((single & 0x7FFFFFFF) == 0) {
+    *half = sign;
+    return true;
+  }
+  //Single precision subnormals are far too small, as is anything below the smallest half precision subnormal
+  if (exponent > 15 || exponent < -24) {
+    return false;
+  }
+  if (exponent >= -14) {
+    //Normal, half precision keeps the top 10 of the 23 mantissa bits
+    if (mantissa & 0x1FFF) {
+      return false;
+    }
+    *half = (uint16_t) (sign | (exponent + 15) << 10 | mantissa >> 13);
+    return true;
+  }
+  //Subnormal, the value is a multiple of 2^-24 below 2^-14
+  uint32_t significand = 0x800000 | mantissa;
+  int shift = -1 - exponent;
+  if (significand & ((1u << shift) - 1)) {
+    return false;
+  }
+  *half = (uint16_t) (sign | significand >> shift);
+  return true;
+}
+
+void cbor_writer_float(cbor_writer_t *writer, float value) {
+  uint32_t single;
+  uint16_t half;
+
+  if (!isfinite(value)) {
+    writer->failed = true;
+    return;
+  }
+  memcpy(&single, &value, sizeof(single));
+  if (half_bits(single, &half)) {
+    if (reserve(writer, 3)) {
+      writer->data[writer->length++] = CBOR_SIMPLE << 5 | CBOR_HALF;
+      put_big_endian(writer, half, 2);
+    }
+  } else if (reserve(writer, 5)) {
+    writer->data[writer->length++] = CBOR_SIMPLE << 5 | CBOR_SINGLE;
+    put_big_endian(writer, single, 4);
+  }
+}
+
+char *cbor_writer_take(cbor_writer_t *writer, size_t *length) {
+  uint8_t *data = NULL;
+
+  *length = 0;
+  if (!writer->failed && reserve(writer, 0)) {
+    data = writer->data;
+    *length = writer->length;
+  } else {
+    free(writer->data);
+  }
+  writer->data = NULL;
+  writer->capacity = 0;
+  writer->length = 0;
+  writer->failed = false;
+  return (char *) data;
+}
+
+void cbor_writer_free(cbor_writer_t *writer) {
+  free(writer->data);
+  writer->data = NULL;
+  writer->capacity = 0;
+  writer->length = 0;
+  writer->failed = false;
+}
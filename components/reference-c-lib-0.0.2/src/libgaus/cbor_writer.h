@@ -0,0 +1,66 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_CBOR_WRITER_H
+#define GAUS_CBOR_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A CBOR (RFC 7049) document written front to back into a growing buffer.
+ *
+ * Only what reports need is supported: maps and arrays of a known size, text strings, integers and floats, each in its
+ * shortest form.  Like json_writer_t, once a write fails (running out of memory, a string that is not valid UTF-8 or a
+ * float that is not finite) the writer is failed and ignores further writes, so only the end result needs checking.
+ */
+typedef struct {
+  uint8_t *data;
+  size_t length;
+  size_t capacity;
+  bool failed;
+} cbor_writer_t;
+
+/* Start an empty document, with room for capacity bytes before the buffer needs to grow */
+void cbor_writer_init(cbor_writer_t *writer, size_t capacity);
+
+/* Start a map of count pairs, each written as a key followed by its value */
+void cbor_writer_map(cbor_writer_t *writer, size_t count);
+
+/* Start an array of count items */
+void cbor_writer_array(cbor_writer_t *writer, size_t count);
+
+/* Append value as a text string, fails for NULL or invalid UTF-8 as json_writer_string does */
+void cbor_writer_string(cbor_writer_t *writer, const char *value);
+
+/* Append prefix followed by value as a single text string */
+void cbor_writer_string_prefixed(cbor_writer_t *writer, const char *prefix, const char *value);
+
+void cbor_writer_integer(cbor_writer_t *writer, long long value);
+
+/* Append value as a half precision float if that holds it exactly, as a single precision one otherwise.  Fails if it
+ * is not finite, as json_writer_real does.
+ */
+void cbor_writer_float(cbor_writer_t *writer, float value);
+
+/* The document, handed over to the caller with its size in length.  NULL if any write failed.  The writer is left
+ * empty.
+ */
+char *cbor_writer_take(cbor_writer_t *writer, size_t *length);
+
+void cbor_writer_free(cbor_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_CBOR_WRITER_H
@@ -0,0 +1,97 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "async.h"
+#include "client.h"
+#include "curl_wrapper.h"
+#include "gaus.h"
+#include "log.h"
+#include "request.h"
+
+#include <stdlib.h>
+
+gaus_error_t *gaus_client_init(gaus_client_t **client) {
+  gaus_client_t *new_client = NULL;
+
+  if (!client) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Client initialized with invalid parameters");
+  }
+
+  new_client = malloc(sizeof(gaus_client_t));
+  if (!new_client) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate client");
+  }
+
+  if (!(new_client->curl = gaus_curl_easy_init())) {
+    free(new_client);
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Failed to initialize curl handle");
+  }
+  if (!(new_client->curl_multi = gaus_curl_multi_init())) {
+    gaus_curl_easy_cleanup(new_client->curl);
+    free(new_client);
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Failed to initialize curl multi handle");
+  }
+  pthread_mutex_init(&new_client->lock, NULL);
+  new_client->headers = (RequestHeaders) {NULL, NULL, 0};
+  new_client->async_headers = (RequestHeaders) {NULL, NULL, 0};
+  new_client->multi = NULL;
+  new_client->pending = NULL;
+  new_client->idle_handle_count = 0;
+  new_client->dns_refresh = NULL;
+  url_prefix_cache_init(&new_client->url_prefix);
+  new_client->proxy = NULL;
+
+  *client = new_client;
+  return NULL;
+}
+
+void gaus_client_cleanup(gaus_client_t *client) {
+  if (!client) {
+    return;
+  }
+  async_cleanup(client);
+  gaus_curl_easy_cleanup(client->curl);
+  gaus_curl_multi_cleanup(client->curl_multi);
+  request_headers_cleanup(&client->headers);
+  url_prefix_cache_cleanup(&client->url_prefix);
+  pthread_mutex_destroy(&client->lock);
+  free(client);
+}
+
+CURL *gaus_client_acquire_handle(gaus_client_t *client, CURLM **multi) {
+  CURL *curl = NULL;
+
+  if (client && pthread_mutex_trylock(&client->lock) == 0) {
+    //Drop all options from the previous request, live connections and session ids are kept by the multi handle.
+    gaus_curl_easy_reset(client->curl);
+    *multi = client->curl_multi;
+    return client->curl;
+  }
+  logging(L_DEBUG, "Shared curl handle not available, using a temporary handle");
+  if (!(*multi = gaus_curl_multi_init())) {
+    return NULL;
+  }
+  if (!(curl = gaus_curl_easy_init())) {
+    gaus_curl_multi_cleanup(*multi);
+    *multi = NULL;
+  }
+  return curl;
+}
+
+void gaus_client_release_handle(gaus_client_t *client, CURL *curl, CURLM *multi) {
+  if (!curl) {
+    return;
+  }
+  if (client && curl == client->curl) {
+    pthread_mutex_unlock(&client->lock);
+  } else {
+    gaus_curl_easy_cleanup(curl);
+    gaus_curl_multi_cleanup(multi);
+  }
+}
@@ -0,0 +1,92 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_CLIENT_H
+#define GAUS_CLIENT_H
+
+#include <pthread.h>
+#include <curl/curl.h>
+#include <gaus/gaus_client_types.h>
+
+#include "dns_cache.h"
+#include "url.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Header lists kept between requests made with the same token (NULL for requests without authorization).
+ *
+ * headers starts with Content-Type, which is only sent with a payload, followed by the headers sent with every
+ * request.  It is only rebuilt for a new token while no request is using it.
+ */
+typedef struct RequestHeaders {
+  char *token;
+  struct curl_slist *headers;
+  unsigned int users;
+} RequestHeaders;
+
+//Number of finished asynchronous request handles kept around for reuse
+#define GAUS_CLIENT_MAX_IDLE_HANDLES 4
+
+struct async_request;
+
+/* A long lived client owning a reusable curl easy handle.
+ *
+ * Reusing the same easy handle for every request lets curl keep the connection (and the negotiated TLS session) to
+ * the gaus server alive between calls, so only the first request pays for the TCP connect and TLS handshake.
+ *
+ * Blocking requests on the shared handle are carried out on curl_multi, which owns the connection cache, so that a
+ * response can be consumed piece by piece while it arrives.
+ *
+ * Asynchronous requests are run on a curl multi handle created on first use, all transfers on it share one connection
+ * cache.  Easy handles of finished asynchronous requests are kept in idle_handles to be reused by the next one.
+ *
+ * headers (used with the shared handle) and async_headers keep the request headers for the last token used.
+ *
+ * url_prefix keeps the start of the device urls for the last session used.
+ *
+ * dns_refresh is the connection started on multi to look up the address of the server again before it expires.
+ *
+ * proxy is the one of the context owning the client, or NULL to connect directly.
+ */
+typedef struct gaus_client {
+  CURL *curl;
+  CURLM *curl_multi;
+  RequestHeaders headers;
+  pthread_mutex_t lock;
+  CURLM *multi;
+  RequestHeaders async_headers;
+  struct async_request *pending;
+  CURL *idle_handles[GAUS_CLIENT_MAX_IDLE_HANDLES];
+  unsigned int idle_handle_count;
+  CURL *dns_refresh;
+  DnsPin dns_refresh_pin;
+  UrlPrefixCache url_prefix;
+  const char *proxy;
+} gaus_client_t;
+
+gaus_error_t *gaus_client_init(gaus_client_t **client);
+
+void gaus_client_cleanup(gaus_client_t *client);
+
+/* Get a handle ready for a new request.
+ *
+ * Returns the client's shared handle (reset to default options) and sets multi to the multi handle holding its
+ * connection cache if it is free.  If the shared handle is in use by another thread, or client is NULL, a temporary
+ * pair of handles is created instead.  Either way the handles must be handed back with gaus_client_release_handle.
+ */
+CURL *gaus_client_acquire_handle(gaus_client_t *client, CURLM **multi);
+
+void gaus_client_release_handle(gaus_client_t *client, CURL *curl, CURLM *multi);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_CLIENT_H
@@ -22,16 +22,37 @@ typedef CURLcode(curl_easy_perform_t)(CURL *curl);
 typedef CURL *(curl_easy_init_t)(void);
 typedef CURLcode (curl_easy_setopt_t)(CURL *curl, CURLoption option, ...);
 typedef void (curl_easy_cleanup_t)(CURL *curl);
+typedef void (curl_easy_reset_t)(CURL *curl);
 typedef void (curl_global_cleanup_t)(void);
 typedef CURLcode (curl_easy_getinfo_t)(CURL *curl, CURLINFO info, ...);
+typedef CURLcode (curl_easy_pause_t)(CURL *curl, int bitmask);
+typedef struct curl_slist *(curl_slist_append_t)(struct curl_slist *list, const char *string);
+typedef CURLM *(curl_multi_init_t)(void);
+typedef CURLMcode (curl_multi_add_handle_t)(CURLM *multi, CURL *curl);
+typedef CURLMcode (curl_multi_remove_handle_t)(CURLM *multi, CURL *curl);
+typedef CURLMcode (curl_multi_perform_t)(CURLM *multi, int *running_handles);
+typedef CURLMcode (curl_multi_wait_t)(CURLM *multi, struct curl_waitfd extra_fds[], unsigned int extra_nfds,
+                                      int timeout_ms, int *numfds);
+typedef CURLMsg *(curl_multi_info_read_t)(CURLM *multi, int *msgs_in_queue);
+typedef CURLMcode (curl_multi_cleanup_t)(CURLM *multi);
 
 extern curl_global_init_t *gaus_curl_global_init;
 extern curl_easy_perform_t *gaus_curl_easy_perform;
 extern curl_easy_init_t *gaus_curl_easy_init;
 extern curl_easy_setopt_t *gaus_curl_easy_setopt;
 extern curl_easy_cleanup_t *gaus_curl_easy_cleanup;
+extern curl_easy_reset_t *gaus_curl_easy_reset;
 extern curl_global_cleanup_t *gaus_curl_global_cleanup;
 extern curl_easy_getinfo_t *gaus_curl_easy_getinfo;
+extern curl_easy_pause_t *gaus_curl_easy_pause;
+extern curl_slist_append_t *gaus_curl_slist_append;
+extern curl_multi_init_t *gaus_curl_multi_init;
+extern curl_multi_add_handle_t *gaus_curl_multi_add_handle;
+extern curl_multi_remove_handle_t *gaus_curl_multi_remove_handle;
+extern curl_multi_perform_t *gaus_curl_multi_perform;
+extern curl_multi_wait_t *gaus_curl_multi_wait;
+extern curl_multi_info_read_t *gaus_curl_multi_info_read;
+extern curl_multi_cleanup_t *gaus_curl_multi_cleanup;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,289 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "dns_cache.h"
+#include "curl_wrapper.h"
+#include "gaus.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//Serialized as "<format> <host> <port> <address> <expires>"
+#define DNS_CACHE_FORMAT "gaus-dns-1"
+
+/* Requests read enabled, address and expires without the lock.  The rest is only used under the lock, or set by
+ * dns_cache_init before requests are made, like host and port.  address and expires are changed under the lock by
+ * publish_address, between two increments of sequence, and read by read_address which tries again when sequence was
+ * odd or changed meanwhile, so that a request never sees half an address.
+ */
+static struct {
+  pthread_mutex_t lock;
+  bool enabled;
+  //The server url requests must start with, and the host and port curl connects to for them
+  char *server_url;
+  char host[DNS_CACHE_HOST_MAX];
+  long port;
+  char unpin_entry[DNS_CACHE_HOST_MAX + 16];
+  //Where dns_cache_refresh connects to: the same host and port, but without TLS so that no handshake is paid for
+  char refresh_url[DNS_CACHE_HOST_MAX + 32];
+  unsigned long ttl_s;
+  bool has_store;
+  gaus_dns_cache_store_t store;
+  //The latest known address, empty if none, and until when it is used
+  char address[DNS_CACHE_ADDRESS_MAX];
+  time_t expires;
+  unsigned int sequence;
+  //From when dns_cache_refresh may look the address up again
+  time_t refresh_after;
+  //A connection resolving the name again was started by dns_cache_refresh
+  bool refreshing;
+} dns_state = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/* Split the host and port curl will connect to off url, returns false if there is no name to resolve */
+static bool parse_server(const char *url, char *host, long *port) {
+  const char *start = strstr(url, "://");
+  size_t length = 0;
+
+  *port = strncmp(url, "https://", 8) == 0 ? 443 : 80;
+  start = start ? start + 3 : url;
+  //An IPv6 address
+  if (*start == '[') {
+    return false;
+  }
+  length = strcspn(start, ":/?#");
+  if (length == 0 || length >= DNS_CACHE_HOST_MAX || start[strcspn(start, "@/")] == '@') {
+    return false;
+  }
+  memcpy(host, start, length);
+  host[length] = '\0';
+  if (start[length] == ':') {
+    *port = strtol(start + length + 1, NULL, 10);
+  }
+  //An IPv4 address
+  return strspn(host, "0123456789.") != length;
+}
+
+/* Use address (the current one if NULL) until expires, refreshing it during the last quarter of ttl_s.  Must hold
+ * the lock. */
+static void publish_address(const char *address, time_t expires, unsigned long ttl_s) {
+  //Release stores, so that a request seeing any of the new values also sees sequence odd
+  __atomic_store_n(&dns_state.sequence, dns_state.sequence + 1, __ATOMIC_RELAXED);
+  if (address) {
+    size_t i = 0;
+    do {
+      __atomic_store_n(&dns_state.address[i], address[i], __ATOMIC_RELEASE);
+    } while (address[i++]);
+  }
+  __atomic_store_n(&dns_state.expires, expires, __ATOMIC_RELEASE);
+  __atomic_store_n(&dns_state.sequence, dns_state.sequence + 1, __ATOMIC_RELEASE);
+  dns_state.refresh_after = expires - (time_t) (ttl_s / 4);
+}
+
+/* Copy the address and until when it is used, without the lock */
+static void read_address(char *address, time_t *expires) {
+  unsigned int sequence;
+
+  do {
+    sequence = __atomic_load_n(&dns_state.sequence, __ATOMIC_ACQUIRE);
+    //Acquire loads, so that sequence is read again after them
+    for (size_t i = 0; i < DNS_CACHE_ADDRESS_MAX; i++) {
+      if (!(address[i] = __atomic_load_n(&dns_state.address[i], __ATOMIC_ACQUIRE))) {
+        break;
+      }
+    }
+    *expires = __atomic_load_n(&dns_state.expires, __ATOMIC_ACQUIRE);
+  } while ((sequence & 1) || __atomic_load_n(&dns_state.sequence, __ATOMIC_RELAXED) != sequence);
+  address[DNS_CACHE_ADDRESS_MAX - 1] = '\0';
+}
+
+/* Must hold the lock */
+static void load_address(void) {
+  unsigned char buffer[GAUS_DNS_CACHE_MAX_SIZE + 1];
+  size_t length = GAUS_DNS_CACHE_MAX_SIZE;
+  char format[16];
+  char host[DNS_CACHE_HOST_MAX];
+  char address[DNS_CACHE_ADDRESS_MAX];
+  long port = 0;
+  long long expires = 0;
+
+  if (dns_state.store.load(dns_state.store.user_data, buffer, &length) != 0 || length > GAUS_DNS_CACHE_MAX_SIZE) {
+    return;
+  }
+  buffer[length] = '\0';
+  if (sscanf((const char *) buffer, "%15s %255s %ld %63s %lld", format, host, &port, address, &expires) != 5
+      || strcmp(format, DNS_CACHE_FORMAT) != 0 || strcmp(host, dns_state.host) != 0 || port != dns_state.port) {
+    logging(L_DEBUG, "Ignoring persisted address of another server");
+    return;
+  }
+  publish_address(address, (time_t) expires, dns_state.ttl_s);
+  logging(L_DEBUG, "Loaded persisted address %s of %s", address, host);
+}
+
+/* Must hold the lock */
+static void save_address(void) {
+  char buffer[GAUS_DNS_CACHE_MAX_SIZE];
+  int length = snprintf(buffer, sizeof(buffer), DNS_CACHE_FORMAT " %s %ld %s %lld", dns_state.host, dns_state.port,
+                        dns_state.address, (long long) dns_state.expires);
+
+  if (length > 0 && (size_t) length < sizeof(buffer)
+      && dns_state.store.save(dns_state.store.user_data, (const unsigned char *) buffer, length) != 0) {
+    logging(L_WARNING, "Failed to persist the address of %s", dns_state.host);
+  }
+}
+
+void dns_cache_init(const char *server_url, const char *proxy, const gaus_dns_cache_store_t *store,
+                    unsigned long ttl_s) {
+  pthread_mutex_lock(&dns_state.lock);
+  publish_address("", 0, 0);
+  dns_state.refreshing = false;
+  dns_state.ttl_s = ttl_s ? ttl_s : GAUS_DNS_CACHE_DEFAULT_TTL_S;
+  //Through a proxy curl reports the address of the proxy, and the proxy resolves the server
+  bool enabled = !(proxy && *proxy) && parse_server(server_url, dns_state.host, &dns_state.port)
+                 && (dns_state.server_url = strdup(server_url));
+  //Removes whatever curl cached itself or was pinned before
+  snprintf(dns_state.unpin_entry, sizeof(dns_state.unpin_entry), "-%s:%ld", dns_state.host, dns_state.port);
+  snprintf(dns_state.refresh_url, sizeof(dns_state.refresh_url), "http://%s:%ld/", dns_state.host, dns_state.port);
+  dns_state.has_store = enabled && store && store->load && store->save;
+  if (dns_state.has_store) {
+    dns_state.store = *store;
+    load_address();
+  }
+  __atomic_store_n(&dns_state.enabled, enabled, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&dns_state.lock);
+}
+
+void dns_cache_cleanup(void) {
+  pthread_mutex_lock(&dns_state.lock);
+  __atomic_store_n(&dns_state.enabled, false, __ATOMIC_RELAXED);
+  dns_state.has_store = false;
+  free(dns_state.server_url);
+  dns_state.server_url = NULL;
+  pthread_mutex_unlock(&dns_state.lock);
+}
+
+/* Set pin as CURLOPT_RESOLVE, pinning the server host to address if not NULL */
+static void set_pin(CURL *curl, DnsPin *pin, const char *address) {
+  pin->active = true;
+  pin->pinned = address != NULL;
+  //Only read by curl, the entry of the server stays until dns_cache_cleanup
+  pin->entries[0].data = dns_state.unpin_entry;
+  pin->entries[0].next = NULL;
+  if (address) {
+    snprintf(pin->address_entry, sizeof(pin->address_entry), strchr(address, ':') ? "%s:%ld:[%s]" : "%s:%ld:%s",
+             dns_state.host, dns_state.port, address);
+    pin->entries[1].data = pin->address_entry;
+    pin->entries[1].next = NULL;
+    pin->entries[0].next = &pin->entries[1];
+  }
+  gaus_curl_easy_setopt(curl, CURLOPT_RESOLVE, pin->entries);
+}
+
+void dns_cache_prepare(CURL *curl, const char *url, DnsPin *pin) {
+  char address[DNS_CACHE_ADDRESS_MAX];
+  time_t expires = 0;
+
+  pin->active = false;
+  pin->pinned = false;
+  //Every request passes here, so it reads the address without taking the lock
+  if (__atomic_load_n(&dns_state.enabled, __ATOMIC_ACQUIRE)
+      && strncmp(url, dns_state.server_url, strlen(dns_state.server_url)) == 0) {
+    read_address(address, &expires);
+    set_pin(curl, pin, address[0] && time(NULL) < expires ? address : NULL);
+  }
+}
+
+void dns_cache_finish(CURL *curl, DnsPin *pin, CURLcode status) {
+  char *address = NULL;
+
+  if (!pin->active) {
+    return;
+  }
+  pin->active = false;
+  gaus_curl_easy_setopt(curl, CURLOPT_RESOLVE, NULL);
+  //Nothing was learned from a request to the cached address that went through, so those don't take the lock
+  if (pin->pinned && status != CURLE_COULDNT_CONNECT) {
+    return;
+  }
+
+  pthread_mutex_lock(&dns_state.lock);
+  //Cleaned up meanwhile
+  if (!dns_state.enabled) {
+    goto out;
+  }
+  if (pin->pinned) {
+    //The server may have moved, look it up again next time
+    logging(L_INFO, "Unable to connect to cached address %s of %s", dns_state.address, dns_state.host);
+    publish_address(NULL, 0, 0);
+    goto out;
+  }
+  dns_state.refreshing = false;
+  if (status == CURLE_COULDNT_RESOLVE_HOST) {
+    //Rather than fail every request while DNS is down, keep using the last address for a while before trying again
+    if (dns_state.address[0]) {
+      logging(L_WARNING, "Unable to resolve %s, keeping address %s", dns_state.host, dns_state.address);
+      publish_address(NULL, time(NULL) + (time_t) (dns_state.ttl_s / 4), dns_state.ttl_s / 4);
+    }
+    goto out;
+  }
+  //Only a transfer that went through tells where it connected to
+  if (status != CURLE_OK
+      || gaus_curl_easy_getinfo(curl, CURLINFO_PRIMARY_IP, &address) != CURLE_OK || !address || !*address
+      || strlen(address) >= DNS_CACHE_ADDRESS_MAX) {
+    goto out;
+  }
+  if (strcmp(address, dns_state.address) != 0) {
+    logging(L_DEBUG, "Resolved %s to %s", dns_state.host, address);
+  }
+  publish_address(address, time(NULL) + (time_t) dns_state.ttl_s, dns_state.ttl_s);
+  if (dns_state.has_store) {
+    save_address();
+  }
+
+  out:
+  pthread_mutex_unlock(&dns_state.lock);
+}
+
+/* Must hold the lock */
+static bool refresh_due(void) {
+  time_t now = time(NULL);
+  //Once expired, the next request resolves the name itself
+  return dns_state.enabled && !dns_state.refreshing && dns_state.address[0] && now >= dns_state.refresh_after
+         && now < dns_state.expires;
+}
+
+bool dns_cache_refresh_due(void) {
+  pthread_mutex_lock(&dns_state.lock);
+  bool due = refresh_due();
+  pthread_mutex_unlock(&dns_state.lock);
+  return due;
+}
+
+bool dns_cache_refresh(CURL *curl, DnsPin *pin) {
+  pthread_mutex_lock(&dns_state.lock);
+  bool due = refresh_due();
+  if (due) {
+    logging(L_DEBUG, "Refreshing the address of %s", dns_state.host);
+    dns_state.refreshing = true;
+    //Only the address matters, connecting over TCP tells it as well as a whole TLS handshake would
+    gaus_curl_easy_setopt(curl, CURLOPT_URL, dns_state.refresh_url);
+    gaus_curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L);
+    if (gaus_global_state.call_options.connect_timeout_ms > 0) {
+      gaus_curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, (long) gaus_global_state.call_options.connect_timeout_ms);
+    }
+    set_pin(curl, pin, NULL);
+  }
+  pthread_mutex_unlock(&dns_state.lock);
+  return due;
+}
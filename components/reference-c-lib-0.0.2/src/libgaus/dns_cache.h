@@ -0,0 +1,67 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_DNS_CACHE_H
+#define GAUS_DNS_CACHE_H
+
+#include <stdbool.h>
+#include <curl/curl.h>
+#include <gaus/gaus_client_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Longest host name curl accepts in CURLOPT_RESOLVE, and the longest address curl reports as CURLINFO_PRIMARY_IP
+#define DNS_CACHE_HOST_MAX 256
+#define DNS_CACHE_ADDRESS_MAX 64
+
+/* The CURLOPT_RESOLVE list of a request.
+ *
+ * curl only reads the list when the transfer starts, so it is built in place instead of allocated: entries[0] drops
+ * whatever curl cached for the server host, entries[1] (if pinned) adds the cached address in its place.
+ */
+typedef struct DnsPin {
+  struct curl_slist entries[2];
+  char address_entry[DNS_CACHE_HOST_MAX + DNS_CACHE_ADDRESS_MAX + 16];
+  bool active;
+  bool pinned;
+} DnsPin;
+
+/* Cache the address of the host of server_url for ttl_s seconds (0 for the default), persisting it in store if not
+ * NULL.  Nothing is cached if the host is an address already or requests go through proxy.
+ */
+void dns_cache_init(const char *server_url, const char *proxy, const gaus_dns_cache_store_t *store,
+                    unsigned long ttl_s);
+
+void dns_cache_cleanup(void);
+
+/* Called before performing a request to url on curl.
+ *
+ * Pins the server host to the cached address while it has not expired, otherwise drops any pin so that curl resolves
+ * the name.  Urls on other hosts are left alone.  pin must stay valid until handed to dns_cache_finish.
+ */
+void dns_cache_prepare(CURL *curl, const char *url, DnsPin *pin);
+
+/* Called after the request was performed on curl, learns the address curl resolved if it was not pinned. */
+void dns_cache_finish(CURL *curl, DnsPin *pin, CURLcode status);
+
+/* Whether the cached address is about to expire and no one is refreshing it yet */
+bool dns_cache_refresh_due(void);
+
+/* Prepare curl to only connect to the server over TCP, resolving its name again, if the cached address is about to
+ * expire and no one is refreshing it yet.  Returns false if no refresh is due, otherwise pin must be handed to
+ * dns_cache_finish.
+ */
+bool dns_cache_refresh(CURL *curl, DnsPin *pin);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_DNS_CACHE_H
@@ -0,0 +1,142 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "error.h"
+#include "gaus.h"
+#include "gaus/gaus_client.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+  gaus_error_t error;
+  char description[ERROR_DESCRIPTION_SIZE];
+} PooledError;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool pool_taken[ERROR_POOL_SIZE];
+static PooledError pool[ERROR_POOL_SIZE];
+
+//Handed out when not even the heap has room for an error, so that a failure is never reported as success.  It is
+//shared, so its type and code are fixed and releasing it does nothing.
+static char out_of_memory_description[] = "Out of memory";
+static gaus_error_t out_of_memory_error = {GAUS_UNKNOWN_ERROR, 500, out_of_memory_description};
+
+static PooledError *pool_acquire(void) {
+  PooledError *pooled = NULL;
+  pthread_mutex_lock(&pool_lock);
+  for (unsigned int i = 0; i < ERROR_POOL_SIZE; i++) {
+    if (!pool_taken[i]) {
+      pool_taken[i] = true;
+      pooled = &pool[i];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&pool_lock);
+  return pooled;
+}
+
+/* The pool index of error, or -1 if it is not pooled */
+static int pool_index(const gaus_error_t *error) {
+  for (int i = 0; i < ERROR_POOL_SIZE; i++) {
+    if (error == &pool[i].error) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void pool_release(int index) {
+  pthread_mutex_lock(&pool_lock);
+  pool_taken[index] = false;
+  pthread_mutex_unlock(&pool_lock);
+}
+
+/* Format description into the pool, or NULL if the pool is exhausted or description does not fit */
+static gaus_error_t *pooled_error(const char *description, va_list args) {
+  PooledError *pooled = pool_acquire();
+  if (!pooled) {
+    return NULL;
+  }
+  int needed = vsnprintf(pooled->description, sizeof(pooled->description), description, args);
+  if (needed < 0 || (size_t) needed >= sizeof(pooled->description)) {
+    pool_release((int) (pooled - pool));
+    return NULL;
+  }
+  pooled->error.description = pooled->description;
+  return &pooled->error;
+}
+
+static gaus_error_t *heap_error(const char *description, va_list args) {
+  va_list args_backup;  //vsnprintf mangles args so we need a backup
+  va_copy(args_backup, args);
+  int needed = vsnprintf(NULL, 0, description, args) + 1;
+  gaus_error_t *error = malloc(sizeof(gaus_error_t));
+  char *buffer = needed > 0 ? malloc((size_t) needed) : NULL;
+  if (!error || !buffer) {
+    free(error);
+    free(buffer);
+    va_end(args_backup);
+    return &out_of_memory_error;
+  }
+  vsnprintf(buffer, (size_t) needed, description, args_backup);
+  va_end(args_backup);
+  error->description = buffer;
+  return error;
+}
+
+gaus_error_t *
+gaus_create_error(const char *func, gaus_error_type_t type, unsigned int code, const char *description, ...) {
+  va_list args;
+  va_start(args, description);
+  va_list args_backup;  //Formatting into the pool mangles args, and the heap may still be needed
+  va_copy(args_backup, args);
+  gaus_error_t *error = pooled_error(description, args);
+  if (!error) {
+    error = heap_error(description, args_backup);
+  }
+  va_end(args);
+  va_end(args_backup);
+
+  logging(L_ERROR, "%s: %s", func, error->description);
+  if (error != &out_of_memory_error) {
+    error->error_type = type;
+    error->http_error_code = code;
+  }
+  return error;
+}
+
+void gaus_error_release(gaus_error_t *error) {
+  if (!error || error == &out_of_memory_error) {
+    return;
+  }
+  int index = pool_index(error);
+  if (index >= 0) {
+    pool_release(index);
+  } else {
+    free(error->description);
+    free(error);
+  }
+}
+
+unsigned int error_pool_in_use(void) {
+  unsigned int in_use = 0;
+  pthread_mutex_lock(&pool_lock);
+  for (unsigned int i = 0; i < ERROR_POOL_SIZE; i++) {
+    if (pool_taken[i]) {
+      in_use++;
+    }
+  }
+  pthread_mutex_unlock(&pool_lock);
+  return in_use;
+}
@@ -0,0 +1,28 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_ERROR_H
+#define GAUS_ERROR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Errors that can be handed out at once without touching the heap.  Any more, and gaus_create_error uses the heap.
+#define ERROR_POOL_SIZE 8
+//Room for the description of a pooled error, including its terminator.  Longer descriptions go on the heap.
+#define ERROR_DESCRIPTION_SIZE 160
+
+/* The number of pooled errors not yet released */
+unsigned int error_pool_in_use(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_ERROR_H
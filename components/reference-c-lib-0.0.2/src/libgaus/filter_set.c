@@ -0,0 +1,107 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "filter_set.h"
+#include "gaus.h"
+#include "url.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+gaus_error_t *
+gaus_filter_set_create(unsigned int filter_count, const gaus_header_filter_t *filters, gaus_filter_set_t **filter_set) {
+  gaus_filter_set_t *new_filter_set = NULL;
+  size_t query_len = 0;
+
+  if (!filter_set || (filter_count > 0 && !filters)) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Filter set created with invalid parameters");
+  }
+
+  for (unsigned int i = 0; i < filter_count; i++) {
+    if (!filters[i].filter_name || !filters[i].filter_value) {
+      return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Filter set created with invalid parameters");
+    }
+    //One '?' or '&' plus '=' for each filter
+    query_len += 2 + url_encode(NULL, filters[i].filter_name) + url_encode(NULL, filters[i].filter_value);
+  }
+
+  if (!(new_filter_set = calloc(1, sizeof(gaus_filter_set_t)))
+      || !(new_filter_set->query = malloc(query_len + 1))
+      || !(new_filter_set->condition = malloc(sizeof(FilterSetCondition)))) {
+    if (new_filter_set) {
+      free(new_filter_set->query);
+    }
+    free(new_filter_set);
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate filter set");
+  }
+  pthread_mutex_init(&new_filter_set->condition->lock, NULL);
+  new_filter_set->condition->header = NULL;
+
+  char *pos = new_filter_set->query;
+  for (unsigned int i = 0; i < filter_count; i++) {
+    *pos++ = i > 0 ? '&' : '?';
+    pos += url_encode(pos, filters[i].filter_name);
+    *pos++ = '=';
+    pos += url_encode(pos, filters[i].filter_value);
+  }
+  *pos = '\0';
+
+  *filter_set = new_filter_set;
+  return NULL;
+}
+
+void gaus_filter_set_free(gaus_filter_set_t *filter_set) {
+  if (!filter_set) {
+    return;
+  }
+  pthread_mutex_destroy(&filter_set->condition->lock);
+  free(filter_set->condition->header);
+  free(filter_set->condition);
+  free(filter_set->query);
+  free(filter_set);
+}
+
+gaus_error_t *
+filter_set_create_temporary(unsigned int filter_count, const gaus_header_filter_t *filters,
+                            gaus_filter_set_t **filter_set) {
+  *filter_set = NULL;
+  if (filter_count == 0) {
+    return NULL;
+  }
+  return gaus_filter_set_create(filter_count, filters, filter_set);
+}
+
+const char *filter_set_query(const gaus_filter_set_t *filter_set) {
+  return filter_set ? filter_set->query : "";
+}
+
+char *filter_set_get_condition(const gaus_filter_set_t *filter_set) {
+  char *header = NULL;
+
+  if (!filter_set) {
+    return NULL;
+  }
+  pthread_mutex_lock(&filter_set->condition->lock);
+  if (filter_set->condition->header) {
+    header = strdup(filter_set->condition->header);
+  }
+  pthread_mutex_unlock(&filter_set->condition->lock);
+  return header;
+}
+
+void filter_set_set_condition(const gaus_filter_set_t *filter_set, char *header) {
+  if (!filter_set) {
+    free(header);
+    return;
+  }
+  pthread_mutex_lock(&filter_set->condition->lock);
+  free(filter_set->condition->header);
+  filter_set->condition->header = header;
+  pthread_mutex_unlock(&filter_set->condition->lock);
+}
@@ -0,0 +1,53 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_FILTER_SET_H
+#define GAUS_FILTER_SET_H
+
+#include <pthread.h>
+#include <gaus/gaus_client_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The validator of the last reply to a check for updates without updates, making the next check conditional */
+typedef struct FilterSetCondition {
+  pthread_mutex_t lock;
+  char *header;
+} FilterSetCondition;
+
+/* Filters compiled into the query string of a request, only condition is changed after creation. */
+struct gaus_filter_set {
+  //"?name=value&..." with names and values percent-encoded, or "" without filters
+  char *query;
+  FilterSetCondition *condition;
+};
+
+/* Compile filters for a call taking an array of filters, filter_set is set to NULL if there are none.
+ *
+ * The filter set must be freed with gaus_filter_set_free.
+ */
+gaus_error_t *
+filter_set_create_temporary(unsigned int filter_count, const gaus_header_filter_t *filters,
+                            gaus_filter_set_t **filter_set);
+
+/* The query string of filter_set, "" if filter_set is NULL */
+const char *filter_set_query(const gaus_filter_set_t *filter_set);
+
+/* A newly allocated copy of the condition header kept for filter_set, NULL if there is none or filter_set is NULL */
+char *filter_set_get_condition(const gaus_filter_set_t *filter_set);
+
+/* Replace the condition header kept for filter_set with header, which may be NULL, taking ownership of it */
+void filter_set_set_condition(const gaus_filter_set_t *filter_set, char *header);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_FILTER_SET_H
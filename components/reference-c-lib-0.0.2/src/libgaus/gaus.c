@@ -8,19 +8,32 @@
 //
 //THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <gaus/gaus_client_types.h>
+#include "client.h"
 #include "curl_wrapper.h"
+#include "dns_cache.h"
 #include "gaus.h"
 #include "gaus/gaus_client.h"
 #include "log.h"
+#include "report_batch.h"
+#include "report_deadband.h"
+#include "report_queue.h"
+#include "retry.h"
+#include "session.h"
+#include "stats.h"
+#include "tls_session.h"
 #include <stdio.h>
 #include <malloc.h>
+#include <stdlib.h>
 #include <string.h>
-#include <stdarg.h>
 
 gaus_global_state_t gaus_global_state = {
     NULL,   //Server
     false,  //Initialized
-    NULL    //Proxy
+    NULL,   //Proxy
+    NULL,   //Client
+    {0},    //Call options
+    GAUS_REPORT_FORMAT_JSON, //Report format
+    GAUS_UPDATE_LAYOUT_SEPARATE //Update layout
 };
 
 gaus_version_t gaus_client_library_version(void) {
@@ -30,11 +43,23 @@ gaus_version_t gaus_client_library_version(void) {
 
 gaus_error_t *gaus_global_init(const char *serverUrl, const gaus_initialization_options_t *options) {
   if (!gaus_global_state.globalInitalized) {
+    //Checks its options, so it goes first
+    gaus_error_t *deadband_error = report_deadband_init(options ? &options->report_deadband : NULL);
+    if (deadband_error) {
+      return deadband_error;
+    }
     //Set state:
     CURLcode status = gaus_curl_global_init(CURL_GLOBAL_ALL);
     if (status != CURLE_OK) {
+      report_deadband_cleanup();
       return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Failed to globally initialize curl");
     }
+    gaus_error_t *client_error = gaus_client_init(&gaus_global_state.client);
+    if (client_error) {
+      report_deadband_cleanup();
+      gaus_curl_global_cleanup();
+      return client_error;
+    }
     gaus_global_state.serverUrl = strdup(serverUrl);
     if (options && options->proxy) {
       gaus_global_state.proxy = strdup(options->proxy);
@@ -42,6 +67,25 @@ gaus_error_t *gaus_global_init(const char *serverUrl, const gaus_initialization_
       //Ensure that proxy is initialized to NULL if not set.
       gaus_global_state.proxy = NULL;
     }
+    gaus_global_state.client->proxy = gaus_global_state.proxy;
+    if (options) {
+      gaus_global_state.call_options = options->call_options;
+    } else {
+      //No limits beyond the defaults of curl
+      memset(&gaus_global_state.call_options, 0, sizeof(gaus_call_options_t));
+    }
+    tls_session_init(options ? options->tls_session_store : NULL);
+    dns_cache_init(serverUrl, gaus_global_state.proxy, options ? options->dns_cache_store : NULL,
+                   options ? options->dns_ttl_s : 0);
+    report_queue_init(options ? options->report_queue_store : NULL);
+    report_batch_init(options ? &options->report_batch : NULL);
+    gaus_global_state.report_format = options ? options->report_format : GAUS_REPORT_FORMAT_JSON;
+    gaus_global_state.update_layout = options ? options->update_layout : GAUS_UPDATE_LAYOUT_SEPARATE;
+    stats_init();
+    retry_seed(serverUrl);
+    if (options && options->log_ring_lines && !log_start_async(options->log_ring_lines)) {
+      logging(L_WARNING, "Unable to log in the background, writing lines as they are logged");
+    }
     gaus_global_state.globalInitalized = true;
 
   }
@@ -52,29 +96,67 @@ void gaus_global_cleanup(void) {
   if (gaus_global_state.globalInitalized) {
     free(gaus_global_state.proxy);
     free(gaus_global_state.serverUrl);
+    tls_session_cleanup();
+    dns_cache_cleanup();
+    session_cleanup();
+    report_batch_cleanup();
+    gaus_client_cleanup(gaus_global_state.client);
+    gaus_global_state.client = NULL;
+    //After the client, which ends batches still in flight
+    report_queue_cleanup();
+    report_deadband_cleanup();
     gaus_curl_global_cleanup();
+    //Last, to write out what the rest logged while cleaning up
+    log_stop_async();
     gaus_global_state.globalInitalized = false;
   }
 }
 
 gaus_error_t *
-gaus_create_error(const char *func, gaus_error_type_t type, unsigned int code, const char *description, ...) {
+gaus_context_create(const char *serverUrl, const gaus_initialization_options_t *options, gaus_context_t **context) {
+  gaus_error_t *status = NULL;
+  gaus_context_t *created = NULL;
+
+  if (!gaus_global_state.globalInitalized) {
+    return gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Created a context without initializing");
+  }
+  if (!serverUrl || !context) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Created a context with invalid parameters");
+  }
+
+  if (!(created = calloc(1, sizeof(gaus_context_t)))
+      || !(created->serverUrl = strdup(serverUrl))
+      || (options && options->proxy && !(created->proxy = strdup(options->proxy)))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate context");
+    goto error;
+  }
+  if (NULL != (status = gaus_client_init(&created->client))) {
+    goto error;
+  }
+  created->client->proxy = created->proxy;
+  if (options) {
+    created->call_options = options->call_options;
+    created->report_format = options->report_format;
+    created->update_layout = options->update_layout;
+  } else {
+    created->report_format = GAUS_REPORT_FORMAT_JSON;
+    created->update_layout = GAUS_UPDATE_LAYOUT_SEPARATE;
+  }
+  created->globalInitalized = true;
+  *context = created;
+  return NULL;
 
-  //Figure out how big of a string is needed and malloc to fill in description.
-  va_list args;
-  va_start(args, description);
-  va_list args_backup;  //vsnprintf mangles args so we need a backup
-  va_copy(args_backup, args);
-  int needed = vsnprintf(NULL, 0, description, args) + 1;
-  char *buffer = malloc((size_t) needed);
-  vsprintf(buffer, description, args_backup);
-  va_end(args);
-  va_end(args_backup);
-  gaus_error_t *error = (gaus_error_t *) malloc(sizeof(gaus_error_t));
+  error:
+  gaus_context_free(created);
+  return status;
+}
 
-  logging(L_ERROR, "%s: %s", func, buffer);
-  error->error_type = type;
-  error->http_error_code = code;
-  error->description = buffer;
-  return error;
+void gaus_context_free(gaus_context_t *context) {
+  if (!context || context == &gaus_global_state) {
+    return;
+  }
+  gaus_client_cleanup(context->client);
+  free(context->proxy);
+  free(context->serverUrl);
+  free(context);
 }
@@ -17,11 +17,20 @@ extern "C" {
 #include <stdbool.h>
 #include <gaus/gaus_client_types.h>
 
-typedef struct {
+/* A context, only report_format changes once it is set up.  gaus_global_state is the context of calls without one,
+ * globalInitalized is set for all others. */
+struct gaus_context {
   char *serverUrl;
   bool globalInitalized;
   char *proxy;
-} gaus_global_state_t;
+  struct gaus_client *client;
+  gaus_call_options_t call_options;
+  //Falls back to json once the server refused another format, read and written atomically
+  gaus_report_format_t report_format;
+  gaus_update_layout_t update_layout;
+};
+
+typedef struct gaus_context gaus_global_state_t;
 
 extern gaus_global_state_t gaus_global_state;
 
@@ -12,6 +12,9 @@
 #include "gaus.h"
 #include "log.h"
 #include "request.h"
+#include "retry.h"
+#include "session.h"
+#include "url.h"
 #include "gaus_json_helpers.h"
 #include "../include/gaus/gaus_client_types.h"
 
@@ -23,21 +26,47 @@ static gaus_error_t *
 parse_authenticate_json(json_t *root, gaus_session_t *session);
 
 gaus_error_t *gaus_authenticate(const char *device_access, const char *device_secret, gaus_session_t *session) {
+  return gaus_authenticate_with_options(device_access, device_secret, session, NULL);
+}
+
+gaus_error_t *gaus_authenticate_with_options(const char *device_access, const char *device_secret,
+                                             gaus_session_t *session, const gaus_call_options_t *options) {
+  return gaus_context_authenticate(NULL, device_access, device_secret, session, options);
+}
+
+gaus_error_t *gaus_context_authenticate(gaus_context_t *context, const char *device_access, const char *device_secret,
+                                        gaus_session_t *session, const gaus_call_options_t *options) {
   gaus_error_t *status = NULL;
-  char *raw_authenticate_result = NULL;
-  char *json_auth_post_string = NULL;
-  json_t *json_authenticate_body = NULL;
-  json_t *json_authenticate_response = NULL;
+  RequestDeadline deadline;
 
-  if (!gaus_global_state.globalInitalized) {
-    status = gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Authenticated without initializing");
-    goto error;
+  if (!context) {
+    context = &gaus_global_state;
+  }
+  if (!context->globalInitalized) {
+    return gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Authenticated without initializing");
   }
 
   if (!device_access || !device_secret || !session) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Authenticated invalid parameters");
-    goto error;
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Authenticated invalid parameters");
   }
+  request_deadline_start(&deadline, options ? options : &context->call_options);
+  //Unique to the device, so retries across a fleet are spread out even if all devices started at once
+  retry_seed(device_access);
+
+  if (!(status = session_authenticate(context, device_access, device_secret, session, &deadline))) {
+    session_remember(device_access, device_secret, session);
+  }
+  return status;
+}
+
+gaus_error_t *session_authenticate(gaus_context_t *context, const char *device_access, const char *device_secret,
+                                   gaus_session_t *session, RequestDeadline *deadline) {
+  gaus_error_t *status = NULL;
+  char *raw_authenticate_result = NULL;
+  char *url = NULL;
+  char *json_auth_post_string = NULL;
+  json_t *json_authenticate_body = NULL;
+  json_t *json_authenticate_response = NULL;
 
   //Ensure that all char * pointers in session are initialized to NULL so they can be freed safely
   session->device_guid = NULL;
@@ -52,10 +81,16 @@ gaus_error_t *gaus_authenticate(const char *device_access, const char *device_se
 
   json_auth_post_string = json_dumps(json_authenticate_body, JSON_COMPACT);
 
-  char url[256];
-  create_url(url, sizeof(url), "%s/authenticate", gaus_global_state.serverUrl);
+  if (!(url = url_create("%s/authenticate", context->serverUrl))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to create authenticate url");
+    goto error;
+  }
   long status_code = 200; //Initialize to a default passing value unless request says otherwise.
-  raw_authenticate_result = request_post_as_string(url, NULL, json_auth_post_string, &status_code);
+  raw_authenticate_result = request_post_as_string(context->client, url, NULL, json_auth_post_string,
+                                                   deadline, &status_code);
+  if (!raw_authenticate_result && (status = request_deadline_error(__func__, deadline))) {
+    goto error;
+  }
   if (!raw_authenticate_result && status_code < 400) {
     status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Posting authenticate failed");
     goto error;
@@ -76,6 +111,7 @@ gaus_error_t *gaus_authenticate(const char *device_access, const char *device_se
   status = parse_authenticate_json(json_authenticate_response, session);
 
   error:
+  free(url);
   free(raw_authenticate_result);
   free(json_auth_post_string);
   json_decref(json_authenticate_body);
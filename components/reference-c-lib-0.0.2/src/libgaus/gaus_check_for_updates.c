@@ -8,92 +8,307 @@
 //
 //THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "gaus/gaus_client.h"
+#include "async.h"
 #include "curl_wrapper.h"
+#include "filter_set.h"
 #include "gaus.h"
 #include "log.h"
 #include "request.h"
+#include "session.h"
+#include "url.h"
 #include "gaus_json_helpers.h"
 #include <jansson.h>
 #include <string.h>
 
-static gaus_error_t *parse_update_json(json_t *root, unsigned int *updateCount, gaus_update_t **updates);
+static gaus_error_t *parse_update_json(json_t *root, gaus_update_layout_t update_layout, unsigned int *updateCount,
+                                       gaus_update_t **updates);
+
+typedef struct {
+  gaus_check_for_updates_callback_t callback;
+  void *user_data;
+} check_for_updates_async_t;
+
+/* Validate the parameters of a check for updates against context and build its url into a newly allocated url */
+static gaus_error_t *prepare_check_for_updates(const gaus_context_t *context, const gaus_session_t *session,
+                                               const gaus_filter_set_t *filter_set, char **url) {
+  if (!context->globalInitalized) {
+    return gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Checked for updates without initializing");
+  }
+
+  if (!session || !session->device_guid || !session->product_guid || !session->token) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Check for updates with invalid parameters");
+  }
+
+  *url = url_create_for_device(&context->client->url_prefix, context->serverUrl, session,
+                               "/check-for-updates", filter_set_query(filter_set));
+  if (!*url) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to create check for updates url");
+  }
+  return NULL;
+}
+
+/* Turn the reply to a check for updates into updates, replied is false if the request failed */
+static gaus_error_t *
+handle_check_for_updates_response(const char *url, bool replied, const RequestDeadline *deadline,
+                                  json_t *json_update_response, long status_code, gaus_update_layout_t update_layout,
+                                  unsigned int *update_count, gaus_update_t **updates) {
+  gaus_error_t *status = NULL;
+
+  if (!replied && (status = request_deadline_error(__func__, deadline))) {
+    return status;
+  }
+  if (!replied && status_code < 400) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Posting authenticate failed to url %s", url);
+  }
+  if (status_code >= 400) {
+    return gaus_create_error(__func__, GAUS_HTTP_ERROR, status_code,
+                             "Posting register failed with http error code %d to url %s",
+                             status_code, url);
+  }
+  if (!json_update_response) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error parsing json ");
+  }
+
+  return parse_update_json(json_update_response, update_layout, update_count, updates);
+}
 
 gaus_error_t *
 gaus_check_for_updates(const gaus_session_t *session, unsigned int filter_count, const gaus_header_filter_t *filters,
                        unsigned int *update_count, gaus_update_t **updates) {
+  gaus_filter_set_t *filter_set = NULL;
+  gaus_error_t *status = NULL;
+
+  if (NULL != (status = filter_set_create_temporary(filter_count, filters, &filter_set))) {
+    return status;
+  }
+  status = gaus_check_for_updates_with_filter_set(session, filter_set, update_count, updates);
+  gaus_filter_set_free(filter_set);
+  return status;
+}
+
+gaus_error_t *
+gaus_check_for_updates_with_filter_set(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                       unsigned int *update_count, gaus_update_t **updates) {
+  return gaus_check_for_updates_with_options(session, filter_set, update_count, updates, NULL);
+}
+
+gaus_error_t *
+gaus_check_for_updates_with_options(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                    unsigned int *update_count, gaus_update_t **updates,
+                                    const gaus_call_options_t *options) {
+  return gaus_context_check_for_updates(NULL, session, filter_set, update_count, updates, options);
+}
+
+gaus_error_t *
+gaus_context_check_for_updates(gaus_context_t *context, const gaus_session_t *session,
+                               const gaus_filter_set_t *filter_set, unsigned int *update_count, gaus_update_t **updates,
+                               const gaus_call_options_t *options) {
   gaus_error_t *status = NULL;
-  char *raw_check_for_update_result = NULL;
+  RequestDeadline deadline;
   json_t *json_update_response = NULL;
-  char *query_parms = NULL;
+  char *url = NULL;
+  //Without a filter set there is nowhere to keep the validator between calls
+  char *condition_header = filter_set_get_condition(filter_set);
+  RequestCondition condition = {condition_header, NULL};
 
-  if (!gaus_global_state.globalInitalized) {
-    return gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Checked for updates without initializing");
+  if (!context) {
+    context = &gaus_global_state;
   }
+  request_deadline_start(&deadline, options ? options : &context->call_options);
 
-  if (!session || !session->device_guid || !session->product_guid || !session->token
-      || !update_count || !updates) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Check for updates with invalid parameters");
+  if (NULL != (status = prepare_check_for_updates(context, session, filter_set, &url))) {
     goto error;
   }
 
-  if (filter_count > 0 && !filters) {
+  if (!update_count || !updates) {
     status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Check for updates with invalid parameters");
     goto error;
   }
 
-  if (filter_count > 0) {
-    query_parms = strdup("?");
-  } else {
-    query_parms = strdup("");
+  const char *token = session_acquire(session);
+  long status_code = 200; //Initialize to a default passing value unless request says otherwise.
+  //The reply is parsed while it arrives, so the raw body is never held in memory as a whole.
+  int result = request_get_as_json(context->client, url, token, filter_set ? &condition : NULL, &deadline,
+                                   &json_update_response, &status_code);
+  if (status_code == 401) {
+    //The session expired, renew it and check once more
+    if (NULL != (status = session_refresh(context, session, token, &deadline))) {
+      session_release();
+      goto error;
+    }
+    session_release();
+    token = session_acquire(session);
+    json_decref(json_update_response);
+    json_update_response = NULL;
+    free(condition.validator);
+    condition.validator = NULL;
+    status_code = 200;
+    result = request_get_as_json(context->client, url, token, filter_set ? &condition : NULL, &deadline,
+                                 &json_update_response, &status_code);
   }
-  for (unsigned int i = 0; i < filter_count; i++) {
-    //Create strings for each filter:
-    char *filter_string = strdup(i > 0 ? "&%s=%s" : "%s=%s");
-    int required_length = snprintf(NULL, 0, filter_string, filters[i].filter_name, filters[i].filter_value) + 1;
-    char *new_filter = malloc(required_length);
-    sprintf(new_filter, filter_string, filters[i].filter_name, filters[i].filter_value);
-    query_parms = realloc(query_parms, strlen(query_parms) + required_length);
-    strcat(query_parms, new_filter);
-    free(filter_string);
-    free(new_filter);
+  session_release();
+  if (result == 0 && status_code == 304) {
+    //Nothing changed since the last reply, which had no updates, so there is nothing to parse
+    *update_count = 0;
+    *updates = NULL;
+    goto error;
+  }
+  status = handle_check_for_updates_response(url, result == 0, &deadline, json_update_response, status_code,
+                                             context->update_layout, update_count, updates);
+  //Only a reply without updates can stand in for a 304, updates must be fetched again until they are installed
+  if (result == 0 && !status && *update_count == 0) {
+    filter_set_set_condition(filter_set, condition.validator);
+    condition.validator = NULL;
+  } else if (result == 0) {
+    filter_set_set_condition(filter_set, NULL);
   }
 
-  //Fixme: This should be dynamically allocated
-  char url[256];
-  create_url(url, sizeof(url), "%s/device/%s/%s/check-for-updates%s",
-             gaus_global_state.serverUrl, session->product_guid, session->device_guid, query_parms);
-  long status_code = 200; //Initialize to a default passing value unless request says otherwise.
-  raw_check_for_update_result = request_get_as_string(url, session->token, &status_code);
-  if (!raw_check_for_update_result && status_code < 400) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Posting authenticate failed to url %s", url);
-    goto error;
+  error:
+  free(condition_header);
+  free(condition.validator);
+  free(url);
+  json_decref(json_update_response);
+  return status;
+}
+
+static void check_for_updates_async_done(int result, long status_code, const char *response, const char *url,
+                                         const RequestDeadline *deadline, void *user_data) {
+  check_for_updates_async_t *async = user_data;
+  unsigned int update_count = 0;
+  gaus_update_t *updates = NULL;
+
+  json_t *json_update_response = NULL;
+
+  if (result == 0 && response) {
+    json_error_t json_error;
+    json_update_response = json_loads(response, JSON_DECODE_ANY, &json_error);
   }
-  if (status_code >= 400) {
-    status = gaus_create_error(__func__, GAUS_HTTP_ERROR, status_code,
-                               "Posting register failed with http error code %d to url %s",
-                               status_code, url);
-    goto error;
+  gaus_error_t *status = handle_check_for_updates_response(url, result == 0 && response, deadline,
+                                                           json_update_response, status_code,
+                                                           gaus_global_state.update_layout, &update_count, &updates);
+  json_decref(json_update_response);
+  async->callback(status, update_count, updates, async->user_data);
+  free(async);
+}
+
+gaus_error_t *
+gaus_check_for_updates_async(const gaus_session_t *session, unsigned int filter_count,
+                             const gaus_header_filter_t *filters, gaus_check_for_updates_callback_t callback,
+                             void *user_data) {
+  gaus_filter_set_t *filter_set = NULL;
+  gaus_error_t *status = NULL;
+
+  if (NULL != (status = filter_set_create_temporary(filter_count, filters, &filter_set))) {
+    return status;
   }
+  status = gaus_check_for_updates_with_filter_set_async(session, filter_set, callback, user_data);
+  gaus_filter_set_free(filter_set);
+  return status;
+}
+
+gaus_error_t *
+gaus_check_for_updates_with_filter_set_async(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                             gaus_check_for_updates_callback_t callback, void *user_data) {
+  gaus_error_t *status = NULL;
+  check_for_updates_async_t *async = NULL;
+  char *url = NULL;
 
-  json_error_t json_error;
-  if (!(json_update_response = json_loads(raw_check_for_update_result, JSON_DECODE_ANY, &json_error))) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error parsing json ");
+  if (!callback) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Check for updates with invalid parameters");
+  }
+
+  if (!(async = malloc(sizeof(check_for_updates_async_t)))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate request");
     goto error;
   }
 
-  status = parse_update_json(json_update_response, update_count, updates);
+  if (NULL != (status = prepare_check_for_updates(&gaus_global_state, session, filter_set, &url))) {
+    goto error;
+  }
 
+  async->callback = callback;
+  async->user_data = user_data;
+  //Ownership of url is handed over even if starting the request fails.
+  const char *token = session_acquire(session);
+  int started = async_request_start(gaus_global_state.client, url, token, NULL, check_for_updates_async_done, async);
+  session_release();
+  if (0 != started) {
+    free(async);
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to start check for updates");
+  }
+  return NULL;
 
   error:
-  free(query_parms);
-  free(raw_check_for_update_result);
-  json_decref(json_update_response);
+  free(url);
+  free(async);
   return status;
 }
 
-static gaus_error_t *parse_update_json(json_t *root, unsigned int *updateCount, gaus_update_t **updates) {
+void gaus_updates_free(gaus_update_t *updates) {
+  free(updates);
+}
+
+/* Where the parts of updates go: each allocated on its own with NULL cursors, or else into one block with the arrays
+ * from its start and the strings after them */
+typedef struct {
+  char *arrays;
+  char *strings;
+} UpdatesLayout;
+
+static void *layout_array(UpdatesLayout *layout, size_t size) {
+  if (!layout->arrays) {
+    return malloc(size);
+  }
+  void *array = layout->arrays;
+  layout->arrays += size;
+  return array;
+}
+
+static char *layout_string(UpdatesLayout *layout, const char *value) {
+  if (!value || !layout->strings) {
+    return value ? strdup(value) : NULL;
+  }
+  size_t size = strlen(value) + 1;
+  char *copy = memcpy(layout->strings, value, size);
+  layout->strings += size;
+  return copy;
+}
+
+/* The string at key of dict copied, NULL if it is missing or not a string */
+static char *layout_dict_string(UpdatesLayout *layout, json_t *dict, char *key) {
+  return layout_string(layout, get_dict_string(dict, key, NULL));
+}
+
+/* The bytes of arrays and of strings needed to lay out json_updates in one block.  Every string that may be copied is
+ * counted, whether it turns out to be valid or not. */
+static void one_block_size(json_t *json_updates, size_t *arrays_size, size_t *strings_size) {
+  static const char *const string_names[] = {UPDATE_TYPE_JSON, PACKAGE_TYPE_JSON, MD5_JSON, UPDATE_ID_JSON,
+                                             VERSION_JSON, DOWNLOAD_URL_JSON};
+  size_t index = 0;
+  json_t *json_update = NULL;
+
+  *arrays_size = sizeof(gaus_update_t) * json_array_size(json_updates);
+  *strings_size = 0;
+  json_array_foreach(json_updates, index, json_update) {
+    json_t *json_metadata = json_object_get(json_update, METADATA_JSON);
+    const char *key = NULL;
+    json_t *value = NULL;
+    *arrays_size += sizeof(gaus_key_value_t) * json_object_size(json_metadata);
+    json_object_foreach(json_metadata, key, value) {
+      *strings_size += strlen(key) + 1 + json_string_length(value) + 1;
+    }
+    for (size_t i = 0; i < sizeof(string_names) / sizeof(string_names[0]); i++) {
+      *strings_size += json_string_length(json_object_get(json_update, string_names[i])) + 1;
+    }
+  }
+}
+
+static gaus_error_t *parse_update_json(json_t *root, gaus_update_layout_t update_layout, unsigned int *updateCount,
+                                       gaus_update_t **updates) {
   gaus_error_t *error = NULL;
   json_t *json_updates = NULL;
+  UpdatesLayout layout = {NULL, NULL};
+  char *block = NULL;
 
   if (!json_is_object(root)) {
     error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Server reply invalid: json root is not an object");
@@ -110,8 +325,21 @@ static gaus_error_t *parse_update_json(json_t *root, unsigned int *updateCount,
   *updateCount = json_array_size(json_updates);
 
   if (*updateCount > 0) {
+    if (update_layout == GAUS_UPDATE_LAYOUT_ONE_BLOCK) {
+      size_t arrays_size = 0;
+      size_t strings_size = 0;
+      one_block_size(json_updates, &arrays_size, &strings_size);
+      if (!(block = calloc(1, arrays_size + strings_size))) {
+        *updateCount = 0;
+        error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate updates");
+        goto error;
+      }
+      layout.arrays = block;
+      layout.strings = block + arrays_size;
+    }
+
     //Allocate memory for updates:
-    *updates = malloc(sizeof(gaus_update_t) * *updateCount);
+    *updates = layout_array(&layout, sizeof(gaus_update_t) * *updateCount);
 
     for (size_t i = 0; i < *updateCount; i++) {
       json_t *json_metadata = NULL;
@@ -139,13 +367,13 @@ static gaus_error_t *parse_update_json(json_t *root, unsigned int *updateCount,
       (*updates)[i].metadata_count = json_object_size(json_metadata);
 
       //Allocate memory for metadata:
-      (*updates)[i].metadata = malloc(sizeof(gaus_key_value_t) * (*updates)[i].metadata_count);
+      (*updates)[i].metadata = layout_array(&layout, sizeof(gaus_key_value_t) * (*updates)[i].metadata_count);
 
       const char *key = NULL;
       json_t *value = NULL;
       unsigned int j = 0;
       json_object_foreach(json_metadata, key, value) {
-        (*updates)[i].metadata[j].key = strdup(key);
+        (*updates)[i].metadata[j].key = layout_string(&layout, key);
 
         if (!json_is_string(value)) {
           error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
@@ -153,29 +381,29 @@ static gaus_error_t *parse_update_json(json_t *root, unsigned int *updateCount,
           goto error;
         }
 
-        (*updates)[i].metadata[j].value = strdup(json_string_value(value));
+        (*updates)[i].metadata[j].value = layout_string(&layout, json_string_value(value));
         j++;
       }
 
-      if (!((*updates)[i].update_type = dup_dict_string(json_current_update, UPDATE_TYPE_JSON, NULL))) {
+      if (!((*updates)[i].update_type = layout_dict_string(&layout, json_current_update, UPDATE_TYPE_JSON))) {
         error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
                                   "Server reply invalid: required \\\"updateType\\\" missing in object\"");
         goto error;
       }
 
-      if (!((*updates)[i].package_type = dup_dict_string(json_current_update, PACKAGE_TYPE_JSON, NULL))) {
+      if (!((*updates)[i].package_type = layout_dict_string(&layout, json_current_update, PACKAGE_TYPE_JSON))) {
         error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
                                   "Server reply invalid: required \\\"packageType\\\" missing in object\"");
         goto error;
       }
 
-      if (!((*updates)[i].update_id = dup_dict_string(json_current_update, UPDATE_ID_JSON, NULL))) {
+      if (!((*updates)[i].update_id = layout_dict_string(&layout, json_current_update, UPDATE_ID_JSON))) {
         error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
                                   "Server reply invalid: required \\\"updateId\\\" missing in object\"");
         goto error;
       }
 
-      if (!((*updates)[i].version = dup_dict_string(json_current_update, VERSION_JSON, NULL))) {
+      if (!((*updates)[i].version = layout_dict_string(&layout, json_current_update, VERSION_JSON))) {
         error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
                                   "Server reply invalid: required \\\"version\\\" missing in object\"");
         goto error;
@@ -194,13 +422,13 @@ static gaus_error_t *parse_update_json(json_t *root, unsigned int *updateCount,
           goto error;
         }
 
-        if (!((*updates)[i].md5 = dup_dict_string(json_current_update, MD5_JSON, NULL))) {
+        if (!((*updates)[i].md5 = layout_dict_string(&layout, json_current_update, MD5_JSON))) {
           error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
                                     "Server reply invalid: required \\\"md5\\\" missing in object\"");
           goto error;
         }
 
-        if (!((*updates)[i].download_url = dup_dict_string(json_current_update, DOWNLOAD_URL_JSON, NULL))) {
+        if (!((*updates)[i].download_url = layout_dict_string(&layout, json_current_update, DOWNLOAD_URL_JSON))) {
           error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
                                     "Server reply invalid: required \\\"downloadUrl\\\" missing in object\"");
           goto error;
@@ -210,5 +438,10 @@ static gaus_error_t *parse_update_json(json_t *root, unsigned int *updateCount,
   }
 
   error:
+  if (error && block) {
+    free(block);
+    *updateCount = 0;
+    *updates = NULL;
+  }
   return error;
 }
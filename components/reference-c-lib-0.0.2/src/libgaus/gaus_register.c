@@ -12,6 +12,7 @@
 #include "gaus.h"
 #include "log.h"
 #include "request.h"
+#include "url.h"
 #include "gaus_json_helpers.h"
 #include <jansson.h>
 #include <string.h>
@@ -22,12 +23,32 @@ parse_device_json(json_t *root, char **device_access, char **device_secret, unsi
 
 gaus_error_t *gaus_register(const char *product_access, const char *product_secret, const char *device_id,
                             char **device_access, char **device_secret, unsigned int *poll_interval_seconds) {
+  return gaus_register_with_options(product_access, product_secret, device_id, device_access, device_secret,
+                                    poll_interval_seconds, NULL);
+}
+
+gaus_error_t *
+gaus_register_with_options(const char *product_access, const char *product_secret, const char *device_id,
+                           char **device_access, char **device_secret, unsigned int *poll_interval_seconds,
+                           const gaus_call_options_t *options) {
+  return gaus_context_register(NULL, product_access, product_secret, device_id, device_access, device_secret,
+                               poll_interval_seconds, options);
+}
+
+gaus_error_t *
+gaus_context_register(gaus_context_t *context, const char *product_access, const char *product_secret,
+                      const char *device_id, char **device_access, char **device_secret,
+                      unsigned int *poll_interval_seconds, const gaus_call_options_t *options) {
 
   gaus_error_t *error = NULL;
+  RequestDeadline deadline;
   json_t *json_register_response = NULL;
   json_t *json_device_params = NULL;
 
-  if (!gaus_global_state.globalInitalized) {
+  if (!context) {
+    context = &gaus_global_state;
+  }
+  if (!context->globalInitalized) {
     return gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Registered without initializing");
   }
 
@@ -36,6 +57,7 @@ gaus_error_t *gaus_register(const char *product_access, const char *product_secr
       || !device_access || !device_secret || !poll_interval_seconds) {
     return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Registered with invalid input parameters");
   }
+  request_deadline_start(&deadline, options ? options : &context->call_options);
 
   json_t *register_body_json = json_pack("{s:s,s:{s:s, s:s}}",
                                          DEVICE_ID_JSON, device_id,
@@ -46,10 +68,18 @@ gaus_error_t *gaus_register(const char *product_access, const char *product_secr
 
   char *jsonString = json_dumps(register_body_json, JSON_COMPACT);
 
-  char url[256];
-  create_url(url, sizeof(url), "%s/register", gaus_global_state.serverUrl);
+  char *raw_register_result = NULL;
+  char *url = url_create("%s/register", context->serverUrl);
+  if (!url) {
+    error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to create register url");
+    goto error;
+  }
   long status_code = 200; //Initialize to a default passing value unless request says otherwise.
-  char *raw_register_result = request_post_as_string(url, NULL, jsonString, &status_code);
+  raw_register_result = request_post_as_string(context->client, url, NULL, jsonString, &deadline,
+                                               &status_code);
+  if (!raw_register_result && (error = request_deadline_error(__func__, &deadline))) {
+    goto error;
+  }
   if (!raw_register_result && status_code < 400) {
     error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Posting register failed");
     goto error;
@@ -70,6 +100,7 @@ gaus_error_t *gaus_register(const char *product_access, const char *product_secr
   error = parse_device_json(json_register_response, device_access, device_secret, poll_interval_seconds);
 
   error:
+  free(url);
   free(raw_register_result);
   free(jsonString);
   json_decref(register_body_json);
@@ -8,338 +8,570 @@
 //
 //THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "gaus/gaus_client.h"
+#include "async.h"
+#include "cbor_writer.h"
+#include "filter_set.h"
 #include "gaus.h"
+#include "json_writer.h"
+#include "report.h"
+#include "report_deadband.h"
 #include "request.h"
+#include "session.h"
+#include "url.h"
 #include "gaus_json_helpers.h"
 #include "log.h"
 
-#include <jansson.h>
 #include <string.h>
 
-static gaus_error_t *
-get_json_for_vints(unsigned int int_count, gaus_v_int_t *v_ints, json_t **json_v_ints);
-
-static gaus_error_t *
-get_json_for_vfloats(unsigned int float_count, gaus_v_float_t *v_floats, json_t **json_v_floats);
+//Room for a typical report, so most bodies are written without growing the buffer
+#define REPORT_SIZE_HINT 192
 
-static gaus_error_t *
-get_json_for_vstrings(unsigned int string_count, gaus_v_string_t *v_strings, json_t **json_v_strings);
-
-static gaus_error_t *create_json_for_header(const gaus_report_header_t *header, json_t **json_header);
+#define CBOR_CONTENT_TYPE_HEADER "Content-Type: application/cbor"
 
-static gaus_error_t *
-create_json_for_update_status(const gaus_report_t *report, json_t **json_report);
+typedef struct {
+  gaus_report_callback_t callback;
+  void *user_data;
+  gaus_report_format_t format;
+  DeadbandUpdate *update;
+} report_async_t;
 
-static gaus_error_t *
-create_json_for_generic(const gaus_report_t *report, json_t **json_report);
-
-gaus_error_t *
-gaus_report(const gaus_session_t *session, unsigned int filter_count, const gaus_header_filter_t *filters,
-            const gaus_report_header_t *header, unsigned int report_count, const gaus_report_t *reports) {
+/* Whether item i of an array of v_ints, v_floats or v_strings (all of which start with their name) has the name of an
+ * earlier item.  Only the first value of a name is reported.
+ */
+static bool repeated_name(const void *items, size_t item_size, unsigned int i) {
+  const char *name = *(const char *const *) ((const char *) items + i * item_size);
 
-  json_t *json_header = NULL;
-  json_t *json_to_send = NULL;
-  json_t *json_reports_array = NULL;
-  json_t *json_temp_one_report = NULL;
-  char *report_post_body = NULL;
-  char *query_parms = NULL;
+  for (unsigned int j = 0; j < i && name; j++) {
+    const char *earlier = *(const char *const *) ((const char *) items + j * item_size);
+    if (earlier && strcmp(earlier, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
 
-  gaus_error_t *status = NULL;
-  char *raw_report_result = NULL;
+/* The number of different names in an array of v_ints, v_floats or v_strings, see repeated_name */
+static unsigned int count_names(const void *items, size_t item_size, unsigned int count) {
+  unsigned int names = 0;
 
-  if (!gaus_global_state.globalInitalized) {
-    status = gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Checked for updates without initializing");
-    goto error;
+  for (unsigned int i = 0; i < count; i++) {
+    if (!repeated_name(items, item_size, i)) {
+      names++;
+    }
   }
+  return names;
+}
 
-  if (!session || !session->device_guid || !session->product_guid || !session->token
-      || !header || report_count < 1 || !reports) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Check for updates with invalid parameters");
-    goto error;
+/* Start the member called name of an object, after the first member of the object when first is false */
+static void write_member(json_writer_t *writer, bool first, const char *name) {
+  if (!first) {
+    JSON_WRITER_LITERAL(writer, ",");
   }
+  json_writer_string(writer, name);
+  JSON_WRITER_LITERAL(writer, ":");
+}
 
-  if (filter_count > 0 && !filters) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Check for updates with invalid parameters");
-    goto error;
+// Writes {"name":value, ...} for however many v_ints are passed in.  Names need to be unique, only the first value of
+// a name is written.  (The same as adding them to an object with json_object_update_missing)
+static void write_v_ints(json_writer_t *writer, unsigned int int_count, const gaus_v_int_t *v_ints) {
+  JSON_WRITER_LITERAL(writer, "{");
+  for (unsigned int i = 0; i < int_count && !writer->failed; i++) {
+    if (!repeated_name(v_ints, sizeof(*v_ints), i)) {
+      write_member(writer, i == 0, v_ints[i].name);
+      json_writer_integer(writer, v_ints[i].value);
+    }
   }
+  JSON_WRITER_LITERAL(writer, "}");
+}
 
-  if (filter_count > 0) {
-    query_parms = strdup("?");
-  } else {
-    query_parms = strdup("");
-  }
-  for (unsigned int i = 0; i < filter_count; i++) {
-    //Create strings for each filter:
-    char *filter_string = strdup(i > 0 ? "&%s=%s" : "%s=%s");
-    int required_length = snprintf(NULL, 0, filter_string, filters[i].filter_name, filters[i].filter_value) + 1;
-    char *new_filter = malloc(required_length);
-    sprintf(new_filter, filter_string, filters[i].filter_name, filters[i].filter_value);
-    query_parms = realloc(query_parms, strlen(query_parms) + required_length);
-    strcat(query_parms, new_filter);
-    free(filter_string);
-    free(new_filter);
+// Writes {"name":value, ...} for however many v_floats are passed in, see write_v_ints.
+static void write_v_floats(json_writer_t *writer, unsigned int float_count, const gaus_v_float_t *v_floats) {
+  JSON_WRITER_LITERAL(writer, "{");
+  for (unsigned int i = 0; i < float_count && !writer->failed; i++) {
+    if (!repeated_name(v_floats, sizeof(*v_floats), i)) {
+      write_member(writer, i == 0, v_floats[i].name);
+      json_writer_real(writer, v_floats[i].value);
+    }
   }
+  JSON_WRITER_LITERAL(writer, "}");
+}
 
-  if (NULL != (status = create_json_for_header(header, &json_header))) {
-    goto error;
+// Writes {"name":"value", ...} for however many v_strings are passed in, see write_v_ints.
+static void write_v_strings(json_writer_t *writer, unsigned int string_count, const gaus_v_string_t *v_strings) {
+  JSON_WRITER_LITERAL(writer, "{");
+  for (unsigned int i = 0; i < string_count && !writer->failed; i++) {
+    if (!repeated_name(v_strings, sizeof(*v_strings), i)) {
+      write_member(writer, i == 0, v_strings[i].name);
+      json_writer_string(writer, v_strings[i].value);
+    }
   }
+  JSON_WRITER_LITERAL(writer, "}");
+}
 
-  if (NULL == (json_reports_array = json_array())) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to create reports array");
-    goto error;
+/* Write everything of a report body up to and including the opening of its data array */
+static void write_body_prefix(json_writer_t *writer, const gaus_report_header_t *header) {
+  JSON_WRITER_LITERAL(writer, "{\"" VERSION_JSON "\":\"" VERSION_1_0_0_JSON "\",\"" HEADER_JSON "\":{\"" TS_JSON "\":");
+  json_writer_string(writer, header->ts);
+  JSON_WRITER_LITERAL(writer, "},\"" DATA_JSON "\":[");
+}
+
+/* Write report as an element of the data array, with its members in the order they always had */
+static gaus_error_t *write_report(json_writer_t *writer, const gaus_report_t *report) {
+  switch (report->report_type) {
+    case GAUS_REPORT_UPDATE:
+      JSON_WRITER_LITERAL(writer, "{\"" TYPE_JSON "\":\"" UPDATE_STATUS_TYPE_JSON "\",\"" TS_JSON "\":");
+      json_writer_string(writer, report->report.update_status.ts);
+      JSON_WRITER_LITERAL(writer, ",\"" V_STRINGS_JSON "\":");
+      write_v_strings(writer, report->report.update_status.v_string_count, report->report.update_status.v_strings);
+      JSON_WRITER_LITERAL(writer, "}");
+      return NULL;
+    case GAUS_REPORT_GENERIC:
+      JSON_WRITER_LITERAL(writer, "{\"" TYPE_JSON "\":");
+      json_writer_string_prefixed(writer, UPDATE_GENERIC_TYPE_JSON, report->report.generic.type);
+      JSON_WRITER_LITERAL(writer, ",\"" TS_JSON "\":");
+      json_writer_string(writer, report->report.generic.ts);
+      JSON_WRITER_LITERAL(writer, ",\"" V_INTS_JSON "\":");
+      write_v_ints(writer, report->report.generic.v_int_count, report->report.generic.v_ints);
+      JSON_WRITER_LITERAL(writer, ",\"" V_FLOATS_JSON "\":");
+      write_v_floats(writer, report->report.generic.v_float_count, report->report.generic.v_floats);
+      JSON_WRITER_LITERAL(writer, ",\"" V_STRINGS_JSON "\":");
+      write_v_strings(writer, report->report.generic.v_string_count, report->report.generic.v_strings);
+      JSON_WRITER_LITERAL(writer, "}");
+      return NULL;
+    default:
+      return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unsupported report type!");
   }
+}
 
-  //Process each report
-  for (unsigned int i = 0; i < report_count; i++) {
-    switch (reports[i].report_type) {
-      case GAUS_REPORT_UPDATE:
-        if (NULL != (status = create_json_for_update_status(&reports[i], &json_temp_one_report))) {
-          goto error;
-        }
-        break;
-      case GAUS_REPORT_GENERIC:
-        if (NULL != (status = create_json_for_generic(&reports[i], &json_temp_one_report))) {
-          goto error;
-        }
-        break;
-      default:
-        status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unsupported report type!");
-        goto error;
+// The CBOR counterparts of the json writers above, writing the same structure with the same names.  Maps need their
+// size up front, so repeated names are counted out first.
+static void cbor_write_v_ints(cbor_writer_t *writer, unsigned int int_count, const gaus_v_int_t *v_ints) {
+  cbor_writer_map(writer, count_names(v_ints, sizeof(*v_ints), int_count));
+  for (unsigned int i = 0; i < int_count && !writer->failed; i++) {
+    if (!repeated_name(v_ints, sizeof(*v_ints), i)) {
+      cbor_writer_string(writer, v_ints[i].name);
+      cbor_writer_integer(writer, v_ints[i].value);
     }
-    if (0 != json_array_append_new(json_reports_array, json_temp_one_report)) {
-      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to add report to array");
-      goto error;
-    }
-
   }
+}
 
-  //Combine header/report array into what we will send:
-  if (!(json_to_send = json_pack("{s:s,s:o,s:o}",
-                                 VERSION_JSON, VERSION_1_0_0_JSON,
-                                 HEADER_JSON, json_header,
-                                 DATA_JSON, json_reports_array))) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding header");
+static void cbor_write_v_floats(cbor_writer_t *writer, unsigned int float_count, const gaus_v_float_t *v_floats) {
+  cbor_writer_map(writer, count_names(v_floats, sizeof(*v_floats), float_count));
+  for (unsigned int i = 0; i < float_count && !writer->failed; i++) {
+    if (!repeated_name(v_floats, sizeof(*v_floats), i)) {
+      cbor_writer_string(writer, v_floats[i].name);
+      cbor_writer_float(writer, v_floats[i].value);
+    }
   }
+}
 
-  report_post_body = json_dumps(json_to_send, JSON_COMPACT);
-
-  //Fixme: This should be dynamically allocated:
-  char url[256];
-  create_url(url, sizeof(url), "%s/device/%s/%s/report%s",
-             gaus_global_state.serverUrl, session->product_guid, session->device_guid, query_parms);
-  long status_code = 200; //Initialize to a default passing value unless request says otherwise.
-  raw_report_result = request_post_as_string(url, session->token, report_post_body, &status_code);
-  if (!raw_report_result && status_code < 400) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Posting authenticate failed");
-    goto error;
+static void cbor_write_v_strings(cbor_writer_t *writer, unsigned int string_count, const gaus_v_string_t *v_strings) {
+  cbor_writer_map(writer, count_names(v_strings, sizeof(*v_strings), string_count));
+  for (unsigned int i = 0; i < string_count && !writer->failed; i++) {
+    if (!repeated_name(v_strings, sizeof(*v_strings), i)) {
+      cbor_writer_string(writer, v_strings[i].name);
+      cbor_writer_string(writer, v_strings[i].value);
+    }
   }
-  if (status_code >= 400) {
-    status = gaus_create_error(__func__, GAUS_HTTP_ERROR, status_code,
-                               "Posting authenticate failed with http error code %d",
-                               status_code);
-    goto error;
+}
+
+static gaus_error_t *cbor_write_report(cbor_writer_t *writer, const gaus_report_t *report) {
+  switch (report->report_type) {
+    case GAUS_REPORT_UPDATE:
+      cbor_writer_map(writer, 3);
+      cbor_writer_string(writer, TYPE_JSON);
+      cbor_writer_string(writer, UPDATE_STATUS_TYPE_JSON);
+      cbor_writer_string(writer, TS_JSON);
+      cbor_writer_string(writer, report->report.update_status.ts);
+      cbor_writer_string(writer, V_STRINGS_JSON);
+      cbor_write_v_strings(writer, report->report.update_status.v_string_count,
+                           report->report.update_status.v_strings);
+      return NULL;
+    case GAUS_REPORT_GENERIC:
+      cbor_writer_map(writer, 5);
+      cbor_writer_string(writer, TYPE_JSON);
+      cbor_writer_string_prefixed(writer, UPDATE_GENERIC_TYPE_JSON, report->report.generic.type);
+      cbor_writer_string(writer, TS_JSON);
+      cbor_writer_string(writer, report->report.generic.ts);
+      cbor_writer_string(writer, V_INTS_JSON);
+      cbor_write_v_ints(writer, report->report.generic.v_int_count, report->report.generic.v_ints);
+      cbor_writer_string(writer, V_FLOATS_JSON);
+      cbor_write_v_floats(writer, report->report.generic.v_float_count, report->report.generic.v_floats);
+      cbor_writer_string(writer, V_STRINGS_JSON);
+      cbor_write_v_strings(writer, report->report.generic.v_string_count, report->report.generic.v_strings);
+      return NULL;
+    default:
+      return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unsupported report type!");
   }
-  error:
-  free(report_post_body);
-  free(raw_report_result);
-  free(query_parms);
-  json_decref(json_to_send);
-  return status;
 }
 
-// Produces {s:s, s:s, s:s, ...} for however many v_ints are passed in.  All keys need to be
-// unique or they will be ignored. (We just add missing keys to the json object)
-static gaus_error_t *
-get_json_for_vints(unsigned int int_count, gaus_v_int_t *v_ints, json_t **json_v_ints) {
+static gaus_error_t *encode_json_body(const gaus_report_header_t *header, unsigned int report_count,
+                                      const gaus_report_t *reports, char **body, size_t *length) {
+  json_writer_t writer;
   gaus_error_t *status = NULL;
-  *json_v_ints = json_object();
 
-  for (unsigned int i = 0; i < int_count; i++) {
-    json_t *this_v_float = json_pack("{s:i}", v_ints[i].name, v_ints[i].value);
-    if (this_v_float == NULL) {
-      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error parsing v_ints");
+  //Written straight into the body, without building a json tree of it first
+  json_writer_init(&writer, REPORT_SIZE_HINT * ((size_t) report_count + 1));
+  write_body_prefix(&writer, header);
+  for (unsigned int i = 0; i < report_count; i++) {
+    if (i > 0) {
+      JSON_WRITER_LITERAL(&writer, ",");
     }
-    int result = json_object_update_missing(*json_v_ints, this_v_float);
-    if (result != 0) {
-      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding v_ints");
+    if (NULL != (status = write_report(&writer, &reports[i]))) {
+      goto error;
     }
-    json_decref(this_v_float);
   }
+  JSON_WRITER_LITERAL(&writer, REPORT_BODY_SUFFIX);
+  *length = writer.length;
+  if (!(*body = json_writer_take(&writer))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding reports");
+    *length = 0;
+    goto error;
+  }
+
+  error:
+  json_writer_free(&writer);
   return status;
 }
 
-// Produces {s:s, s:s, s:s, ...} for however many v_floats are passed in.  All keys need to be
-// unique or they will be ignored. (We just add missing keys to the json object)
-static gaus_error_t *
-get_json_for_vfloats(unsigned int float_count, gaus_v_float_t *v_floats, json_t **json_v_floats) {
+static gaus_error_t *encode_cbor_body(const gaus_report_header_t *header, unsigned int report_count,
+                                      const gaus_report_t *reports, char **body, size_t *length) {
+  cbor_writer_t writer;
   gaus_error_t *status = NULL;
-  *json_v_floats = json_object();
 
-  for (unsigned int i = 0; i < float_count; i++) {
-    json_t *this_v_float = json_pack("{s:f}", v_floats[i].name, v_floats[i].value);
-    if (this_v_float == NULL) {
-      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error parsing v_floats");
-    }
-    int result = json_object_update_missing(*json_v_floats, this_v_float);
-    if (result != 0) {
-      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding v_floats");
+  //Roughly two thirds of the json
+  cbor_writer_init(&writer, REPORT_SIZE_HINT * ((size_t) report_count + 1) * 2 / 3);
+  cbor_writer_map(&writer, 3);
+  cbor_writer_string(&writer, VERSION_JSON);
+  cbor_writer_string(&writer, VERSION_1_0_0_JSON);
+  cbor_writer_string(&writer, HEADER_JSON);
+  cbor_writer_map(&writer, 1);
+  cbor_writer_string(&writer, TS_JSON);
+  cbor_writer_string(&writer, header->ts);
+  cbor_writer_string(&writer, DATA_JSON);
+  cbor_writer_array(&writer, report_count);
+  for (unsigned int i = 0; i < report_count; i++) {
+    if (NULL != (status = cbor_write_report(&writer, &reports[i]))) {
+      goto error;
     }
-    json_decref(this_v_float);
   }
+  if (!(*body = cbor_writer_take(&writer, length))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding reports");
+    goto error;
+  }
+
+  error:
+  cbor_writer_free(&writer);
   return status;
 }
 
-// Produces {s:s, s:s, s:s, ...} for however many v_strings are passed in.  All keys need to be
-// unique or they will be ignored. (We just add missing keys to the json object)
-static gaus_error_t *
-get_json_for_vstrings(unsigned int string_count, gaus_v_string_t *v_strings, json_t **json_v_strings) {
-  gaus_error_t *status = NULL;
-  *json_v_strings = json_object();
-
-  for (unsigned int i = 0; i < string_count; i++) {
-    json_t *this_v_string = json_pack("{s:s}", v_strings[i].name, v_strings[i].value);
-    if (this_v_string == NULL) {
-      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error parsing v_strings");
-    }
-    int result = json_object_update_missing(*json_v_strings, this_v_string);
-    if (result != 0) {
-      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding v_strings");
-    }
-    json_decref(this_v_string);
+gaus_error_t *report_encode_body(const gaus_report_header_t *header, unsigned int report_count,
+                                 const gaus_report_t *reports, gaus_report_format_t format, char **body,
+                                 size_t *length) {
+  *body = NULL;
+  *length = 0;
+  if (format == GAUS_REPORT_FORMAT_CBOR) {
+    return encode_cbor_body(header, report_count, reports, body, length);
   }
-  return status;
+  return encode_json_body(header, report_count, reports, body, length);
 }
 
-static gaus_error_t *create_json_for_header(const gaus_report_header_t *header, json_t **json_header) {
-  gaus_error_t *status = NULL;
-  if (!(*json_header = json_pack("{s:s}", TS_JSON, header->ts))) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding header");
+/* The header announcing a body in format, NULL for json which request_setup announces by default */
+static const char *content_type_header(gaus_report_format_t format) {
+  return format == GAUS_REPORT_FORMAT_CBOR ? CBOR_CONTENT_TYPE_HEADER : NULL;
+}
+
+/* The server of context replied 415 to a report in format, send json to it from now on */
+static void report_format_refused(gaus_context_t *context, gaus_report_format_t format) {
+  gaus_report_format_t expected = format;
+  //Only the first of concurrent reports refused warns
+  if (format != GAUS_REPORT_FORMAT_JSON
+      && __atomic_compare_exchange_n(&context->report_format, &expected, GAUS_REPORT_FORMAT_JSON, false,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    logging(L_WARNING, "Server does not accept reports as %s, sending json instead",
+            format == GAUS_REPORT_FORMAT_CBOR ? "cbor" : "unknown format");
   }
-  return status;
 }
 
+/* Validate the parameters of a report against context, pick the reports to send (see report_deadband_filter), build
+ * its url into a newly allocated url and encode the reports in format into a strong report_post_body of length bytes.
+ *
+ * report_post_body is left NULL if every report is held back.  send must be released with report_deadband_release
+ * whether this succeeds or not, and update committed or discarded.
+ */
 static gaus_error_t *
-create_json_for_update_status(const gaus_report_t *report, json_t **json_report) {
+prepare_report(const gaus_context_t *context, const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+               const gaus_report_header_t *header, unsigned int report_count, const gaus_report_t *reports,
+               gaus_report_format_t format, unsigned int *send_count, const gaus_report_t **send,
+               DeadbandUpdate **update, char **url, char **report_post_body, size_t *length) {
   gaus_error_t *status = NULL;
-  json_t *json_vstrings = NULL;
 
-  if (report->report_type != GAUS_REPORT_UPDATE) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
-                               "Attempted to create an update from wrong report type");
-    goto error;
-  }
+  *send = reports;
+  *send_count = report_count;
+  *update = NULL;
 
-  *json_report = json_object();
-  if (*json_report == NULL) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
-                               "Unable to create json object");
+  if (!context->globalInitalized) {
+    status = gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Checked for updates without initializing");
     goto error;
   }
-  if (0 != json_object_set_new(*json_report, TYPE_JSON, json_string(UPDATE_STATUS_TYPE_JSON))) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding update status type");
+
+  if (!session || !session->device_guid || !session->product_guid || !session->token
+      || !header || report_count < 1 || !reports) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Check for updates with invalid parameters");
     goto error;
   }
 
-  if (0 != json_object_set_new(*json_report, TS_JSON, json_string(report->report.update_status.ts))) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding update status timestamp");
+  if (NULL != (status = report_deadband_filter(report_count, reports, request_monotonic_ms(), send_count, send,
+                                               update)) || *send_count == 0) {
     goto error;
   }
 
-  if (NULL != (status = get_json_for_vstrings(report->report.update_status.v_string_count,
-                                              report->report.update_status.v_strings,
-                                              &json_vstrings))) {
+  if (NULL != (status = report_encode_body(header, *send_count, *send, format, report_post_body, length))) {
     goto error;
   }
-  if (json_vstrings) {
-    if (0 != json_object_set(*json_report, V_STRINGS_JSON, json_vstrings)) {
-      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding vstrings to report");
-      goto error;
-    }
-  } else {
-    logging(L_WARNING, "No json_vstrings in event.update.Status type report!");
-  }
 
+  if (!(*url = url_create_for_device(&context->client->url_prefix, context->serverUrl, session, "/report",
+                                     filter_set_query(filter_set)))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to create report url");
+  }
   error:
-  json_decref(json_vstrings);
   return status;
 }
 
+gaus_error_t *report_encode(const gaus_report_t *report, char **json) {
+  json_writer_t writer;
+  gaus_error_t *status = NULL;
+
+  json_writer_init(&writer, REPORT_SIZE_HINT);
+  if (NULL == (status = write_report(&writer, report)) && !(*json = json_writer_take(&writer))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to encode report");
+  }
+  if (status) {
+    *json = NULL;
+  }
+  json_writer_free(&writer);
+  return status;
+}
 
+gaus_error_t *report_encode_prefix(const gaus_report_header_t *header, char **prefix) {
+  json_writer_t writer;
+
+  json_writer_init(&writer, REPORT_SIZE_HINT);
+  write_body_prefix(&writer, header);
+  if (!(*prefix = json_writer_take(&writer))) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding header");
+  }
+  return NULL;
+}
+
+/* Check the reply to a report, raw_report_result is NULL if the request failed */
 static gaus_error_t *
-create_json_for_generic(const gaus_report_t *report, json_t **json_report) {
+handle_report_response(const char *raw_report_result, const RequestDeadline *deadline, long status_code) {
   gaus_error_t *status = NULL;
-  json_t *json_vints = NULL;
-  json_t *json_vfloats = NULL;
-  json_t *json_vstrings = NULL;
-  char *temp_type = NULL;
-
-  if (report->report_type != GAUS_REPORT_GENERIC) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
-                               "Attempted to create a generic from wrong report type");
-    goto error;
+
+  if (!raw_report_result && (status = request_deadline_error(__func__, deadline))) {
+    return status;
+  }
+  if (!raw_report_result && status_code < 400) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Posting authenticate failed");
+  }
+  if (status_code >= 400) {
+    return gaus_create_error(__func__, GAUS_HTTP_ERROR, status_code,
+                             "Posting authenticate failed with http error code %d",
+                             status_code);
   }
+  return NULL;
+}
 
-  *json_report = json_object();
-  if (*json_report == NULL) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500,
-                               "Unable to create json object");
-    goto error;
+gaus_error_t *
+gaus_report(const gaus_session_t *session, unsigned int filter_count, const gaus_header_filter_t *filters,
+            const gaus_report_header_t *header, unsigned int report_count, const gaus_report_t *reports) {
+  gaus_filter_set_t *filter_set = NULL;
+  gaus_error_t *status = NULL;
+
+  if (NULL != (status = filter_set_create_temporary(filter_count, filters, &filter_set))) {
+    return status;
   }
+  status = gaus_report_with_filter_set(session, filter_set, header, report_count, reports);
+  gaus_filter_set_free(filter_set);
+  return status;
+}
+
+gaus_error_t *
+gaus_report_with_filter_set(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                            const gaus_report_header_t *header, unsigned int report_count,
+                            const gaus_report_t *reports) {
+  return gaus_report_with_options(session, filter_set, header, report_count, reports, NULL);
+}
 
-  int required_size = snprintf(NULL, 0, "%s%s", UPDATE_GENERIC_TYPE_JSON, report->report.generic.type) + 1;
-  temp_type = malloc(required_size);
-  sprintf(temp_type, "%s%s", UPDATE_GENERIC_TYPE_JSON, report->report.generic.type);
+gaus_error_t *
+gaus_report_with_options(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                         const gaus_report_header_t *header, unsigned int report_count, const gaus_report_t *reports,
+                         const gaus_call_options_t *options) {
+  return gaus_context_report(NULL, session, filter_set, header, report_count, reports, options);
+}
 
-  if (0 != json_object_set_new(*json_report, TYPE_JSON, json_string(temp_type))) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding update status type");
+gaus_error_t *
+gaus_context_report(gaus_context_t *context, const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                    const gaus_report_header_t *header, unsigned int report_count, const gaus_report_t *reports,
+                    const gaus_call_options_t *options) {
+  gaus_error_t *status = NULL;
+  RequestDeadline deadline;
+  if (!context) {
+    context = &gaus_global_state;
+  }
+  gaus_report_format_t format = __atomic_load_n(&context->report_format, __ATOMIC_RELAXED);
+  const gaus_report_t *send = NULL;
+  unsigned int send_count = 0;
+  DeadbandUpdate *update = NULL;
+  char *report_post_body = NULL;
+  char *raw_report_result = NULL;
+  char *url = NULL;
+  size_t length = 0;
+
+  request_deadline_start(&deadline, options ? options : &context->call_options);
+  status = prepare_report(context, session, filter_set, header, report_count, reports, format, &send_count, &send,
+                          &update, &url, &report_post_body, &length);
+  //Nothing to send if the deadband held back every report
+  if (status || !report_post_body) {
     goto error;
   }
 
-  if (0 != json_object_set_new(*json_report, TS_JSON, json_string(report->report.update_status.ts))) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding update status timestamp");
-    goto error;
+  const char *token = session_acquire(session);
+  long status_code = 200; //Initialize to a default passing value unless request says otherwise.
+  RequestBody body = {.data = report_post_body, .length = length, .content_type_header = content_type_header(format)};
+  raw_report_result = request_post_body_as_string(context->client, url, token, &body, &deadline, &status_code);
+  //Refused before it was looked at, so reporting again with a renewed session does not report twice
+  if (status_code == 401 && !(status = session_refresh(context, session, token, &deadline))) {
+    session_release();
+    token = session_acquire(session);
+    free(raw_report_result);
+    status_code = 200;
+    raw_report_result = request_post_body_as_string(context->client, url, token, &body, &deadline, &status_code);
   }
+  //Refused for its format alone, so it is sent once more as json
+  if (!status && status_code == 415 && format != GAUS_REPORT_FORMAT_JSON) {
+    report_format_refused(context, format);
+    free(report_post_body);
+    report_post_body = NULL;
+    status = report_encode_body(header, send_count, send, GAUS_REPORT_FORMAT_JSON, &report_post_body, &length);
+    if (!status) {
+      body = (RequestBody) {.data = report_post_body, .length = length};
+      free(raw_report_result);
+      status_code = 200;
+      raw_report_result = request_post_body_as_string(context->client, url, token, &body, &deadline,
+                                                      &status_code);
+    }
+  }
+  if (!status) {
+    status = handle_report_response(raw_report_result, &deadline, status_code);
+  }
+  session_release();
 
-  //v_ints
-  if (NULL != (status = get_json_for_vints(report->report.update_status.v_int_count,
-                                           report->report.update_status.v_ints,
-                                           &json_vints))) {
-    goto error;
+  error:
+  report_deadband_release(send, reports);
+  if (status) {
+    report_deadband_discard(update);
+  } else {
+    report_deadband_commit(update);
   }
+  free(url);
+  free(report_post_body);
+  free(raw_report_result);
+  return status;
+}
 
-  if (0 != json_object_set(*json_report, V_INTS_JSON, json_vints)) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding vints to report");
-    goto error;
+static void report_async_done(int result, long status_code, const char *response, const char *url,
+                              const RequestDeadline *deadline, void *user_data) {
+  report_async_t *async = user_data;
+  (void) url;
+
+  //Too late to send this one again, the error tells the caller it was not reported
+  if (status_code == 415) {
+    report_format_refused(&gaus_global_state, async->format);
   }
+  gaus_error_t *status = handle_report_response(result == 0 ? response : NULL, deadline, status_code);
+  if (status) {
+    report_deadband_discard(async->update);
+  } else {
+    report_deadband_commit(async->update);
+  }
+  async->callback(status, async->user_data);
+  free(async);
+}
 
-  //v_floats
-  if (NULL != (status = get_json_for_vfloats(report->report.update_status.v_float_count,
-                                             report->report.update_status.v_floats,
-                                             &json_vfloats))) {
-    goto error;
+gaus_error_t *
+gaus_report_async(const gaus_session_t *session, unsigned int filter_count, const gaus_header_filter_t *filters,
+                  const gaus_report_header_t *header, unsigned int report_count, const gaus_report_t *reports,
+                  gaus_report_callback_t callback, void *user_data) {
+  gaus_filter_set_t *filter_set = NULL;
+  gaus_error_t *status = NULL;
+
+  if (NULL != (status = filter_set_create_temporary(filter_count, filters, &filter_set))) {
+    return status;
+  }
+  status = gaus_report_with_filter_set_async(session, filter_set, header, report_count, reports, callback, user_data);
+  gaus_filter_set_free(filter_set);
+  return status;
+}
+
+gaus_error_t *
+gaus_report_with_filter_set_async(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                  const gaus_report_header_t *header, unsigned int report_count,
+                                  const gaus_report_t *reports, gaus_report_callback_t callback, void *user_data) {
+  gaus_error_t *status = NULL;
+  report_async_t *async = NULL;
+  gaus_report_format_t format = __atomic_load_n(&gaus_global_state.report_format, __ATOMIC_RELAXED);
+  const gaus_report_t *send = NULL;
+  unsigned int send_count = 0;
+  DeadbandUpdate *update = NULL;
+  char *report_post_body = NULL;
+  char *url = NULL;
+  size_t length = 0;
+
+  if (!callback) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Report with invalid parameters");
   }
 
-  if (0 != json_object_set(*json_report, V_FLOATS_JSON, json_vfloats)) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding vfloats to report");
+  if (!(async = malloc(sizeof(report_async_t)))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate request");
     goto error;
   }
 
-  //v_strings
-  if (NULL != (status = get_json_for_vstrings(report->report.update_status.v_string_count,
-                                              report->report.update_status.v_strings,
-                                              &json_vstrings))) {
+  status = prepare_report(&gaus_global_state, session, filter_set, header, report_count, reports, format, &send_count,
+                          &send, &update, &url, &report_post_body, &length);
+  report_deadband_release(send, reports);
+  if (status) {
     goto error;
   }
+  if (!report_post_body) {
+    //Held back by the deadband, which is as good as reported
+    report_deadband_commit(update);
+    free(async);
+    callback(NULL, user_data);
+    return NULL;
+  }
 
-  if (0 != json_object_set(*json_report, V_STRINGS_JSON, json_vstrings)) {
-    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error encoding vstrings to report");
-    goto error;
+  async->callback = callback;
+  async->user_data = user_data;
+  async->format = format;
+  async->update = update;
+  //Ownership of url and report_post_body is handed over even if starting the request fails.
+  const char *token = session_acquire(session);
+  int started = async_request_start_body(gaus_global_state.client, url, token, report_post_body, length,
+                                         content_type_header(format), report_async_done, async);
+  session_release();
+  if (0 != started) {
+    report_deadband_discard(update);
+    free(async);
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to start report");
   }
+  return NULL;
 
   error:
-  free(temp_type);
-  json_decref(json_vints);
-  json_decref(json_vfloats);
-  json_decref(json_vstrings);
+  report_deadband_discard(update);
+  free(report_post_body);
+  free(url);
+  free(async);
   return status;
 }
@@ -0,0 +1,203 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "json_writer.h"
+#include "utf8.h"
+
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Longest output of "%.17g" for a double, with room for the ".0" added by json_writer_real
+#define REAL_MAX_LENGTH 32
+
+void json_writer_init(json_writer_t *writer, size_t capacity) {
+  writer->length = 0;
+  writer->failed = false;
+  writer->capacity = capacity;
+  if (!(writer->data = capacity ? malloc(capacity) : NULL)) {
+    writer->capacity = 0;
+  }
+}
+
+void json_writer_reset(json_writer_t *writer) {
+  writer->length = 0;
+  writer->failed = false;
+}
+
+/* Make room for length more bytes and the terminating null, returns false (failing writer) if impossible */
+static bool reserve(json_writer_t *writer, size_t length) {
+  if (writer->failed) {
+    return false;
+  }
+  size_t needed = writer->length + length + 1;
+  if (needed <= writer->capacity) {
+    return true;
+  }
+  size_t capacity = writer->capacity ? writer->capacity * 2 : 64;
+  if (capacity < needed) {
+    capacity = needed;
+  }
+  char *data = realloc(writer->data, capacity);
+  if (!data) {
+    writer->failed = true;
+    return false;
+  }
+  writer->data = data;
+  writer->capacity = capacity;
+  return true;
+}
+
+void json_writer_raw(json_writer_t *writer, const char *json, size_t length) {
+  if (reserve(writer, length)) {
+    memcpy(writer->data + writer->length, json, length);
+    writer->length += length;
+  }
+}
+
+/* Append the escaped content of a json string for text, returns false (failing writer) if it is not valid UTF-8 */
+static bool write_escaped(json_writer_t *writer, const char *text) {
+  const unsigned char *pos = (const unsigned char *) text;
+  const unsigned char *run = pos;
+
+  while (*pos) {
+    int32_t codepoint = 0;
+    size_t count = utf8_sequence(pos, &codepoint);
+    if (count == 0) {
+      writer->failed = true;
+      return false;
+    }
+    if (codepoint != '\\' && codepoint != '"' && codepoint >= 0x20) {
+      pos += count;
+      continue;
+    }
+
+    //Copy what needs no escaping in one go
+    json_writer_raw(writer, (const char *) run, (size_t) (pos - run));
+    switch (codepoint) {
+      case '\\':
+        JSON_WRITER_LITERAL(writer, "\\\\");
+        break;
+      case '"':
+        JSON_WRITER_LITERAL(writer, "\\\"");
+        break;
+      case '\b':
+        JSON_WRITER_LITERAL(writer, "\\b");
+        break;
+      case '\f':
+        JSON_WRITER_LITERAL(writer, "\\f");
+        break;
+      case '\n':
+        JSON_WRITER_LITERAL(writer, "\\n");
+        break;
+      case '\r':
+        JSON_WRITER_LITERAL(writer, "\\r");
+        break;
+      case '\t':
+        JSON_WRITER_LITERAL(writer, "\\t");
+        break;
+      default: {
+        char escaped[7];
+        snprintf(escaped, sizeof(escaped), "\\u%04X", (unsigned int) codepoint);
+        json_writer_raw(writer, escaped, 6);
+        break;
+      }
+    }
+    pos += count;
+    run = pos;
+  }
+  json_writer_raw(writer, (const char *) run, (size_t) (pos - run));
+  return true;
+}
+
+void json_writer_string(json_writer_t *writer, const char *value) {
+  json_writer_string_prefixed(writer, "", value);
+}
+
+void json_writer_string_prefixed(json_writer_t *writer, const char *prefix, const char *value) {
+  if (!prefix || !value) {
+    writer->failed = true;
+    return;
+  }
+  JSON_WRITER_LITERAL(writer, "\"");
+  if (write_escaped(writer, prefix) && write_escaped(writer, value)) {
+    JSON_WRITER_LITERAL(writer, "\"");
+  }
+}
+
+void json_writer_integer(json_writer_t *writer, long long value) {
+  char buffer[24];
+  int length = snprintf(buffer, sizeof(buffer), "%lld", value);
+  json_writer_raw(writer, buffer, (size_t) length);
+}
+
+void json_writer_real(json_writer_t *writer, double value) {
+  char buffer[REAL_MAX_LENGTH];
+
+  if (!isfinite(value)) {
+    writer->failed = true;
+    return;
+  }
+  int length = snprintf(buffer, sizeof(buffer), "%.17g", value);
+  if (length < 0 || length + 3 > (int) sizeof(buffer)) {
+    writer->failed = true;
+    return;
+  }
+  //The same clean up as jansson: a dot whatever the locale, always a dot or exponent, no '+' or leading zeros in it
+  const char *point = localeconv()->decimal_point;
+  char *pos = NULL;
+  if (*point != '.' && (pos = strchr(buffer, *point))) {
+    *pos = '.';
+  }
+  if (!strchr(buffer, '.') && !strchr(buffer, 'e')) {
+    strcpy(buffer + length, ".0");
+    length += 2;
+  }
+  char *start = strchr(buffer, 'e');
+  if (start) {
+    start++;
+    char *end = start + 1;
+    if (*start == '-') {
+      start++;
+    }
+    while (*end == '0') {
+      end++;
+    }
+    if (end != start) {
+      memmove(start, end, (size_t) length - (size_t) (end - buffer) + 1);
+      length -= (int) (end - start);
+    }
+  }
+  json_writer_raw(writer, buffer, (size_t) length);
+}
+
+char *json_writer_take(json_writer_t *writer) {
+  char *data = NULL;
+
+  if (!writer->failed && reserve(writer, 0)) {
+    data = writer->data;
+    data[writer->length] = '\0';
+  } else {
+    free(writer->data);
+  }
+  writer->data = NULL;
+  writer->capacity = 0;
+  writer->length = 0;
+  writer->failed = false;
+  return data;
+}
+
+void json_writer_free(json_writer_t *writer) {
+  free(writer->data);
+  writer->data = NULL;
+  writer->capacity = 0;
+  writer->length = 0;
+}
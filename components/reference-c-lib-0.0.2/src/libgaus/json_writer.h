@@ -0,0 +1,65 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_JSON_WRITER_H
+#define GAUS_JSON_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A json document written front to back into a growing buffer, without building a tree of json_t first.
+ *
+ * Values are written exactly as json_dumps writes them with JSON_COMPACT, so a document written in the same order as
+ * a tree is encoded gives the same bytes.  Once a write fails (running out of memory, a string that is not valid UTF-8
+ * or a real that is not finite) the writer is failed and ignores further writes, so only the end result needs to be
+ * checked.
+ */
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+  bool failed;
+} json_writer_t;
+
+/* Start an empty document, with room for capacity bytes before the buffer needs to grow */
+void json_writer_init(json_writer_t *writer, size_t capacity);
+
+/* Start over, keeping the buffer for reuse */
+void json_writer_reset(json_writer_t *writer);
+
+/* Append length bytes of already encoded json */
+void json_writer_raw(json_writer_t *writer, const char *json, size_t length);
+
+//Append a string literal of already encoded json
+#define JSON_WRITER_LITERAL(writer, json) json_writer_raw((writer), (json), sizeof(json) - 1)
+
+/* Append value as a quoted json string, fails for NULL or invalid UTF-8 as json_string does */
+void json_writer_string(json_writer_t *writer, const char *value);
+
+/* Append prefix followed by value as a single json string */
+void json_writer_string_prefixed(json_writer_t *writer, const char *prefix, const char *value);
+
+void json_writer_integer(json_writer_t *writer, long long value);
+
+/* Append value as a json real, fails if it is not finite as json_real does */
+void json_writer_real(json_writer_t *writer, double value);
+
+/* The null terminated document, handed over to the caller.  NULL if any write failed.  The writer is left empty. */
+char *json_writer_take(json_writer_t *writer);
+
+void json_writer_free(json_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_JSON_WRITER_H
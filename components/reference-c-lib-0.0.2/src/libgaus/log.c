@@ -9,7 +9,9 @@
 //THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "log.h"
 
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,15 +37,42 @@
 #define SYSLOG_ENABLED 0
 #endif
 
+//How long the thread of log_start_async sleeps once it found the ring empty
+#define LOG_DRAIN_INTERVAL_MS 20
+//Enough for formatting a line with its time and writing it out, also on the ESP32
+#define LOG_THREAD_STACK_SIZE 4096
+#define LOG_RING_MAX_LINES 4096
+
 static int verbosity_level = VERBOSITY;
 static int log_to_stdout = 1;
-
+static FILE *log_stream = NULL;
 #ifndef GAUS_USE_RAWLOG
 static int syslog_enabled = SYSLOG_ENABLED;
 #endif
 static int systemd_output = 0;
 
-static void log_raw(int level, const char *msg);
+typedef struct {
+  uint32_t sequence; //The position of the line plus one, once it is complete
+  int level;
+  struct timeval time;
+  char message[LOG_RING_LINE_SIZE];
+} LogSlot;
+
+/* Any thread takes the next position from head, the drain thread alone moves tail.  A position is only handed out
+ * once the line a lap earlier in its slot is written out, so taking one is the only step logging threads share. */
+typedef struct {
+  LogSlot *slots;
+  uint32_t mask;     //The number of slots minus one, a power of two
+  uint32_t head;     //The next position to hand out
+  uint32_t tail;     //The next position to write out
+  uint32_t dropped;  //Lines logged while the ring was full, since last reported
+  bool stopping;
+  pthread_t thread;
+} LogRing;
+
+static LogRing *ring = NULL;
+
+static void log_raw(int level, const struct timeval *tv, const char *msg);
 
 void init_logging(void) {
   char *uses_journald = getenv("JOURNAL_STREAM");
@@ -56,7 +85,16 @@ void set_loglevel(int level) {
   verbosity_level = level;
 }
 
-static void log_raw(int level, const char *msg) {
+void set_log_stream(FILE *stream) {
+  log_stream = stream;
+}
+
+static FILE *output(void) {
+  return log_stream ? log_stream : stdout;
+}
+
+/* Write msg, logged at tv, without flushing */
+static void log_raw(int level, const struct timeval *tv, const char *msg) {
 #ifndef GAUS_USE_RAWLOG
   static const int syslog_level_map[] = {LOG_DEBUG, LOG_INFO, LOG_NOTICE,
                                          LOG_WARNING, LOG_ERR};
@@ -66,28 +104,24 @@ static void log_raw(int level, const char *msg) {
   char buf[64];
   int rawmode = (level & L_RAW);
   level &= 0xff; /* clear flags */
-  if (level < verbosity_level) {
-    return;
-  }
 
   if (log_to_stdout) {
     if (rawmode) {
-      fprintf(stdout, "%s\n", msg);
+      fprintf(output(), "%s\n", msg);
     } else if (systemd_output) {
 #ifndef GAUS_USE_RAWLOG
-      fprintf(stdout, "<%d>%s\n", systemd_level_map[level], msg);
+      fprintf(output(), "<%d>%s\n", systemd_level_map[level], msg);
 #endif
     } else {
       int off;
-      struct timeval tv;
+      struct tm tm;
 
-      gettimeofday(&tv, NULL);
+      //localtime_r, as localtime reads the time zone again on every call, which allocates in glibc
       off =
-          strftime(buf, sizeof(buf), "%d %b %H:%M:%S.", localtime(&tv.tv_sec));
-      snprintf(buf + off, sizeof(buf) - off, "%03d", (int) tv.tv_usec / 1000);
-      fprintf(stdout, "%s - %s\n", buf, msg);
+          strftime(buf, sizeof(buf), "%d %b %H:%M:%S.", localtime_r(&tv->tv_sec, &tm));
+      snprintf(buf + off, sizeof(buf) - off, "%03d", (int) tv->tv_usec / 1000);
+      fprintf(output(), "%s - %s\n", buf, msg);
     }
-    fflush(stdout);
   }
 #ifndef GAUS_USE_RAWLOG
   if (syslog_enabled) {
@@ -96,19 +130,138 @@ static void log_raw(int level, const char *msg) {
 #endif
 }
 
-void logging(int level, const char *fmt, ...) {
+/* Format a line into the next free slot, or count it as dropped if there is none */
+static void ring_push(LogRing *r, int level, const char *fmt, va_list ap) {
+  uint32_t head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+  do {
+    if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) > r->mask) {
+      __atomic_fetch_add(&r->dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+  } while (!__atomic_compare_exchange_n(&r->head, &head, head + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  LogSlot *slot = &r->slots[head & r->mask];
+  slot->level = level;
+  gettimeofday(&slot->time, NULL);
+  vsnprintf(slot->message, sizeof(slot->message), fmt, ap);
+  __atomic_store_n(&slot->sequence, head + 1, __ATOMIC_RELEASE);
+}
+
+/* Write out the complete lines at the tail of the ring, returns how many were written */
+static unsigned int ring_drain(LogRing *r) {
+  unsigned int written = 0;
+  for (;;) {
+    LogSlot *slot = &r->slots[r->tail & r->mask];
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != r->tail + 1) {
+      break;
+    }
+    log_raw(slot->level, &slot->time, slot->message);
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+    written++;
+  }
+
+  uint32_t dropped = __atomic_exchange_n(&r->dropped, 0, __ATOMIC_RELAXED);
+  if (dropped) {
+    char msg[64];
+    struct timeval tv;
+    snprintf(msg, sizeof(msg), "log: Dropped %u lines logged while the ring was full", (unsigned int) dropped);
+    gettimeofday(&tv, NULL);
+    log_raw(L_WARNING, &tv, msg);
+    written++;
+  }
+  //Once for all lines written out together, rather than for each
+  if (written && log_to_stdout) {
+    fflush(output());
+  }
+  return written;
+}
+
+static void *ring_thread(void *arg) {
+  LogRing *r = arg;
+  while (!__atomic_load_n(&r->stopping, __ATOMIC_ACQUIRE)) {
+    if (!ring_drain(r)) {
+      struct timespec interval = {0, LOG_DRAIN_INTERVAL_MS * 1000000L};
+      nanosleep(&interval, NULL);
+    }
+  }
+  ring_drain(r);
+  return NULL;
+}
+
+bool log_start_async(unsigned int lines) {
+  if (ring) {
+    return true;
+  }
+  uint32_t count = 2;
+  while (count < lines && count < LOG_RING_MAX_LINES) {
+    count *= 2;
+  }
+
+  pthread_attr_t attr;
+  bool attr_initialized = false;
+  LogRing *started = calloc(1, sizeof(LogRing));
+  LogSlot *slots = calloc(count, sizeof(LogSlot));
+  if (!started || !slots) {
+    goto error;
+  }
+  started->slots = slots;
+  started->mask = count - 1;
+  if (pthread_attr_init(&attr) != 0) {
+    goto error;
+  }
+  attr_initialized = true;
+  pthread_attr_setstacksize(&attr, LOG_THREAD_STACK_SIZE);
+  if (pthread_create(&started->thread, &attr, ring_thread, started) != 0) {
+    goto error;
+  }
+  pthread_attr_destroy(&attr);
+  ring = started;
+  return true;
+
+  error:
+  if (attr_initialized) {
+    pthread_attr_destroy(&attr);
+  }
+  free(slots);
+  free(started);
+  return false;
+}
+
+void log_stop_async(void) {
+  if (!ring) {
+    return;
+  }
+  LogRing *stopped = ring;
+  ring = NULL;
+  __atomic_store_n(&stopped->stopping, true, __ATOMIC_RELEASE);
+  pthread_join(stopped->thread, NULL);
+  free(stopped->slots);
+  free(stopped);
+}
+
+void log_message(int level, const char *fmt, ...) {
   va_list ap;
   char msg[LOG_MAX_LEN];
+  struct timeval tv;
 
   if ((level & 0xff) < verbosity_level) {
     return;
   }
 
   va_start(ap, fmt);
+  if (ring) {
+    ring_push(ring, level, fmt, ap);
+    va_end(ap);
+    return;
+  }
   vsnprintf(msg, sizeof(msg), fmt, ap);
   va_end(ap);
 
-  log_raw(level, msg);
+  gettimeofday(&tv, NULL);
+  log_raw(level, &tv, msg);
+  if (log_to_stdout) {
+    fflush(output());
+  }
 }
 
 void set_loglevel_from_string(char *loglevel) {
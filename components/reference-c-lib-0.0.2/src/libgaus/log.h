@@ -10,6 +10,13 @@
 #ifndef GAUS_UPDATECLIENT_LOG_H
 #define GAUS_UPDATECLIENT_LOG_H
 
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define L_DEBUG 0
 #define L_INFO 1
 #define L_NOTICE 2
@@ -18,12 +25,45 @@
 
 #define L_RAW (1 << 10) /* Modifier to log without timestamp */
 
+/* Levels below the floor are compiled out, their arguments are not even evaluated.  Build with for example
+ * -DGAUS_LOG_FLOOR=L_INFO to leave out the debug lines, and their format strings, whatever set_loglevel is given. */
+#ifndef GAUS_LOG_FLOOR
+#define GAUS_LOG_FLOOR L_DEBUG
+#endif
+
+#define logging(level, ...) \
+  do { \
+    if (((level) & 0xff) >= GAUS_LOG_FLOOR) { \
+      log_message((level), __VA_ARGS__); \
+    } \
+  } while (0)
+
 void init_logging(void);
 
-void logging(int level, const char *fmt, ...);
+void log_message(int level, const char *fmt, ...);
 
 void set_loglevel(int level);
 
 void set_loglevel_from_string(char *loglevel);
 
+/* Write lines to stream rather than stdout, NULL for stdout again */
+void set_log_stream(FILE *stream);
+
+/* Hand lines to a ring of at least lines entries instead of writing them on the calling thread.  A background thread
+ * adds their time and writes them out.  Lines are formatted into the ring when logged, as the strings they refer to
+ * are often gone by the time they are written, and cut at LOG_RING_LINE_SIZE.  Lines logged while the ring is full
+ * are dropped and counted.  Returns false, leaving lines written on the calling thread, if the ring or thread can't
+ * be set up.  Not thread safe, nothing may be logged while starting. */
+bool log_start_async(unsigned int lines);
+
+/* Write out the lines left in the ring and write lines on the calling thread again.  Not thread safe, nothing may be
+ * logged while stopping. */
+void log_stop_async(void);
+
+//Room for a line in the ring of log_start_async, including its terminator
+#define LOG_RING_LINE_SIZE 160
+
+#ifdef __cplusplus
+}
+#endif
 #endif
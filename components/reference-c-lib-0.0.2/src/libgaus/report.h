@@ -0,0 +1,40 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_REPORT_H
+#define GAUS_REPORT_H
+
+#include <gaus/gaus_client_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//What follows the encoded reports of report_encode_prefix to complete a report body
+#define REPORT_BODY_SUFFIX "]}"
+
+/* Encode the body gaus_report sends for reports in format into a strong body of length bytes, which is null terminated
+ * for json */
+gaus_error_t *report_encode_body(const gaus_report_header_t *header, unsigned int report_count,
+                                 const gaus_report_t *reports, gaus_report_format_t format, char **body,
+                                 size_t *length);
+
+/* Encode report into a strong null terminated string, as it appears in the data array of a report body */
+gaus_error_t *report_encode(const gaus_report_t *report, char **json);
+
+/* Encode the start of a report body for header into a strong null terminated string, up to and including the opening
+ * of its data array.  Followed by reports from report_encode separated by commas and REPORT_BODY_SUFFIX, it makes the
+ * same body as gaus_report would for those reports.
+ */
+gaus_error_t *report_encode_prefix(const gaus_report_header_t *header, char **prefix);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_REPORT_H
@@ -0,0 +1,325 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "report_batch.h"
+#include "gaus/gaus_client.h"
+#include "async.h"
+#include "filter_set.h"
+#include "gaus.h"
+#include "log.h"
+#include "report.h"
+#include "report_deadband.h"
+#include "report_queue.h"
+#include "request.h"
+#include "retry.h"
+#include "session.h"
+#include "url.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The body of a batch is built as reports are added, up to the opening of its data array followed by the reports
+ * separated by commas.  REPORT_BODY_SUFFIX is only appended when it is sent, room for it is always kept.
+ */
+typedef struct {
+  char *url;
+  char *token;
+  char *body;
+  size_t used;
+  size_t capacity;
+  //Where each report starts in body, so a failed batch can be taken apart again
+  size_t *starts;
+  unsigned int count;
+  unsigned int starts_capacity;
+  uint64_t opened_ms;
+} report_batch_t;
+
+static struct {
+  pthread_mutex_t lock;
+  gaus_report_batch_options_t options;
+  //The batch reports are added to, NULL until the next report
+  report_batch_t *open;
+} batch_state = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+void report_batch_init(const gaus_report_batch_options_t *options) {
+  pthread_mutex_lock(&batch_state.lock);
+  batch_state.options = options ? *options : (gaus_report_batch_options_t) {0, 0, 0};
+  if (!batch_state.options.max_bytes) {
+    batch_state.options.max_bytes = GAUS_REPORT_BATCH_DEFAULT_BYTES;
+  }
+  if (!batch_state.options.max_age_ms) {
+    batch_state.options.max_age_ms = GAUS_REPORT_BATCH_DEFAULT_AGE_MS;
+  }
+  pthread_mutex_unlock(&batch_state.lock);
+}
+
+static void free_batch(report_batch_t *batch) {
+  free(batch->url);
+  free(batch->token);
+  free(batch->body);
+  free(batch->starts);
+  free(batch);
+}
+
+/* Hand the reports of batch to the report queue, as they were never sent */
+static void requeue_batch(const report_batch_t *batch) {
+  unsigned int queued = 0;
+
+  for (; queued < batch->count; queued++) {
+    size_t start = batch->starts[queued];
+    size_t end = queued + 1 < batch->count ? batch->starts[queued + 1] - 1 : batch->used;
+    gaus_error_t *status = report_queue_append(batch->body + start, end - start);
+    if (status) {
+      logging(L_DEBUG, "%s", status->description);
+      gaus_error_release(status);
+      break;
+    }
+  }
+  if (queued < batch->count) {
+    logging(L_ERROR, "Lost %u batched reports", batch->count - queued);
+  } else {
+    logging(L_INFO, "Queued %u batched reports to send later", queued);
+  }
+}
+
+static void batch_done(int result, long status_code, const char *response, const char *url,
+                       const RequestDeadline *deadline, void *user_data) {
+  report_batch_t *batch = user_data;
+  (void) response;
+  (void) url;
+  (void) deadline;
+
+  if (result == 0) {
+    logging(L_DEBUG, "Sent a batch of %u reports", batch->count);
+  } else if (status_code >= 400 && status_code < 500 && status_code != 401
+             && !retry_is_transient(CURLE_OK, status_code)) {
+    logging(L_ERROR, "Batched reports refused with http error code %ld, dropping them", status_code);
+  } else {
+    requeue_batch(batch);
+  }
+  //body is the payload of the request, freed once this returns
+  batch->body = NULL;
+  free_batch(batch);
+}
+
+/* Start sending the open batch.  Must hold the lock. */
+static gaus_error_t *send_open_batch(void) {
+  report_batch_t *batch = batch_state.open;
+  char *url = NULL;
+
+  if (!batch) {
+    return NULL;
+  }
+  batch_state.open = NULL;
+  //Left empty if adding its first report failed
+  if (batch->count == 0) {
+    free_batch(batch);
+    return NULL;
+  }
+  strcpy(batch->body + batch->used, REPORT_BODY_SUFFIX);
+  logging(L_DEBUG, "Sending a batch of %u reports in %zu bytes", batch->count,
+          batch->used + strlen(REPORT_BODY_SUFFIX));
+
+  url = batch->url;
+  batch->url = NULL;
+  //Ownership of url and body is handed over even if starting the request fails
+  if (0 != async_request_start(gaus_global_state.client, url, batch->token, batch->body, batch_done, batch)) {
+    unsigned int count = batch->count;
+    batch->body = NULL;
+    free_batch(batch);
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to start sending a batch, lost %u reports",
+                             count);
+  }
+  return NULL;
+}
+
+/* Grow the body of batch to hold at least capacity bytes */
+static bool reserve_body(report_batch_t *batch, size_t capacity) {
+  if (capacity <= batch->capacity) {
+    return true;
+  }
+  if (capacity < batch->capacity * 2) {
+    capacity = batch->capacity * 2;
+  }
+  char *body = realloc(batch->body, capacity);
+  if (!body) {
+    return false;
+  }
+  batch->body = body;
+  batch->capacity = capacity;
+  return true;
+}
+
+/* Open a batch for url, its body starting with prefix.  Must hold the lock. */
+static gaus_error_t *open_batch(const char *url, const char *prefix) {
+  report_batch_t *batch = calloc(1, sizeof(report_batch_t));
+
+  if (!batch || !(batch->url = strdup(url)) || !reserve_body(batch, batch_state.options.max_bytes + 1)) {
+    if (batch) {
+      free_batch(batch);
+    }
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report batch");
+  }
+  batch->used = strlen(prefix);
+  if (!reserve_body(batch, batch->used + strlen(REPORT_BODY_SUFFIX) + 1)) {
+    free_batch(batch);
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report batch");
+  }
+  memcpy(batch->body, prefix, batch->used);
+  batch->opened_ms = request_monotonic_ms();
+  batch_state.open = batch;
+  return NULL;
+}
+
+/* Add a report encoded by report_encode to the open batch, sending batches as they fill up.  Must hold the lock. */
+static gaus_error_t *add_report(const char *url, const char *token, const char *prefix, const char *json) {
+  gaus_error_t *status = NULL;
+  report_batch_t *batch = batch_state.open;
+  size_t length = strlen(json);
+  size_t suffix_length = strlen(REPORT_BODY_SUFFIX);
+
+  if (batch && batch->used + 1 + length + suffix_length > batch_state.options.max_bytes
+      && NULL != (status = send_open_batch())) {
+    return status;
+  }
+  if (!batch_state.open && NULL != (status = open_batch(url, prefix))) {
+    return status;
+  }
+  batch = batch_state.open;
+
+  //Sent with the token of the latest report, in case the session was renewed meanwhile
+  if (!batch->token || strcmp(batch->token, token) != 0) {
+    char *copy = strdup(token);
+    if (!copy) {
+      return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report batch");
+    }
+    free(batch->token);
+    batch->token = copy;
+  }
+  if (batch->count == batch->starts_capacity) {
+    unsigned int starts_capacity = batch->starts_capacity ? batch->starts_capacity * 2 : 16;
+    size_t *starts = realloc(batch->starts, starts_capacity * sizeof(size_t));
+    if (!starts) {
+      return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report batch");
+    }
+    batch->starts = starts;
+    batch->starts_capacity = starts_capacity;
+  }
+  if (!reserve_body(batch, batch->used + 1 + length + suffix_length + 1)) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report batch");
+  }
+  if (batch->count > 0) {
+    batch->body[batch->used++] = ',';
+  }
+  batch->starts[batch->count++] = batch->used;
+  memcpy(batch->body + batch->used, json, length);
+  batch->used += length;
+
+  if (batch->used + suffix_length >= batch_state.options.max_bytes
+      || (batch_state.options.max_reports && batch->count >= batch_state.options.max_reports)) {
+    status = send_open_batch();
+  }
+  return status;
+}
+
+gaus_error_t *gaus_report_enqueue(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                  const gaus_report_header_t *header, unsigned int report_count,
+                                  const gaus_report_t *reports) {
+  gaus_error_t *status = NULL;
+  const gaus_report_t *send = NULL;
+  unsigned int send_count = 0;
+  DeadbandUpdate *update = NULL;
+  char *prefix = NULL;
+  char *json = NULL;
+  char *url = NULL;
+
+  if (!gaus_global_state.globalInitalized) {
+    return gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Enqueued reports without initializing");
+  }
+  if (!session || !session->device_guid || !session->product_guid || !session->token || !header
+      || report_count < 1 || !reports) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Enqueued reports with invalid parameters");
+  }
+  if (!(url = url_create_for_device(&gaus_global_state.client->url_prefix, gaus_global_state.serverUrl, session,
+                                    "/report", filter_set_query(filter_set)))) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to create report url");
+  }
+  if (NULL != (status = report_encode_prefix(header, &prefix))
+      || NULL != (status = report_deadband_filter(report_count, reports, request_monotonic_ms(), &send_count, &send,
+                                                   &update))) {
+    goto out;
+  }
+
+  for (unsigned int i = 0; i < send_count && !status; i++) {
+    //Encoded before taking the lock, so polling is not held up by it
+    if (NULL != (status = report_encode(&send[i], &json))) {
+      break;
+    }
+    pthread_mutex_lock(&batch_state.lock);
+    //Reports for another session or filter set make a batch of their own
+    if (batch_state.open && strcmp(batch_state.open->url, url) != 0) {
+      status = send_open_batch();
+    }
+    if (!status) {
+      const char *token = session_acquire(session);
+      status = add_report(url, token, prefix, json);
+      session_release();
+    }
+    pthread_mutex_unlock(&batch_state.lock);
+    free(json);
+  }
+
+  out:
+  report_deadband_release(send, reports);
+  //Reports enqueued before one failed may be enqueued again, rather than lose the ones that were not
+  if (status) {
+    report_deadband_discard(update);
+  } else {
+    report_deadband_commit(update);
+  }
+  free(prefix);
+  free(url);
+  return status;
+}
+
+gaus_error_t *gaus_report_flush(void) {
+  if (!gaus_global_state.globalInitalized) {
+    return gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Flushed reports without initializing");
+  }
+  pthread_mutex_lock(&batch_state.lock);
+  gaus_error_t *status = send_open_batch();
+  pthread_mutex_unlock(&batch_state.lock);
+  return status;
+}
+
+void report_batch_poll(void) {
+  pthread_mutex_lock(&batch_state.lock);
+  if (batch_state.open && request_monotonic_ms() - batch_state.open->opened_ms >= batch_state.options.max_age_ms) {
+    gaus_error_t *status = send_open_batch();
+    if (status) {
+      logging(L_ERROR, "%s", status->description);
+      gaus_error_release(status);
+    }
+  }
+  pthread_mutex_unlock(&batch_state.lock);
+}
+
+void report_batch_cleanup(void) {
+  pthread_mutex_lock(&batch_state.lock);
+  if (batch_state.open) {
+    requeue_batch(batch_state.open);
+    free_batch(batch_state.open);
+    batch_state.open = NULL;
+  }
+  pthread_mutex_unlock(&batch_state.lock);
+}
@@ -0,0 +1,31 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_REPORT_BATCH_H
+#define GAUS_REPORT_BATCH_H
+
+#include <gaus/gaus_client_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Set when the batches of gaus_report_enqueue are sent, NULL for the defaults */
+void report_batch_init(const gaus_report_batch_options_t *options);
+
+/* Send the batch being collected if it is too old, called by gaus_client_poll */
+void report_batch_poll(void);
+
+/* Move the batch being collected to the report queue, before the report queue is closed */
+void report_batch_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_REPORT_BATCH_H
@@ -0,0 +1,230 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "gaus/gaus_client.h"
+#include "gaus.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Everything laid out in the arena holds pointers, so their alignment is enough
+#define ARENA_ALIGNMENT sizeof(void *)
+
+#define ARENA_FULL "Reports do not fit in the report builder arena"
+#define INVALID_CALL "Report built with invalid parameters"
+
+/* Fail builder, keeping the first failure */
+static void fail(gaus_report_builder_t *builder, const char *failure) {
+  if (!builder->failure) {
+    builder->failure = failure;
+  }
+}
+
+/* Take size bytes aligned to align off the free space between the reports and the values, NULL if it is too small */
+static void *take(gaus_report_builder_t *builder, size_t size, size_t align) {
+  char *reports_end = (char *) (builder->reports + builder->report_count);
+  if (builder->failure || size > (size_t) (builder->values - reports_end)) {
+    fail(builder, ARENA_FULL);
+    return NULL;
+  }
+  uintptr_t start = ((uintptr_t) builder->values - size) & ~(uintptr_t) (align - 1);
+  if (start < (uintptr_t) reports_end) {
+    fail(builder, ARENA_FULL);
+    return NULL;
+  }
+  builder->values = (char *) start;
+  return builder->values;
+}
+
+static char *copy_string(gaus_report_builder_t *builder, const char *value) {
+  if (!value) {
+    fail(builder, INVALID_CALL);
+    return NULL;
+  }
+  size_t size = strlen(value) + 1;
+  char *copy = take(builder, size, 1);
+  if (copy) {
+    memcpy(copy, value, size);
+  }
+  return copy;
+}
+
+/* Take an array of count elements of size bytes, NULL if count is 0 */
+static void *take_array(gaus_report_builder_t *builder, unsigned int count, size_t size) {
+  if (count == 0) {
+    return NULL;
+  }
+  if (count > SIZE_MAX / size) {
+    fail(builder, ARENA_FULL);
+    return NULL;
+  }
+  return take(builder, count * size, ARENA_ALIGNMENT);
+}
+
+/* The last report begun if it has room for one more value in room, else fail builder */
+static gaus_report_t *next_value(gaus_report_builder_t *builder, unsigned int *room) {
+  if (builder->failure) {
+    return NULL;
+  }
+  if (builder->report_count == 0) {
+    fail(builder, INVALID_CALL);
+    return NULL;
+  }
+  if (*room == 0) {
+    fail(builder, "More values added to a report than it was begun with");
+    return NULL;
+  }
+  (*room)--;
+  return &builder->reports[builder->report_count - 1];
+}
+
+gaus_error_t *gaus_report_builder_init(gaus_report_builder_t *builder, void *arena, size_t size) {
+  if (!builder) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Report builder created with invalid parameters");
+  }
+  memset(builder, 0, sizeof(*builder));
+  if (!arena) {
+    if (!(arena = malloc(size))) {
+      return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report builder arena");
+    }
+    builder->owned = 1;
+  }
+  builder->arena = arena;
+  builder->size = size;
+  gaus_report_builder_reset(builder);
+  return NULL;
+}
+
+void gaus_report_builder_reset(gaus_report_builder_t *builder) {
+  uintptr_t start = ((uintptr_t) builder->arena + ARENA_ALIGNMENT - 1) & ~(uintptr_t) (ARENA_ALIGNMENT - 1);
+  builder->values = builder->arena + builder->size;
+  //An arena too small to align the reports has no room for any
+  builder->reports = (gaus_report_t *) (start < (uintptr_t) builder->values ? start : (uintptr_t) builder->values);
+  builder->report_count = 0;
+  builder->v_int_room = 0;
+  builder->v_float_room = 0;
+  builder->v_string_room = 0;
+  builder->header.ts = NULL;
+  builder->failure = NULL;
+}
+
+void gaus_report_builder_free(gaus_report_builder_t *builder) {
+  if (builder && builder->owned) {
+    free(builder->arena);
+    builder->arena = NULL;
+    builder->size = 0;
+    builder->owned = 0;
+  }
+}
+
+void gaus_report_builder_header(gaus_report_builder_t *builder, const char *ts) {
+  char *copy = copy_string(builder, ts);
+  if (!builder->failure) {
+    builder->header.ts = copy;
+  }
+}
+
+void gaus_report_builder_begin(gaus_report_builder_t *builder, gaus_report_type_t report_type, const char *type,
+                               const char *ts, unsigned int v_int_count, unsigned int v_float_count,
+                               unsigned int v_string_count) {
+  if (report_type != GAUS_REPORT_GENERIC && report_type != GAUS_REPORT_UPDATE) {
+    fail(builder, INVALID_CALL);
+  }
+  char *reports_end = (char *) (builder->reports + builder->report_count);
+  if (builder->failure || (size_t) (builder->values - reports_end) < sizeof(gaus_report_t)) {
+    fail(builder, ARENA_FULL);
+    return;
+  }
+  //The report goes first, so the values taken next leave room for it
+  gaus_report_t *report = &builder->reports[builder->report_count++];
+  memset(report, 0, sizeof(*report));
+  report->report_type = report_type;
+  char *type_copy = copy_string(builder, type);
+  char *ts_copy = copy_string(builder, ts);
+  gaus_v_int_t *v_ints = take_array(builder, v_int_count, sizeof(gaus_v_int_t));
+  gaus_v_float_t *v_floats = take_array(builder, v_float_count, sizeof(gaus_v_float_t));
+  gaus_v_string_t *v_strings = take_array(builder, v_string_count, sizeof(gaus_v_string_t));
+  if (builder->failure) {
+    return;
+  }
+
+  if (report_type == GAUS_REPORT_GENERIC) {
+    report->report.generic.type = type_copy;
+    report->report.generic.ts = ts_copy;
+    report->report.generic.v_ints = v_ints;
+    report->report.generic.v_floats = v_floats;
+    report->report.generic.v_strings = v_strings;
+  } else {
+    report->report.update_status.type = type_copy;
+    report->report.update_status.ts = ts_copy;
+    report->report.update_status.v_ints = v_ints;
+    report->report.update_status.v_floats = v_floats;
+    report->report.update_status.v_strings = v_strings;
+  }
+  builder->v_int_room = v_int_count;
+  builder->v_float_room = v_float_count;
+  builder->v_string_room = v_string_count;
+}
+
+void gaus_report_builder_int(gaus_report_builder_t *builder, const char *name, int value) {
+  char *name_copy = copy_string(builder, name);
+  gaus_report_t *report = next_value(builder, &builder->v_int_room);
+  if (!report) {
+    return;
+  }
+  gaus_v_int_t *v_int = report->report_type == GAUS_REPORT_GENERIC
+                        ? &report->report.generic.v_ints[report->report.generic.v_int_count++]
+                        : &report->report.update_status.v_ints[report->report.update_status.v_int_count++];
+  v_int->name = name_copy;
+  v_int->value = value;
+}
+
+void gaus_report_builder_float(gaus_report_builder_t *builder, const char *name, float value) {
+  char *name_copy = copy_string(builder, name);
+  gaus_report_t *report = next_value(builder, &builder->v_float_room);
+  if (!report) {
+    return;
+  }
+  gaus_v_float_t *v_float = report->report_type == GAUS_REPORT_GENERIC
+                            ? &report->report.generic.v_floats[report->report.generic.v_float_count++]
+                            : &report->report.update_status.v_floats[report->report.update_status.v_float_count++];
+  v_float->name = name_copy;
+  v_float->value = value;
+}
+
+void gaus_report_builder_string(gaus_report_builder_t *builder, const char *name, const char *value) {
+  char *name_copy = copy_string(builder, name);
+  char *value_copy = copy_string(builder, value);
+  gaus_report_t *report = next_value(builder, &builder->v_string_room);
+  if (!report) {
+    return;
+  }
+  gaus_v_string_t *v_string =
+      report->report_type == GAUS_REPORT_GENERIC
+      ? &report->report.generic.v_strings[report->report.generic.v_string_count++]
+      : &report->report.update_status.v_strings[report->report.update_status.v_string_count++];
+  v_string->name = name_copy;
+  v_string->value = value_copy;
+}
+
+gaus_error_t *gaus_report_builder_finish(const gaus_report_builder_t *builder, const gaus_report_header_t **header,
+                                         unsigned int *report_count, const gaus_report_t **reports) {
+  if (!builder || !header || !report_count || !reports) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Report builder finished with invalid parameters");
+  }
+  if (builder->failure) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "%s (arena of %zu bytes)", builder->failure,
+                             builder->size);
+  }
+  *header = &builder->header;
+  *report_count = builder->report_count;
+  *reports = builder->reports;
+  return NULL;
+}
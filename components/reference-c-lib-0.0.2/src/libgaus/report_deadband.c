@@ -0,0 +1,354 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "report_deadband.h"
+#include "gaus.h"
+
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Room for the names of the summary of a value called name: name_min, name_max, name_mean and name_count
+#define SUMMARY_NAMES_SIZE(name) (4 * strlen(name) + sizeof("_min") + sizeof("_max") + sizeof("_mean") \
+                                  + sizeof("_count"))
+//Values added to the v_floats and v_ints of a report by a summary
+#define SUMMARY_FLOATS 3
+#define SUMMARY_INTS 1
+//Marks a report that is held back
+#define HELD UINT_MAX
+
+/* A rule and the state of the value it is for */
+typedef struct {
+  char *type;
+  char *name;
+  float deadband;
+  unsigned long heartbeat_ms;
+  bool summary;
+  bool seen;
+  float sent_value;
+  uint64_t sent_ms;
+  //What was held back since the value was last sent
+  unsigned long held;
+  float min;
+  float max;
+  double sum;
+} deadband_metric_t;
+
+/* What a report made of the state of one of the rules */
+typedef struct {
+  unsigned int index;
+  deadband_metric_t metric;
+} deadband_change_t;
+
+struct DeadbandUpdate {
+  unsigned long generation;
+  unsigned int count;
+  deadband_change_t changes[];
+};
+
+static struct {
+  pthread_mutex_t lock;
+  deadband_metric_t *metrics;
+  unsigned int count; //Changed atomically, so reports without rules skip the lock
+  unsigned long generation; //Counts cleanups, so an update is not applied to rules that were cleaned up meanwhile
+} deadband_state = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+gaus_error_t *report_deadband_init(const gaus_report_deadband_options_t *options) {
+  gaus_error_t *status = NULL;
+
+  pthread_mutex_lock(&deadband_state.lock);
+  if (!options || options->rule_count == 0) {
+    goto out;
+  }
+  if (!options->rules) {
+    status = gaus_create_error(__func__, GAUS_BAD_INIT_ERROR, 500, "Report deadband without rules");
+    goto out;
+  }
+  if (!(deadband_state.metrics = calloc(options->rule_count, sizeof(deadband_metric_t)))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report deadband");
+    goto out;
+  }
+  for (unsigned int i = 0; i < options->rule_count; i++) {
+    const gaus_report_deadband_rule_t *rule = &options->rules[i];
+    deadband_metric_t *metric = &deadband_state.metrics[i];
+    //Counted as they are copied, so cleanup frees what was
+    __atomic_add_fetch(&deadband_state.count, 1, __ATOMIC_RELAXED);
+    if (!rule->type || !rule->name || !(rule->deadband >= 0)) {
+      status = gaus_create_error(__func__, GAUS_BAD_INIT_ERROR, 500, "Invalid report deadband rule %u", i);
+      goto out;
+    }
+    if (!(metric->type = strdup(rule->type)) || !(metric->name = strdup(rule->name))) {
+      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report deadband");
+      goto out;
+    }
+    metric->deadband = rule->deadband;
+    metric->heartbeat_ms = rule->heartbeat_ms;
+    metric->summary = rule->summary != 0;
+  }
+
+  out:
+  pthread_mutex_unlock(&deadband_state.lock);
+  if (status) {
+    report_deadband_cleanup();
+  }
+  return status;
+}
+
+void report_deadband_cleanup(void) {
+  pthread_mutex_lock(&deadband_state.lock);
+  for (unsigned int i = 0; i < deadband_state.count; i++) {
+    free(deadband_state.metrics[i].type);
+    free(deadband_state.metrics[i].name);
+  }
+  free(deadband_state.metrics);
+  deadband_state.metrics = NULL;
+  deadband_state.generation++;
+  __atomic_store_n(&deadband_state.count, 0, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&deadband_state.lock);
+}
+
+static deadband_metric_t *find_metric(deadband_metric_t *metrics, const char *type, const char *name) {
+  for (unsigned int i = 0; type && name && i < deadband_state.count; i++) {
+    if (strcmp(metrics[i].type, type) == 0 && strcmp(metrics[i].name, name) == 0) {
+      return &metrics[i];
+    }
+  }
+  return NULL;
+}
+
+/* Only the first value of a name is reported */
+static bool repeated_name(const gaus_v_float_t *v_floats, unsigned int i) {
+  for (unsigned int j = 0; j < i && v_floats[i].name; j++) {
+    if (v_floats[j].name && strcmp(v_floats[j].name, v_floats[i].name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool value_due(const deadband_metric_t *metric, float value, uint64_t now_ms) {
+  if (!metric->seen || (metric->heartbeat_ms && now_ms - metric->sent_ms >= metric->heartbeat_ms)) {
+    return true;
+  }
+  float change = fabsf(value - metric->sent_value);
+  //Also true for a value that is not a number, so encoding it fails as it would without a rule
+  return metric->deadband > 0 ? !(change < metric->deadband) : change != 0;
+}
+
+/* Append the summary of what metric held back to the v_floats and v_ints of summarized, which have room for it, taking
+ * the names from *names.
+ */
+static void add_summary(gaus_report_event_generic_t *summarized, char **names, const deadband_metric_t *metric) {
+  static const char *const suffixes[SUMMARY_FLOATS + SUMMARY_INTS] = {"_min", "_max", "_mean", "_count"};
+  float values[SUMMARY_FLOATS] = {metric->min, metric->max, (float) (metric->sum / metric->held)};
+
+  for (unsigned int i = 0; i < SUMMARY_FLOATS + SUMMARY_INTS; i++) {
+    char *name = *names;
+    *names += sprintf(name, "%s%s", metric->name, suffixes[i]) + 1;
+    if (i < SUMMARY_FLOATS) {
+      summarized->v_floats[summarized->v_float_count++] = (gaus_v_float_t) {name, values[i]};
+    } else {
+      int count = metric->held > INT_MAX ? INT_MAX : (int) metric->held;
+      summarized->v_ints[summarized->v_int_count++] = (gaus_v_int_t) {name, count};
+    }
+  }
+}
+
+/* Decide whether report is sent, updating metrics as if it was (or was held back).  Returns the number of summaries it
+ * carries when sent, adding the room their names take to name_size, or HELD.  The summaries are added to summarized
+ * if it is not NULL.
+ */
+static unsigned int step(deadband_metric_t *metrics, const gaus_report_t *report, uint64_t now_ms,
+                         gaus_report_event_generic_t *summarized, char **names, size_t *name_size) {
+  const gaus_report_event_generic_t *generic = &report->report.generic;
+  unsigned int summaries = 0;
+
+  if (report->report_type != GAUS_REPORT_GENERIC) {
+    return 0;
+  }
+  bool due = generic->v_int_count > 0 || generic->v_string_count > 0 || generic->v_float_count == 0;
+  for (unsigned int i = 0; i < generic->v_float_count && !due; i++) {
+    deadband_metric_t *metric = find_metric(metrics, generic->type, generic->v_floats[i].name);
+    due = !metric || (!repeated_name(generic->v_floats, i) && value_due(metric, generic->v_floats[i].value, now_ms));
+  }
+
+  for (unsigned int i = 0; i < generic->v_float_count; i++) {
+    deadband_metric_t *metric = find_metric(metrics, generic->type, generic->v_floats[i].name);
+    float value = generic->v_floats[i].value;
+    if (!metric || repeated_name(generic->v_floats, i)) {
+      continue;
+    }
+    if (!due) {
+      metric->min = metric->held == 0 || value < metric->min ? value : metric->min;
+      metric->max = metric->held == 0 || value > metric->max ? value : metric->max;
+      metric->sum = (metric->held == 0 ? 0 : metric->sum) + value;
+      metric->held++;
+      continue;
+    }
+    if (metric->summary && metric->held > 0) {
+      summaries++;
+      *name_size += SUMMARY_NAMES_SIZE(metric->name);
+      if (summarized) {
+        add_summary(summarized, names, metric);
+      }
+    }
+    metric->seen = true;
+    metric->sent_value = value;
+    metric->sent_ms = now_ms;
+    metric->held = 0;
+  }
+  return due ? summaries : HELD;
+}
+
+/* Set *update to the rules that trial changed from the state, left NULL if none */
+static gaus_error_t *create_update(const deadband_metric_t *trial, DeadbandUpdate **update) {
+  unsigned int count = 0;
+
+  for (unsigned int i = 0; i < deadband_state.count; i++) {
+    count += memcmp(&trial[i], &deadband_state.metrics[i], sizeof(deadband_metric_t)) != 0;
+  }
+  if (count == 0) {
+    return NULL;
+  }
+  if (!(*update = malloc(sizeof(DeadbandUpdate) + count * sizeof(deadband_change_t)))) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report deadband");
+  }
+  (*update)->generation = deadband_state.generation;
+  (*update)->count = 0;
+  for (unsigned int i = 0; i < deadband_state.count; i++) {
+    if (memcmp(&trial[i], &deadband_state.metrics[i], sizeof(deadband_metric_t)) != 0) {
+      (*update)->changes[(*update)->count++] = (deadband_change_t) {i, trial[i]};
+    }
+  }
+  return NULL;
+}
+
+gaus_error_t *report_deadband_filter(unsigned int report_count, const gaus_report_t *reports, uint64_t now_ms,
+                                     unsigned int *send_count, const gaus_report_t **send, DeadbandUpdate **update) {
+  gaus_error_t *status = NULL;
+  deadband_metric_t *trial = NULL;
+  unsigned int *summaries = NULL;
+  unsigned char *block = NULL;
+  unsigned int sent = 0;
+  bool summarized = false;
+  size_t name_size = 0;
+
+  *send = reports;
+  *send_count = report_count;
+  *update = NULL;
+  if (__atomic_load_n(&deadband_state.count, __ATOMIC_RELAXED) == 0) {
+    return NULL;
+  }
+  pthread_mutex_lock(&deadband_state.lock);
+  if (deadband_state.count == 0 || !reports) {
+    goto out;
+  }
+
+  //Decided on a copy of the state, which only becomes the state once the reports picked are sent.  The summaries are
+  //taken from a second copy, as the first one no longer has what was held back.
+  size_t metrics_size = deadband_state.count * sizeof(deadband_metric_t);
+  if (!(trial = malloc(2 * metrics_size + report_count * sizeof(unsigned int)))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report deadband");
+    goto out;
+  }
+  memcpy(trial, deadband_state.metrics, metrics_size);
+  deadband_metric_t *held = trial + deadband_state.count;
+  summaries = (unsigned int *) (held + deadband_state.count);
+  size_t block_size = 0;
+  for (unsigned int i = 0; i < report_count; i++) {
+    summaries[i] = step(trial, &reports[i], now_ms, NULL, NULL, &name_size);
+    if (summaries[i] != HELD) {
+      sent++;
+      block_size += sizeof(gaus_report_t);
+    }
+    if (summaries[i] != HELD && summaries[i] > 0) {
+      summarized = true;
+      block_size += (reports[i].report.generic.v_float_count + SUMMARY_FLOATS * summaries[i]) * sizeof(gaus_v_float_t)
+                    + (reports[i].report.generic.v_int_count + SUMMARY_INTS * summaries[i]) * sizeof(gaus_v_int_t);
+    }
+  }
+  if (NULL != (status = create_update(trial, update)) || (sent == report_count && !summarized)) {
+    goto out;
+  }
+  *send = NULL;
+  *send_count = 0;
+  if (sent == 0) {
+    goto out;
+  }
+
+  //The reports, then the values of those with summaries, then the names of the summaries
+  if (!(block = malloc(block_size + name_size))) {
+    *send = reports;
+    *send_count = report_count;
+    report_deadband_discard(*update);
+    *update = NULL;
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report deadband");
+    goto out;
+  }
+  memcpy(held, deadband_state.metrics, metrics_size);
+  gaus_report_t *picked = (gaus_report_t *) block;
+  unsigned char *values = block + sent * sizeof(gaus_report_t);
+  char *names = (char *) block + block_size;
+  name_size = 0;
+  for (unsigned int i = 0; i < report_count; i++) {
+    if (summaries[i] == HELD) {
+      step(held, &reports[i], now_ms, NULL, NULL, &name_size);
+      continue;
+    }
+    gaus_report_t *report = &picked[(*send_count)++];
+    *report = reports[i];
+    if (summaries[i] > 0) {
+      gaus_report_event_generic_t *generic = &report->report.generic;
+      gaus_v_float_t *v_floats = (gaus_v_float_t *) values;
+      values += (generic->v_float_count + SUMMARY_FLOATS * summaries[i]) * sizeof(gaus_v_float_t);
+      gaus_v_int_t *v_ints = (gaus_v_int_t *) values;
+      values += (generic->v_int_count + SUMMARY_INTS * summaries[i]) * sizeof(gaus_v_int_t);
+      memcpy(v_floats, generic->v_floats, generic->v_float_count * sizeof(gaus_v_float_t));
+      memcpy(v_ints, generic->v_ints, generic->v_int_count * sizeof(gaus_v_int_t));
+      generic->v_floats = v_floats;
+      generic->v_ints = v_ints;
+    }
+    step(held, &reports[i], now_ms, &report->report.generic, &names, &name_size);
+  }
+  *send = picked;
+
+  out:
+  pthread_mutex_unlock(&deadband_state.lock);
+  free(trial);
+  return status;
+}
+
+void report_deadband_release(const gaus_report_t *send, const gaus_report_t *reports) {
+  if (send != reports) {
+    free((void *) send);
+  }
+}
+
+void report_deadband_commit(DeadbandUpdate *update) {
+  if (!update) {
+    return;
+  }
+  pthread_mutex_lock(&deadband_state.lock);
+  //Not for rules that were cleaned up or replaced meanwhile
+  for (unsigned int i = 0; update->generation == deadband_state.generation && i < update->count; i++) {
+    deadband_state.metrics[update->changes[i].index] = update->changes[i].metric;
+  }
+  pthread_mutex_unlock(&deadband_state.lock);
+  free(update);
+}
+
+void report_deadband_discard(DeadbandUpdate *update) {
+  free(update);
+}
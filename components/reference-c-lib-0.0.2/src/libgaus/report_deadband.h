@@ -0,0 +1,58 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_REPORT_DEADBAND_H
+#define GAUS_REPORT_DEADBAND_H
+
+#include <gaus/gaus_client_types.h>
+#include <gaus/gaus_client_report_types.h>
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Copy the rules of options, NULL for none.  Fails for a rule without a type or name, or with a deadband that is
+ * negative or not a number.
+ */
+/* The state that reports picked by report_deadband_filter leave behind once they are sent */
+typedef struct DeadbandUpdate DeadbandUpdate;
+
+gaus_error_t *report_deadband_init(const gaus_report_deadband_options_t *options);
+
+/* Pick the reports to send out of reports at now_ms of the monotonic clock, see gaus_report_deadband_options_t.
+ *
+ * send is set to reports if they are all sent as they are.  Otherwise it is set to a newly allocated array of the
+ * send_count reports to send (NULL if all are held back) in their order, with the summaries of their rules added.  It
+ * must be released with report_deadband_release once they are encoded.
+ *
+ * The state is left as it is, so reports that fail to be sent are picked again.  update is set to what the reports
+ * make of it (NULL for nothing), to be passed to report_deadband_commit once they are sent, appended or enqueued, or
+ * to report_deadband_discard if that fails.  Reports of a value picked before an earlier update is committed are
+ * decided on the state without it, so at worst a value is sent twice.
+ */
+gaus_error_t *report_deadband_filter(unsigned int report_count, const gaus_report_t *reports, uint64_t now_ms,
+                                     unsigned int *send_count, const gaus_report_t **send, DeadbandUpdate **update);
+
+/* Release what report_deadband_filter set send to for reports */
+void report_deadband_release(const gaus_report_t *send, const gaus_report_t *reports);
+
+/* Make update the state, as the reports it was picked for were sent, and free it.  NULL does nothing. */
+void report_deadband_commit(DeadbandUpdate *update);
+
+/* Free update without changing the state, as the reports it was picked for were not sent.  NULL does nothing. */
+void report_deadband_discard(DeadbandUpdate *update);
+
+void report_deadband_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_REPORT_DEADBAND_H
@@ -0,0 +1,624 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "report_queue.h"
+#include "gaus/gaus_client.h"
+#include "async.h"
+#include "filter_set.h"
+#include "gaus.h"
+#include "log.h"
+#include "report.h"
+#include "report_deadband.h"
+#include "request.h"
+#include "retry.h"
+#include "session.h"
+#include "url.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The store is a ring of sectors.  Each starts with SECTOR_MAGIC and a sequence number (4 bytes, little endian) that
+ * grows with every sector opened, followed by records.  A record is the length of its report (2 bytes, little endian),
+ * its state and a reserved byte, followed by the encoded report and padding up to a multiple of 4 bytes.  Erased
+ * space reads as a length of RECORD_FREE_LENGTH.
+ */
+#define SECTOR_MAGIC "GRQ1"
+#define SECTOR_HEADER_SIZE 8
+#define RECORD_HEADER_SIZE 4
+#define RECORD_FREE_LENGTH 0xFFFF
+//Each state only clears bits of the one before, so a record moves on by rewriting its state byte without erasing
+#define RECORD_WRITTEN 0xFF
+#define RECORD_COMMITTED 0xFE
+#define RECORD_SENT 0x00
+
+typedef struct {
+  size_t sector;
+  size_t offset;
+} queue_position_t;
+
+static struct {
+  pthread_mutex_t lock;
+  bool enabled;
+  gaus_report_queue_store_t store;
+  size_t sector_count;
+  //The sequence number of every sector in the ring, 0 for sectors not in use
+  uint32_t *sector_seqs;
+  uint32_t next_seq;
+  //Where the next record goes, and where the oldest record that may not have been sent is
+  queue_position_t head;
+  queue_position_t tail;
+  //The batch in flight covers the unsent records before batch_end, see position_key
+  bool in_flight;
+  uint64_t batch_end;
+  //Rate limit and waiting out failed batches, in milliseconds of the monotonic clock
+  gaus_retry_policy_t retry;
+  double tokens;
+  uint64_t refilled_ms;
+  uint64_t hold_until_ms;
+  unsigned int failures;
+  gaus_report_queue_stats_t stats;
+} queue_state = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static size_t record_size(size_t length) {
+  return (RECORD_HEADER_SIZE + length + 3) & ~(size_t) 3;
+}
+
+static size_t store_offset(queue_position_t position) {
+  return position.sector * queue_state.store.sector_size + position.offset;
+}
+
+/* Orders positions across the ring, positions in a sector opened later compare greater.  Must hold the lock. */
+static uint64_t position_key(queue_position_t position) {
+  return (uint64_t) queue_state.sector_seqs[position.sector] << 32 | position.offset;
+}
+
+static bool at_head(queue_position_t position) {
+  return position.sector == queue_state.head.sector && position.offset == queue_state.head.offset;
+}
+
+/* Read the header of the record at position, returns false if there is none (erased or unreadable space, or the end
+ * of the sector).  Must hold the lock.
+ */
+static bool read_record(queue_position_t position, size_t *length, unsigned char *state) {
+  unsigned char header[RECORD_HEADER_SIZE];
+
+  if (position.offset + RECORD_HEADER_SIZE > queue_state.store.sector_size
+      || queue_state.store.read(queue_state.store.user_data, store_offset(position), header, sizeof(header)) != 0) {
+    return false;
+  }
+  *length = (size_t) header[0] | (size_t) header[1] << 8;
+  *state = header[2];
+  return *length != RECORD_FREE_LENGTH
+         && position.offset + RECORD_HEADER_SIZE + *length <= queue_state.store.sector_size;
+}
+
+/* Find the first record at or after position up to the head, moving on to later sectors as they run out.  Returns
+ * false once the head is reached.  Must hold the lock.
+ */
+static bool next_record(queue_position_t *position, size_t *length, unsigned char *state) {
+  while (!at_head(*position)) {
+    if (read_record(*position, length, state)) {
+      return true;
+    }
+    if (position->sector == queue_state.head.sector) {
+      return false;
+    }
+    position->sector = (position->sector + 1) % queue_state.sector_count;
+    position->offset = SECTOR_HEADER_SIZE;
+  }
+  return false;
+}
+
+/* Move the tail past records that were sent or never completed.  Must hold the lock. */
+static void skip_done_records(void) {
+  size_t length = 0;
+  unsigned char state = 0;
+
+  while (next_record(&queue_state.tail, &length, &state) && state != RECORD_COMMITTED) {
+    queue_state.tail.offset += record_size(length);
+  }
+}
+
+/* Erase the sector after the head and continue writing there, dropping the unsent reports it still holds.  Must hold
+ * the lock.
+ */
+static bool open_next_sector(void) {
+  size_t sector = (queue_state.head.sector + 1) % queue_state.sector_count;
+  size_t length = 0;
+  unsigned char state = 0;
+  unsigned char header[SECTOR_HEADER_SIZE];
+
+  //Only the oldest sector can be next, so the tail is either in it or past it already
+  if (queue_state.sector_seqs[sector] && queue_state.tail.sector == sector) {
+    unsigned int dropped = 0;
+    while (next_record(&queue_state.tail, &length, &state) && queue_state.tail.sector == sector) {
+      dropped += state == RECORD_COMMITTED;
+      queue_state.tail.offset += record_size(length);
+    }
+    if (dropped) {
+      logging(L_WARNING, "Report queue is full, dropping %u of the oldest reports", dropped);
+    }
+    queue_state.stats.pending -= dropped;
+    queue_state.stats.dropped += dropped;
+    queue_state.tail.sector = (sector + 1) % queue_state.sector_count;
+    queue_state.tail.offset = SECTOR_HEADER_SIZE;
+  }
+
+  queue_state.sector_seqs[sector] = 0;
+  memcpy(header, SECTOR_MAGIC, 4);
+  for (int i = 0; i < 4; i++) {
+    header[4 + i] = (unsigned char) (queue_state.next_seq >> (8 * i));
+  }
+  if (queue_state.store.erase(queue_state.store.user_data, sector * queue_state.store.sector_size,
+                              queue_state.store.sector_size) != 0
+      || queue_state.store.write(queue_state.store.user_data, sector * queue_state.store.sector_size, header,
+                                 sizeof(header)) != 0) {
+    logging(L_ERROR, "Unable to open sector %zu of the report queue", sector);
+    return false;
+  }
+  queue_state.sector_seqs[sector] = queue_state.next_seq++;
+  //Nothing was left to send, so the tail moves along with the head
+  if (at_head(queue_state.tail)) {
+    queue_state.tail.sector = sector;
+    queue_state.tail.offset = SECTOR_HEADER_SIZE;
+  }
+  queue_state.head.sector = sector;
+  queue_state.head.offset = SECTOR_HEADER_SIZE;
+  return true;
+}
+
+/* Find the head and tail among the sectors in the store and count the reports left to send.  Must hold the lock. */
+static bool open_queue(void) {
+  unsigned char header[SECTOR_HEADER_SIZE];
+  size_t newest = 0;
+  size_t oldest = 0;
+  size_t length = 0;
+  unsigned char state = 0;
+
+  for (size_t i = 0; i < queue_state.sector_count; i++) {
+    queue_state.sector_seqs[i] = 0;
+    if (queue_state.store.read(queue_state.store.user_data, i * queue_state.store.sector_size, header,
+                               sizeof(header)) == 0 && memcmp(header, SECTOR_MAGIC, 4) == 0) {
+      queue_state.sector_seqs[i] = (uint32_t) header[4] | (uint32_t) header[5] << 8 | (uint32_t) header[6] << 16
+                                   | (uint32_t) header[7] << 24;
+    }
+    if (queue_state.sector_seqs[i] > queue_state.sector_seqs[newest]) {
+      newest = i;
+    }
+  }
+
+  if (!queue_state.sector_seqs[newest]) {
+    //A new store, start writing at the first sector
+    queue_state.next_seq = 1;
+    queue_state.head.sector = queue_state.sector_count - 1;
+    queue_state.head.offset = SECTOR_HEADER_SIZE;
+    queue_state.tail = queue_state.head;
+    return open_next_sector();
+  }
+  queue_state.next_seq = queue_state.sector_seqs[newest] + 1;
+
+  //The ring runs back from the newest sector for as long as sectors get older, anything else is left over
+  oldest = newest;
+  for (size_t i = 1; i < queue_state.sector_count; i++) {
+    size_t previous = (newest + queue_state.sector_count - i) % queue_state.sector_count;
+    if (!queue_state.sector_seqs[previous] || queue_state.sector_seqs[previous] >= queue_state.sector_seqs[oldest]) {
+      break;
+    }
+    oldest = previous;
+  }
+  for (size_t i = 0; i < queue_state.sector_count; i++) {
+    size_t distance = (i + queue_state.sector_count - oldest) % queue_state.sector_count;
+    if (distance > (newest + queue_state.sector_count - oldest) % queue_state.sector_count) {
+      queue_state.sector_seqs[i] = 0;
+    }
+  }
+
+  //Writing continues after the last record of the newest sector, unless a torn write left something else behind
+  queue_state.head.sector = newest;
+  queue_state.head.offset = queue_state.store.sector_size;
+  queue_position_t position = {newest, SECTOR_HEADER_SIZE};
+  while (read_record(position, &length, &state)) {
+    position.offset += record_size(length);
+  }
+  if (position.offset + RECORD_HEADER_SIZE <= queue_state.store.sector_size
+      && queue_state.store.read(queue_state.store.user_data, store_offset(position), header, RECORD_HEADER_SIZE) == 0
+      && memcmp(header, "\xFF\xFF\xFF\xFF", RECORD_HEADER_SIZE) == 0) {
+    queue_state.head.offset = position.offset;
+  }
+
+  queue_state.tail.sector = oldest;
+  queue_state.tail.offset = SECTOR_HEADER_SIZE;
+  position = queue_state.tail;
+  while (next_record(&position, &length, &state)) {
+    queue_state.stats.pending += state == RECORD_COMMITTED;
+    position.offset += record_size(length);
+  }
+  skip_done_records();
+  return true;
+}
+
+void report_queue_init(const gaus_report_queue_store_t *store) {
+  pthread_mutex_lock(&queue_state.lock);
+  memset(&queue_state.stats, 0, sizeof(queue_state.stats));
+  queue_state.in_flight = false;
+  queue_state.refilled_ms = 0;
+  queue_state.hold_until_ms = 0;
+  queue_state.failures = 0;
+  queue_state.enabled = false;
+  if (store && store->read && store->write && store->erase) {
+    if (store->sector_size <= SECTOR_HEADER_SIZE + RECORD_HEADER_SIZE || store->size % store->sector_size != 0
+        || store->size / store->sector_size < 2) {
+      logging(L_ERROR, "Report queue store of %zu bytes in sectors of %zu bytes is not usable", store->size,
+              store->sector_size);
+      goto out;
+    }
+    queue_state.store = *store;
+    queue_state.sector_count = store->size / store->sector_size;
+    if (!(queue_state.sector_seqs = calloc(queue_state.sector_count, sizeof(uint32_t)))) {
+      logging(L_ERROR, "Unable to allocate report queue");
+      goto out;
+    }
+    if (!(queue_state.enabled = open_queue())) {
+      free(queue_state.sector_seqs);
+      queue_state.sector_seqs = NULL;
+      goto out;
+    }
+    logging(L_DEBUG, "Report queue opened with %u reports to send", queue_state.stats.pending);
+  }
+
+  out:
+  pthread_mutex_unlock(&queue_state.lock);
+}
+
+void report_queue_cleanup(void) {
+  pthread_mutex_lock(&queue_state.lock);
+  queue_state.enabled = false;
+  free(queue_state.sector_seqs);
+  queue_state.sector_seqs = NULL;
+  pthread_mutex_unlock(&queue_state.lock);
+}
+
+/* Must hold the lock */
+static gaus_error_t *append_record(const char *json, size_t length) {
+  unsigned char header[RECORD_HEADER_SIZE] = {(unsigned char) length, (unsigned char) (length >> 8), RECORD_WRITTEN,
+                                              0xFF};
+  const unsigned char committed = RECORD_COMMITTED;
+
+  if (length >= RECORD_FREE_LENGTH || SECTOR_HEADER_SIZE + record_size(length) > queue_state.store.sector_size) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Report of %zu bytes does not fit the report queue",
+                             length);
+  }
+  if (queue_state.head.offset + record_size(length) > queue_state.store.sector_size && !open_next_sector()) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to make room in the report queue");
+  }
+
+  size_t offset = store_offset(queue_state.head);
+  //Whatever happens, the space is used now
+  queue_state.head.offset += record_size(length);
+  //Committed last, so a record cut short by a restart is skipped
+  if (queue_state.store.write(queue_state.store.user_data, offset, header, sizeof(header)) != 0
+      || queue_state.store.write(queue_state.store.user_data, offset + RECORD_HEADER_SIZE, (const unsigned char *) json,
+                                 length) != 0
+      || queue_state.store.write(queue_state.store.user_data, offset + 2, &committed, 1) != 0) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to write to the report queue");
+  }
+  queue_state.stats.pending++;
+  queue_state.stats.queued++;
+  return NULL;
+}
+
+gaus_error_t *gaus_report_queue_push(unsigned int report_count, const gaus_report_t *reports) {
+  gaus_error_t *status = NULL;
+  const gaus_report_t *send = NULL;
+  unsigned int send_count = 0;
+  DeadbandUpdate *update = NULL;
+  char *json = NULL;
+
+  if (!gaus_global_state.globalInitalized) {
+    return gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Queued reports without initializing");
+  }
+  if (report_count < 1 || !reports) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Queued reports with invalid parameters");
+  }
+  pthread_mutex_lock(&queue_state.lock);
+  bool enabled = queue_state.enabled;
+  pthread_mutex_unlock(&queue_state.lock);
+  if (!enabled) {
+    return gaus_create_error(__func__, GAUS_BAD_INIT_ERROR, 500, "Queued reports without a report queue store");
+  }
+
+  if (NULL != (status = report_deadband_filter(report_count, reports, request_monotonic_ms(), &send_count, &send,
+                                               &update))) {
+    return status;
+  }
+  for (unsigned int i = 0; i < send_count && !status; i++) {
+    //Encoded before taking the lock, so a drain is not held up by it
+    if (NULL != (status = report_encode(&send[i], &json))) {
+      break;
+    }
+    pthread_mutex_lock(&queue_state.lock);
+    //Unless cleaned up meanwhile
+    status = queue_state.enabled ? append_record(json, strlen(json))
+                                 : gaus_create_error(__func__, GAUS_BAD_INIT_ERROR, 500, "Report queue was closed");
+    pthread_mutex_unlock(&queue_state.lock);
+    free(json);
+  }
+  report_deadband_release(send, reports);
+  //Reports appended before one failed may be appended again, rather than lose the ones that were not
+  if (status) {
+    report_deadband_discard(update);
+  } else {
+    report_deadband_commit(update);
+  }
+  return status;
+}
+
+gaus_error_t *report_queue_append(const char *json, size_t length) {
+  gaus_error_t *status = NULL;
+
+  pthread_mutex_lock(&queue_state.lock);
+  status = queue_state.enabled ? append_record(json, length)
+                               : gaus_create_error(__func__, GAUS_BAD_INIT_ERROR, 500, "No report queue store");
+  pthread_mutex_unlock(&queue_state.lock);
+  return status;
+}
+
+/* Mark the records of the batch that was in flight as done, counting them as sent or rejected.  Must hold the lock. */
+static void finish_batch(bool rejected) {
+  queue_position_t position = queue_state.tail;
+  size_t length = 0;
+  unsigned char state = 0;
+  const unsigned char sent = RECORD_SENT;
+
+  //Records dropped to make room meanwhile are gone, and those in reopened sectors compare past the end
+  while (next_record(&position, &length, &state) && position_key(position) < queue_state.batch_end) {
+    if (state == RECORD_COMMITTED) {
+      if (queue_state.store.write(queue_state.store.user_data, store_offset(position) + 2, &sent, 1) != 0) {
+        logging(L_WARNING, "Unable to mark a report as sent, it will be sent again after a restart");
+      }
+      queue_state.stats.pending--;
+      if (rejected) {
+        queue_state.stats.rejected++;
+      } else {
+        queue_state.stats.sent++;
+      }
+    }
+    position.offset += record_size(length);
+  }
+  queue_state.tail = position;
+  skip_done_records();
+}
+
+static void batch_done(int result, long status_code, const char *response, const char *url,
+                       const RequestDeadline *deadline, void *user_data) {
+  (void) response;
+  (void) url;
+  (void) deadline;
+  (void) user_data;
+
+  pthread_mutex_lock(&queue_state.lock);
+  queue_state.in_flight = false;
+  if (!queue_state.enabled) {
+    goto out;
+  }
+  if (result == 0) {
+    finish_batch(false);
+    queue_state.stats.batches++;
+    queue_state.failures = 0;
+  } else if (status_code >= 400 && status_code < 500 && status_code != 401
+             && !retry_is_transient(CURLE_OK, status_code)) {
+    //Sending the same reports again would only be refused again
+    logging(L_ERROR, "Queued reports refused with http error code %ld, dropping them", status_code);
+    finish_batch(true);
+    queue_state.failures = 0;
+  } else {
+    queue_state.stats.failed_batches++;
+    queue_state.failures++;
+    queue_state.hold_until_ms = request_monotonic_ms()
+                                + gaus_retry_delay_ms(&queue_state.retry, queue_state.failures);
+  }
+
+  out:
+  pthread_mutex_unlock(&queue_state.lock);
+}
+
+/* Copy as many unsent records from the tail into body (after its used bytes) as fit in limit bytes, leaving room for
+ * REPORT_BODY_SUFFIX.  The first record is taken even if it does not fit when force is set.  Must hold the lock.
+ */
+static unsigned int collect_batch(char *body, size_t *used, size_t limit, bool force) {
+  queue_position_t position = queue_state.tail;
+  size_t length = 0;
+  unsigned char state = 0;
+  unsigned int count = 0;
+
+  while (next_record(&position, &length, &state)) {
+    if (state == RECORD_COMMITTED) {
+      size_t needed = (count > 0) + length + strlen(REPORT_BODY_SUFFIX);
+      if (*used + needed > limit && (count > 0 || !force)) {
+        break;
+      }
+      if (count > 0) {
+        body[(*used)++] = ',';
+      }
+      if (queue_state.store.read(queue_state.store.user_data, store_offset(position) + RECORD_HEADER_SIZE,
+                                 (unsigned char *) body + *used, length) != 0) {
+        logging(L_WARNING, "Unable to read queued report");
+        *used -= count > 0;
+        break;
+      }
+      *used += length;
+      count++;
+    }
+    position.offset += record_size(length);
+  }
+  queue_state.batch_end = position_key(position);
+  return count;
+}
+
+gaus_error_t *gaus_report_queue_drain(const gaus_session_t *session, const gaus_filter_set_t *filter_set,
+                                      const gaus_report_header_t *header,
+                                      const gaus_report_queue_drain_options_t *options) {
+  gaus_error_t *status = NULL;
+  char *prefix = NULL;
+  char *body = NULL;
+  char *url = NULL;
+  unsigned int count = 0;
+  size_t used = 0;
+  size_t batch_bytes = options && options->batch_bytes ? options->batch_bytes : GAUS_REPORT_QUEUE_DEFAULT_BATCH_BYTES;
+  unsigned long bytes_per_s = options ? options->bytes_per_s : 0;
+
+  if (!gaus_global_state.globalInitalized) {
+    return gaus_create_error(__func__, GAUS_NO_INIT_ERROR, 500, "Drained reports without initializing");
+  }
+  if (!session || !session->device_guid || !session->product_guid || !session->token || !header) {
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Drained reports with invalid parameters");
+  }
+  if (NULL != (status = report_encode_prefix(header, &prefix))) {
+    return status;
+  }
+
+  pthread_mutex_lock(&queue_state.lock);
+  if (!queue_state.enabled) {
+    status = gaus_create_error(__func__, GAUS_BAD_INIT_ERROR, 500, "Drained reports without a report queue store");
+    goto out;
+  }
+  uint64_t now = request_monotonic_ms();
+  if (queue_state.in_flight || queue_state.stats.pending == 0 || now < queue_state.hold_until_ms) {
+    goto out;
+  }
+
+  size_t limit = batch_bytes;
+  bool force = true;
+  if (bytes_per_s) {
+    //A bucket of up to a batch worth of bytes, refilled at the rate allowed
+    if (queue_state.refilled_ms == 0) {
+      queue_state.tokens = (double) batch_bytes;
+    } else {
+      queue_state.tokens += (double) (now - queue_state.refilled_ms) * bytes_per_s / 1000;
+    }
+    if (queue_state.tokens > (double) batch_bytes) {
+      queue_state.tokens = (double) batch_bytes;
+    }
+    queue_state.refilled_ms = now;
+    if (queue_state.tokens < (double) limit) {
+      limit = (size_t) queue_state.tokens;
+      force = false;
+    }
+  }
+
+  //Room for the largest record on its own
+  size_t capacity = strlen(prefix) + queue_state.store.sector_size + strlen(REPORT_BODY_SUFFIX) + 1;
+  if (!(body = malloc(capacity > batch_bytes + 1 ? capacity : batch_bytes + 1))) {
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate report batch");
+    goto out;
+  }
+  used = strlen(prefix);
+  memcpy(body, prefix, used);
+  if ((count = collect_batch(body, &used, limit, force)) == 0) {
+    goto out;
+  }
+  strcpy(body + used, REPORT_BODY_SUFFIX);
+  used += strlen(REPORT_BODY_SUFFIX);
+  if (bytes_per_s) {
+    queue_state.tokens -= (double) used;
+  }
+  queue_state.retry = options ? options->retry : (gaus_retry_policy_t) {0, 0, 0};
+  queue_state.in_flight = true;
+  pthread_mutex_unlock(&queue_state.lock);
+
+  logging(L_DEBUG, "Sending %u queued reports in %zu bytes", count, used);
+  if (!(url = url_create_for_device(&gaus_global_state.client->url_prefix, gaus_global_state.serverUrl, session,
+                                    "/report", filter_set_query(filter_set)))) {
+    free(body);
+    status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to create report url");
+  } else {
+    const char *token = session_acquire(session);
+    int started = async_request_start(gaus_global_state.client, url, token, body, batch_done, NULL);
+    session_release();
+    if (0 != started) {
+      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to start sending queued reports");
+    }
+  }
+  //Ownership of url and body was handed over
+  body = NULL;
+  pthread_mutex_lock(&queue_state.lock);
+  if (status) {
+    queue_state.in_flight = false;
+  }
+
+  out:
+  pthread_mutex_unlock(&queue_state.lock);
+  free(body);
+  free(prefix);
+  return status;
+}
+
+gaus_report_queue_stats_t gaus_get_report_queue_stats(void) {
+  pthread_mutex_lock(&queue_state.lock);
+  gaus_report_queue_stats_t stats = queue_state.stats;
+  pthread_mutex_unlock(&queue_state.lock);
+  return stats;
+}
+
+/* Open path for reading and writing, creating it if needed */
+static FILE *open_store_file(const char *path) {
+  FILE *file = fopen(path, "r+b");
+  return file ? file : fopen(path, "w+b");
+}
+
+int gaus_report_queue_file_read(void *path, size_t offset, unsigned char *buffer, size_t length) {
+  FILE *file = open_store_file((const char *) path);
+  if (!file) {
+    return -1;
+  }
+  size_t done = fseek(file, (long) offset, SEEK_SET) == 0 ? fread(buffer, 1, length, file) : 0;
+  int error = ferror(file);
+  fclose(file);
+  //Never written, so still erased
+  memset(buffer + done, 0xFF, length - done);
+  return error ? -1 : 0;
+}
+
+int gaus_report_queue_file_write(void *path, size_t offset, const unsigned char *buffer, size_t length) {
+  FILE *file = open_store_file((const char *) path);
+  if (!file) {
+    logging(L_WARNING, "Unable to open %s for writing reports", (const char *) path);
+    return -1;
+  }
+  size_t written = fseek(file, (long) offset, SEEK_SET) == 0 ? fwrite(buffer, 1, length, file) : 0;
+  int result = fclose(file);
+  return (written == length && result == 0) ? 0 : -1;
+}
+
+int gaus_report_queue_file_erase(void *path, size_t offset, size_t length) {
+  unsigned char erased[256];
+  size_t written = 0;
+  FILE *file = open_store_file((const char *) path);
+  if (!file) {
+    logging(L_WARNING, "Unable to open %s for erasing reports", (const char *) path);
+    return -1;
+  }
+  memset(erased, 0xFF, sizeof(erased));
+  if (fseek(file, (long) offset, SEEK_SET) == 0) {
+    while (written < length) {
+      size_t chunk = length - written < sizeof(erased) ? length - written : sizeof(erased);
+      if (fwrite(erased, 1, chunk, file) != chunk) {
+        break;
+      }
+      written += chunk;
+    }
+  }
+  int result = fclose(file);
+  return (written == length && result == 0) ? 0 : -1;
+}
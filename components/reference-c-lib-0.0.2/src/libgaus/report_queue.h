@@ -0,0 +1,31 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_REPORT_QUEUE_H
+#define GAUS_REPORT_QUEUE_H
+
+#include <gaus/gaus_client_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Open the queue kept in store (NULL to not queue reports), picking up the reports left in it */
+void report_queue_init(const gaus_report_queue_store_t *store);
+
+/* Queue a report encoded by report_encode, length bytes of json (not null terminated) */
+gaus_error_t *report_queue_append(const char *json, size_t length);
+
+/* Close the queue, a batch in flight must be done by now */
+void report_queue_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_REPORT_QUEUE_H
@@ -9,117 +9,127 @@
 //THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "log.h"
 
-#include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
 
+#include "client.h"
 #include "curl_wrapper.h"
+#include "dns_cache.h"
 #include "gaus.h"
 #include "gaus/gaus_client.h"
+#include "request.h"
+#include "retry.h"
+#include "stats.h"
+#include "tls_session.h"
 
 
+//Longest time to block in curl_multi_wait before checking on a transfer again
+#define REQUEST_WAIT_MS 1000
+//Longest time to sleep between retries before checking for a cancel again
+#define RETRY_SLICE_MS 100
+//Most bytes of a part of a response shown by the debug log
+#define RESPONSE_DUMP_MAX 1000
+
 typedef struct FileResponse {
   int fd;
   FILE *file;
 } FileResponse;
 
-typedef struct InMemoryResponse {
-  char *data;
+typedef struct Transfer {
+  CURLM *multi;
+  CURL *curl;
+  bool done;
+  CURLcode result;
+} Transfer;
+
+typedef struct JsonStream {
+  Transfer *transfer;
+  char *buffer;
+  size_t size;
+  size_t length;
   size_t pos;
-} InMemoryResponse;
-
-static int request_get(const char *url, const char *auth_token,
-                       curl_write_callback response_writer, void *response, long *status_code);
+  bool paused;
+  bool draining;
+} JsonStream;
 
-static int request_post(const char *url, const char *auth_token, const char *payload,
-                        curl_write_callback response_writer, void *response, long *status_code);
+static int request_get(gaus_client_t *client, const char *url, const char *auth_token,
+                       curl_write_callback response_writer, void *response, RequestDeadline *deadline,
+                       long *status_code);
 
-static size_t in_memory_response_writer(char *content, size_t size,
-                                        size_t nmemb, void *userp);
+static int request_post(gaus_client_t *client, const char *url, const char *auth_token, const RequestBody *body,
+                        curl_write_callback response_writer, void *response, RequestDeadline *deadline,
+                        long *status_code);
 
 static size_t file_response_writer(char *content, size_t size, size_t nmemb,
                                    void *userp);
 
-static inline void write_char_safe(char *base, size_t *offset, size_t len, char ch) {
-  if (base != NULL && *offset + 1 < len) {
-    base[*offset] = ch;
-  }
-  (*offset)++;
+static size_t response_header_callback(char *buffer, size_t size, size_t nitems, void *userp);
+
+uint64_t request_monotonic_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000 + (uint64_t) now.tv_nsec / 1000000;
 }
 
-/* snprintf-like function for constructing urls
- * Only accepts two format string directives:
- *   %s - string as given
- *   %e - urlencode the given string
- */
-int create_url(char *dest, size_t dest_len, char *fmt, ...) {
-  va_list ap;
-  char *str;
-  char *encoded;
-  bool in_specifier = false;
-  size_t pos = 0;
-
-  CURL *curl = gaus_curl_easy_init();
-  if (!curl) {
-    logging(L_ERROR, "create_url: Failed to initialize curl");
-    return -1;
+void request_deadline_start(RequestDeadline *deadline, const gaus_call_options_t *options) {
+  if (!options) {
+    options = &gaus_global_state.call_options;
   }
+  deadline->connect_timeout_ms = (long) options->connect_timeout_ms;
+  deadline->end_ms = options->timeout_ms ? request_monotonic_ms() + options->timeout_ms : 0;
+  deadline->cancel = options->cancel;
+  deadline->retry = options->retry;
+  deadline->expired = 0;
+}
 
-  va_start(ap, fmt);
+gaus_error_t *request_deadline_error(const char *func, const RequestDeadline *deadline) {
+  switch (deadline->expired) {
+    case GAUS_TIMEOUT_ERROR:
+      return gaus_create_error(func, GAUS_TIMEOUT_ERROR, 408, "Request timed out");
+    case GAUS_CANCELLED_ERROR:
+      return gaus_create_error(func, GAUS_CANCELLED_ERROR, 500, "Request cancelled");
+    default:
+      return NULL;
+  }
+}
 
-  while (*fmt) {
-    if (!in_specifier) {
-      if (*fmt == '%') {
-        in_specifier = true;
-      } else {
-        write_char_safe(dest, &pos, dest_len, *fmt);
-      }
-    } else {
-      switch (*fmt) {
-        case '%':
-          write_char_safe(dest, &pos, dest_len, '%');
-          break;
-        case 'e':
-          str = va_arg(ap, char *);
-          encoded = curl_easy_escape(curl, str, strlen(str));
-          str = encoded;
-          while (*str) {
-            write_char_safe(dest, &pos, dest_len, *str++);
-          }
-          curl_free(encoded);
-          break;
-        case 's':
-          str = va_arg(ap, char *);
-          while (*str) {
-            write_char_safe(dest, &pos, dest_len, *str++);
-          }
-          break;
-        default:
-          logging(L_ERROR, "Invalid format string");
-          goto out;
-      }
-      in_specifier = false;
-    }
-    fmt++;
+/* Check whether deadline expired, returns true (and marks it expired) if it did, setting remaining_ms otherwise */
+static bool deadline_expired(RequestDeadline *deadline, long *remaining_ms) {
+  if (deadline->cancel && deadline->cancel->cancelled) {
+    deadline->expired = GAUS_CANCELLED_ERROR;
+    return true;
   }
-  out:
-  gaus_curl_easy_cleanup(curl);
-  if (dest) {
-    if (pos + 1 < dest_len) {
-      dest[pos] = '\0';
-    } else {
-      dest[dest_len - 1] = '\0';
-      logging(L_ERROR, "create_url: URL too large, truncating (%s)", dest);
+  *remaining_ms = 0;
+  if (deadline->end_ms) {
+    uint64_t now = request_monotonic_ms();
+    if (now >= deadline->end_ms) {
+      deadline->expired = GAUS_TIMEOUT_ERROR;
+      return true;
     }
+    *remaining_ms = (long) (deadline->end_ms - now);
   }
-  va_end(ap);
+  return false;
+}
 
-  return pos;
+/* Called by curl at least once a second during a transfer, returning non zero aborts it */
+static int request_progress_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal,
+                                     curl_off_t ulnow) {
+  RequestContext *context = clientp;
+  long remaining_ms = 0;
+  (void) dltotal;
+  (void) dlnow;
+  (void) ultotal;
+  (void) ulnow;
+
+  return deadline_expired(context->deadline, &remaining_ms) ? 1 : 0;
 }
 
-int request_get_as_file(const char *url, const char *token, int fd, long *status_code) {
+int request_get_as_file(gaus_client_t *client, const char *url, const char *token, int fd, RequestDeadline *deadline,
+                        long *status_code) {
   FILE *file = fdopen(fd, "w");
   if (!file) {
     logging(L_ERROR, "Failed to open file");
@@ -127,15 +137,16 @@ int request_get_as_file(const char *url, const char *token, int fd, long *status
   }
   FileResponse response = {.file = file, .fd = fd};
 
-  int result = request_get(url, token, file_response_writer, &response, status_code);
+  int result = request_get(client, url, token, file_response_writer, &response, deadline, status_code);
   fclose(file);
   return result;
 }
 
 /* Returns the downloaded data as a string */
-char *request_get_as_string(const char *url, const char *auth_token, long *status_code) {
+char *request_get_as_string(gaus_client_t *client, const char *url, const char *auth_token, RequestDeadline *deadline,
+                            long *status_code) {
   struct InMemoryResponse response = {};
-  int err = request_get(url, auth_token, in_memory_response_writer, &response, status_code);
+  int err = request_get(client, url, auth_token, in_memory_response_writer, &response, deadline, status_code);
   if (err) {
     if (response.pos > 0) {
       logging(L_ERROR, "%s", response.data);
@@ -148,9 +159,17 @@ char *request_get_as_string(const char *url, const char *auth_token, long *statu
   return response.data;
 }
 
-char *request_post_as_string(const char *url, const char *auth_token, const char *payload, long *status_code) {
+char *request_post_as_string(gaus_client_t *client, const char *url, const char *auth_token, const char *payload,
+                             RequestDeadline *deadline, long *status_code) {
+  RequestBody body = {.data = payload, .length = strlen(payload)};
+  return request_post_body_as_string(client, url, auth_token, &body, deadline, status_code);
+}
+
+char *request_post_body_as_string(gaus_client_t *client, const char *url, const char *auth_token,
+                                  const RequestBody *body, RequestDeadline *deadline, long *status_code) {
   struct InMemoryResponse response = {};
-  int err = request_post(url, auth_token, payload, in_memory_response_writer, &response, status_code);
+  int err = request_post(client, url, auth_token, body, in_memory_response_writer, &response, deadline,
+                         status_code);
   if (err) {
     if (response.pos > 0) {
       logging(L_ERROR, "%s", response.data);
@@ -163,210 +182,530 @@ char *request_post_as_string(const char *url, const char *auth_token, const char
   return response.data;
 }
 
-static int request_post(const char *url, const char *auth_token, const char *payload,
-                        curl_write_callback response_writer, void *response, long *status_code) {
-  CURL *curl = NULL;
-  CURLcode status;
+static struct curl_slist *append_header(struct curl_slist **headers, const char *header) {
+  struct curl_slist *appended = gaus_curl_slist_append(*headers, header);
+  if (!appended) {
+    curl_slist_free_all(*headers);
+  }
+  *headers = appended;
+  return appended;
+}
+
+/* Build the header list described by RequestHeaders for auth_token */
+static struct curl_slist *create_headers(const char *auth_token) {
   struct curl_slist *headers = NULL;
-  long code;
   char *auth_header = NULL;
-  char *user_agent_header = NULL;
+  char user_agent_header[64];
 
-  curl = gaus_curl_easy_init();
-  if (!curl) {
+  if (!append_header(&headers, "Content-Type: application/json")) {
     goto error;
   }
 
   if (auth_token) {
     size_t required_auth_header_len = snprintf(NULL, 0, "Authorization: Bearer %s", auth_token) + 1;
-    auth_header = malloc(required_auth_header_len);
-    size_t auth_header_len = snprintf(auth_header, required_auth_header_len,
-                                      "Authorization: Bearer %s", auth_token);
-    if (auth_header_len >= required_auth_header_len) {
-      logging(L_ERROR, "request_get error: Authorization header to large");
+    if (!(auth_header = malloc(required_auth_header_len))) {
+      logging(L_ERROR, "request error: Unable to allocate Authorization header");
+      goto error;
+    }
+    snprintf(auth_header, required_auth_header_len, "Authorization: Bearer %s", auth_token);
+    if (!append_header(&headers, auth_header)) {
       goto error;
     }
-    headers = curl_slist_append(headers, auth_header);
   }
 
   gaus_version_t version = gaus_client_library_version();
-  size_t required_user_agent_len =
-      snprintf(NULL, 0, "User-Agent: gaus-device-client-c/v%d.%d.%d", version.major, version.minor, version.patch) + 1;
-  user_agent_header = malloc(required_user_agent_len);
-  size_t user_agent_len = snprintf(user_agent_header, required_user_agent_len,
+  size_t user_agent_len = snprintf(user_agent_header, sizeof(user_agent_header),
                                    "User-Agent: gaus-device-client-c/v%d.%d.%d", version.major, version.minor,
                                    version.patch);
-  if (user_agent_len >= required_user_agent_len) {
-    logging(L_ERROR, "request_get error: User-Agent header too large");
+  if (user_agent_len >= sizeof(user_agent_header)) {
+    logging(L_ERROR, "request error: User-Agent header too large");
     goto error;
   }
-  headers = curl_slist_append(headers, user_agent_header);
-  headers = curl_slist_append(headers, "Content-Type: application/json");
+  if (!append_header(&headers, user_agent_header)) {
+    goto error;
+  }
+
+  free(auth_header);
+  return headers;
 
-  if (gaus_global_state.proxy) {
-    gaus_curl_easy_setopt(curl, CURLOPT_PROXY, gaus_global_state.proxy);
+  error:
+  free(auth_header);
+  curl_slist_free_all(headers);
+  return NULL;
+}
+
+static bool same_token(const char *a, const char *b) {
+  return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+/* Get the headers for a request with auth_token from cache, rebuilding them if the token changed. */
+static struct curl_slist *get_cached_headers(RequestHeaders *cache, const char *auth_token) {
+  if (cache->headers && same_token(cache->token, auth_token)) {
+    cache->users++;
+    return cache->headers;
+  }
+  if (cache->users > 0) {
+    //Still in use with the old token
+    return NULL;
   }
 
-  gaus_curl_easy_setopt(curl, CURLOPT_URL, url);
-  gaus_curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
-  gaus_curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, strlen(payload));
-  gaus_curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  logging(L_DEBUG, "Building request headers for new token");
+  request_headers_cleanup(cache);
+  if (auth_token && !(cache->token = strdup(auth_token))) {
+    return NULL;
+  }
+  if (!(cache->headers = create_headers(auth_token))) {
+    request_headers_cleanup(cache);
+    return NULL;
+  }
+  cache->users++;
+  return cache->headers;
+}
+
+void request_headers_cleanup(RequestHeaders *cache) {
+  curl_slist_free_all(cache->headers);
+  free(cache->token);
+  cache->headers = NULL;
+  cache->token = NULL;
+}
+
+int request_setup(CURL *curl, RequestContext *context, RequestHeaders *cache, const char *url, const char *auth_token,
+                  const RequestBody *body, RequestCondition *condition, RequestDeadline *deadline,
+                  curl_write_callback response_writer, void *response) {
+  long remaining_ms = 0;
+
+  context->curl = curl;
+  context->headers = NULL;
+  context->cached_headers = NULL;
+  context->condition = condition;
+  context->deadline = deadline;
+  context->headers_started = false;
+  context->tls_resumed = false;
+  context->validator_is_etag = false;
+  context->method = body ? "POST" : "GET";
+  context->url = url;
+  context->has_body = body != NULL;
+  if (body) {
+    context->body = *body;
+  }
+  context->retry_after_ms = 0;
+  context->dns_pin.active = false;
+
+  if (deadline && deadline_expired(deadline, &remaining_ms)) {
+    logging(L_ERROR, "request error: Cancelled or out of time before requesting %s", url);
+    return -1;
+  }
+
+  struct curl_slist *headers = NULL;
+  if (cache && (headers = get_cached_headers(cache, auth_token))) {
+    context->cached_headers = cache;
+  } else if ((headers = create_headers(auth_token))) {
+    context->headers = headers;
+  } else {
+    logging(L_ERROR, "request error: Unable to create headers");
+    return -1;
+  }
+  //Content-Type is first in the list, skip it if there is nothing to send or the body is no json.
+  if (!body || body->content_type_header) {
+    headers = headers->next;
+  }
+  if (body && body->content_type_header) {
+    context->content_type_header.data = (char *) body->content_type_header;
+    context->content_type_header.next = headers;
+    headers = &context->content_type_header;
+  }
+  if (condition) {
+    condition->validator = NULL;
+    if (condition->header) {
+      //Put the condition in front of the shared headers without touching them, curl only reads the list.
+      context->condition_header.data = (char *) condition->header;
+      context->condition_header.next = headers;
+      headers = &context->condition_header;
+    }
+  }
 
 #ifdef GAUS_NO_CA_CHECK
   logging(L_DEBUG, "skipping verify peer certificate");
   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
 #endif
 
+  gaus_curl_easy_setopt(curl, CURLOPT_URL, url);
+  if (body) {
+    gaus_curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body->data);
+    gaus_curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) body->length);
+  } else {
+    gaus_curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+  }
+  gaus_curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  //Probe the connection kept for the next call while it idles, so NAT and firewall state for it does not time out.
+  gaus_curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
   gaus_curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, response_writer);
   gaus_curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
 
-  logging(L_DEBUG, "POST %s", url);
-  status = gaus_curl_easy_perform(curl);
-  if (status != 0) {
-    logging(L_ERROR,
-            "request_post error: unable to request data from %s:", url);
-    logging(L_ERROR, "%s", curl_easy_strerror(status));
-    goto error;
+  gaus_curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, response_header_callback);
+  gaus_curl_easy_setopt(curl, CURLOPT_HEADERDATA, context);
+
+  if (deadline) {
+    if (deadline->connect_timeout_ms > 0) {
+      gaus_curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, deadline->connect_timeout_ms);
+    }
+    if (remaining_ms > 0) {
+      gaus_curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, remaining_ms);
+    }
+    //Lets a cancel token stop the transfer, and the deadline too should curl miss it while stuck in a callback.
+    if (deadline->end_ms || deadline->cancel) {
+      gaus_curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, request_progress_callback);
+      gaus_curl_easy_setopt(curl, CURLOPT_XFERINFODATA, context);
+      gaus_curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    }
   }
+  tls_session_prepare(curl);
+  dns_cache_prepare(curl, url, &context->dns_pin);
 
-  gaus_curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
-  *status_code = code;
-  if (code != 200) {
-    logging(L_ERROR, "request_post error: server responded with code %ld for url: %s",
-            code, url);
-    logging(L_ERROR, "Failed post with payload: '%s'", payload);
-    goto error;
+  logging(L_DEBUG, "%s %s", context->method, url);
+  return 0;
+}
+
+int request_finish(RequestContext *context, CURLcode status, long *status_code) {
+  CURL *curl = context->curl;
+  int result = -1;
+
+  tls_session_finish(curl, context->tls_resumed);
+  stats_record(curl, context->url, status);
+  dns_cache_finish(curl, &context->dns_pin, status);
+
+  if (status != CURLE_OK) {
+    logging(L_ERROR, "%s error: unable to request data from %s: %s", context->method, context->url,
+            curl_easy_strerror(status));
+    //An abort by the progress callback already marked the deadline expired
+    if (status == CURLE_OPERATION_TIMEDOUT && context->deadline) {
+      context->deadline->expired = GAUS_TIMEOUT_ERROR;
+    }
+    goto out;
   }
 
-  free(auth_header);
-  free(user_agent_header);
-  gaus_curl_easy_cleanup(curl);
-  curl_slist_free_all(headers);
+  gaus_curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, status_code);
+  if (*status_code == 304 && context->condition && context->condition->header) {
+    logging(L_DEBUG, "%s %s: not modified", context->method, context->url);
+    result = 0;
+    goto out;
+  }
+  if (*status_code != 200) {
+    logging(L_ERROR, "%s error: server responded with code %ld for url: %s", context->method, *status_code,
+            context->url);
+    //Only json is worth printing
+    if (context->has_body && !context->body.content_type_header) {
+      logging(L_ERROR, "Failed post with payload: '%.*s'", (int) context->body.length, context->body.data);
+    }
+    goto out;
+  }
 
-  return 0;
+  result = 0;
 
-  error:
-  free(auth_header);
-  free(user_agent_header);
-  if (curl) {
-    gaus_curl_easy_cleanup(curl);
+  out:
+  //Detach our headers before releasing them, the handle may outlive them.
+  gaus_curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+  curl_slist_free_all(context->headers);
+  context->headers = NULL;
+  if (context->cached_headers) {
+    context->cached_headers->users--;
+    context->cached_headers = NULL;
   }
-  if (headers) {
-    curl_slist_free_all(headers);
+  if (result != 0 && context->condition) {
+    free(context->condition->validator);
+    context->condition->validator = NULL;
   }
-  return 1;
+  return result;
 }
 
-static int request_get(const char *url, const char *auth_token,
-                       curl_write_callback response_writer, void *response, long *status_code) {
-  CURL *curl = NULL;
-  CURLcode status;
-  struct curl_slist *headers = NULL;
-  char *auth_header = NULL;
-  char *user_agent_header = NULL;
+/* Carry out a transfer on a multi handle a step at a time, so the caller can act on data as it arrives. */
+static int transfer_start(Transfer *transfer, CURLM *multi, CURL *curl) {
+  transfer->multi = multi;
+  transfer->curl = curl;
+  transfer->done = false;
+  transfer->result = CURLE_OK;
 
-  curl = gaus_curl_easy_init();
-  if (!curl) {
-    goto error;
+  if (gaus_curl_multi_add_handle(multi, curl) != CURLM_OK) {
+    logging(L_ERROR, "request error: Failed to start transfer");
+    return -1;
   }
+  return 0;
+}
 
-#ifdef GAUS_NO_CA_CHECK
-  logging(L_DEBUG, "skipping verify peer certificate");
-  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-#endif
+static void transfer_step(Transfer *transfer) {
+  int running = 0;
+  int queued = 0;
+  CURLMsg *message = NULL;
 
-  gaus_curl_easy_setopt(curl, CURLOPT_URL, url);
-  gaus_curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+  CURLMcode code = gaus_curl_multi_perform(transfer->multi, &running);
+  if (code == CURLM_OK && running > 0) {
+    code = gaus_curl_multi_wait(transfer->multi, NULL, 0, REQUEST_WAIT_MS, NULL);
+  }
+  if (code != CURLM_OK) {
+    logging(L_ERROR, "request error: %s", curl_multi_strerror(code));
+    transfer->result = CURLE_FAILED_INIT;
+    transfer->done = true;
+    return;
+  }
 
-  if (auth_token) {
-    size_t required_auth_header_len = snprintf(NULL, 0, "Authorization: Bearer %s", auth_token) + 1;
-    auth_header = malloc(required_auth_header_len);
-    size_t auth_header_len = snprintf(auth_header, required_auth_header_len,
-                                      "Authorization: Bearer %s", auth_token);
-    if (auth_header_len >= required_auth_header_len) {
-      logging(L_ERROR, "request_get error: Authorization header to large");
-      goto error;
+  while ((message = gaus_curl_multi_info_read(transfer->multi, &queued))) {
+    if (message->msg == CURLMSG_DONE && message->easy_handle == transfer->curl) {
+      transfer->result = message->data.result;
+      transfer->done = true;
     }
-    headers = curl_slist_append(headers, auth_header);
   }
+}
 
-  gaus_version_t version = gaus_client_library_version();
-  size_t required_user_agent_len =
-      snprintf(NULL, 0, "User-Agent: gaus-device-client-c/v%d.%d.%d", version.major, version.minor, version.patch) + 1;
-  user_agent_header = malloc(required_user_agent_len);
-  size_t user_agent_len = snprintf(user_agent_header, required_user_agent_len,
-                                   "User-Agent: gaus-device-client-c/v%d.%d.%d", version.major, version.minor,
-                                   version.patch);
-  if (user_agent_len >= required_user_agent_len) {
-    logging(L_ERROR, "request_get error: User-Agent header too large");
-    goto error;
+static CURLcode transfer_complete(Transfer *transfer) {
+  while (!transfer->done) {
+    transfer_step(transfer);
   }
-  headers = curl_slist_append(headers, user_agent_header);
-  gaus_curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  gaus_curl_multi_remove_handle(transfer->multi, transfer->curl);
+  return transfer->result;
+}
+
+/* Receives the body for request_get_as_json, holding at most one chunk of it at a time.
+ *
+ * A chunk arriving before jansson consumed the previous one pauses the transfer, curl keeps it until json_stream_reader
+ * asks for more.
+ */
+static size_t json_stream_writer(char *content, size_t size, size_t nmemb, void *userp) {
+  JsonStream *stream = userp;
+  size_t write_size = size * nmemb;
 
-  if (gaus_global_state.proxy) {
-    gaus_curl_easy_setopt(curl, CURLOPT_PROXY, gaus_global_state.proxy);
+  if (stream->draining) {
+    return write_size;
   }
 
-  gaus_curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, response_writer);
-  gaus_curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+  if (stream->pos < stream->length) {
+    stream->paused = true;
+    return CURL_WRITEFUNC_PAUSE;
+  }
 
-  logging(L_DEBUG, "GET %s", url);
-  status = gaus_curl_easy_perform(curl);
-  if (status != 0) {
-    logging(L_ERROR, "request_get error: %s", curl_easy_strerror(status));
-    goto error;
+  if (write_size > stream->size) {
+    char *buffer = realloc(stream->buffer, write_size);
+    if (!buffer) {
+      logging(L_ERROR, "not enough memory (realloc returned NULL)");
+      return 0;
+    }
+    stream->buffer = buffer;
+    stream->size = write_size;
   }
 
-  gaus_curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, status_code);
-  if (*status_code != 200) {
-    logging(L_ERROR, "request_get error: server responded with code %ld", *status_code);
-    goto error;
+  memcpy(stream->buffer, content, write_size);
+  stream->length = write_size;
+  stream->pos = 0;
+  return write_size;
+}
+
+/* json_load_callback source driving the transfer until there is something to parse, 0 means the body ended */
+static size_t json_stream_reader(void *buffer, size_t buflen, void *data) {
+  JsonStream *stream = data;
+
+  while (stream->pos == stream->length) {
+    if (stream->paused) {
+      //Resuming may deliver the held back chunk right away.
+      stream->paused = false;
+      gaus_curl_easy_pause(stream->transfer->curl, CURLPAUSE_CONT);
+    } else if (stream->transfer->done) {
+      return 0;
+    } else {
+      transfer_step(stream->transfer);
+    }
   }
 
-  free(auth_header);
-  free(user_agent_header);
-  gaus_curl_easy_cleanup(curl);
-  curl_slist_free_all(headers);
+  size_t read_size = stream->length - stream->pos;
+  if (read_size > buflen) {
+    read_size = buflen;
+  }
+  memcpy(buffer, stream->buffer + stream->pos, read_size);
+  stream->pos += read_size;
+  return read_size;
+}
 
-  return 0;
+/* Wait before repeating a request that failed with status (and status_code), as the retry policy of deadline allows.
+ *
+ * attempt is the number of attempts made so far.  Returns false without waiting if the request should not be repeated,
+ * or if the wait would run past the deadline.
+ */
+static bool retry_wait(RequestDeadline *deadline, unsigned int attempt, CURLcode status, long status_code,
+                       unsigned long retry_after) {
+  long remaining_ms = 0;
 
-  error:
-  free(auth_header);
-  free(user_agent_header);
-  if (curl) {
-    gaus_curl_easy_cleanup(curl);
+  if (!deadline || attempt >= deadline->retry.max_attempts || !retry_is_transient(status, status_code)) {
+    return false;
+  }
+  if (deadline->retry.max_delay_ms && retry_after > deadline->retry.max_delay_ms) {
+    logging(L_WARNING, "request: Server asked to wait %lu ms, not retrying", retry_after);
+    return false;
+  }
+  unsigned long delay_ms = retry_after + gaus_retry_delay_ms(&deadline->retry, attempt);
+  if (deadline_expired(deadline, &remaining_ms) || (deadline->end_ms && delay_ms >= (unsigned long) remaining_ms)) {
+    return false;
+  }
+
+  logging(L_WARNING, "request: Attempt %u failed, retrying in %lu ms", attempt, delay_ms);
+  while (delay_ms > 0) {
+    //Sleep in slices to notice a cancel in time
+    unsigned long slice_ms = delay_ms < RETRY_SLICE_MS ? delay_ms : RETRY_SLICE_MS;
+    struct timespec slice = {slice_ms / 1000, (long) (slice_ms % 1000) * 1000000};
+    nanosleep(&slice, NULL);
+    delay_ms -= slice_ms;
+    if (deadline_expired(deadline, &remaining_ms)) {
+      return false;
+    }
+  }
+  //A connect timeout of the failed attempt is no reason to fail the call any more
+  deadline->expired = 0;
+  return true;
+}
+
+/* Perform a request on a handle from the client.
+ *
+ * A GET is made if body is NULL, otherwise body is POSTed.  If root is not NULL the reply is parsed as
+ * json while it arrives, instead of being handed to response_writer.  A GET whose reply is parsed or kept in memory is
+ * repeated as the retry policy of deadline allows, there is no harm in throwing away a failed reply.
+ */
+static int request_perform(gaus_client_t *client, const char *url, const char *auth_token, const RequestBody *body,
+                           RequestCondition *condition, RequestDeadline *deadline,
+                           curl_write_callback response_writer, void *response, json_t **root, long *status_code) {
+  RequestContext context;
+  Transfer transfer;
+  JsonStream stream = {.transfer = &transfer};
+  CURLM *multi = NULL;
+  int result = -1;
+  long initial_status_code = *status_code;
+  bool idempotent = !body && (root || response_writer == in_memory_response_writer);
+
+  CURL *curl = gaus_client_acquire_handle(client, &multi);
+  if (!curl) {
+    logging(L_ERROR, "request error: Failed to initialize curl");
+    return result;
+  }
+
+  if (root) {
+    response_writer = json_stream_writer;
+    response = &stream;
   }
-  if (headers) {
-    curl_slist_free_all(headers);
+
+  //Headers are only cached for the shared handle, which the lock keeps to one thread at a time.
+  RequestHeaders *cache = (client && curl == client->curl) ? &client->headers : NULL;
+  for (unsigned int attempt = 1;; attempt++) {
+    if (request_setup(curl, &context, cache, url, auth_token, body, condition, deadline, response_writer,
+                      response) != 0) {
+      goto out;
+    }
+    if (client && client->proxy) {
+      gaus_curl_easy_setopt(curl, CURLOPT_PROXY, client->proxy);
+    }
+
+    if (transfer_start(&transfer, multi, curl) != 0) {
+      request_finish(&context, CURLE_FAILED_INIT, status_code);
+      goto out;
+    }
+
+    if (root) {
+      json_error_t json_error;
+      if (!(*root = json_load_callback(json_stream_reader, &stream, JSON_DECODE_ANY, &json_error))) {
+        long response_code = 0;
+        gaus_curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+        //Only a 2xx reply is json, a 304 has no body and error replies or failed transfers are reported elsewhere
+        if (response_code >= 200 && response_code < 300 && transfer.result == CURLE_OK) {
+          logging(L_ERROR, "Error parsing json from %s: %s", url, json_error.text);
+        }
+      }
+      //Discard whatever jansson did not read, so the transfer can run to its end.
+      stream.draining = true;
+      if (stream.paused) {
+        gaus_curl_easy_pause(curl, CURLPAUSE_CONT);
+      }
+    }
+
+    CURLcode transfer_status = transfer_complete(&transfer);
+    result = request_finish(&context, transfer_status, status_code);
+    if (root && result != 0) {
+      json_decref(*root);
+      *root = NULL;
+    }
+    if (result == 0 || !idempotent
+        || !retry_wait(deadline, attempt, transfer_status, *status_code, context.retry_after_ms)) {
+      break;
+    }
+
+    //Start over as if the failed attempt never happened
+    *status_code = initial_status_code;
+    if (root) {
+      stream.length = 0;
+      stream.pos = 0;
+      stream.paused = false;
+      stream.draining = false;
+    } else {
+      InMemoryResponse *memory = response;
+      memory->pos = 0;
+      if (memory->data) {
+        memory->data[0] = '\0';
+      }
+    }
   }
-  return -1;
+
+  out:
+  free(stream.buffer);
+  gaus_client_release_handle(client, curl, multi);
+  return result;
+}
+
+static int request_post(gaus_client_t *client, const char *url, const char *auth_token, const RequestBody *body,
+                        curl_write_callback response_writer, void *response, RequestDeadline *deadline,
+                        long *status_code) {
+  return request_perform(client, url, auth_token, body, NULL, deadline, response_writer, response, NULL,
+                         status_code);
+}
+
+static int request_get(gaus_client_t *client, const char *url, const char *auth_token,
+                       curl_write_callback response_writer, void *response, RequestDeadline *deadline,
+                       long *status_code) {
+  return request_perform(client, url, auth_token, NULL, NULL, deadline, response_writer, response, NULL,
+                         status_code);
+}
+
+int request_get_as_json(gaus_client_t *client, const char *url, const char *auth_token, RequestCondition *condition,
+                        RequestDeadline *deadline, json_t **root, long *status_code) {
+  *root = NULL;
+  return request_perform(client, url, auth_token, NULL, condition, deadline, NULL, NULL, root, status_code);
 }
 
-static size_t in_memory_response_writer(char *content, size_t size, size_t nmemb, void *userp) {
+size_t in_memory_response_writer(char *content, size_t size, size_t nmemb, void *userp) {
   InMemoryResponse *resp = userp;
   size_t write_size = size * nmemb;
   size_t total_size = resp->pos + write_size + 1;
-  /* If resp->data is NULL, then  the  call  is  equivalent  to  malloc(size) */
-  resp->data = realloc(resp->data, total_size);
-
-  if (resp->data == NULL) {
-    logging(L_ERROR, "not enough memory (realloc returned NULL)\n");
-    return 0;
+  if (total_size > resp->size) {
+    //Grow geometrically so a response arriving in many small chunks isn't copied around for each one.
+    size_t new_size = resp->size ? resp->size : 256;
+    while (new_size < total_size) {
+      new_size *= 2;
+    }
+    /* If resp->data is NULL, then  the  call  is  equivalent  to  malloc(size) */
+    char *data = realloc(resp->data, new_size);
+    if (data == NULL) {
+      logging(L_ERROR, "not enough memory (realloc returned NULL)\n");
+      return 0;
+    }
+    resp->data = data;
+    resp->size = new_size;
   }
 
   memcpy(&(resp->data[resp->pos]), content, write_size);
   resp->pos += write_size;
   resp->data[resp->pos] = '\0'; /* Null terminate */
 
-  logging(L_DEBUG, "Wrote %d bytes (+ NUL byte) to response (%d total)",
+  logging(L_DEBUG, "Wrote %zu bytes (+ NUL byte) to response (%zu total)",
           write_size, resp->pos);
-  if (resp->pos < 1000) {
-    logging(L_DEBUG | L_RAW,
-            "----[ data follows ]----\n%s\n"
-            "------------------------",
-            resp->data);
-  }
+  //Only the part just written, the start of it for a long one, rather than all of the response again for every part
+  logging(L_DEBUG | L_RAW,
+          "----[ data follows ]----\n%.*s\n"
+          "------------------------",
+          (int) (write_size < RESPONSE_DUMP_MAX ? write_size : RESPONSE_DUMP_MAX), content);
   return write_size;
 }
 
@@ -388,3 +727,82 @@ static size_t file_response_writer(char *content, size_t size, size_t nmemb, voi
   out:
   return written;
 }
+
+/* If the header line in buffer is name, return where its value starts and set value_length to its length */
+static const char *header_value(const char *buffer, size_t length, const char *name, size_t *value_length) {
+  size_t name_length = strlen(name);
+
+  if (length <= name_length || buffer[name_length] != ':' || strncasecmp(buffer, name, name_length) != 0) {
+    return NULL;
+  }
+  const char *value = buffer + name_length + 1;
+  const char *end = buffer + length;
+  while (value < end && (*value == ' ' || *value == '\t')) {
+    value++;
+  }
+  while (end > value && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ' || end[-1] == '\t')) {
+    end--;
+  }
+  *value_length = end - value;
+  return value;
+}
+
+/* Keep the validator from a header line, an ETag wins over Last-Modified as it is the stronger of the two */
+static void store_validator(RequestContext *context, const char *buffer, size_t length) {
+  const char *value = NULL;
+  const char *condition = NULL;
+  size_t value_length = 0;
+  bool is_etag = false;
+
+  if ((value = header_value(buffer, length, "ETag", &value_length))) {
+    condition = "If-None-Match: ";
+    is_etag = true;
+  } else if (!context->validator_is_etag
+             && (value = header_value(buffer, length, "Last-Modified", &value_length))) {
+    condition = "If-Modified-Since: ";
+  }
+  if (!value || value_length == 0) {
+    return;
+  }
+
+  size_t condition_length = strlen(condition);
+  char *validator = malloc(condition_length + value_length + 1);
+  if (!validator) {
+    logging(L_ERROR, "request error: Unable to allocate validator");
+    return;
+  }
+  memcpy(validator, condition, condition_length);
+  memcpy(validator + condition_length, value, value_length);
+  validator[condition_length + value_length] = '\0';
+
+  free(context->condition->validator);
+  context->condition->validator = validator;
+  context->validator_is_etag = is_etag;
+}
+
+static size_t response_header_callback(char *buffer, size_t size, size_t nitems, void *userp) {
+  RequestContext *context = userp;
+  size_t length = size * nitems;
+  const char *value = NULL;
+  size_t value_length = 0;
+
+  if (!context->headers_started) {
+    //The first header line means any TLS handshake is complete
+    context->headers_started = true;
+    context->tls_resumed = tls_session_connected(context->curl);
+  }
+  if (length > 5 && strncmp(buffer, "HTTP/", 5) == 0) {
+    //The status line of a new response (e.g. after a redirect), forget what the previous one said
+    context->retry_after_ms = 0;
+    if (context->condition) {
+      free(context->condition->validator);
+      context->condition->validator = NULL;
+      context->validator_is_etag = false;
+    }
+  } else if ((value = header_value(buffer, length, "Retry-After", &value_length))) {
+    context->retry_after_ms = retry_after_ms(value, value_length);
+  } else if (context->condition) {
+    store_validator(context, buffer, length);
+  }
+  return length;
+}
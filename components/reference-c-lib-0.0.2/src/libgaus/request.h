@@ -10,14 +10,128 @@
 #ifndef GAUS_UPDATECLIENT_REQUEST_H
 #define GAUS_UPDATECLIENT_REQUEST_H
 
+#include <jansson.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
-char *request_get_as_string(const char *url, const char *auth_token, long *status_code);
+#include "client.h"
 
-char *request_post_as_string(const char *url, const char *auth_token, const char *payload, long *status_code);
+typedef struct InMemoryResponse {
+  char *data;
+  size_t pos;
+  size_t size;
+} InMemoryResponse;
 
-int request_get_as_file(const char *url, const char *token, int fd, long *status_code);
+/* A conditional GET.
+ *
+ * header (e.g. "If-None-Match: <etag>") is sent if not NULL, the server then replies 304 if the resource did not
+ * change.  validator is set to a newly allocated header making the next request conditional on this reply, or NULL if
+ * the reply carried neither an ETag nor a Last-Modified header.
+ */
+typedef struct RequestCondition {
+  const char *header;
+  char *validator;
+} RequestCondition;
 
-int create_url(char *dest, size_t dest_len, char *fmt, ...);
+/* The body of a POST.
+ *
+ * data holds length bytes, it need not be null terminated.  content_type_header (e.g. "Content-Type: application/cbor")
+ * is sent instead of the json Content-Type if not NULL, it is not copied and must stay valid while the request runs.
+ */
+typedef struct RequestBody {
+  const char *data;
+  size_t length;
+  const char *content_type_header;
+} RequestBody;
+
+/* The limits of one call, shared by all requests it makes (see gaus_call_options_t).
+ *
+ * end_ms is the time (of the monotonic clock) by which the call must be done, 0 if it has no deadline.  expired is 0
+ * until a request is stopped by the deadline or the cancel token, it is then set to GAUS_TIMEOUT_ERROR or
+ * GAUS_CANCELLED_ERROR.  Requests that may be repeated are retried according to retry while time is left.
+ */
+typedef struct RequestDeadline {
+  long connect_timeout_ms;
+  uint64_t end_ms;
+  const gaus_cancel_token_t *cancel;
+  gaus_retry_policy_t retry;
+  gaus_error_type_t expired;
+} RequestDeadline;
+
+/* State for a single request, kept alive until the transfer is finished. */
+typedef struct RequestContext {
+  CURL *curl;
+  struct curl_slist *headers;
+  RequestHeaders *cached_headers;
+  RequestCondition *condition;
+  struct curl_slist condition_header;
+  struct curl_slist content_type_header;
+  RequestDeadline *deadline;
+  const char *method;
+  const char *url;
+  RequestBody body;
+  bool has_body;
+  unsigned long retry_after_ms;
+  DnsPin dns_pin;
+  bool headers_started;
+  bool tls_resumed;
+  bool validator_is_etag;
+} RequestContext;
+
+/* Milliseconds of the monotonic clock, the clock of deadlines */
+uint64_t request_monotonic_ms(void);
+
+/* Start the deadline of a call limited by options, or by the options given to gaus_global_init if options is NULL */
+void request_deadline_start(RequestDeadline *deadline, const gaus_call_options_t *options);
+
+/* The error to return from func if a request failed because deadline expired, NULL if it did not */
+gaus_error_t *request_deadline_error(const char *func, const RequestDeadline *deadline);
+
+char *request_get_as_string(gaus_client_t *client, const char *url, const char *auth_token, RequestDeadline *deadline,
+                            long *status_code);
+
+char *request_post_as_string(gaus_client_t *client, const char *url, const char *auth_token, const char *payload,
+                             RequestDeadline *deadline, long *status_code);
+
+/* POST body, like request_post_as_string but for a body of any content type */
+char *request_post_body_as_string(gaus_client_t *client, const char *url, const char *auth_token,
+                                  const RequestBody *body, RequestDeadline *deadline, long *status_code);
+
+/* Get url and parse the reply as json while it is received, without keeping the raw body in memory.
+ *
+ * Returns 0 if the server replied with 200, root is then set to the parsed reply or NULL if it was not valid json.
+ * The request is conditional if condition is not NULL, 0 is then also returned for a 304 and root left NULL.
+ */
+int request_get_as_json(gaus_client_t *client, const char *url, const char *auth_token, RequestCondition *condition,
+                        RequestDeadline *deadline, json_t **root, long *status_code);
+
+int request_get_as_file(gaus_client_t *client, const char *url, const char *token, int fd, RequestDeadline *deadline,
+                        long *status_code);
+
+/* Setup curl for a request without performing it.
+ *
+ * A GET is made if body is NULL, otherwise body is POSTed.  url and the data of body are not copied and must stay valid
+ * until request_finish is called.  Headers are taken from cache when it was built for auth_token, cache may be
+ * NULL to build them for this request only.  condition, if not NULL, makes the request conditional and must also stay
+ * valid until request_finish.  deadline, if not NULL, limits the time the request may take and must also stay valid
+ * until request_finish, setup fails if it already expired.  Returns 0 on success, after which request_finish must be
+ * called to release the context.
+ */
+int request_setup(CURL *curl, RequestContext *context, RequestHeaders *cache, const char *url, const char *auth_token,
+                  const RequestBody *body, RequestCondition *condition, RequestDeadline *deadline,
+                  curl_write_callback response_writer, void *response);
+
+void request_headers_cleanup(RequestHeaders *cache);
+
+/* Finish a request setup by request_setup once curl is done with it, status is the result of the transfer.
+ *
+ * Returns 0 if the server replied with 200 (or 304 to a conditional request), status_code is filled in if the server
+ * replied at all.
+ */
+int request_finish(RequestContext *context, CURLcode status, long *status_code);
+
+/* A curl write callback collecting the response into an InMemoryResponse */
+size_t in_memory_response_writer(char *content, size_t size, size_t nmemb, void *userp);
 
 #endif
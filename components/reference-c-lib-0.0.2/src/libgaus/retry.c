@@ -0,0 +1,113 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "retry.h"
+#include "gaus/gaus_client.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+static struct {
+  pthread_mutex_t lock;
+  uint64_t state;
+} retry_random = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .state = 0
+};
+
+//splitmix64, spreads any change of its input over all bits of the output
+static uint64_t mix(uint64_t value) {
+  value += 0x9E3779B97F4A7C15ULL;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+void retry_seed(const char *salt) {
+  struct timespec realtime;
+  struct timespec monotonic;
+  //FNV-1a
+  uint64_t hash = 0xCBF29CE484222325ULL;
+
+  clock_gettime(CLOCK_REALTIME, &realtime);
+  clock_gettime(CLOCK_MONOTONIC, &monotonic);
+  for (const char *c = salt; c && *c; c++) {
+    hash = (hash ^ (unsigned char) *c) * 0x100000001B3ULL;
+  }
+
+  pthread_mutex_lock(&retry_random.lock);
+  retry_random.state = mix(retry_random.state ^ hash ^ (uint64_t) realtime.tv_nsec ^ ((uint64_t) realtime.tv_sec << 32)
+                           ^ mix((uint64_t) monotonic.tv_nsec) ^ (uint64_t) (uintptr_t) &realtime);
+  pthread_mutex_unlock(&retry_random.lock);
+}
+
+/* A random number between 0 and max, inclusive */
+static unsigned long random_up_to(unsigned long max) {
+  pthread_mutex_lock(&retry_random.lock);
+  uint64_t value = mix(retry_random.state++);
+  pthread_mutex_unlock(&retry_random.lock);
+  return max == ULONG_MAX ? (unsigned long) value : (unsigned long) (value % ((uint64_t) max + 1));
+}
+
+unsigned long gaus_retry_delay_ms(const gaus_retry_policy_t *policy, unsigned int failures) {
+  unsigned long ceiling = policy->base_delay_ms;
+  unsigned long cap = policy->max_delay_ms ? policy->max_delay_ms : ULONG_MAX;
+
+  //Double per failure without overflowing
+  for (unsigned int i = 1; i < failures && ceiling < cap; i++) {
+    ceiling = ceiling > cap / 2 ? cap : ceiling * 2;
+  }
+  if (ceiling > cap) {
+    ceiling = cap;
+  }
+  return random_up_to(ceiling);
+}
+
+bool retry_is_transient(CURLcode status, long status_code) {
+  switch (status) {
+    case CURLE_OK:
+      return status_code == 408 || status_code == 429 || status_code >= 500;
+    case CURLE_COULDNT_RESOLVE_PROXY:
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_HTTP2:
+    case CURLE_HTTP2_STREAM:
+      return true;
+    default:
+      //Our own errors (e.g. out of memory, aborted by a callback) or ones that repeating won't fix
+      return false;
+  }
+}
+
+unsigned long retry_after_ms(const char *value, size_t length) {
+  unsigned long seconds = 0;
+
+  if (length == 0) {
+    return 0;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (value[i] < '0' || value[i] > '9') {
+      //An HTTP date, not worth parsing just to pace retries
+      return 0;
+    }
+    if (seconds > ULONG_MAX / 10000) {
+      return ULONG_MAX;
+    }
+    seconds = seconds * 10 + (value[i] - '0');
+  }
+  return seconds > ULONG_MAX / 1000 ? ULONG_MAX : seconds * 1000;
+}
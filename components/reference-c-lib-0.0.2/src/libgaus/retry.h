@@ -0,0 +1,37 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_RETRY_H
+#define GAUS_RETRY_H
+
+#include <stdbool.h>
+#include <curl/curl.h>
+#include <gaus/gaus_client_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Seed the random waits between retries, mixing salt (if not NULL) into what is already there.
+ *
+ * Called with something unique to the device when available, so a fleet does not share the same waits even if all
+ * devices started at the same time.
+ */
+void retry_seed(const char *salt);
+
+/* Whether a request that ended with status (and status_code if the server replied) may succeed when repeated */
+bool retry_is_transient(CURLcode status, long status_code);
+
+/* The wait requested by the value of a Retry-After header in milliseconds, 0 if it is not a number of seconds */
+unsigned long retry_after_ms(const char *value, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_RETRY_H
@@ -0,0 +1,230 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "session.h"
+#include "gaus/gaus_client.h"
+#include "gaus.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Number of lists the credentials are spread over by device guid, so that finding those of a request stays short
+#define SESSION_CREDENTIALS_BUCKETS 64
+
+//What it takes to renew the session of a device
+typedef struct SessionCredentials {
+  char *device_guid;
+  char *device_access;
+  char *device_secret;
+  char *token; //The latest token of the device, sent instead of the one of the session.  Written with the lock held.
+  bool refreshing; //Whether a caller is authenticating the device again
+  struct SessionCredentials *next;
+} SessionCredentials;
+
+//A token replaced by a newer one, waiting for the requests still sending it to finish
+typedef struct RetiredToken {
+  char *token;
+  struct RetiredToken *next;
+} RetiredToken;
+
+/* Requests find the credentials of their device and load its token without the lock.  Credentials are only prepended
+ * to a bucket, fully set up, and only freed by session_cleanup, so a request walking a bucket never sees them change
+ * but for their token.  A token is only freed once no request is counted in by session_acquire.
+ */
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t refreshed;
+  SessionCredentials *credentials[SESSION_CREDENTIALS_BUCKETS]; //Prepended to with the lock held, read atomically
+  RetiredToken *retired; //Written with the lock held, read atomically
+  unsigned int in_flight; //Requests between session_acquire and session_release, changed atomically
+} session_state = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .refreshed = PTHREAD_COND_INITIALIZER
+};
+
+static bool same_string(const char *a, const char *b) {
+  return a && b && strcmp(a, b) == 0;
+}
+
+/* FNV-1a */
+static SessionCredentials **bucket_of(const char *device_guid) {
+  uint32_t hash = 2166136261u;
+  for (const unsigned char *c = (const unsigned char *) device_guid; *c; c++) {
+    hash = (hash ^ *c) * 16777619u;
+  }
+  return &session_state.credentials[hash % SESSION_CREDENTIALS_BUCKETS];
+}
+
+/* Does not need the lock */
+static SessionCredentials *find_credentials(const char *device_guid) {
+  if (!device_guid) {
+    return NULL;
+  }
+  for (SessionCredentials *credentials = __atomic_load_n(bucket_of(device_guid), __ATOMIC_ACQUIRE); credentials;
+       credentials = credentials->next) {
+    if (same_string(credentials->device_guid, device_guid)) {
+      return credentials;
+    }
+  }
+  return NULL;
+}
+
+/* Replace *field with a copy of value, keeping the old value if out of memory */
+static void replace_string(char **field, const char *value) {
+  char *copy = strdup(value);
+  if (copy) {
+    free(*field);
+    *field = copy;
+  }
+}
+
+/* Make token the one sent for credentials, the old one is freed once no request uses it.  Must hold the lock. */
+static gaus_error_t *replace_token(SessionCredentials *credentials, char *token) {
+  RetiredToken *retired = NULL;
+
+  if (credentials->token && !(retired = malloc(sizeof(RetiredToken)))) {
+    free(token);
+    return gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate renewed token");
+  }
+  if (retired) {
+    retired->token = credentials->token;
+    retired->next = session_state.retired;
+    __atomic_store_n(&session_state.retired, retired, __ATOMIC_SEQ_CST);
+  }
+  __atomic_store_n(&credentials->token, token, __ATOMIC_SEQ_CST);
+  return NULL;
+}
+
+void session_remember(const char *device_access, const char *device_secret, const gaus_session_t *session) {
+  char *token = NULL;
+
+  pthread_mutex_lock(&session_state.lock);
+  SessionCredentials *credentials = find_credentials(session->device_guid);
+  if (!credentials) {
+    SessionCredentials **bucket = bucket_of(session->device_guid);
+    if (!(credentials = calloc(1, sizeof(SessionCredentials)))
+        || !(credentials->device_guid = strdup(session->device_guid))) {
+      logging(L_WARNING, "Unable to remember credentials, the session will not be renewed when it expires");
+      free(credentials);
+      goto out;
+    }
+    credentials->next = *bucket;
+    __atomic_store_n(bucket, credentials, __ATOMIC_RELEASE);
+  }
+  replace_string(&credentials->device_access, device_access);
+  replace_string(&credentials->device_secret, device_secret);
+  if (!same_string(credentials->token, session->token) && (token = strdup(session->token))) {
+    gaus_error_release(replace_token(credentials, token));
+  }
+
+  out:
+  pthread_mutex_unlock(&session_state.lock);
+}
+
+/* Counting the request in before loading the token keeps whatever it loads out of free_retired_tokens, which only
+ * runs when no request is counted in. */
+const char *session_acquire(const gaus_session_t *session) {
+  __atomic_add_fetch(&session_state.in_flight, 1, __ATOMIC_SEQ_CST);
+  SessionCredentials *credentials = find_credentials(session->device_guid);
+  const char *token = credentials ? __atomic_load_n(&credentials->token, __ATOMIC_SEQ_CST) : NULL;
+  return token ? token : session->token;
+}
+
+/* Must hold the lock */
+static void free_retired_tokens(void) {
+  while (session_state.retired) {
+    RetiredToken *retired = session_state.retired;
+    __atomic_store_n(&session_state.retired, retired->next, __ATOMIC_SEQ_CST);
+    free(retired->token);
+    free(retired);
+  }
+}
+
+void session_release(void) {
+  if (__atomic_sub_fetch(&session_state.in_flight, 1, __ATOMIC_SEQ_CST) == 0
+      && __atomic_load_n(&session_state.retired, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&session_state.lock);
+    //Another request may have been counted in since
+    if (__atomic_load_n(&session_state.in_flight, __ATOMIC_SEQ_CST) == 0) {
+      free_retired_tokens();
+    }
+    pthread_mutex_unlock(&session_state.lock);
+  }
+}
+
+gaus_error_t *session_refresh(gaus_context_t *context, const gaus_session_t *session, const char *token,
+                             RequestDeadline *deadline) {
+  gaus_error_t *status = NULL;
+  gaus_session_t renewed = {NULL, NULL, NULL};
+  char *device_access = NULL;
+  char *device_secret = NULL;
+
+  pthread_mutex_lock(&session_state.lock);
+  SessionCredentials *credentials = find_credentials(session->device_guid);
+  if (!credentials) {
+    status = gaus_create_error(__func__, GAUS_HTTP_ERROR, 401, "Session expired, and it was not authenticated here");
+    goto out;
+  }
+  while (credentials->refreshing) {
+    pthread_cond_wait(&session_state.refreshed, &session_state.lock);
+  }
+  //Otherwise another caller renewed it meanwhile, and the next session_acquire gets the new token
+  if (!credentials->token || same_string(credentials->token, token)) {
+    //First to find the token refused, renew it for everyone
+    device_access = strdup(credentials->device_access);
+    device_secret = strdup(credentials->device_secret);
+    if (!device_access || !device_secret) {
+      status = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Unable to allocate credentials");
+      goto out;
+    }
+    credentials->refreshing = true;
+    pthread_mutex_unlock(&session_state.lock);
+
+    logging(L_INFO, "Session expired, authenticating again");
+    status = session_authenticate(context, device_access, device_secret, &renewed, deadline);
+
+    pthread_mutex_lock(&session_state.lock);
+    credentials->refreshing = false;
+    if (!status) {
+      status = replace_token(credentials, renewed.token);
+      renewed.token = NULL;
+    }
+    pthread_cond_broadcast(&session_state.refreshed);
+  }
+
+  out:
+  pthread_mutex_unlock(&session_state.lock);
+  free(device_access);
+  free(device_secret);
+  free(renewed.device_guid);
+  free(renewed.product_guid);
+  free(renewed.token);
+  return status;
+}
+
+void session_cleanup(void) {
+  pthread_mutex_lock(&session_state.lock);
+  for (int bucket = 0; bucket < SESSION_CREDENTIALS_BUCKETS; bucket++) {
+    while (session_state.credentials[bucket]) {
+      SessionCredentials *credentials = session_state.credentials[bucket];
+      session_state.credentials[bucket] = credentials->next;
+      free(credentials->device_guid);
+      free(credentials->device_access);
+      free(credentials->device_secret);
+      free(credentials->token);
+      free(credentials);
+    }
+  }
+  free_retired_tokens();
+  pthread_mutex_unlock(&session_state.lock);
+}
@@ -0,0 +1,52 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_SESSION_H
+#define GAUS_SESSION_H
+
+#include <gaus/gaus_client_types.h>
+#include "request.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Authenticate a device against context within deadline, without remembering its credentials (see
+ * gaus_authenticate.c) */
+gaus_error_t *session_authenticate(gaus_context_t *context, const char *device_access, const char *device_secret,
+                                   gaus_session_t *session, RequestDeadline *deadline);
+
+/* Keep the credentials that authenticated session, so the session can be renewed once its token expires */
+void session_remember(const char *device_access, const char *device_secret, const gaus_session_t *session);
+
+/* The token to send with a request for session, without taking any lock.
+ *
+ * That is the latest token of the device if it was authenticated here, which is renewed without touching the token of
+ * session, otherwise the one of session.  It stays valid until the matching session_release, even if the device is
+ * authenticated again by another thread meanwhile.
+ */
+const char *session_acquire(const gaus_session_t *session);
+
+void session_release(void);
+
+/* Renew session against context after the server refused token, the one returned by session_acquire.
+ *
+ * Only the first caller to find token refused authenticates again, concurrent callers wait for it and share the
+ * result.  On success the next session_acquire returns the new token, the old one is freed once no request uses it.
+ */
+gaus_error_t *session_refresh(gaus_context_t *context, const gaus_session_t *session, const char *token,
+                             RequestDeadline *deadline);
+
+/* Forget all credentials */
+void session_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_SESSION_H
@@ -0,0 +1,167 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "stats.h"
+#include "curl_wrapper.h"
+#include "gaus/gaus_client.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+  METRIC_NAME_LOOKUP,
+  METRIC_CONNECT,
+  METRIC_TLS_CONNECT,
+  METRIC_START_TRANSFER,
+  METRIC_TOTAL,
+  METRIC_BYTES_UP,
+  METRIC_BYTES_DOWN,
+  METRIC_COUNT
+} Metric;
+
+//The curl info behind each metric, in Metric order
+static const CURLINFO metric_info[METRIC_COUNT] = {
+    CURLINFO_NAMELOOKUP_TIME_T,
+    CURLINFO_CONNECT_TIME_T,
+    CURLINFO_APPCONNECT_TIME_T,
+    CURLINFO_STARTTRANSFER_TIME_T,
+    CURLINFO_TOTAL_TIME_T,
+    CURLINFO_SIZE_UPLOAD_T,
+    CURLINFO_SIZE_DOWNLOAD_T
+};
+
+static const char *endpoint_names[GAUS_ENDPOINT_COUNT] = {
+    "register",
+    "authenticate",
+    "check-for-updates",
+    "report",
+    "other"
+};
+
+/* The last GAUS_STATS_WINDOW samples of each metric for one endpoint, kept as a ring.
+ *
+ * Every request records into it, so it is updated with atomics instead of under a lock: a request takes the slot
+ * taken % GAUS_STATS_WINDOW for its sample by counting it in taken.  A summary made while requests finish may thus
+ * miss their samples, or mix them with the ones they replace, which does not matter for statistics.
+ */
+typedef struct EndpointSamples {
+  unsigned int count;
+  unsigned int failures;
+  unsigned int taken;
+  uint32_t samples[METRIC_COUNT][GAUS_STATS_WINDOW];
+} EndpointSamples;
+
+static struct {
+  EndpointSamples endpoints[GAUS_ENDPOINT_COUNT];
+} stats_state;
+
+void stats_init(void) {
+  memset(stats_state.endpoints, 0, sizeof(stats_state.endpoints));
+}
+
+gaus_endpoint_t stats_endpoint(const char *url) {
+  size_t end = strcspn(url, "?#");
+  size_t start = end;
+  while (start > 0 && url[start - 1] != '/') {
+    start--;
+  }
+
+  //"other" is not an endpoint of the server, it never matches
+  for (int endpoint = 0; endpoint < GAUS_ENDPOINT_OTHER; endpoint++) {
+    size_t length = strlen(endpoint_names[endpoint]);
+    if (end - start == length && strncmp(url + start, endpoint_names[endpoint], length) == 0) {
+      return (gaus_endpoint_t) endpoint;
+    }
+  }
+  return GAUS_ENDPOINT_OTHER;
+}
+
+void stats_record(CURL *curl, const char *url, CURLcode result) {
+  uint32_t sample[METRIC_COUNT];
+
+  if (result == CURLE_OK) {
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+      curl_off_t value = 0;
+      gaus_curl_easy_getinfo(curl, metric_info[metric], &value);
+      sample[metric] = value < 0 ? 0 : value > UINT32_MAX ? UINT32_MAX : (uint32_t) value;
+    }
+  }
+
+  EndpointSamples *samples = &stats_state.endpoints[stats_endpoint(url)];
+  __atomic_add_fetch(&samples->count, 1, __ATOMIC_RELAXED);
+  if (result != CURLE_OK) {
+    __atomic_add_fetch(&samples->failures, 1, __ATOMIC_RELAXED);
+  } else {
+    unsigned int slot = __atomic_fetch_add(&samples->taken, 1, __ATOMIC_RELAXED) % GAUS_STATS_WINDOW;
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+      __atomic_store_n(&samples->samples[metric][slot], sample[metric], __ATOMIC_RELAXED);
+    }
+  }
+}
+
+static int compare_samples(const void *a, const void *b) {
+  uint32_t left = *(const uint32_t *) a;
+  uint32_t right = *(const uint32_t *) b;
+  return (left > right) - (left < right);
+}
+
+static gaus_stat_summary_t summarize(const uint32_t *samples, unsigned int filled) {
+  gaus_stat_summary_t summary = {0, 0, 0, 0};
+  uint32_t sorted[GAUS_STATS_WINDOW];
+  uint64_t sum = 0;
+
+  if (filled == 0) {
+    return summary;
+  }
+  //Requests may be recording samples meanwhile
+  for (unsigned int i = 0; i < filled; i++) {
+    sorted[i] = __atomic_load_n(&samples[i], __ATOMIC_RELAXED);
+  }
+  qsort(sorted, filled, sizeof(uint32_t), compare_samples);
+  for (unsigned int i = 0; i < filled; i++) {
+    sum += sorted[i];
+  }
+
+  summary.min = sorted[0];
+  summary.max = sorted[filled - 1];
+  summary.mean = sum / filled;
+  //Nearest rank: the smallest sample with at least 95% of the samples at or below it
+  summary.p95 = sorted[(filled * 95 + 99) / 100 - 1];
+  return summary;
+}
+
+gaus_stats_t gaus_get_stats(void) {
+  gaus_stats_t stats;
+
+  for (int endpoint = 0; endpoint < GAUS_ENDPOINT_COUNT; endpoint++) {
+    const EndpointSamples *samples = &stats_state.endpoints[endpoint];
+    gaus_endpoint_stats_t *endpoint_stats = &stats.endpoints[endpoint];
+    unsigned int taken = __atomic_load_n(&samples->taken, __ATOMIC_RELAXED);
+    unsigned int filled = taken < GAUS_STATS_WINDOW ? taken : GAUS_STATS_WINDOW;
+
+    endpoint_stats->count = __atomic_load_n(&samples->count, __ATOMIC_RELAXED);
+    endpoint_stats->failures = __atomic_load_n(&samples->failures, __ATOMIC_RELAXED);
+    endpoint_stats->name_lookup_us = summarize(samples->samples[METRIC_NAME_LOOKUP], filled);
+    endpoint_stats->connect_us = summarize(samples->samples[METRIC_CONNECT], filled);
+    endpoint_stats->tls_connect_us = summarize(samples->samples[METRIC_TLS_CONNECT], filled);
+    endpoint_stats->start_transfer_us = summarize(samples->samples[METRIC_START_TRANSFER], filled);
+    endpoint_stats->total_us = summarize(samples->samples[METRIC_TOTAL], filled);
+    endpoint_stats->bytes_up = summarize(samples->samples[METRIC_BYTES_UP], filled);
+    endpoint_stats->bytes_down = summarize(samples->samples[METRIC_BYTES_DOWN], filled);
+  }
+  return stats;
+}
+
+const char *gaus_endpoint_name(gaus_endpoint_t endpoint) {
+  if ((int) endpoint < 0 || endpoint >= GAUS_ENDPOINT_COUNT) {
+    return NULL;
+  }
+  return endpoint_names[endpoint];
+}
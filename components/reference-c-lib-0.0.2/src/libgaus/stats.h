@@ -0,0 +1,37 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_STATS_H
+#define GAUS_STATS_H
+
+#include <curl/curl.h>
+#include <gaus/gaus_client_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Number of most recent requests to each endpoint the statistics are summarized over
+#ifndef GAUS_STATS_WINDOW
+#define GAUS_STATS_WINDOW 32
+#endif
+
+/* Forget all statistics, must not be called while requests are made */
+void stats_init(void);
+
+/* The endpoint requested by url, judged by the last segment of its path */
+gaus_endpoint_t stats_endpoint(const char *url);
+
+/* Called after a request to url was performed on curl, result is the result of the transfer */
+void stats_record(CURL *curl, const char *url, CURLcode result);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_STATS_H
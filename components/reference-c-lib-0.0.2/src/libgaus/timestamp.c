@@ -0,0 +1,100 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "timestamp.h"
+#include "gaus/gaus_client.h"
+#include "request.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+//How often the offset of the wall clock from the monotonic clock is sampled again, to follow the wall clock being set
+#define WALL_CLOCK_RESYNC_MS 60000
+
+//Where the parts of "2018-11-15T12:00:22.123Z" start
+#define YEAR_AT 0
+#define MONTH_AT 5
+#define DAY_AT 8
+#define HOUR_AT 11
+#define MINUTE_AT 14
+#define SECOND_AT 17
+#define MILLISECOND_AT 20
+
+typedef struct {
+  pthread_mutex_t lock;
+  bool synced;
+  uint64_t synced_at_ms; //The monotonic time the offset was sampled at
+  int64_t offset_ms;     //Wall clock minus monotonic clock
+  bool formatted;
+  int64_t hour;          //The hour of text, in seconds since 1970
+  int64_t second;        //The second of text, in seconds since 1970
+  char text[GAUS_TIMESTAMP_SIZE];
+} TimestampCache;
+
+static TimestampCache cache = {PTHREAD_MUTEX_INITIALIZER, false, 0, 0, false, 0, 0, ""};
+
+/* Write the count lowest decimal digits of value at */
+static void write_digits(char *at, unsigned int value, int count) {
+  for (int i = count - 1; i >= 0; i--) {
+    at[i] = (char) ('0' + value % 10);
+    value /= 10;
+  }
+}
+
+/* Rounding down also before 1970 */
+static int64_t floor_div(int64_t value, int64_t divisor) {
+  return value / divisor - (value % divisor < 0 ? 1 : 0);
+}
+
+static void format_hour(int64_t hour) {
+  time_t start = (time_t) hour;
+  struct tm tm;
+  gmtime_r(&start, &tm);
+  memcpy(cache.text, "0000-00-00T00:00:00.000Z", GAUS_TIMESTAMP_SIZE);
+  write_digits(cache.text + YEAR_AT, (unsigned int) (tm.tm_year + 1900), 4);
+  write_digits(cache.text + MONTH_AT, (unsigned int) (tm.tm_mon + 1), 2);
+  write_digits(cache.text + DAY_AT, (unsigned int) tm.tm_mday, 2);
+  write_digits(cache.text + HOUR_AT, (unsigned int) tm.tm_hour, 2);
+}
+
+void timestamp_format(int64_t unix_ms, char *buffer) {
+  int64_t second = floor_div(unix_ms, 1000);
+  pthread_mutex_lock(&cache.lock);
+  if (!cache.formatted || second != cache.second) {
+    int64_t hour = floor_div(second, 3600) * 3600;
+    if (!cache.formatted || hour != cache.hour) {
+      format_hour(hour);
+      cache.hour = hour;
+    }
+    write_digits(cache.text + MINUTE_AT, (unsigned int) (second - hour) / 60, 2);
+    write_digits(cache.text + SECOND_AT, (unsigned int) (second - hour) % 60, 2);
+    cache.second = second;
+    cache.formatted = true;
+  }
+  write_digits(cache.text + MILLISECOND_AT, (unsigned int) (unix_ms - second * 1000), 3);
+  memcpy(buffer, cache.text, GAUS_TIMESTAMP_SIZE);
+  pthread_mutex_unlock(&cache.lock);
+}
+
+void gaus_timestamp(char *buffer) {
+  uint64_t now_ms = request_monotonic_ms();
+  pthread_mutex_lock(&cache.lock);
+  if (!cache.synced || now_ms - cache.synced_at_ms >= WALL_CLOCK_RESYNC_MS) {
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    cache.offset_ms = (int64_t) wall.tv_sec * 1000 + wall.tv_nsec / 1000000 - (int64_t) now_ms;
+    cache.synced_at_ms = now_ms;
+    cache.synced = true;
+  }
+  int64_t offset_ms = cache.offset_ms;
+  pthread_mutex_unlock(&cache.lock);
+  timestamp_format((int64_t) now_ms + offset_ms, buffer);
+}
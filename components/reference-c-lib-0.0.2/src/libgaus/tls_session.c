@@ -0,0 +1,257 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "tls_session.h"
+#include "curl_wrapper.h"
+#include "log.h"
+#include "gaus/gaus_client.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef GAUS_USE_MBEDTLS
+
+#include <mbedtls/ssl.h>
+
+/* Serialized session layout (all integers big endian):
+ *   [0]      format version
+ *   [1..4]   ciphersuite
+ *   [5]      compression
+ *   [6]      session id length
+ *   [7..38]  session id
+ *   [39..86] master secret
+ *   [87..94] session start time
+ */
+#define TLS_SESSION_FORMAT_VERSION 1
+#define TLS_SESSION_SERIALIZED_SIZE 95
+
+#endif
+
+static struct {
+  pthread_mutex_t lock;
+  bool has_store;
+  gaus_tls_session_store_t store;
+  //The latest known session, either loaded from the store or exported after a handshake
+  unsigned char session[GAUS_TLS_SESSION_MAX_SIZE];
+  size_t session_len;
+  //Whether the loaded session still needs to be offered, after that curl keeps sessions in its own cache
+  bool offer_pending;
+  gaus_tls_session_stats_t stats;
+} tls_state = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+void tls_session_init(const gaus_tls_session_store_t *store) {
+  pthread_mutex_lock(&tls_state.lock);
+  memset(&tls_state.stats, 0, sizeof(tls_state.stats));
+  tls_state.session_len = 0;
+  tls_state.offer_pending = false;
+  tls_state.has_store = store && store->load && store->save;
+  if (tls_state.has_store) {
+    tls_state.store = *store;
+#ifdef GAUS_USE_MBEDTLS
+    size_t len = sizeof(tls_state.session);
+    if (tls_state.store.load(tls_state.store.user_data, tls_state.session, &len) == 0
+        && len == TLS_SESSION_SERIALIZED_SIZE && tls_state.session[0] == TLS_SESSION_FORMAT_VERSION) {
+      tls_state.session_len = len;
+      tls_state.offer_pending = true;
+      logging(L_DEBUG, "Loaded persisted TLS session");
+    }
+#endif
+  }
+  pthread_mutex_unlock(&tls_state.lock);
+}
+
+void tls_session_cleanup(void) {
+  pthread_mutex_lock(&tls_state.lock);
+  tls_state.has_store = false;
+  tls_state.session_len = 0;
+  tls_state.offer_pending = false;
+  //Wipe the secret, it should not linger in memory after we are done with it
+  memset(tls_state.session, 0, sizeof(tls_state.session));
+  pthread_mutex_unlock(&tls_state.lock);
+}
+
+#ifdef GAUS_USE_MBEDTLS
+
+static void write_be(unsigned char *dest, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    dest[i] = (unsigned char) (value >> (8 * (bytes - 1 - i)));
+  }
+}
+
+static uint64_t read_be(const unsigned char *src, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    value = (value << 8) | src[i];
+  }
+  return value;
+}
+
+static void serialize_session(const mbedtls_ssl_session *session, unsigned char *dest) {
+  dest[0] = TLS_SESSION_FORMAT_VERSION;
+  write_be(dest + 1, (uint32_t) session->ciphersuite, 4);
+  dest[5] = (unsigned char) session->compression;
+  dest[6] = (unsigned char) session->id_len;
+  memcpy(dest + 7, session->id, 32);
+  memcpy(dest + 39, session->master, 48);
+#if defined(MBEDTLS_HAVE_TIME)
+  write_be(dest + 87, (uint64_t) session->start, 8);
+#else
+  write_be(dest + 87, 0, 8);
+#endif
+}
+
+static void deserialize_session(const unsigned char *src, mbedtls_ssl_session *session) {
+  session->ciphersuite = (int) read_be(src + 1, 4);
+  session->compression = src[5];
+  session->id_len = src[6] > 32 ? 32 : src[6];
+  memcpy(session->id, src + 7, 32);
+  memcpy(session->master, src + 39, 48);
+#if defined(MBEDTLS_HAVE_TIME)
+  session->start = (mbedtls_time_t) read_be(src + 87, 8);
+#endif
+}
+
+static mbedtls_ssl_context *get_ssl_context(CURL *curl) {
+  struct curl_tlssessioninfo *tls_info = NULL;
+  if (gaus_curl_easy_getinfo(curl, CURLINFO_TLS_SSL_PTR, &tls_info) != CURLE_OK || !tls_info
+      || tls_info->backend != CURLSSLBACKEND_MBEDTLS) {
+    return NULL;
+  }
+  return tls_info->internals;
+}
+
+/* Called by curl once mbedTLS is setup for a new connection, but before the handshake. */
+static CURLcode offer_session_callback(CURL *curl, void *ssl_config, void *user_data) {
+  (void) ssl_config;
+  (void) user_data;
+  mbedtls_ssl_context *ssl = get_ssl_context(curl);
+  if (!ssl) {
+    return CURLE_OK;
+  }
+
+  pthread_mutex_lock(&tls_state.lock);
+  if (tls_state.offer_pending) {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    deserialize_session(tls_state.session, &session);
+    int ret = mbedtls_ssl_set_session(ssl, &session);
+    if (ret) {
+      logging(L_WARNING, "Unable to offer persisted TLS session (-0x%x)", -ret);
+    } else {
+      logging(L_DEBUG, "Offering persisted TLS session");
+    }
+    mbedtls_ssl_session_free(&session);
+    tls_state.offer_pending = false;
+  }
+  pthread_mutex_unlock(&tls_state.lock);
+  //Never fail the connection, a full handshake is always an option
+  return CURLE_OK;
+}
+
+#endif
+
+void tls_session_prepare(CURL *curl) {
+#ifdef GAUS_USE_MBEDTLS
+  if (tls_state.offer_pending) {
+    gaus_curl_easy_setopt(curl, CURLOPT_SSL_CTX_FUNCTION, offer_session_callback);
+  }
+#else
+  (void) curl;
+#endif
+}
+
+bool tls_session_connected(CURL *curl) {
+  bool resumed = false;
+#ifdef GAUS_USE_MBEDTLS
+  long new_connections = 0;
+  gaus_curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connections);
+  if (new_connections <= 0) {
+    //Reused an already established connection, no handshake took place.
+    return false;
+  }
+
+  mbedtls_ssl_context *ssl = get_ssl_context(curl);
+  if (!ssl) {
+    return false;
+  }
+
+  mbedtls_ssl_session session;
+  mbedtls_ssl_session_init(&session);
+  if (mbedtls_ssl_get_session(ssl, &session) == 0 && session.id_len > 0) {
+    unsigned char serialized[TLS_SESSION_SERIALIZED_SIZE];
+    serialize_session(&session, serialized);
+
+    pthread_mutex_lock(&tls_state.lock);
+    //A server resuming a session echoes back the session id we offered
+    resumed = tls_state.session_len == TLS_SESSION_SERIALIZED_SIZE
+              && session.id_len == tls_state.session[6]
+              && memcmp(session.id, tls_state.session + 7, session.id_len) == 0;
+    if (!resumed) {
+      memcpy(tls_state.session, serialized, sizeof(serialized));
+      tls_state.session_len = sizeof(serialized);
+      if (tls_state.has_store && tls_state.store.save(tls_state.store.user_data, serialized, sizeof(serialized))) {
+        logging(L_WARNING, "Unable to persist TLS session");
+      }
+    }
+    pthread_mutex_unlock(&tls_state.lock);
+    memset(serialized, 0, sizeof(serialized));
+  }
+  mbedtls_ssl_session_free(&session);
+#else
+  (void) curl;
+#endif
+  return resumed;
+}
+
+void tls_session_finish(CURL *curl, bool resumed) {
+  long new_connections = 0;
+  gaus_curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connections);
+  if (new_connections <= 0) {
+    return;
+  }
+  pthread_mutex_lock(&tls_state.lock);
+  tls_state.stats.handshakes++;
+  if (resumed) {
+    tls_state.stats.resumed++;
+  }
+  pthread_mutex_unlock(&tls_state.lock);
+}
+
+gaus_tls_session_stats_t gaus_get_tls_session_stats(void) {
+  pthread_mutex_lock(&tls_state.lock);
+  gaus_tls_session_stats_t stats = tls_state.stats;
+  pthread_mutex_unlock(&tls_state.lock);
+  return stats;
+}
+
+int gaus_tls_session_file_load(void *path, unsigned char *buffer, size_t *length) {
+  FILE *file = fopen((const char *) path, "rb");
+  if (!file) {
+    return -1;
+  }
+  *length = fread(buffer, 1, *length, file);
+  fclose(file);
+  return *length > 0 ? 0 : -1;
+}
+
+int gaus_tls_session_file_save(void *path, const unsigned char *buffer, size_t length) {
+  FILE *file = fopen((const char *) path, "wb");
+  if (!file) {
+    logging(L_WARNING, "Unable to open %s for writing TLS session", (const char *) path);
+    return -1;
+  }
+  size_t written = fwrite(buffer, 1, length, file);
+  int result = fclose(file);
+  return (written == length && result == 0) ? 0 : -1;
+}
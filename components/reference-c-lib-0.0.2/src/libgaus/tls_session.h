@@ -0,0 +1,41 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_TLS_SESSION_H
+#define GAUS_TLS_SESSION_H
+
+#include <stdbool.h>
+#include <curl/curl.h>
+#include <gaus/gaus_client_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Setup TLS session persistence.  store may be NULL in which case sessions are only reused in process by curl. */
+void tls_session_init(const gaus_tls_session_store_t *store);
+
+void tls_session_cleanup(void);
+
+/* Called before performing a request on curl, offers a persisted session to the next handshake if there is one. */
+void tls_session_prepare(CURL *curl);
+
+/* Called during the transfer once the server has started responding, i.e. after any TLS handshake completed.
+ *
+ * Exports the session of a new connection and returns whether its handshake resumed a previous session.
+ */
+bool tls_session_connected(CURL *curl);
+
+/* Called after a request was performed on curl, counts any handshake that was made. */
+void tls_session_finish(CURL *curl, bool resumed);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_TLS_SESSION_H
@@ -0,0 +1,179 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "url.h"
+#include "log.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+static bool is_unreserved(unsigned char ch) {
+  return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')
+         || ch == '-' || ch == '.' || ch == '_' || ch == '~';
+}
+
+size_t url_encode(char *dest, const char *str) {
+  size_t pos = 0;
+
+  for (; *str; str++) {
+    unsigned char ch = (unsigned char) *str;
+    if (is_unreserved(ch)) {
+      if (dest) {
+        dest[pos] = ch;
+      }
+      pos++;
+    } else {
+      if (dest) {
+        dest[pos] = '%';
+        dest[pos + 1] = hex_digits[ch >> 4];
+        dest[pos + 2] = hex_digits[ch & 0x0f];
+      }
+      pos += 3;
+    }
+  }
+  return pos;
+}
+
+/* Write the url described by fmt and ap to dest, or only measure it if dest is NULL. Returns the length or -1. */
+static long format_url(char *dest, const char *fmt, va_list ap) {
+  size_t pos = 0;
+  const char *str = NULL;
+  size_t len = 0;
+
+  for (; *fmt; fmt++) {
+    if (*fmt != '%') {
+      if (dest) {
+        dest[pos] = *fmt;
+      }
+      pos++;
+      continue;
+    }
+
+    switch (*++fmt) {
+      case '%':
+        if (dest) {
+          dest[pos] = '%';
+        }
+        pos++;
+        break;
+      case 's':
+        str = va_arg(ap, const char *);
+        len = strlen(str);
+        if (dest) {
+          memcpy(dest + pos, str, len);
+        }
+        pos += len;
+        break;
+      case 'e':
+        pos += url_encode(dest ? dest + pos : NULL, va_arg(ap, const char *));
+        break;
+      default:
+        logging(L_ERROR, "Invalid format string");
+        return -1;
+    }
+  }
+  return pos;
+}
+
+char *url_create(const char *fmt, ...) {
+  va_list ap;
+  char *url = NULL;
+
+  va_start(ap, fmt);
+  long len = format_url(NULL, fmt, ap);
+  va_end(ap);
+  if (len < 0) {
+    return NULL;
+  }
+
+  if (!(url = malloc(len + 1))) {
+    logging(L_ERROR, "url_create: Unable to allocate url");
+    return NULL;
+  }
+
+  va_start(ap, fmt);
+  format_url(url, fmt, ap);
+  va_end(ap);
+  url[len] = '\0';
+  return url;
+}
+
+void url_prefix_cache_init(UrlPrefixCache *cache) {
+  pthread_mutex_init(&cache->lock, NULL);
+  cache->product_guid = NULL;
+  cache->device_guid = NULL;
+  cache->prefix = NULL;
+  cache->prefix_len = 0;
+}
+
+static void clear_prefix(UrlPrefixCache *cache) {
+  free(cache->product_guid);
+  free(cache->device_guid);
+  free(cache->prefix);
+  cache->product_guid = NULL;
+  cache->device_guid = NULL;
+  cache->prefix = NULL;
+  cache->prefix_len = 0;
+}
+
+void url_prefix_cache_cleanup(UrlPrefixCache *cache) {
+  clear_prefix(cache);
+  pthread_mutex_destroy(&cache->lock);
+}
+
+/* Make sure cache holds the prefix for session, must be called with the lock held */
+static int update_prefix(UrlPrefixCache *cache, const char *server_url, const gaus_session_t *session) {
+  if (cache->prefix && strcmp(cache->product_guid, session->product_guid) == 0
+      && strcmp(cache->device_guid, session->device_guid) == 0) {
+    return 0;
+  }
+
+  clear_prefix(cache);
+  cache->product_guid = strdup(session->product_guid);
+  cache->device_guid = strdup(session->device_guid);
+  cache->prefix = url_create("%s/device/%e/%e", server_url, session->product_guid, session->device_guid);
+  if (!cache->product_guid || !cache->device_guid || !cache->prefix) {
+    clear_prefix(cache);
+    return -1;
+  }
+  cache->prefix_len = strlen(cache->prefix);
+  return 0;
+}
+
+char *url_create_for_device(UrlPrefixCache *cache, const char *server_url, const gaus_session_t *session,
+                            const char *path, const char *query) {
+  char *url = NULL;
+  size_t path_len = strlen(path);
+  size_t query_len = query ? strlen(query) : 0;
+
+  pthread_mutex_lock(&cache->lock);
+  if (update_prefix(cache, server_url, session) != 0) {
+    logging(L_ERROR, "url_create_for_device: Unable to create url prefix");
+    goto out;
+  }
+
+  if (!(url = malloc(cache->prefix_len + path_len + query_len + 1))) {
+    logging(L_ERROR, "url_create_for_device: Unable to allocate url");
+    goto out;
+  }
+  memcpy(url, cache->prefix, cache->prefix_len);
+  memcpy(url + cache->prefix_len, path, path_len);
+  if (query_len > 0) {
+    memcpy(url + cache->prefix_len + path_len, query, query_len);
+  }
+  url[cache->prefix_len + path_len + query_len] = '\0';
+
+  out:
+  pthread_mutex_unlock(&cache->lock);
+  return url;
+}
@@ -0,0 +1,58 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_URL_H
+#define GAUS_URL_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <gaus/gaus_client_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The start of every device url, "<server url>/device/<product guid>/<device guid>", kept for the last session used */
+typedef struct UrlPrefixCache {
+  pthread_mutex_t lock;
+  char *product_guid;
+  char *device_guid;
+  char *prefix;
+  size_t prefix_len;
+} UrlPrefixCache;
+
+/* Build a url into a newly allocated string of exactly the required size, or NULL on failure.
+ *
+ * fmt only accepts two format string directives:
+ *   %s - string as given
+ *   %e - percent-encode the given string, leaving only unreserved characters (RFC 3986) as they are
+ */
+char *url_create(const char *fmt, ...);
+
+/* Percent-encode str like %e of url_create into dest without terminating it, or only measure it if dest is NULL.
+ *
+ * Returns the length of the encoded string.
+ */
+size_t url_encode(char *dest, const char *str);
+
+void url_prefix_cache_init(UrlPrefixCache *cache);
+
+void url_prefix_cache_cleanup(UrlPrefixCache *cache);
+
+/* Build "<server_url>/device/<product guid>/<device guid><path><query>" for session into a newly allocated string.
+ *
+ * The part up to path is taken from cache, which is rebuilt if it was made for another session.  query may be NULL.
+ */
+char *url_create_for_device(UrlPrefixCache *cache, const char *server_url, const gaus_session_t *session,
+                            const char *path, const char *query);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //GAUS_URL_H
@@ -0,0 +1,59 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "utf8.h"
+
+size_t utf8_sequence(const unsigned char *text, int32_t *codepoint) {
+  size_t count;
+  int32_t value;
+
+  if (text[0] < 0x80) {
+    *codepoint = text[0];
+    return 1;
+  } else if (text[0] >= 0xC2 && text[0] <= 0xDF) {
+    count = 2;
+    value = text[0] & 0x1F;
+  } else if (text[0] >= 0xE0 && text[0] <= 0xEF) {
+    count = 3;
+    value = text[0] & 0x0F;
+  } else if (text[0] >= 0xF0 && text[0] <= 0xF4) {
+    count = 4;
+    value = text[0] & 0x07;
+  } else {
+    return 0;
+  }
+  //The terminating null is no continuation byte, so this never reads past the end
+  for (size_t i = 1; i < count; i++) {
+    if (text[i] < 0x80 || text[i] > 0xBF) {
+      return 0;
+    }
+    value = (value << 6) | (text[i] & 0x3F);
+  }
+  //Out of range, surrogate halves and overlong encodings
+  if (value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF) || (count == 2 && value < 0x80)
+      || (count == 3 && value < 0x800) || (count == 4 && value < 0x10000)) {
+    return 0;
+  }
+  *codepoint = value;
+  return count;
+}
+
+bool utf8_valid(const char *text) {
+  const unsigned char *pos = (const unsigned char *) text;
+  int32_t codepoint = 0;
+
+  while (*pos) {
+    size_t count = utf8_sequence(pos, &codepoint);
+    if (count == 0) {
+      return false;
+    }
+    pos += count;
+  }
+  return true;
+}
@@ -0,0 +1,108 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <malloc.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define ALLOC_COUNTER_DISABLED
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define ALLOC_COUNTER_DISABLED
+#endif
+#endif
+
+static std::atomic<bool> counting(false);
+static std::atomic<size_t> allocations(0);
+static std::atomic<long> currentBytes(0);
+static std::atomic<long> peakBytes(0);
+
+#ifndef ALLOC_COUNTER_DISABLED
+
+static void countAllocation(void *ptr) {
+  if (ptr && counting) {
+    allocations++;
+    long current = currentBytes += malloc_usable_size(ptr);
+    long peak = peakBytes;
+    while (current > peak && !peakBytes.compare_exchange_weak(peak, current)) {
+    }
+  }
+}
+
+static void countFree(void *ptr) {
+  if (ptr && counting) {
+    currentBytes -= malloc_usable_size(ptr);
+  }
+}
+
+//Replace the glibc allocator entry points, forwarding to the real implementation
+extern "C" {
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+  void *ptr = __libc_malloc(size);
+  countAllocation(ptr);
+  return ptr;
+}
+
+void *calloc(size_t count, size_t size) {
+  void *ptr = __libc_calloc(count, size);
+  countAllocation(ptr);
+  return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+  countFree(ptr);
+  void *new_ptr = __libc_realloc(ptr, size);
+  if (!new_ptr && ptr && size > 0) {
+    //Failed, the old block is still in use
+    currentBytes += counting ? malloc_usable_size(ptr) : 0;
+    return new_ptr;
+  }
+  countAllocation(new_ptr);
+  return new_ptr;
+}
+
+void free(void *ptr) {
+  countFree(ptr);
+  __libc_free(ptr);
+}
+}
+
+bool allocCounterAvailable() {
+  return true;
+}
+
+#else
+
+bool allocCounterAvailable() {
+  return false;
+}
+
+#endif
+
+void allocCounterStart() {
+  allocations = 0;
+  currentBytes = 0;
+  peakBytes = 0;
+  counting = true;
+}
+
+AllocStats allocCounterStop() {
+  counting = false;
+  AllocStats stats;
+  stats.allocations = allocations;
+  stats.peakBytes = peakBytes;
+  return stats;
+}
@@ -0,0 +1,30 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_ALLOC_COUNTER_H
+#define GAUS_ALLOC_COUNTER_H
+
+#include <cstddef>
+
+//Heap use between allocCounterStart and allocCounterStop
+class AllocStats {
+public:
+  size_t allocations = {0}; //Calls to malloc, calloc and realloc
+  size_t peakBytes = {0}; //Most bytes in use at once, counted from the start
+};
+
+//Counting wraps malloc and friends for the whole process, this is not possible when built with a sanitizer which
+//already replaces them.
+bool allocCounterAvailable();
+
+void allocCounterStart();
+
+AllocStats allocCounterStop();
+
+#endif //GAUS_ALLOC_COUNTER_H
@@ -0,0 +1,229 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+//Access gaus internals
+#include "../src/libgaus/client.h"
+#include "../src/libgaus/gaus.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+class GausAsync : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    //Setup a default fake response that will work for all tests.
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+    reportResults.clear();
+    checkResults.clear();
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+
+public:
+  class CheckResult {
+  public:
+    gaus_error_t *error;
+    unsigned int updateCount;
+  };
+
+  static std::vector<gaus_error_t *> reportResults;
+  static std::vector<CheckResult> checkResults;
+};
+
+std::vector<gaus_error_t *> GausAsync::reportResults;
+std::vector<GausAsync::CheckResult> GausAsync::checkResults;
+
+static gaus_session_t fakeSession = {
+    const_cast<char *>("fakeDeviceGUID"),
+    const_cast<char *>("fakeProductGUID"),
+    const_cast<char *>("fakeToken")
+};
+
+static gaus_report_header_t fakeHeader = {
+    const_cast<char *>("FAKE_TIMESTAMP")
+};
+
+static gaus_report_t fakeReport = {
+    .report = {
+        .update_status = {
+            .type = const_cast<char *>("Status"),
+            .ts = const_cast<char *>("FAKE_TIME"),
+            .v_int_count = 0,
+            .v_ints = NULL,
+            .v_float_count = 0,
+            .v_floats = NULL,
+            .v_string_count = 0,
+            .v_strings = NULL,
+            .tag_count = 0,
+            .tags = NULL
+        }
+    },
+    .report_type = GAUS_REPORT_UPDATE
+};
+
+static void reportDone(gaus_error_t *error, void *userData) {
+  EXPECT_EQ(&fakeReport, userData);
+  GausAsync::reportResults.push_back(error);
+}
+
+static void checkDone(gaus_error_t *error, unsigned int updateCount, gaus_update_t *updates, void *userData) {
+  GausAsync::checkResults.push_back({error, updateCount});
+  free(updates);
+}
+
+static void freeError(gaus_error_t *error) {
+  if (error) {
+    gaus_error_release(error);
+  }
+}
+
+TEST_F(GausAsync, fails_without_initialize) {
+  unsigned int pending = 1;
+  gaus_error_t *status = gaus_client_poll(0, &pending);
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_NO_INIT_ERROR, status->error_type);
+  EXPECT_EQ(0, pending);
+  freeError(status);
+
+  status = gaus_report_async(&fakeSession, 0, NULL, &fakeHeader, 1, &fakeReport, reportDone, &fakeReport);
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_NO_INIT_ERROR, status->error_type);
+  EXPECT_EQ(0, reportResults.size());
+  freeError(status);
+}
+
+TEST_F(GausAsync, invalid_parameters_do_not_call_callback) {
+  gaus_global_init("fakeServerUrl", NULL);
+
+  gaus_error_t *status = gaus_check_for_updates_async(NULL, 0, NULL, checkDone, NULL);
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_UNKNOWN_ERROR, status->error_type);
+  freeError(status);
+
+  unsigned int pending = 1;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, &pending));
+  EXPECT_EQ(0, pending);
+  EXPECT_EQ(0, checkResults.size());
+  EXPECT_EQ(0, curlPerformData.size());
+}
+
+TEST_F(GausAsync, requests_are_in_flight_together_until_polled) {
+  gaus_global_init("fakeServerUrl", NULL);
+
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+              gaus_report_async(&fakeSession, 0, NULL, &fakeHeader, 1, &fakeReport, reportDone, &fakeReport));
+  }
+  //Nothing is sent before polling
+  EXPECT_EQ(0, curlPerformData.size());
+  EXPECT_EQ(3, curlMultiMaxInFlight);
+
+  unsigned int pending = 0;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(100, &pending));
+  EXPECT_EQ(0, pending);
+
+  ASSERT_EQ(3, reportResults.size());
+  for (gaus_error_t *error : reportResults) {
+    EXPECT_EQ(static_cast<gaus_error_t *>(NULL), error);
+  }
+  //Each request has its own handle, none of them the one used by blocking calls
+  ASSERT_EQ(3, curlPerformHandles.size());
+  std::set<CURL *> handles(curlPerformHandles.begin(), curlPerformHandles.end());
+  EXPECT_EQ(3, handles.size());
+  EXPECT_EQ(0, handles.count(gaus_global_state.client->curl));
+  //Asynchronous requests get a multi handle of their own, separate from the one used by blocking calls
+  EXPECT_EQ(2, curlCallCounter.multiInit);
+
+  for (const CurlOptionsData &data : curlPerformData) {
+    EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/report", data.CURLOPT_URL);
+    EXPECT_EQ("{\"version\":\"1.0.0\",\"header\":{\"ts\":\"FAKE_TIMESTAMP\"},\"data\":[{\"type\":"
+              "\"event.update.Status\",\"ts\":\"FAKE_TIME\",\"v_strings\":{}}]}", data.CURLOPT_POSTFIELDS);
+    EXPECT_NE(data.CURLOPT_HEADER.end(),
+              std::find(data.CURLOPT_HEADER.begin(), data.CURLOPT_HEADER.end(), "Authorization: Bearer fakeToken"));
+  }
+}
+
+TEST_F(GausAsync, check_for_updates_returns_updates_to_callback) {
+  gaus_header_filter_t filter = {const_cast<char *>("firmware"), const_cast<char *>("1.0.0")};
+  gaus_global_init("fakeServerUrl", NULL);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_check_for_updates_async(&fakeSession, 1, &filter, checkDone, NULL));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, NULL));
+
+  ASSERT_EQ(1, checkResults.size());
+  EXPECT_EQ(static_cast<gaus_error_t *>(NULL), checkResults[0].error);
+  EXPECT_EQ(0, checkResults[0].updateCount);
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/check-for-updates?firmware=1.0.0",
+            curlPerformData[0].CURLOPT_URL);
+  EXPECT_EQ(1L, curlPerformData[0].CURLOPT_HTTPGET);
+}
+
+TEST_F(GausAsync, invalid_reply_is_reported_to_callback) {
+  free(fakeResponse);
+  fakeResponse = strdup("not json");
+  gaus_global_init("fakeServerUrl", NULL);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_check_for_updates_async(&fakeSession, 0, NULL, checkDone, NULL));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, NULL));
+
+  ASSERT_EQ(1, checkResults.size());
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), checkResults[0].error);
+  EXPECT_EQ(GAUS_UNKNOWN_ERROR, checkResults[0].error->error_type);
+  freeError(checkResults[0].error);
+}
+
+TEST_F(GausAsync, finished_handles_are_reused) {
+  gaus_global_init("fakeServerUrl", NULL);
+
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 2; i++) {
+      ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+                gaus_report_async(&fakeSession, 0, NULL, &fakeHeader, 1, &fakeReport, reportDone, &fakeReport));
+    }
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, NULL));
+  }
+
+  EXPECT_EQ(6, reportResults.size());
+  EXPECT_EQ(6, curlPerformHandles.size());
+  //Only the first round needed new handles
+  std::set<CURL *> handles(curlPerformHandles.begin(), curlPerformHandles.end());
+  EXPECT_EQ(2, handles.size());
+  //Asynchronous requests get a multi handle of their own, separate from the one used by blocking calls
+  EXPECT_EQ(2, curlCallCounter.multiInit);
+}
+
+TEST_F(GausAsync, cleanup_fails_pending_requests) {
+  gaus_global_init("fakeServerUrl", NULL);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_report_async(&fakeSession, 0, NULL, &fakeHeader, 1, &fakeReport, reportDone, &fakeReport));
+  gaus_global_cleanup();
+
+  ASSERT_EQ(1, reportResults.size());
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), reportResults[0]);
+  EXPECT_EQ(0, curlPerformData.size());
+  EXPECT_EQ(2, curlCallCounter.multiCleanup);
+  //Both the shared handle and the one used by the aborted request are released
+  EXPECT_TRUE(allCurlData.empty());
+  EXPECT_TRUE(allCurlMultiData.empty());
+  freeError(reportResults[0]);
+}
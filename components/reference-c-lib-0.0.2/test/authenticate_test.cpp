@@ -50,8 +50,7 @@ TEST_F(GausAuthenticate, fails_without_initialize) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausAuthenticate, fails_without_device_access) {
@@ -66,8 +65,7 @@ TEST_F(GausAuthenticate, fails_without_device_access) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausAuthenticate, fails_without_device_secret) {
@@ -82,8 +80,7 @@ TEST_F(GausAuthenticate, fails_without_device_secret) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausAuthenticate, fails_without_session) {
@@ -97,8 +94,7 @@ TEST_F(GausAuthenticate, fails_without_session) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausAuthenticate, posts_to_correct_address) {
@@ -165,8 +161,7 @@ TEST_F(GausAuthenticate, handles_errors_on_perform_without_status) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 static CURLcode mock_curl_easy_getinfo_return_500(CURL *curl, CURLINFO info, ...) {
@@ -204,8 +199,7 @@ TEST_F(GausAuthenticate, handles_errors_on_perform_with_status_500) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 static CURLcode mock_curl_easy_getinfo_return_400(CURL *curl, CURLINFO info, ...) {
@@ -243,8 +237,7 @@ TEST_F(GausAuthenticate, handles_errors_on_perform_with_status_400) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausAuthenticate, retreives_correctly_from_server) {
@@ -295,8 +288,7 @@ TEST_F(GausAuthenticate, handles_no_device_guid_from_server) {
   free(session.device_guid);
   free(session.product_guid);
   free(session.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausAuthenticate, handles_no_product_guid_from_server) {
@@ -324,8 +316,7 @@ TEST_F(GausAuthenticate, handles_no_product_guid_from_server) {
   free(session.device_guid);
   free(session.product_guid);
   free(session.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausAuthenticate, handles_no_token_from_server) {
@@ -353,8 +344,7 @@ TEST_F(GausAuthenticate, handles_no_token_from_server) {
   free(session.device_guid);
   free(session.product_guid);
   free(session.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausAuthenticate, handles_malformed_json_from_server) {
@@ -379,8 +369,7 @@ TEST_F(GausAuthenticate, handles_malformed_json_from_server) {
   free(session.device_guid);
   free(session.product_guid);
   free(session.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausAuthenticate, uses_proxy_from_init) {
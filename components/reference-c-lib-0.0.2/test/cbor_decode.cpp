@@ -0,0 +1,171 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "cbor_decode.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+//Deeper nesting than any report has
+#define MAX_DEPTH 16
+
+class CborReader {
+public:
+  explicit CborReader(const std::string &cbor) : data(cbor), pos(0) {}
+
+  json_t *item(int depth) {
+    uint8_t major;
+    uint8_t additional;
+    uint64_t value;
+
+    if (depth > MAX_DEPTH || !head(&major, &additional, &value)) {
+      return NULL;
+    }
+    switch (major) {
+      case 0:
+        return value <= INT64_MAX ? json_integer(static_cast<json_int_t>(value)) : NULL;
+      case 1:
+        return value <= INT64_MAX ? json_integer(-1 - static_cast<json_int_t>(value)) : NULL;
+      case 3:
+        if (value > data.size() - pos) {
+          return NULL;
+        } else {
+          json_t *text = json_stringn(data.data() + pos, value);
+          pos += value;
+          return text;
+        }
+      case 4:
+        return array(value, depth);
+      case 5:
+        return map(value, depth);
+      case 7:
+        return simple(additional, value);
+      default:
+        //Byte strings and tags are never sent
+        return NULL;
+    }
+  }
+
+  bool atEnd() const {
+    return pos == data.size();
+  }
+
+private:
+  const std::string &data;
+  size_t pos;
+
+  //Read the head of an item, value being its argument (or the bits of a float)
+  bool head(uint8_t *major, uint8_t *additional, uint64_t *value) {
+    if (pos >= data.size()) {
+      return false;
+    }
+    uint8_t initial = static_cast<uint8_t>(data[pos++]);
+    *major = initial >> 5;
+    *additional = initial & 0x1F;
+    size_t size;
+    if (*additional < 24) {
+      *value = *additional;
+      return true;
+    } else if (*additional <= 27) {
+      size = static_cast<size_t>(1) << (*additional - 24);
+    } else {
+      //Reserved, or an indefinite length which reports never use
+      return false;
+    }
+    if (size > data.size() - pos) {
+      return false;
+    }
+    *value = 0;
+    for (size_t i = 0; i < size; i++) {
+      *value = *value << 8 | static_cast<uint8_t>(data[pos++]);
+    }
+    return true;
+  }
+
+  json_t *array(uint64_t count, int depth) {
+    json_t *result = json_array();
+    for (uint64_t i = 0; i < count && result; i++) {
+      json_t *element = item(depth + 1);
+      if (!element || json_array_append_new(result, element) != 0) {
+        json_decref(result);
+        result = NULL;
+      }
+    }
+    return result;
+  }
+
+  json_t *map(uint64_t count, int depth) {
+    json_t *result = json_object();
+    for (uint64_t i = 0; i < count && result; i++) {
+      json_t *key = item(depth + 1);
+      json_t *value = json_is_string(key) ? item(depth + 1) : NULL;
+      //A repeated key would be silently lost in json, so it is as wrong as a key that is no text
+      if (!value || json_object_get(result, json_string_value(key))
+          || json_object_set_new(result, json_string_value(key), value) != 0) {
+        json_decref(value);
+        json_decref(result);
+        result = NULL;
+      }
+      json_decref(key);
+    }
+    return result;
+  }
+
+  static json_t *simple(uint8_t additional, uint64_t value) {
+    switch (additional) {
+      case 20:
+        return json_false();
+      case 21:
+        return json_true();
+      case 22:
+        return json_null();
+      case 25:
+        return json_real(halfToDouble(static_cast<uint16_t>(value)));
+      case 26: {
+        uint32_t bits = static_cast<uint32_t>(value);
+        float single;
+        memcpy(&single, &bits, sizeof(single));
+        return json_real(single);
+      }
+      case 27: {
+        double real;
+        memcpy(&real, &value, sizeof(real));
+        return json_real(real);
+      }
+      default:
+        return NULL;
+    }
+  }
+
+  //As in appendix D of RFC 7049
+  static double halfToDouble(uint16_t half) {
+    int exponent = (half >> 10) & 0x1F;
+    int mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0) {
+      value = ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+      value = ldexp(mantissa + 1024, exponent - 25);
+    } else {
+      value = mantissa == 0 ? INFINITY : NAN;
+    }
+    return half & 0x8000 ? -value : value;
+  }
+};
+
+json_t *cborDecode(const std::string &cbor) {
+  CborReader reader(cbor);
+  json_t *result = reader.item(0);
+  if (result && !reader.atEnd()) {
+    json_decref(result);
+    result = NULL;
+  }
+  return result;
+}
@@ -0,0 +1,216 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "cbor_decode.h"
+
+//Access gaus internals
+#include "../src/libgaus/cbor_writer.h"
+
+#include <jansson.h>
+
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+class GausCborWriter : public ::testing::Test {
+protected:
+  cbor_writer_t writer = {NULL, 0, 0, false};
+
+  virtual void TearDown() {
+    cbor_writer_free(&writer);
+  }
+
+  //The document written so far as hex, or "<failed>"
+  std::string take() {
+    size_t length;
+    char *data = cbor_writer_take(&writer, &length);
+    if (!data) {
+      return "<failed>";
+    }
+    std::string result;
+    char byte[3];
+    for (size_t i = 0; i < length; i++) {
+      snprintf(byte, sizeof(byte), "%02x", static_cast<uint8_t>(data[i]));
+      result += byte;
+    }
+    free(data);
+    return result;
+  }
+
+  std::string writeInteger(long long value) {
+    cbor_writer_integer(&writer, value);
+    return take();
+  }
+
+  std::string writeFloat(float value) {
+    cbor_writer_float(&writer, value);
+    return take();
+  }
+
+  std::string writeString(const char *value) {
+    cbor_writer_string(&writer, value);
+    return take();
+  }
+};
+
+//Examples from appendix A of RFC 7049
+
+TEST_F(GausCborWriter, writes_integers_in_their_shortest_form) {
+  EXPECT_EQ("00", writeInteger(0));
+  EXPECT_EQ("01", writeInteger(1));
+  EXPECT_EQ("0a", writeInteger(10));
+  EXPECT_EQ("17", writeInteger(23));
+  EXPECT_EQ("1818", writeInteger(24));
+  EXPECT_EQ("1864", writeInteger(100));
+  EXPECT_EQ("1903e8", writeInteger(1000));
+  EXPECT_EQ("1a000f4240", writeInteger(1000000));
+  EXPECT_EQ("1b000000e8d4a51000", writeInteger(1000000000000LL));
+  EXPECT_EQ("20", writeInteger(-1));
+  EXPECT_EQ("29", writeInteger(-10));
+  EXPECT_EQ("3863", writeInteger(-100));
+  EXPECT_EQ("3903e7", writeInteger(-1000));
+  EXPECT_EQ("1b7fffffffffffffff", writeInteger(LLONG_MAX));
+  EXPECT_EQ("3b7fffffffffffffff", writeInteger(LLONG_MIN));
+}
+
+TEST_F(GausCborWriter, writes_floats_as_half_precision_when_exact) {
+  EXPECT_EQ("f90000", writeFloat(0.0f));
+  EXPECT_EQ("f98000", writeFloat(-0.0f));
+  EXPECT_EQ("f93c00", writeFloat(1.0f));
+  EXPECT_EQ("f93e00", writeFloat(1.5f));
+  EXPECT_EQ("f97bff", writeFloat(65504.0f));
+  EXPECT_EQ("f90001", writeFloat(5.960464477539063e-8f));
+  EXPECT_EQ("f90400", writeFloat(0.00006103515625f));
+  EXPECT_EQ("f9c400", writeFloat(-4.0f));
+}
+
+TEST_F(GausCborWriter, writes_other_floats_as_single_precision) {
+  EXPECT_EQ("fa47c35000", writeFloat(100000.0f));
+  EXPECT_EQ("fa7f7fffff", writeFloat(3.4028234663852886e+38f));
+  EXPECT_EQ("fa3f8ccccd", writeFloat(1.1f));
+  //Too precise for half precision, whether normal or subnormal
+  EXPECT_EQ("fa3f801000", writeFloat(1.00048828125f));
+  EXPECT_EQ("fa33c00000", writeFloat(8.940696716308594e-8f));
+}
+
+TEST_F(GausCborWriter, fails_for_floats_that_are_not_finite) {
+  EXPECT_EQ("<failed>", writeFloat(NAN));
+  EXPECT_EQ("<failed>", writeFloat(INFINITY));
+  EXPECT_EQ("<failed>", writeFloat(-INFINITY));
+}
+
+TEST_F(GausCborWriter, writes_text_strings) {
+  EXPECT_EQ("60", writeString(""));
+  EXPECT_EQ("6161", writeString("a"));
+  EXPECT_EQ("6449455446", writeString("IETF"));
+  EXPECT_EQ("62c3bc", writeString("\xc3\xbc"));
+  EXPECT_EQ("63e6b0b4", writeString("\xe6\xb0\xb4"));
+  //24 bytes no longer fit in the head
+  EXPECT_EQ("7818" + std::string(48, '6'), writeString(std::string(24, 'f').c_str()));
+}
+
+TEST_F(GausCborWriter, writes_prefixed_strings_as_one) {
+  cbor_writer_string_prefixed(&writer, "event.generic.", "T");
+
+  EXPECT_EQ("6f6576656e742e67656e657269632e54", take());
+}
+
+TEST_F(GausCborWriter, fails_for_strings_that_json_refuses) {
+  EXPECT_EQ("<failed>", writeString(NULL));
+  EXPECT_EQ("<failed>", writeString("\xff"));
+  EXPECT_EQ("<failed>", writeString("\xc0\x80"));
+  EXPECT_EQ("<failed>", writeString("\xed\xa0\x80"));
+}
+
+TEST_F(GausCborWriter, writes_maps_and_arrays_of_a_known_size) {
+  cbor_writer_array(&writer, 3);
+  cbor_writer_integer(&writer, 1);
+  cbor_writer_array(&writer, 2);
+  cbor_writer_integer(&writer, 2);
+  cbor_writer_integer(&writer, 3);
+  cbor_writer_array(&writer, 2);
+  cbor_writer_integer(&writer, 4);
+  cbor_writer_integer(&writer, 5);
+  EXPECT_EQ("8301820203820405", take());
+
+  cbor_writer_map(&writer, 2);
+  cbor_writer_string(&writer, "a");
+  cbor_writer_integer(&writer, 1);
+  cbor_writer_string(&writer, "b");
+  cbor_writer_array(&writer, 2);
+  cbor_writer_integer(&writer, 2);
+  cbor_writer_integer(&writer, 3);
+  EXPECT_EQ("a26161016162820203", take());
+
+  cbor_writer_map(&writer, 0);
+  cbor_writer_array(&writer, 0);
+  EXPECT_EQ("a080", take());
+}
+
+TEST_F(GausCborWriter, ignores_writes_once_failed) {
+  cbor_writer_string(&writer, "\xff");
+  cbor_writer_integer(&writer, 1);
+
+  EXPECT_TRUE(writer.failed);
+  EXPECT_EQ(0, writer.length);
+  EXPECT_EQ("<failed>", take());
+  //Taking starts over
+  EXPECT_EQ("01", writeInteger(1));
+}
+
+TEST_F(GausCborWriter, grows_from_nothing) {
+  cbor_writer_init(&writer, 0);
+  cbor_writer_array(&writer, 100);
+  for (int i = 0; i < 100; i++) {
+    cbor_writer_integer(&writer, 100000 + i);
+  }
+  size_t length;
+  char *data = cbor_writer_take(&writer, &length);
+
+  ASSERT_NE(static_cast<char *>(NULL), data);
+  EXPECT_EQ(2 + 100 * 5, length);
+  free(data);
+}
+
+TEST_F(GausCborWriter, decodes_to_the_values_written) {
+  cbor_writer_map(&writer, 4);
+  cbor_writer_string(&writer, "min");
+  cbor_writer_integer(&writer, LLONG_MIN);
+  cbor_writer_string(&writer, "max");
+  cbor_writer_integer(&writer, LLONG_MAX);
+  cbor_writer_string(&writer, "half");
+  cbor_writer_float(&writer, -0.375f);
+  cbor_writer_string(&writer, "single");
+  cbor_writer_float(&writer, 21.3f);
+  size_t length;
+  char *data = cbor_writer_take(&writer, &length);
+  ASSERT_NE(static_cast<char *>(NULL), data);
+
+  json_t *decoded = cborDecode(std::string(data, length));
+
+  ASSERT_NE(static_cast<json_t *>(NULL), decoded);
+  EXPECT_EQ(LLONG_MIN, json_integer_value(json_object_get(decoded, "min")));
+  EXPECT_EQ(LLONG_MAX, json_integer_value(json_object_get(decoded, "max")));
+  EXPECT_EQ(-0.375, json_real_value(json_object_get(decoded, "half")));
+  EXPECT_EQ(21.3f, json_real_value(json_object_get(decoded, "single")));
+  json_decref(decoded);
+  free(data);
+}
+
+TEST_F(GausCborWriter, decoder_refuses_what_is_not_a_single_item) {
+  EXPECT_EQ(static_cast<json_t *>(NULL), cborDecode(""));
+  EXPECT_EQ(static_cast<json_t *>(NULL), cborDecode(std::string("\x01\x01", 2)));
+  EXPECT_EQ(static_cast<json_t *>(NULL), cborDecode(std::string("\x82\x01", 2)));
+  EXPECT_EQ(static_cast<json_t *>(NULL), cborDecode(std::string("\x63" "ab", 3)));
+  EXPECT_EQ(static_cast<json_t *>(NULL), cborDecode(std::string("\xa1\x01\x01", 3)));
+  EXPECT_EQ(static_cast<json_t *>(NULL), cborDecode(std::string("\xa2\x61" "a\x01\x61" "a\x02", 7)));
+}
@@ -13,7 +13,9 @@
 
 //Access gaus curl wrapper
 #include "../src/libgaus/curl_wrapper.h"
+#include "../src/libgaus/log.h"
 
+#include <algorithm>
 #include <cstdarg>
 
 #include <map>
@@ -64,8 +66,7 @@ TEST_F(GausCheckForUpdates, fails_without_initialize) {
   free(fakeSession.device_guid);
   free(fakeSession.product_guid);
   free(fakeSession.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, fails_without_session) {
@@ -83,8 +84,7 @@ TEST_F(GausCheckForUpdates, fails_without_session) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, fails_without_device_guid) {
@@ -110,8 +110,7 @@ TEST_F(GausCheckForUpdates, fails_without_device_guid) {
   free(fakeSession.device_guid);
   free(fakeSession.product_guid);
   free(fakeSession.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, fails_without_product_guid) {
@@ -137,8 +136,7 @@ TEST_F(GausCheckForUpdates, fails_without_product_guid) {
   free(fakeSession.device_guid);
   free(fakeSession.product_guid);
   free(fakeSession.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, fails_without_token) {
@@ -164,8 +162,7 @@ TEST_F(GausCheckForUpdates, fails_without_token) {
   free(fakeSession.device_guid);
   free(fakeSession.product_guid);
   free(fakeSession.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, fails_if_filter_count_and_no_filter) {
@@ -191,8 +188,7 @@ TEST_F(GausCheckForUpdates, fails_if_filter_count_and_no_filter) {
   free(fakeSession.device_guid);
   free(fakeSession.product_guid);
   free(fakeSession.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, fails_if_no_update_count) {
@@ -217,8 +213,7 @@ TEST_F(GausCheckForUpdates, fails_if_no_update_count) {
   free(fakeSession.device_guid);
   free(fakeSession.product_guid);
   free(fakeSession.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, fails_if_no_updates) {
@@ -243,8 +238,7 @@ TEST_F(GausCheckForUpdates, fails_if_no_updates) {
   free(fakeSession.device_guid);
   free(fakeSession.product_guid);
   free(fakeSession.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, gets_from_correct_address) {
@@ -353,8 +347,7 @@ TEST_F(GausCheckForUpdates, handles_errors_on_perform_without_status) {
   free(fakeSession.device_guid);
   free(fakeSession.product_guid);
   free(fakeSession.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 static CURLcode mock_curl_easy_getinfo_return_500(CURL *curl, CURLINFO info, ...) {
@@ -403,8 +396,7 @@ TEST_F(GausCheckForUpdates, handles_errors_on_perform_with_status_500) {
   free(fakeSession.device_guid);
   free(fakeSession.product_guid);
   free(fakeSession.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 static CURLcode mock_curl_easy_getinfo_return_400(CURL *curl, CURLINFO info, ...) {
@@ -453,8 +445,7 @@ TEST_F(GausCheckForUpdates, handles_errors_on_perform_with_status_400) {
   free(fakeSession.device_guid);
   free(fakeSession.product_guid);
   free(fakeSession.token);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 
@@ -690,6 +681,298 @@ TEST_F(GausCheckForUpdates, retreives_two_updates_correctly_from_server) {
 }
 
 
+TEST_F(GausCheckForUpdates, parses_reply_arriving_in_small_chunks) {
+  gaus_session_t fakeSession = {
+      strdup("fakeDeviceGUID"),
+      strdup("fakeProductGUID"),
+      strdup("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+
+  std::string fakeUpdate = std::string("") +
+                           "{" +
+                           "\"metadata\": {\"FAKEMETAKEY\": \"FAKEMETAVALUE\"}," +
+                           "\"size\": 123," +
+                           "\"updateType\": \"firmware\"," +
+                           "\"packageType\": \"file\"," +
+                           "\"md5\": \"FAKEMD5\"," +
+                           "\"updateId\": \"FAKEUPDATEID\"," +
+                           "\"version\": \"FAKEVERSION\"," +
+                           "\"downloadUrl\": \"FAKEDOWNLOADURL\"" +
+                           "}";
+  //Enough updates that the reply is much larger than what jansson reads at a time
+  std::string fakeManyUpdateResponse = "{\"updates\":[" + fakeUpdate;
+  for (int i = 1; i < 20; i++) {
+    fakeManyUpdateResponse += "," + fakeUpdate;
+  }
+  fakeManyUpdateResponse += "]}";
+
+  free(fakeResponse);
+  fakeResponse = strdup(fakeManyUpdateResponse.c_str());
+  fakeResponseChunkSize = 7;
+  gaus_global_init("fakeServerUrl", NULL);
+
+  gaus_error_t *status = gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), status);
+  ASSERT_EQ(20, updateCount);
+  EXPECT_EQ(std::string("FAKEMETAVALUE"), updates[0].metadata[0].value);
+  EXPECT_EQ(std::string("FAKEUPDATEID"), updates[19].update_id);
+  EXPECT_EQ(std::string("FAKEDOWNLOADURL"), updates[19].download_url);
+  EXPECT_EQ(1, curlPerformData.size());
+
+  //Cleanup after test
+  freeUpdates(updateCount, &updates);
+  free(fakeSession.device_guid);
+  free(fakeSession.product_guid);
+  free(fakeSession.token);
+}
+
+//A reply with count updates, the last one without a version if brokenLast
+static std::string oneBlockResponse(int count, bool brokenLast) {
+  std::string response = "{\"updates\":[";
+  for (int i = 0; i < count; i++) {
+    response += std::string(i ? "," : "") +
+                "{" +
+                "\"metadata\": {\"FAKEMETAKEY\": \"FAKEMETAVALUE" + std::to_string(i) + "\", \"hint\": \"\"}," +
+                "\"size\": 123," +
+                "\"updateType\": \"firmware\"," +
+                "\"packageType\": \"file\"," +
+                "\"md5\": \"FAKEMD5\"," +
+                "\"updateId\": \"FAKEUPDATEID" + std::to_string(i) + "\"," +
+                (brokenLast && i == count - 1 ? "" : "\"version\": \"FAKEVERSION\",") +
+                "\"downloadUrl\": \"FAKEDOWNLOADURL\"" +
+                "}";
+  }
+  return response + "]}";
+}
+
+TEST_F(GausCheckForUpdates, lays_out_updates_in_one_block) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_initialization_options_t options = {};
+  options.update_layout = GAUS_UPDATE_LAYOUT_ONE_BLOCK;
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  std::string response = oneBlockResponse(3, false);
+  free(fakeResponse);
+  fakeResponse = strdup(response.c_str());
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", &options));
+
+  gaus_error_t *status = gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), status);
+  ASSERT_EQ(3, updateCount);
+  //Every part lies after the updates, within a block no larger than the reply
+  const char *end = reinterpret_cast<const char *>(updates + updateCount) + response.size();
+  for (unsigned int i = 0; i < updateCount; i++) {
+    std::string index = std::to_string(i);
+    ASSERT_EQ(2, updates[i].metadata_count);
+    EXPECT_EQ(std::string("FAKEMETAKEY"), updates[i].metadata[0].key);
+    EXPECT_EQ("FAKEMETAVALUE" + index, updates[i].metadata[0].value);
+    EXPECT_EQ(std::string("hint"), updates[i].metadata[1].key);
+    EXPECT_EQ(std::string(""), updates[i].metadata[1].value);
+    EXPECT_EQ(123, updates[i].size);
+    EXPECT_EQ(std::string("firmware"), updates[i].update_type);
+    EXPECT_EQ(std::string("file"), updates[i].package_type);
+    EXPECT_EQ(std::string("FAKEMD5"), updates[i].md5);
+    EXPECT_EQ("FAKEUPDATEID" + index, updates[i].update_id);
+    EXPECT_EQ(std::string("FAKEVERSION"), updates[i].version);
+    EXPECT_EQ(std::string("FAKEDOWNLOADURL"), updates[i].download_url);
+    const void *parts[] = {updates[i].metadata, updates[i].metadata[0].key, updates[i].metadata[1].value,
+                           updates[i].update_type, updates[i].package_type, updates[i].md5, updates[i].update_id,
+                           updates[i].version, updates[i].download_url};
+    for (const void *part : parts) {
+      EXPECT_TRUE(part >= updates + updateCount && part < end);
+    }
+  }
+
+  //Everything goes with the block, a leak would show up with the sanitizers
+  gaus_updates_free(updates);
+}
+
+TEST_F(GausCheckForUpdates, one_block_updates_are_null_on_failure) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_initialization_options_t options = {};
+  options.update_layout = GAUS_UPDATE_LAYOUT_ONE_BLOCK;
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  free(fakeResponse);
+  fakeResponse = strdup(oneBlockResponse(2, true).c_str());
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", &options));
+
+  gaus_error_t *status = gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates);
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_UNKNOWN_ERROR, status->error_type);
+  EXPECT_EQ(0, updateCount);
+  EXPECT_EQ(static_cast<gaus_update_t *>(NULL), updates);
+  gaus_error_release(status);
+}
+
+//The conditional header sent with a request, or "" if it was not conditional
+static std::string conditionHeader(const CurlOptionsData &request) {
+  for (const std::string &header : request.CURLOPT_HEADER) {
+    if (header.find("If-None-Match:") == 0 || header.find("If-Modified-Since:") == 0) {
+      return header;
+    }
+  }
+  return "";
+}
+
+TEST_F(GausCheckForUpdates, sends_etag_back_and_skips_parsing_when_not_modified) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  gaus_filter_set_t *filterSet = NULL;
+  fakeResponseHeaders = {"Content-Type: application/json", "etag:  \"v1\" "};
+  gaus_global_init("fakeServerUrl", NULL);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_filter_set_create(0, NULL, &filterSet));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates));
+  //Not valid json, so the reply must not be parsed
+  free(fakeResponse);
+  fakeResponse = strdup("");
+  fakeStatusCode = 304;
+  updateCount = 1;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates));
+
+  EXPECT_EQ(0, updateCount);
+  EXPECT_EQ(static_cast<gaus_update_t *>(NULL), updates);
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ("", conditionHeader(curlPerformData[0]));
+  EXPECT_EQ("If-None-Match: \"v1\"", conditionHeader(curlPerformData[1]));
+  gaus_filter_set_free(filterSet);
+}
+
+TEST_F(GausCheckForUpdates, does_not_log_parse_errors_for_error_replies) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  FILE *stream = tmpfile();
+  ASSERT_NE(static_cast<FILE *>(NULL), stream);
+  set_log_stream(stream);
+  gaus_global_init("fakeServerUrl", NULL);
+  //An error page from a proxy is not json
+  free(fakeResponse);
+  fakeResponse = strdup("<html><body>Bad Gateway</body></html>");
+  fakeStatusCode = 502;
+
+  gaus_error_t *status = gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates);
+  set_log_stream(NULL);
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(502, status->http_error_code);
+  std::string log;
+  char line[512];
+  rewind(stream);
+  while (fgets(line, sizeof(line), stream)) {
+    log += line;
+  }
+  EXPECT_EQ(std::string::npos, log.find("Error parsing json")) << log;
+  fclose(stream);
+  gaus_error_release(status);
+}
+
+TEST_F(GausCheckForUpdates, sends_last_modified_back_without_etag) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  gaus_filter_set_t *filterSet = NULL;
+  fakeResponseHeaders = {"Last-Modified: Wed, 21 Oct 2015 07:28:00 GMT"};
+  gaus_global_init("fakeServerUrl", NULL);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_filter_set_create(0, NULL, &filterSet));
+
+  gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates);
+  gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates);
+  fakeResponseHeaders = {"Last-Modified: Wed, 21 Oct 2015 07:28:00 GMT", "ETag: W/\"v2\""};
+  gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates);
+  gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates);
+
+  ASSERT_EQ(4, curlPerformData.size());
+  EXPECT_EQ("If-Modified-Since: Wed, 21 Oct 2015 07:28:00 GMT", conditionHeader(curlPerformData[1]));
+  //An ETag wins over Last-Modified
+  EXPECT_EQ("If-None-Match: W/\"v2\"", conditionHeader(curlPerformData[3]));
+  gaus_filter_set_free(filterSet);
+}
+
+TEST_F(GausCheckForUpdates, does_not_make_checks_conditional_on_replies_with_updates) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  gaus_filter_set_t *filterSet = NULL;
+  fakeResponseHeaders = {"ETag: \"v1\""};
+  gaus_global_init("fakeServerUrl", NULL);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_filter_set_create(0, NULL, &filterSet));
+  gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates);
+
+  //A new update shows up, it must be fetched on every check until it is installed
+  free(fakeResponse);
+  fakeResponse = strdup("{\"updates\": [{\"metadata\": {}, \"size\": 123, \"updateType\": \"firmware\","
+                        "\"packageType\": \"file\", \"md5\": \"FAKEMD5\", \"updateId\": \"FAKEUPDATEID\","
+                        "\"version\": \"FAKEVERSION\", \"downloadUrl\": \"FAKEDOWNLOADURL\"}]}");
+  fakeResponseHeaders = {"ETag: \"v2\""};
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates));
+  ASSERT_EQ(1, updateCount);
+  freeUpdates(updateCount, &updates);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates));
+  ASSERT_EQ(1, updateCount);
+  freeUpdates(updateCount, &updates);
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ("If-None-Match: \"v1\"", conditionHeader(curlPerformData[1]));
+  EXPECT_EQ("", conditionHeader(curlPerformData[2]));
+  gaus_filter_set_free(filterSet);
+}
+
+TEST_F(GausCheckForUpdates, not_modified_to_unconditional_check_is_an_error) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  free(fakeResponse);
+  fakeResponse = strdup("");
+  fakeStatusCode = 304;
+  gaus_global_init("fakeServerUrl", NULL);
+
+  gaus_error_t *status = gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates);
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ("", conditionHeader(curlPerformData[0]));
+  gaus_error_release(status);
+}
+
 TEST_F(GausCheckForUpdates, handles_multiple_metadata_correctly) {
   std::string serverUrl = "fakeServerUrl";
   std::string fakeDeviceGuid = "fakeDeviceGUID";
@@ -826,8 +1109,7 @@ TEST_F(GausCheckForUpdates, handles_missing_update_type) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   freeUpdates(updateCount, &updates);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, handles_missing_package_type) {
@@ -890,8 +1172,7 @@ TEST_F(GausCheckForUpdates, handles_missing_package_type) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   freeUpdates(updateCount, &updates);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, handles_missing_md5) {
@@ -954,8 +1235,7 @@ TEST_F(GausCheckForUpdates, handles_missing_md5) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   freeUpdates(updateCount, &updates);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, handles_missing_updateId) {
@@ -1018,8 +1298,7 @@ TEST_F(GausCheckForUpdates, handles_missing_updateId) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   freeUpdates(updateCount, &updates);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, handles_missing_version) {
@@ -1082,8 +1361,7 @@ TEST_F(GausCheckForUpdates, handles_missing_version) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   freeUpdates(updateCount, &updates);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, handles_missing_download_url) {
@@ -1146,8 +1424,7 @@ TEST_F(GausCheckForUpdates, handles_missing_download_url) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   freeUpdates(updateCount, &updates);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, handles_missing_meta_data) {
@@ -1207,8 +1484,7 @@ TEST_F(GausCheckForUpdates, handles_missing_meta_data) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   freeUpdates(updateCount, &updates);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, handles_malformed_json_from_server) {
@@ -1247,8 +1523,7 @@ TEST_F(GausCheckForUpdates, handles_malformed_json_from_server) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   freeUpdates(updateCount, &updates);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausCheckForUpdates, handles_one_filter_correctly) {
@@ -0,0 +1,183 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+#include "alloc_counter.h"
+
+//Access gaus internals
+#include "../src/libgaus/client.h"
+#include "../src/libgaus/curl_wrapper.h"
+#include "../src/libgaus/gaus.h"
+
+#include <algorithm>
+#include <cstdarg>
+
+#include <map>
+#include <iostream>
+
+class GausClient : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    //Setup a default fake response that will work for all tests.
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+};
+
+TEST_F(GausClient, global_init_creates_one_shared_handle) {
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", NULL));
+  ASSERT_NE(static_cast<gaus_client_t *>(NULL), gaus_global_state.client);
+  EXPECT_EQ(1, curlCallCounter.easyInit);
+
+  gaus_global_cleanup();
+  EXPECT_EQ(1, curlCallCounter.easyCleanup);
+  EXPECT_EQ(static_cast<gaus_client_t *>(NULL), gaus_global_state.client);
+}
+
+TEST_F(GausClient, reuses_handle_across_calls) {
+  gaus_session_t fakeSession = {
+      strdup("fakeDeviceGUID"),
+      strdup("fakeProductGUID"),
+      strdup("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+
+  gaus_global_init("fakeServerUrl", NULL);
+  CURL *sharedHandle = gaus_global_state.client->curl;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates));
+
+  ASSERT_EQ(2, curlPerformHandles.size());
+  EXPECT_EQ(sharedHandle, curlPerformHandles[0]);
+  EXPECT_EQ(sharedHandle, curlPerformHandles[1]);
+  //Handle is reset between calls so options from the first call do not leak into the second
+  EXPECT_EQ(2, curlCallCounter.easyReset);
+  EXPECT_EQ(curlPerformData[0].CURLOPT_HEADER, curlPerformData[1].CURLOPT_HEADER);
+
+  //Cleanup after test
+  free(fakeSession.device_guid);
+  free(fakeSession.product_guid);
+  free(fakeSession.token);
+}
+
+TEST_F(GausClient, busy_handle_falls_back_to_temporary_handle) {
+  gaus_client_t *client = NULL;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_init(&client));
+
+  CURLM *firstMulti = NULL;
+  CURLM *secondMulti = NULL;
+  CURL *first = gaus_client_acquire_handle(client, &firstMulti);
+  CURL *second = gaus_client_acquire_handle(client, &secondMulti);
+  EXPECT_EQ(client->curl, first);
+  EXPECT_EQ(client->curl_multi, firstMulti);
+  EXPECT_NE(first, second);
+  EXPECT_NE(firstMulti, secondMulti);
+  EXPECT_EQ(2, curlCallCounter.easyInit);
+
+  gaus_client_release_handle(client, second, secondMulti);
+  EXPECT_EQ(1, curlCallCounter.easyCleanup);
+  EXPECT_EQ(1, curlCallCounter.multiCleanup);
+  gaus_client_release_handle(client, first, firstMulti);
+  EXPECT_EQ(1, curlCallCounter.easyCleanup);
+  EXPECT_EQ(1, curlCallCounter.multiCleanup);
+
+  //Shared handle is available again once released
+  EXPECT_EQ(client->curl, gaus_client_acquire_handle(client, &firstMulti));
+  gaus_client_release_handle(client, client->curl, firstMulti);
+
+  gaus_client_cleanup(client);
+  EXPECT_EQ(2, curlCallCounter.easyCleanup);
+}
+
+static gaus_error_t *reportStatus(gaus_session_t *session) {
+  gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+  gaus_report_t report = {};
+  report.report_type = GAUS_REPORT_UPDATE;
+  report.report.update_status.type = const_cast<char *>("Status");
+  report.report.update_status.ts = const_cast<char *>("FAKE_TIME");
+  return gaus_report(session, 0, NULL, &header, 1, &report);
+}
+
+TEST_F(GausClient, steady_state_report_builds_no_headers) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_global_init("fakeServerUrl", NULL);
+  //Keep the mock's own bookkeeping from allocating while counting
+  curlPerformData.reserve(8);
+  curlPerformHandles.reserve(8);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), reportStatus(&fakeSession));
+  EXPECT_EQ(3, curlCallCounter.slistAppend);
+
+  curlCallCounter.slistAppend = 0;
+  allocCounterStart();
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), reportStatus(&fakeSession));
+  AllocStats steady = allocCounterStop();
+  allocCounterStart();
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), reportStatus(&fakeSession));
+  AllocStats steadyAgain = allocCounterStop();
+  EXPECT_EQ(0, curlCallCounter.slistAppend);
+
+  //A new token from gaus_authenticate gets its own headers
+  fakeSession.token = const_cast<char *>("newFakeToken");
+  allocCounterStart();
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), reportStatus(&fakeSession));
+  AllocStats rebuilt = allocCounterStop();
+  EXPECT_EQ(3, curlCallCounter.slistAppend);
+  ASSERT_EQ(4, curlPerformData.size());
+  EXPECT_NE(curlPerformData[3].CURLOPT_HEADER.end(),
+            std::find(curlPerformData[3].CURLOPT_HEADER.begin(), curlPerformData[3].CURLOPT_HEADER.end(),
+                      "Authorization: Bearer newFakeToken"));
+
+  if (allocCounterAvailable()) {
+    EXPECT_EQ(steady.allocations, steadyAgain.allocations);
+    //The token copy, the Authorization header and the three list nodes
+    EXPECT_LE(steady.allocations + 5, rebuilt.allocations);
+  }
+}
+
+TEST_F(GausClient, headers_are_sent_only_where_needed) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  gaus_global_init("fakeServerUrl", NULL);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), reportStatus(&fakeSession));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates));
+
+  ASSERT_EQ(2, curlPerformData.size());
+  std::vector<std::string> postHeaders = curlPerformData[0].CURLOPT_HEADER;
+  std::vector<std::string> getHeaders = curlPerformData[1].CURLOPT_HEADER;
+  EXPECT_NE(postHeaders.end(), std::find(postHeaders.begin(), postHeaders.end(), "Content-Type: application/json"));
+  EXPECT_EQ(getHeaders.end(), std::find(getHeaders.begin(), getHeaders.end(), "Content-Type: application/json"));
+  EXPECT_NE(getHeaders.end(), std::find(getHeaders.begin(), getHeaders.end(), "Authorization: Bearer fakeToken"));
+  //Both requests share one list
+  EXPECT_EQ(3, curlCallCounter.slistAppend);
+}
@@ -0,0 +1,309 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+#include "local_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#define AUTHENTICATE_REPLY(token) \
+  "{\"deviceGUID\": \"FAKEDEVICEGUID\", \"productGUID\": \"FAKEPRODUCTGUID\", \"token\": \"" token "\"}"
+
+class GausContext : public ::testing::Test {
+protected:
+  gaus_context_t *context = NULL;
+  gaus_session_t session = {NULL, NULL, NULL};
+  gaus_initialization_options_t options = {};
+  gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+  gaus_report_t report = {};
+
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    setFakeResponse();
+    report.report_type = GAUS_REPORT_UPDATE;
+    report.report.update_status.type = const_cast<char *>("Status");
+    report.report.update_status.ts = const_cast<char *>("FAKE_TIME");
+  }
+
+  virtual void TearDown() {
+    free(session.device_guid);
+    free(session.product_guid);
+    free(session.token);
+    gaus_context_free(context);
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+
+  static void setFakeResponse() {
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+  }
+
+  static CurlFailure replyWith(long statusCode, const char *body = NULL) {
+    CurlFailure reply;
+    reply.statusCode = statusCode;
+    reply.body = body;
+    return reply;
+  }
+
+  //Initialize with "fakeServerUrl" and create context for "otherServerUrl" with options
+  void createContext() {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", NULL));
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_context_create("otherServerUrl", &options, &context));
+  }
+
+  void authenticate(gaus_context_t *with) {
+    fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("OLDTOKEN")));
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+              gaus_context_authenticate(with, "fakeDeviceAccess", "fakeDeviceSecret", &session, NULL));
+    resetCurlMockHistory();
+    setFakeResponse();
+  }
+
+  gaus_error_t *checkForUpdates(gaus_context_t *with) {
+    unsigned int updateCount = 0;
+    gaus_update_t *updates = NULL;
+    return gaus_context_check_for_updates(with, &session, NULL, &updateCount, &updates, NULL);
+  }
+
+  static bool sentHeader(const CurlOptionsData &transfer, const std::string &header) {
+    const std::vector<std::string> &headers = transfer.CURLOPT_HEADER;
+    return std::find(headers.begin(), headers.end(), header) != headers.end();
+  }
+
+  static void expectError(gaus_error_type_t type, gaus_error_t *status) {
+    ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+    EXPECT_EQ(type, status->error_type);
+    gaus_error_release(status);
+  }
+};
+
+TEST_F(GausContext, cannot_be_created_without_init) {
+  expectError(GAUS_NO_INIT_ERROR, gaus_context_create("otherServerUrl", NULL, &context));
+  EXPECT_EQ(static_cast<gaus_context_t *>(NULL), context);
+}
+
+TEST_F(GausContext, cannot_be_created_without_url) {
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", NULL));
+  expectError(GAUS_UNKNOWN_ERROR, gaus_context_create(NULL, NULL, &context));
+}
+
+TEST_F(GausContext, calls_its_own_server) {
+  createContext();
+  char *deviceAccess = NULL;
+  char *deviceSecret = NULL;
+  unsigned int pollInterval = 0;
+  free(fakeResponse);
+  fakeResponse = strdup("{\"deviceAuthParameters\": {\"accessKey\": \"A\", \"secretKey\": \"S\"},"
+                        " \"pollIntervalSeconds\": 60}");
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_context_register(context, "fakeProductAccess", "fakeProductSecret", "fakeDeviceId", &deviceAccess,
+                                  &deviceSecret, &pollInterval, NULL));
+  free(deviceAccess);
+  free(deviceSecret);
+  deviceAccess = deviceSecret = NULL;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_register("fakeProductAccess", "fakeProductSecret", "fakeDeviceId", &deviceAccess, &deviceSecret,
+                          &pollInterval));
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ("otherServerUrl/register", curlPerformData[0].CURLOPT_URL);
+  EXPECT_EQ("fakeServerUrl/register", curlPerformData[1].CURLOPT_URL);
+  free(deviceAccess);
+  free(deviceSecret);
+}
+
+TEST_F(GausContext, without_context_calls_the_global_server) {
+  createContext();
+  authenticate(NULL);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(NULL));
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ("fakeServerUrl/device/FAKEPRODUCTGUID/FAKEDEVICEGUID/check-for-updates", curlPerformData[0].CURLOPT_URL);
+}
+
+TEST_F(GausContext, uses_its_own_proxy) {
+  options.proxy = "contextProxy";
+  createContext();
+  authenticate(context);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(context));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(NULL));
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ("otherServerUrl/device/FAKEPRODUCTGUID/FAKEDEVICEGUID/check-for-updates", curlPerformData[0].CURLOPT_URL);
+  EXPECT_EQ("contextProxy", curlPerformData[0].CURLOPT_PROXY);
+  EXPECT_EQ(MOCK_NOT_SET, curlPerformData[1].CURLOPT_PROXY);
+}
+
+TEST_F(GausContext, reports_in_its_own_format) {
+  options.report_format = GAUS_REPORT_FORMAT_CBOR;
+  createContext();
+  authenticate(context);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_context_report(context, &session, NULL, &header, 1, &report, NULL));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&session, 0, NULL, &header, 1, &report));
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ("otherServerUrl/device/FAKEPRODUCTGUID/FAKEDEVICEGUID/report", curlPerformData[0].CURLOPT_URL);
+  EXPECT_TRUE(sentHeader(curlPerformData[0], "Content-Type: application/cbor"));
+  EXPECT_FALSE(sentHeader(curlPerformData[1], "Content-Type: application/cbor"));
+}
+
+TEST_F(GausContext, uses_its_own_call_options) {
+  options.call_options.timeout_ms = 5000;
+  createContext();
+  authenticate(context);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(context));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(NULL));
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_GT(curlPerformData[0].CURLOPT_TIMEOUT_MS, 0);
+  EXPECT_LE(curlPerformData[0].CURLOPT_TIMEOUT_MS, 5000);
+  EXPECT_EQ(MOCK_NOT_SET_LONG, curlPerformData[1].CURLOPT_TIMEOUT_MS);
+}
+
+TEST_F(GausContext, renews_a_session_with_its_own_server) {
+  createContext();
+  authenticate(context);
+  fakeFailures.push_back(replyWith(401));
+  fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("NEWTOKEN")));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(context));
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ("otherServerUrl/authenticate", curlPerformData[1].CURLOPT_URL);
+  EXPECT_TRUE(sentHeader(curlPerformData[2], "Authorization: Bearer NEWTOKEN"));
+}
+
+TEST_F(GausContext, free_ignores_null) {
+  gaus_context_free(NULL);
+}
+
+#define THREADS 8
+#define CALLS 25
+
+//Threads calling at once through real curl, against a server on the loopback interface
+class GausContextThreads : public ::testing::Test {
+protected:
+  LocalServer server;
+
+  virtual void SetUp() {
+    ASSERT_TRUE(server.listening());
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init(server.url().c_str(), NULL));
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+  }
+
+  static bool succeeded(gaus_error_t *status) {
+    if (status) {
+      ADD_FAILURE() << status->description;
+      gaus_error_release(status);
+      return false;
+    }
+    return true;
+  }
+
+  //Register and authenticate a device, then check for updates and report CALLS times, counting the calls that fail
+  static void device(gaus_context_t *context, gaus_session_t *session, int index, std::atomic<int> *failures) {
+    gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+    gaus_report_t report = {};
+    report.report_type = GAUS_REPORT_UPDATE;
+    report.report.update_status.type = const_cast<char *>("Status");
+    report.report.update_status.ts = const_cast<char *>("FAKE_TIME");
+    gaus_session_t own = {NULL, NULL, NULL};
+    char *deviceAccess = NULL;
+    char *deviceSecret = NULL;
+    unsigned int pollInterval = 0;
+    std::string deviceId = "device-" + std::to_string(index);
+
+    if (!session) {
+      session = &own;
+      if (!succeeded(gaus_context_register(context, "access", "secret", deviceId.c_str(), &deviceAccess,
+                                           &deviceSecret, &pollInterval, NULL))
+          || !succeeded(gaus_context_authenticate(context, deviceAccess, deviceSecret, session, NULL))) {
+        (*failures)++;
+        goto out;
+      }
+    }
+    for (int i = 0; i < CALLS; i++) {
+      unsigned int updateCount = 0;
+      gaus_update_t *updates = NULL;
+      if (!succeeded(gaus_context_check_for_updates(context, session, NULL, &updateCount, &updates, NULL))
+          || !succeeded(gaus_context_report(context, session, NULL, &header, 1, &report, NULL))) {
+        (*failures)++;
+      }
+    }
+
+    out:
+    free(deviceAccess);
+    free(deviceSecret);
+    free(own.device_guid);
+    free(own.product_guid);
+    free(own.token);
+  }
+};
+
+TEST_F(GausContextThreads, threads_with_their_own_contexts) {
+  gaus_context_t *contexts[THREADS] = {};
+  std::vector<std::thread> threads;
+  std::atomic<int> failures(0);
+
+  for (int i = 0; i < THREADS; i++) {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_context_create(server.url().c_str(), NULL, &contexts[i]));
+  }
+  for (int i = 0; i < THREADS; i++) {
+    threads.emplace_back(device, contexts[i], static_cast<gaus_session_t *>(NULL), i, &failures);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < THREADS; i++) {
+    gaus_context_free(contexts[i]);
+  }
+
+  EXPECT_EQ(0, failures);
+  EXPECT_EQ(THREADS * (2 + 2 * CALLS), server.requestCount());
+  //Each context keeps its connection alive
+  EXPECT_EQ(THREADS, server.connectionCount());
+}
+
+TEST_F(GausContextThreads, threads_sharing_the_global_context_and_a_session) {
+  gaus_session_t session = {NULL, NULL, NULL};
+  std::vector<std::thread> threads;
+  std::atomic<int> failures(0);
+  char *deviceAccess = NULL;
+  char *deviceSecret = NULL;
+  unsigned int pollInterval = 0;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_register("access", "secret", "shared", &deviceAccess, &deviceSecret, &pollInterval));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_authenticate(deviceAccess, deviceSecret, &session));
+  for (int i = 0; i < THREADS; i++) {
+    threads.emplace_back(device, static_cast<gaus_context_t *>(NULL), &session, i, &failures);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(0, failures);
+  EXPECT_EQ(2 + THREADS * 2 * CALLS, server.requestCount());
+  free(deviceAccess);
+  free(deviceSecret);
+  free(session.device_guid);
+  free(session.product_guid);
+  free(session.token);
+}
@@ -8,7 +8,9 @@
 //
 //THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "curl_mock.h"
+#include <algorithm>
 #include <cstring>
+#include <thread>
 
 //Allow backing up original functions to so we can restore them
 bool mocks_setup = false;
@@ -17,14 +19,34 @@ curl_easy_init_t *original_curl_easy_init;
 curl_easy_perform_t *original_curl_easy_perform;
 curl_easy_setopt_t *original_curl_easy_setopt;
 curl_easy_cleanup_t *original_curl_easy_cleanup;
+curl_easy_reset_t *original_curl_easy_reset;
 curl_global_cleanup_t *original_curl_global_cleanup;
 curl_easy_getinfo_t *original_curl_easy_getinfo;
+curl_easy_pause_t *original_curl_easy_pause;
+curl_slist_append_t *original_curl_slist_append;
+curl_multi_init_t *original_curl_multi_init;
+curl_multi_add_handle_t *original_curl_multi_add_handle;
+curl_multi_remove_handle_t *original_curl_multi_remove_handle;
+curl_multi_perform_t *original_curl_multi_perform;
+curl_multi_wait_t *original_curl_multi_wait;
+curl_multi_info_read_t *original_curl_multi_info_read;
+curl_multi_cleanup_t *original_curl_multi_cleanup;
 
 //Storage for curl mocking
 std::map<CURL *, CurlMockData> allCurlData;
 std::vector<CurlOptionsData> curlPerformData;
+std::vector<CURL *> curlPerformHandles;
 CurlCallCounter curlCallCounter;
+std::map<CURLM *, CurlMultiMockData> allCurlMultiData;
+size_t curlMultiMaxInFlight = 0;
 char *fakeResponse = strdup("{}");
+size_t fakeResponseChunkSize = 0;
+long fakeStatusCode = 200;
+std::vector<std::string> fakeResponseHeaders;
+CurlTransferInfo fakeTransferInfo;
+long fakeResponseDelayMs = 0;
+std::deque<CurlFailure> fakeFailures;
+std::string fakePrimaryIp = "192.0.2.1";
 
 //** Curl mock functions
 CURLcode mock_curl_global_init(long flags) {
@@ -33,6 +55,7 @@ CURLcode mock_curl_global_init(long flags) {
 }
 
 CURL *mock_curl_easy_init(void) {
+  curlCallCounter.easyInit++;
   //Allocate a string and use its address to track this curl
   CURL *curl = static_cast<CURL *>(strdup("fakeHandle"));
   CurlMockData emptyData;
@@ -40,13 +63,116 @@ CURL *mock_curl_easy_init(void) {
   return curl;
 }
 
-CURLcode mock_curl_easy_perform(CURL *curl) {
-  curlPerformData.push_back(allCurlData[curl].setOptions);
-  write_function_t writeFunction = allCurlData[curl].setOptions.CURLOPT_WRITEFUNCTION;
-  if (writeFunction) {
-    void *writeData = allCurlData[curl].setOptions.CURLOPT_WRITEDATA;
-    (*writeFunction)(fakeResponse, sizeof(char), strlen(fakeResponse), writeData);
+//Write the status line and fakeResponseHeaders to the header function, like curl does before the body
+static void writeHeaders(CURL *curl) {
+  CurlOptionsData &options = allCurlData[curl].setOptions;
+  const CurlFailure &reply = allCurlData[curl].reply;
+  if (!options.CURLOPT_HEADERFUNCTION) {
+    return;
+  }
+  std::vector<std::string> lines;
+  lines.push_back("HTTP/1.1 " + std::to_string(reply.statusCode) + " \r\n");
+  for (const std::string &header : fakeResponseHeaders) {
+    lines.push_back(header + "\r\n");
+  }
+  for (const std::string &header : reply.headers) {
+    lines.push_back(header + "\r\n");
+  }
+  lines.push_back("\r\n");
+  for (std::string &line : lines) {
+    (*options.CURLOPT_HEADERFUNCTION)(&line[0], sizeof(char), line.size(), options.CURLOPT_HEADERDATA);
+  }
+}
+
+//Record the start of a transfer on curl
+static void startTransfer(CURL *curl) {
+  CurlOptionsData &options = allCurlData[curl].setOptions;
+  //Without a size curl takes the body to be null terminated
+  if (options.postFieldsPointer) {
+    options.CURLOPT_POSTFIELDS = options.postFieldsPointer;
+    options.postFieldsPointer = nullptr;
+  }
+  curlPerformData.push_back(options);
+  curlPerformHandles.push_back(curl);
+  allCurlData[curl].performCount++;
+  allCurlData[curl].responseOffset = 0;
+  allCurlData[curl].paused = false;
+  allCurlData[curl].startTime = std::chrono::steady_clock::now();
+  allCurlData[curl].reply = CurlFailure();
+  allCurlData[curl].reply.statusCode = fakeStatusCode;
+  if (!fakeFailures.empty()) {
+    allCurlData[curl].reply = fakeFailures.front();
+    fakeFailures.pop_front();
+  }
+  allCurlData[curl].replied = fakeResponseDelayMs <= 0 && allCurlData[curl].reply.result == CURLE_OK;
+  if (allCurlData[curl].replied) {
+    writeHeaders(curl);
+  }
+}
+
+/* Let the server take fakeResponseDelayMs to reply, returns false while still waiting for it.
+ *
+ * Like curl, the progress callback is called while waiting and the transfer fails with result once it was aborted by
+ * that callback or ran out of CURLOPT_TIMEOUT_MS.
+ */
+static bool awaitReply(CURL *curl, CURLcode *result) {
+  CurlMockData &data = allCurlData[curl];
+  CurlOptionsData &options = data.setOptions;
+  if (data.replied) {
+    return true;
+  }
+  if (data.reply.result != CURLE_OK) {
+    *result = data.reply.result;
+    return true;
+  }
+  if (options.CURLOPT_XFERINFOFUNCTION && options.CURLOPT_NOPROGRESS == 0
+      && (*options.CURLOPT_XFERINFOFUNCTION)(options.CURLOPT_XFERINFODATA, 0, 0, 0, 0) != 0) {
+    *result = CURLE_ABORTED_BY_CALLBACK;
+    return true;
+  }
+  long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - data.startTime).count();
+  if (elapsed >= fakeResponseDelayMs) {
+    data.replied = true;
+    writeHeaders(curl);
+    return true;
+  }
+  if (options.CURLOPT_TIMEOUT_MS > 0 && elapsed >= options.CURLOPT_TIMEOUT_MS) {
+    *result = CURLE_OPERATION_TIMEDOUT;
+    return true;
+  }
+  return false;
+}
+
+//Write the body of the reply to the write function, returns true once all of it was accepted
+static bool writeResponse(CURL *curl) {
+  CurlMockData &data = allCurlData[curl];
+  write_function_t writeFunction = data.setOptions.CURLOPT_WRITEFUNCTION;
+  const char *response = data.reply.body ? data.reply.body : fakeResponse;
+  size_t length = strlen(response);
+
+  while (!data.paused && data.responseOffset < length) {
+    size_t chunk = length - data.responseOffset;
+    if (fakeResponseChunkSize > 0 && chunk > fakeResponseChunkSize) {
+      chunk = fakeResponseChunkSize;
+    }
+    if (writeFunction) {
+      void *writeData = data.setOptions.CURLOPT_WRITEDATA;
+      if ((*writeFunction)(const_cast<char *>(response) + data.responseOffset, sizeof(char), chunk, writeData) ==
+          CURL_WRITEFUNC_PAUSE) {
+        //Like curl, hold on to the chunk and write it again once unpaused
+        data.paused = true;
+        break;
+      }
+    }
+    data.responseOffset += chunk;
   }
+  return data.responseOffset >= length;
+}
+
+CURLcode mock_curl_easy_perform(CURL *curl) {
+  startTransfer(curl);
+  writeResponse(curl);
   //Always return ok
   return CURLE_OK;
 }
@@ -61,7 +187,13 @@ CURLcode mock_curl_easy_setopt(CURL *curl, CURLoption option, ...) {
       allCurlData[curl].setOptions.CURLOPT_URL = va_arg(valist, char*);
       break;
     case CURLOPT_POSTFIELDS:
-      allCurlData[curl].setOptions.CURLOPT_POSTFIELDS = va_arg(valist, char*);
+      //Copied once the size is known, the body need not be null terminated
+      allCurlData[curl].setOptions.postFieldsPointer = va_arg(valist, char*);
+      break;
+    case CURLOPT_POSTFIELDSIZE:
+      allCurlData[curl].setOptions.CURLOPT_POSTFIELDS.assign(allCurlData[curl].setOptions.postFieldsPointer,
+                                                             va_arg(valist, long));
+      allCurlData[curl].setOptions.postFieldsPointer = nullptr;
       break;
     case CURLOPT_WRITEFUNCTION:
       allCurlData[curl].setOptions.CURLOPT_WRITEFUNCTION = va_arg(valist, write_function_t);
@@ -69,14 +201,45 @@ CURLcode mock_curl_easy_setopt(CURL *curl, CURLoption option, ...) {
     case CURLOPT_WRITEDATA:
       allCurlData[curl].setOptions.CURLOPT_WRITEDATA = va_arg(valist, void*);
       break;
+    case CURLOPT_HEADERFUNCTION:
+      allCurlData[curl].setOptions.CURLOPT_HEADERFUNCTION = va_arg(valist, write_function_t);
+      break;
+    case CURLOPT_HEADERDATA:
+      allCurlData[curl].setOptions.CURLOPT_HEADERDATA = va_arg(valist, void*);
+      break;
     case CURLOPT_PROXY:
       allCurlData[curl].setOptions.CURLOPT_PROXY = va_arg(valist, char*);
       break;
     case CURLOPT_HTTPGET:
       allCurlData[curl].setOptions.CURLOPT_HTTPGET = va_arg(valist, long);
       break;
+    case CURLOPT_CONNECTTIMEOUT_MS:
+      allCurlData[curl].setOptions.CURLOPT_CONNECTTIMEOUT_MS = va_arg(valist, long);
+      break;
+    case CURLOPT_TIMEOUT_MS:
+      allCurlData[curl].setOptions.CURLOPT_TIMEOUT_MS = va_arg(valist, long);
+      break;
+    case CURLOPT_NOPROGRESS:
+      allCurlData[curl].setOptions.CURLOPT_NOPROGRESS = va_arg(valist, long);
+      break;
+    case CURLOPT_XFERINFOFUNCTION:
+      allCurlData[curl].setOptions.CURLOPT_XFERINFOFUNCTION = va_arg(valist, curl_xferinfo_callback);
+      break;
+    case CURLOPT_XFERINFODATA:
+      allCurlData[curl].setOptions.CURLOPT_XFERINFODATA = va_arg(valist, void*);
+      break;
+    case CURLOPT_RESOLVE:
+      allCurlData[curl].setOptions.CURLOPT_RESOLVE.clear();
+      for (current = va_arg(valist, curl_slist*); current; current = current->next) {
+        allCurlData[curl].setOptions.CURLOPT_RESOLVE.push_back(current->data);
+      }
+      break;
+    case CURLOPT_CONNECT_ONLY:
+      allCurlData[curl].setOptions.CURLOPT_CONNECT_ONLY = va_arg(valist, long);
+      break;
     case CURLOPT_HTTPHEADER:
-      //Loop over options in list and add them to vector for easier testing
+      //Loop over options in list and add them to vector for easier testing, replacing any previous list
+      allCurlData[curl].setOptions.CURLOPT_HEADER.clear();
       current = va_arg(valist, curl_slist*);
       while (current) {
         std::string temp(current->data);
@@ -93,23 +256,68 @@ CURLcode mock_curl_easy_setopt(CURL *curl, CURLoption option, ...) {
 }
 
 void mock_curl_easy_cleanup(CURL *curl) {
+  curlCallCounter.easyCleanup++;
   allCurlData.erase(curl);
   free(curl); //Cleanup our fakeHandle string
 }
 
+void mock_curl_easy_reset(CURL *curl) {
+  curlCallCounter.easyReset++;
+  //Forget all options set on this handle, just like curl_easy_reset
+  allCurlData[curl].setOptions = CurlOptionsData();
+}
+
 void mock_curl_global_cleanup(void) {
   curlCallCounter.globalCleanup++;
 }
 
 CURLcode mock_curl_easy_getinfo(CURL *curl, CURLINFO info, ...) {
   long *code;
+  curl_off_t *value;
+  char **string;
   va_list valist;
   va_start(valist, info);
   switch (info) {
     case CURLINFO_RESPONSE_CODE:
-      //Always return 200 for last status
       code = va_arg(valist, long*);
-      *code = 200;
+      *code = allCurlData[curl].replied ? allCurlData[curl].reply.statusCode : 0;
+      break;
+    case CURLINFO_PRIMARY_IP:
+      string = va_arg(valist, char**);
+      *string = const_cast<char *>(allCurlData[curl].replied ? fakePrimaryIp.c_str() : "");
+      break;
+    case CURLINFO_NUM_CONNECTS:
+      //Only the first transfer on a handle needs to connect, later ones reuse the connection
+      code = va_arg(valist, long*);
+      *code = allCurlData[curl].performCount == 1 ? 1 : 0;
+      break;
+    case CURLINFO_NAMELOOKUP_TIME_T:
+      value = va_arg(valist, curl_off_t*);
+      *value = fakeTransferInfo.nameLookupTime;
+      break;
+    case CURLINFO_CONNECT_TIME_T:
+      value = va_arg(valist, curl_off_t*);
+      *value = fakeTransferInfo.connectTime;
+      break;
+    case CURLINFO_APPCONNECT_TIME_T:
+      value = va_arg(valist, curl_off_t*);
+      *value = fakeTransferInfo.appConnectTime;
+      break;
+    case CURLINFO_STARTTRANSFER_TIME_T:
+      value = va_arg(valist, curl_off_t*);
+      *value = fakeTransferInfo.startTransferTime;
+      break;
+    case CURLINFO_TOTAL_TIME_T:
+      value = va_arg(valist, curl_off_t*);
+      *value = fakeTransferInfo.totalTime;
+      break;
+    case CURLINFO_SIZE_UPLOAD_T:
+      value = va_arg(valist, curl_off_t*);
+      *value = fakeTransferInfo.sizeUpload;
+      break;
+    case CURLINFO_SIZE_DOWNLOAD_T:
+      value = va_arg(valist, curl_off_t*);
+      *value = fakeTransferInfo.sizeDownload;
       break;
     default:
       //doNothing unless this is a param we need to handle
@@ -119,6 +327,111 @@ CURLcode mock_curl_easy_getinfo(CURL *curl, CURLINFO info, ...) {
   return CURLE_OK;
 }
 
+CURLcode mock_curl_easy_pause(CURL *curl, int bitmask) {
+  if (bitmask == CURLPAUSE_CONT && allCurlData[curl].paused) {
+    //Like curl, write the held back chunk right away
+    allCurlData[curl].paused = false;
+    writeResponse(curl);
+  }
+  return CURLE_OK;
+}
+
+struct curl_slist *mock_curl_slist_append(struct curl_slist *list, const char *string) {
+  curlCallCounter.slistAppend++;
+  //Build a real list, it is handed to curl_slist_free_all by libgaus
+  return original_curl_slist_append(list, string);
+}
+
+CURLM *mock_curl_multi_init(void) {
+  curlCallCounter.multiInit++;
+  //Allocate a string and use its address to track this multi
+  CURLM *multi = static_cast<CURLM *>(strdup("fakeMultiHandle"));
+  allCurlMultiData.emplace(multi, CurlMultiMockData());
+  return multi;
+}
+
+CURLMcode mock_curl_multi_add_handle(CURLM *multi, CURL *curl) {
+  allCurlData[curl].transferStarted = false;
+  allCurlMultiData[multi].handles.push_back(curl);
+  curlMultiMaxInFlight = std::max(curlMultiMaxInFlight, allCurlMultiData[multi].handles.size());
+  return CURLM_OK;
+}
+
+CURLMcode mock_curl_multi_remove_handle(CURLM *multi, CURL *curl) {
+  std::vector<CURL *> &handles = allCurlMultiData[multi].handles;
+  for (auto it = handles.begin(); it != handles.end(); ++it) {
+    if (*it == curl) {
+      handles.erase(it);
+      break;
+    }
+  }
+  return CURLM_OK;
+}
+
+CURLMcode mock_curl_multi_perform(CURLM *multi, int *running_handles) {
+  curlCallCounter.multiPerform++;
+  //Transfers complete as soon as their whole response is written, just as if the server replied immediately
+  CurlMultiMockData &data = allCurlMultiData[multi];
+  for (auto it = data.handles.begin(); it != data.handles.end();) {
+    CURL *curl = *it;
+    CURLMsg message = {};
+    message.msg = CURLMSG_DONE;
+    message.easy_handle = curl;
+    if (gaus_curl_easy_perform != mock_curl_easy_perform) {
+      //A test replaced the blocking perform, let it run the whole transfer
+      message.data.result = gaus_curl_easy_perform(curl);
+    } else {
+      if (!allCurlData[curl].transferStarted) {
+        allCurlData[curl].transferStarted = true;
+        startTransfer(curl);
+      }
+      CURLcode result = CURLE_OK;
+      if (!awaitReply(curl, &result) || (result == CURLE_OK && !writeResponse(curl))) {
+        ++it;
+        continue;
+      }
+      message.data.result = result;
+    }
+    data.messages.push_back(message);
+    it = data.handles.erase(it);
+  }
+  *running_handles = data.handles.size();
+  return CURLM_OK;
+}
+
+CURLMcode mock_curl_multi_wait(CURLM *multi, struct curl_waitfd extra_fds[], unsigned int extra_nfds, int timeout_ms,
+                               int *numfds) {
+  //Transfers complete in mock_curl_multi_perform, only a delayed reply is worth waiting for
+  for (CURL *curl : allCurlMultiData[multi].handles) {
+    if (allCurlData[curl].transferStarted && !allCurlData[curl].replied) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout_ms, 1)));
+      break;
+    }
+  }
+  if (numfds) {
+    *numfds = 0;
+  }
+  return CURLM_OK;
+}
+
+CURLMsg *mock_curl_multi_info_read(CURLM *multi, int *msgs_in_queue) {
+  CurlMultiMockData &data = allCurlMultiData[multi];
+  if (data.messages.empty()) {
+    *msgs_in_queue = 0;
+    return NULL;
+  }
+  data.lastMessage = data.messages.front();
+  data.messages.pop_front();
+  *msgs_in_queue = data.messages.size();
+  return &data.lastMessage;
+}
+
+CURLMcode mock_curl_multi_cleanup(CURLM *multi) {
+  curlCallCounter.multiCleanup++;
+  allCurlMultiData.erase(multi);
+  free(multi); //Cleanup our fakeMultiHandle string
+  return CURLM_OK;
+}
 
 //Mock setup/teardown functions:
 void setupMocks() {
@@ -129,8 +442,18 @@ void setupMocks() {
     original_curl_easy_perform = gaus_curl_easy_perform;
     original_curl_easy_setopt = gaus_curl_easy_setopt;
     original_curl_easy_cleanup = gaus_curl_easy_cleanup;
+    original_curl_easy_reset = gaus_curl_easy_reset;
     original_curl_global_cleanup = gaus_curl_global_cleanup;
     original_curl_easy_getinfo = gaus_curl_easy_getinfo;
+    original_curl_easy_pause = gaus_curl_easy_pause;
+    original_curl_slist_append = gaus_curl_slist_append;
+    original_curl_multi_init = gaus_curl_multi_init;
+    original_curl_multi_add_handle = gaus_curl_multi_add_handle;
+    original_curl_multi_remove_handle = gaus_curl_multi_remove_handle;
+    original_curl_multi_perform = gaus_curl_multi_perform;
+    original_curl_multi_wait = gaus_curl_multi_wait;
+    original_curl_multi_info_read = gaus_curl_multi_info_read;
+    original_curl_multi_cleanup = gaus_curl_multi_cleanup;
 
     //Setup our "mocks"
     gaus_curl_global_init = mock_curl_global_init;
@@ -138,8 +461,18 @@ void setupMocks() {
     gaus_curl_easy_perform = mock_curl_easy_perform;
     gaus_curl_easy_setopt = mock_curl_easy_setopt;
     gaus_curl_easy_cleanup = mock_curl_easy_cleanup;
+    gaus_curl_easy_reset = mock_curl_easy_reset;
     gaus_curl_global_cleanup = mock_curl_global_cleanup;
     gaus_curl_easy_getinfo = mock_curl_easy_getinfo;
+    gaus_curl_easy_pause = mock_curl_easy_pause;
+    gaus_curl_slist_append = mock_curl_slist_append;
+    gaus_curl_multi_init = mock_curl_multi_init;
+    gaus_curl_multi_add_handle = mock_curl_multi_add_handle;
+    gaus_curl_multi_remove_handle = mock_curl_multi_remove_handle;
+    gaus_curl_multi_perform = mock_curl_multi_perform;
+    gaus_curl_multi_wait = mock_curl_multi_wait;
+    gaus_curl_multi_info_read = mock_curl_multi_info_read;
+    gaus_curl_multi_cleanup = mock_curl_multi_cleanup;
     mocks_setup = true;
   } else {
     throw "Attempted to setup mocks twice!";
@@ -154,8 +487,18 @@ void cleanupMocks() {
     gaus_curl_easy_perform = original_curl_easy_perform;
     gaus_curl_easy_setopt = original_curl_easy_setopt;
     gaus_curl_easy_cleanup = original_curl_easy_cleanup;
+    gaus_curl_easy_reset = original_curl_easy_reset;
     gaus_curl_global_cleanup = original_curl_global_cleanup;
     gaus_curl_easy_getinfo = original_curl_easy_getinfo;
+    gaus_curl_easy_pause = original_curl_easy_pause;
+    gaus_curl_slist_append = original_curl_slist_append;
+    gaus_curl_multi_init = original_curl_multi_init;
+    gaus_curl_multi_add_handle = original_curl_multi_add_handle;
+    gaus_curl_multi_remove_handle = original_curl_multi_remove_handle;
+    gaus_curl_multi_perform = original_curl_multi_perform;
+    gaus_curl_multi_wait = original_curl_multi_wait;
+    gaus_curl_multi_info_read = original_curl_multi_info_read;
+    gaus_curl_multi_cleanup = original_curl_multi_cleanup;
     mocks_setup = false;
   } else {
     throw "Attempting to restore without having mocked!";
@@ -166,12 +509,29 @@ void cleanupMocks() {
 void resetCurlMockHistory() {
   free(fakeResponse);
   fakeResponse = strdup("{}");
+  fakeResponseChunkSize = 0;
+  fakeStatusCode = 200;
+  fakeResponseHeaders.clear();
+  fakeTransferInfo = CurlTransferInfo();
+  fakeResponseDelayMs = 0;
+  fakeFailures.clear();
+  fakePrimaryIp = "192.0.2.1";
   allCurlData.clear();
+  allCurlMultiData.clear();
   curlPerformData.clear();
+  curlPerformHandles.clear();
+  curlMultiMaxInFlight = 0;
   curlCallCounter.reset();
 }
 
 void CurlCallCounter::reset(void) {
   globalInit = 0;
   globalCleanup = 0;
+  easyInit = 0;
+  easyReset = 0;
+  easyCleanup = 0;
+  slistAppend = 0;
+  multiInit = 0;
+  multiPerform = 0;
+  multiCleanup = 0;
 }
@@ -10,9 +10,12 @@
 #ifndef GAUS_CURL_MOCK_H
 #define GAUS_CURL_MOCK_H
 
+#include <chrono>
 #include <cstdarg>
+#include <deque>
 #include <map>
 #include <iostream>
+#include <string>
 #include <vector>
 
 //Get access to ability to mock curl inside libgaus
@@ -25,11 +28,21 @@ extern curl_easy_init_t *original_curl_easy_init;
 extern curl_easy_perform_t *original_curl_easy_perform;
 extern curl_easy_setopt_t *original_curl_easy_setopt;
 extern curl_easy_cleanup_t *original_curl_easy_cleanup;
+extern curl_easy_reset_t *original_curl_easy_reset;
 extern curl_global_cleanup_t *original_curl_global_cleanup;
 extern curl_easy_getinfo_t *original_curl_easy_getinfo;
+extern curl_easy_pause_t *original_curl_easy_pause;
+extern curl_slist_append_t *original_curl_slist_append;
+extern curl_multi_init_t *original_curl_multi_init;
+extern curl_multi_add_handle_t *original_curl_multi_add_handle;
+extern curl_multi_remove_handle_t *original_curl_multi_remove_handle;
+extern curl_multi_perform_t *original_curl_multi_perform;
+extern curl_multi_wait_t *original_curl_multi_wait;
+extern curl_multi_info_read_t *original_curl_multi_info_read;
+extern curl_multi_cleanup_t *original_curl_multi_cleanup;
 
 //Data structures for mocks:
-typedef void (*write_function_t)(char *ptr, size_t size, size_t nmemb, void *userdata);
+typedef size_t (*write_function_t)(char *ptr, size_t size, size_t nmemb, void *userdata);
 
 #define MOCK_NOT_SET "NOT_SET"
 #define MOCK_NOT_SET_LONG -1L
@@ -38,33 +51,102 @@ class CurlOptionsData {
 public:
   std::string CURLOPT_URL = MOCK_NOT_SET; //If this is set multiple times we overwrite old value
   std::string CURLOPT_POSTFIELDS = MOCK_NOT_SET; //If this is set multiple times we overwrite old value
+  const char *postFieldsPointer = {nullptr}; //Body set by CURLOPT_POSTFIELDS and not yet copied
   void *CURLOPT_WRITEDATA = {nullptr}; //If this is set multiple times we overwrite old value
-  write_function_t CURLOPT_WRITEFUNCTION;
+  write_function_t CURLOPT_WRITEFUNCTION = {nullptr};
+  write_function_t CURLOPT_HEADERFUNCTION = {nullptr};
+  void *CURLOPT_HEADERDATA = {nullptr};
   std::string CURLOPT_PROXY = MOCK_NOT_SET; //If this is set multiple times we overwrite old value
   long CURLOPT_HTTPGET = MOCK_NOT_SET_LONG;
+  long CURLOPT_CONNECTTIMEOUT_MS = MOCK_NOT_SET_LONG;
+  long CURLOPT_TIMEOUT_MS = MOCK_NOT_SET_LONG;
+  long CURLOPT_NOPROGRESS = 1L;
+  curl_xferinfo_callback CURLOPT_XFERINFOFUNCTION = {nullptr};
+  void *CURLOPT_XFERINFODATA = {nullptr};
   std::vector<std::string> CURLOPT_HEADER;
+  std::vector<std::string> CURLOPT_RESOLVE;
+  long CURLOPT_CONNECT_ONLY = MOCK_NOT_SET_LONG;
 };
 
 class CurlCallCounter {
 public:
   int globalInit = {0};
   int globalCleanup = {0};
+  int easyInit = {0};
+  int easyReset = {0};
+  int easyCleanup = {0};
+  int slistAppend = {0};
+  int multiInit = {0};
+  int multiPerform = {0};
+  int multiCleanup = {0};
 
   void reset(void);
 };
 
+//What curl_easy_getinfo reports about every transfer, times in microseconds
+class CurlTransferInfo {
+public:
+  curl_off_t nameLookupTime = {0};
+  curl_off_t connectTime = {0};
+  curl_off_t appConnectTime = {0};
+  curl_off_t startTransferTime = {0};
+  curl_off_t totalTime = {0};
+  curl_off_t sizeUpload = {0};
+  curl_off_t sizeDownload = {0};
+};
+
+//A failure injected into a single transfer, see fakeFailures
+class CurlFailure {
+public:
+  CURLcode result = {CURLE_OK}; //If not CURLE_OK the transfer fails with it, without a reply
+  long statusCode = {200}; //Otherwise the status of the reply
+  std::vector<std::string> headers; //Header lines sent with the reply, on top of fakeResponseHeaders
+  const char *body = {nullptr}; //If set, sent instead of fakeResponse
+};
+
 class CurlMockData {
 public:
   CurlOptionsData setOptions;
+  int performCount = {0}; //Survives curl_easy_reset, like the connection kept by a real handle
+  bool transferStarted = {false}; //Whether the transfer on a multi handle has begun
+  size_t responseOffset = {0}; //How much of fakeResponse was accepted by the write function
+  bool paused = {false}; //Write function returned CURL_WRITEFUNC_PAUSE
+  std::chrono::steady_clock::time_point startTime; //When the transfer began
+  bool replied = {false}; //Whether the server replied yet, see fakeResponseDelayMs
+  CurlFailure reply; //How the server replies to the current transfer
+};
+
+class CurlMultiMockData {
+public:
+  std::vector<CURL *> handles; //Handles added and not yet performed
+  std::deque<CURLMsg> messages; //Finished transfers not yet read
+  CURLMsg lastMessage; //Storage for the message handed out by curl_multi_info_read
 };
 
 //Hold results of curl operations
 extern std::map<CURL *, CurlMockData> allCurlData;
 extern std::vector<CurlOptionsData> curlPerformData;
+extern std::vector<CURL *> curlPerformHandles;
 extern CurlCallCounter curlCallCounter;
+extern std::map<CURLM *, CurlMultiMockData> allCurlMultiData;
+//Most handles that were added to a multi handle at the same time
+extern size_t curlMultiMaxInFlight;
 
 //Used to send a response to the CURLOPT_WRITE_FUNCTION
 extern char *fakeResponse;
+//Split fakeResponse into chunks of this size when writing it, 0 writes it all at once
+extern size_t fakeResponseChunkSize;
+//Status code of every response
+extern long fakeStatusCode;
+//Header lines (without line endings) sent to the CURLOPT_HEADERFUNCTION after the status line of every response
+extern std::vector<std::string> fakeResponseHeaders;
+extern CurlTransferInfo fakeTransferInfo;
+//How long the server takes to reply to a transfer on a multi handle, in milliseconds (real time)
+extern long fakeResponseDelayMs;
+//Address every transfer that got a reply connected to, reported as CURLINFO_PRIMARY_IP
+extern std::string fakePrimaryIp;
+//Replies to the next transfers, one is taken as each transfer starts.  Once empty, transfers get fakeStatusCode.
+extern std::deque<CurlFailure> fakeFailures;
 
 //Mock functions
 CURLcode mock_curl_global_init(long flags);
@@ -77,10 +159,31 @@ CURLcode mock_curl_easy_setopt(CURL *curl, CURLoption option, ...);
 
 void mock_curl_easy_cleanup(CURL *curl);
 
+void mock_curl_easy_reset(CURL *curl);
+
 void mock_curl_global_cleanup(void);
 
 CURLcode mock_curl_easy_getinfo(CURL *curl, CURLINFO info, ...);
 
+CURLcode mock_curl_easy_pause(CURL *curl, int bitmask);
+
+struct curl_slist *mock_curl_slist_append(struct curl_slist *list, const char *string);
+
+CURLM *mock_curl_multi_init(void);
+
+CURLMcode mock_curl_multi_add_handle(CURLM *multi, CURL *curl);
+
+CURLMcode mock_curl_multi_remove_handle(CURLM *multi, CURL *curl);
+
+CURLMcode mock_curl_multi_perform(CURLM *multi, int *running_handles);
+
+CURLMcode mock_curl_multi_wait(CURLM *multi, struct curl_waitfd extra_fds[], unsigned int extra_nfds, int timeout_ms,
+                               int *numfds);
+
+CURLMsg *mock_curl_multi_info_read(CURLM *multi, int *msgs_in_queue);
+
+CURLMcode mock_curl_multi_cleanup(CURLM *multi);
+
 //Setup/Teardown:
 void setupMocks();
 
@@ -0,0 +1,221 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+#include <chrono>
+#include <thread>
+
+class GausDeadline : public ::testing::Test {
+protected:
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    //Setup a default fake response that will work for all tests.
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+    reportResult = NULL;
+    reportDone = false;
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+
+  void init(unsigned long connectTimeoutMs, unsigned long timeoutMs) {
+    gaus_initialization_options_t options = {};
+    options.call_options.connect_timeout_ms = connectTimeoutMs;
+    options.call_options.timeout_ms = timeoutMs;
+    gaus_global_init("fakeServerUrl", &options);
+  }
+
+  gaus_error_t *checkForUpdates(const gaus_call_options_t *options) {
+    unsigned int updateCount = 0;
+    gaus_update_t *updates = NULL;
+    return gaus_check_for_updates_with_options(&fakeSession, NULL, &updateCount, &updates, options);
+  }
+
+  static long millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  static void expectError(gaus_error_type_t type, gaus_error_t *status) {
+    ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+    EXPECT_EQ(type, status->error_type);
+    gaus_error_release(status);
+  }
+
+public:
+  static gaus_error_t *reportResult;
+  static bool reportDone;
+
+  static void reportCallback(gaus_error_t *error, void *user_data) {
+    reportResult = error;
+    reportDone = true;
+  }
+};
+
+gaus_error_t *GausDeadline::reportResult;
+bool GausDeadline::reportDone;
+
+static gaus_report_header_t fakeHeader = {
+    const_cast<char *>("FAKE_TIMESTAMP")
+};
+
+static gaus_report_t fakeReport = {
+    .report = {
+        .update_status = {
+            .type = const_cast<char *>("Status"),
+            .ts = const_cast<char *>("FAKE_TIME"),
+            .v_int_count = 0,
+            .v_ints = NULL,
+            .v_float_count = 0,
+            .v_floats = NULL,
+            .v_string_count = 0,
+            .v_strings = NULL,
+            .tag_count = 0,
+            .tags = NULL
+        }
+    },
+    .report_type = GAUS_REPORT_UPDATE
+};
+
+TEST_F(GausDeadline, leaves_curl_defaults_without_limits) {
+  gaus_global_init("fakeServerUrl", NULL);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(NULL));
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(MOCK_NOT_SET_LONG, curlPerformData[0].CURLOPT_CONNECTTIMEOUT_MS);
+  EXPECT_EQ(MOCK_NOT_SET_LONG, curlPerformData[0].CURLOPT_TIMEOUT_MS);
+  EXPECT_EQ(nullptr, curlPerformData[0].CURLOPT_XFERINFOFUNCTION);
+}
+
+TEST_F(GausDeadline, limits_requests_by_the_init_options) {
+  init(2000, 5000);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(NULL));
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(2000, curlPerformData[0].CURLOPT_CONNECTTIMEOUT_MS);
+  //What is left of the deadline when the request starts
+  EXPECT_GT(curlPerformData[0].CURLOPT_TIMEOUT_MS, 0);
+  EXPECT_LE(curlPerformData[0].CURLOPT_TIMEOUT_MS, 5000);
+  EXPECT_NE(nullptr, curlPerformData[0].CURLOPT_XFERINFOFUNCTION);
+  EXPECT_EQ(0, curlPerformData[0].CURLOPT_NOPROGRESS);
+}
+
+TEST_F(GausDeadline, call_options_replace_the_init_options) {
+  init(2000, 5000);
+  gaus_call_options_t options = {100, 0, NULL};
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(&options));
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(100, curlPerformData[0].CURLOPT_CONNECTTIMEOUT_MS);
+  EXPECT_EQ(MOCK_NOT_SET_LONG, curlPerformData[0].CURLOPT_TIMEOUT_MS);
+}
+
+TEST_F(GausDeadline, waits_for_a_reply_within_the_deadline) {
+  init(0, 2000);
+  fakeResponseDelayMs = 20;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(NULL));
+}
+
+TEST_F(GausDeadline, check_for_updates_times_out) {
+  gaus_global_init("fakeServerUrl", NULL);
+  fakeResponseDelayMs = 5000;
+  gaus_call_options_t options = {0, 50, NULL};
+  auto start = std::chrono::steady_clock::now();
+
+  expectError(GAUS_TIMEOUT_ERROR, checkForUpdates(&options));
+
+  EXPECT_LT(millisecondsSince(start), 1000);
+}
+
+TEST_F(GausDeadline, report_times_out) {
+  init(0, 50);
+  fakeResponseDelayMs = 5000;
+
+  expectError(GAUS_TIMEOUT_ERROR, gaus_report(&fakeSession, 0, NULL, &fakeHeader, 1, &fakeReport));
+}
+
+TEST_F(GausDeadline, register_times_out) {
+  init(0, 50);
+  fakeResponseDelayMs = 5000;
+  char *deviceAccess = NULL;
+  char *deviceSecret = NULL;
+  unsigned int pollInterval = 0;
+
+  expectError(GAUS_TIMEOUT_ERROR, gaus_register("fakeProductAccess", "fakeProductSecret", "fakeDeviceId",
+                                                &deviceAccess, &deviceSecret, &pollInterval));
+}
+
+TEST_F(GausDeadline, authenticate_times_out) {
+  init(0, 50);
+  fakeResponseDelayMs = 5000;
+  gaus_session_t session = {};
+
+  expectError(GAUS_TIMEOUT_ERROR, gaus_authenticate("fakeDeviceAccess", "fakeDeviceSecret", &session));
+}
+
+TEST_F(GausDeadline, async_requests_time_out) {
+  init(0, 50);
+  fakeResponseDelayMs = 5000;
+  auto start = std::chrono::steady_clock::now();
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_report_async(&fakeSession, 0, NULL, &fakeHeader, 1, &fakeReport, reportCallback, NULL));
+  while (!reportDone && millisecondsSince(start) < 1000) {
+    gaus_error_t *status = gaus_client_poll(10, NULL);
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), status);
+  }
+
+  ASSERT_TRUE(reportDone);
+  expectError(GAUS_TIMEOUT_ERROR, reportResult);
+}
+
+TEST_F(GausDeadline, is_cancelled_before_the_request) {
+  gaus_global_init("fakeServerUrl", NULL);
+  gaus_cancel_token_t cancel = {1};
+  gaus_call_options_t options = {0, 0, &cancel};
+
+  expectError(GAUS_CANCELLED_ERROR, checkForUpdates(&options));
+
+  EXPECT_EQ(0, curlPerformData.size());
+}
+
+TEST_F(GausDeadline, is_cancelled_while_waiting_for_the_server) {
+  gaus_global_init("fakeServerUrl", NULL);
+  fakeResponseDelayMs = 5000;
+  gaus_cancel_token_t cancel = {0};
+  gaus_call_options_t options = {0, 0, &cancel};
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread canceller([&cancel]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    cancel.cancelled = 1;
+  });
+  gaus_error_t *status = checkForUpdates(&options);
+  canceller.join();
+
+  expectError(GAUS_CANCELLED_ERROR, status);
+  EXPECT_EQ(1, curlPerformData.size());
+  EXPECT_LT(millisecondsSince(start), 1000);
+}
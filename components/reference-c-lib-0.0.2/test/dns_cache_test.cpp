@@ -0,0 +1,265 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+#include <ctime>
+
+#define SERVER_URL "https://gaus.example.com/api"
+#define UNPIN "-gaus.example.com:443"
+
+//What the store persisted, user_data of the store points at it
+static int store_load(void *user_data, unsigned char *buffer, size_t *length) {
+  std::string *stored = static_cast<std::string *>(user_data);
+  if (stored->empty() || stored->size() > *length) {
+    return -1;
+  }
+  memcpy(buffer, stored->data(), stored->size());
+  *length = stored->size();
+  return 0;
+}
+
+static int store_save(void *user_data, const unsigned char *buffer, size_t length) {
+  static_cast<std::string *>(user_data)->assign(reinterpret_cast<const char *>(buffer), length);
+  return 0;
+}
+
+class GausDnsCache : public ::testing::Test {
+protected:
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  std::string stored;
+  gaus_dns_cache_store_t store = {&stored, store_load, store_save};
+
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    //Setup a default fake response that will work for all tests.
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+
+  void init(const char *serverUrl = SERVER_URL, unsigned long ttl = 0, const char *proxy = NULL) {
+    gaus_initialization_options_t options = {};
+    options.proxy = proxy;
+    options.dns_cache_store = &store;
+    options.dns_ttl_s = ttl;
+    gaus_global_init(serverUrl, &options);
+  }
+
+  //Persist address for the test server, expiring in expiresIn seconds
+  void persist(const char *address, long expiresIn, const char *host = "gaus.example.com") {
+    stored = std::string("gaus-dns-1 ") + host + " 443 " + address + " " + std::to_string(time(NULL) + expiresIn);
+  }
+
+  gaus_error_t *checkForUpdates() {
+    unsigned int updateCount = 0;
+    gaus_update_t *updates = NULL;
+    return gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates);
+  }
+
+  //Poll until the refresh (or anything else) started by the first poll is done
+  void poll() {
+    for (int i = 0; i < 3; i++) {
+      ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, NULL));
+    }
+  }
+
+  static CurlFailure failWith(CURLcode result) {
+    CurlFailure failure;
+    failure.result = result;
+    return failure;
+  }
+
+  static std::vector<std::string> pinnedTo(const std::string &address) {
+    return {UNPIN, "gaus.example.com:443:" + address};
+  }
+};
+
+TEST_F(GausDnsCache, resolves_the_first_time_and_pins_the_address_after) {
+  init();
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(std::vector<std::string>({UNPIN}), curlPerformData[0].CURLOPT_RESOLVE);
+  EXPECT_EQ(pinnedTo("192.0.2.1"), curlPerformData[1].CURLOPT_RESOLVE);
+}
+
+TEST_F(GausDnsCache, uses_the_port_of_the_server) {
+  init("http://gaus.example.com:8080/api");
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(std::vector<std::string>({"-gaus.example.com:8080"}), curlPerformData[0].CURLOPT_RESOLVE);
+  EXPECT_EQ(std::vector<std::string>({"-gaus.example.com:8080", "gaus.example.com:8080:192.0.2.1"}),
+            curlPerformData[1].CURLOPT_RESOLVE);
+}
+
+TEST_F(GausDnsCache, keeps_ipv6_addresses_in_brackets) {
+  init();
+  fakePrimaryIp = "2001:db8::1";
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  EXPECT_EQ(pinnedTo("[2001:db8::1]"), curlPerformData[1].CURLOPT_RESOLVE);
+}
+
+TEST_F(GausDnsCache, leaves_addresses_and_proxies_alone) {
+  init("https://192.0.2.5/api");
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  gaus_global_cleanup();
+  init(SERVER_URL, 0, "http://proxy.example.com:3128");
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  ASSERT_EQ(3, curlPerformData.size());
+  for (const CurlOptionsData &transfer : curlPerformData) {
+    EXPECT_TRUE(transfer.CURLOPT_RESOLVE.empty());
+  }
+  EXPECT_TRUE(stored.empty());
+}
+
+TEST_F(GausDnsCache, persists_the_address_with_its_expiry) {
+  init(SERVER_URL, 600);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  char host[64];
+  char address[64];
+  long port = 0;
+  long long expires = 0;
+  ASSERT_EQ(4, sscanf(stored.c_str(), "gaus-dns-1 %63s %ld %63s %lld", host, &port, address, &expires));
+  EXPECT_STREQ("gaus.example.com", host);
+  EXPECT_EQ(443, port);
+  EXPECT_STREQ("192.0.2.1", address);
+  EXPECT_NEAR(time(NULL) + 600, expires, 2);
+}
+
+TEST_F(GausDnsCache, pins_a_persisted_address_from_the_first_request) {
+  persist("192.0.2.9", 100);
+  init();
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  EXPECT_EQ(pinnedTo("192.0.2.9"), curlPerformData[0].CURLOPT_RESOLVE);
+}
+
+TEST_F(GausDnsCache, ignores_expired_or_foreign_addresses) {
+  persist("192.0.2.9", -1);
+  init();
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  gaus_global_cleanup();
+  persist("192.0.2.9", 100, "other.example.com");
+  init();
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(std::vector<std::string>({UNPIN}), curlPerformData[0].CURLOPT_RESOLVE);
+  EXPECT_EQ(std::vector<std::string>({UNPIN}), curlPerformData[1].CURLOPT_RESOLVE);
+}
+
+TEST_F(GausDnsCache, keeps_the_address_while_resolving_fails) {
+  persist("192.0.2.9", -1);
+  init();
+  fakeFailures.push_back(failWith(CURLE_COULDNT_RESOLVE_HOST));
+
+  gaus_error_t *status = checkForUpdates();
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  gaus_error_release(status);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(pinnedTo("192.0.2.9"), curlPerformData[1].CURLOPT_RESOLVE);
+}
+
+TEST_F(GausDnsCache, falls_back_to_a_cached_address_within_a_retried_call) {
+  persist("192.0.2.9", -1);
+  gaus_initialization_options_t options = {};
+  options.dns_cache_store = &store;
+  options.call_options.retry = {2, 1, 1};
+  gaus_global_init(SERVER_URL, &options);
+  fakeFailures.push_back(failWith(CURLE_COULDNT_RESOLVE_HOST));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(pinnedTo("192.0.2.9"), curlPerformData[1].CURLOPT_RESOLVE);
+}
+
+TEST_F(GausDnsCache, resolves_again_when_the_cached_address_does_not_answer) {
+  persist("192.0.2.9", 100);
+  init();
+  fakeFailures.push_back(failWith(CURLE_COULDNT_CONNECT));
+
+  gaus_error_t *status = checkForUpdates();
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  gaus_error_release(status);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ(pinnedTo("192.0.2.9"), curlPerformData[0].CURLOPT_RESOLVE);
+  EXPECT_EQ(std::vector<std::string>({UNPIN}), curlPerformData[1].CURLOPT_RESOLVE);
+  EXPECT_EQ(pinnedTo("192.0.2.1"), curlPerformData[2].CURLOPT_RESOLVE);
+}
+
+TEST_F(GausDnsCache, refreshes_in_the_background_before_expiry) {
+  persist("192.0.2.9", 50);
+  init(SERVER_URL, 400);
+  fakePrimaryIp = "192.0.2.7";
+
+  poll();
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(1, curlPerformData[0].CURLOPT_CONNECT_ONLY);
+  EXPECT_EQ("http://gaus.example.com:443/", curlPerformData[0].CURLOPT_URL);
+  EXPECT_EQ(std::vector<std::string>({UNPIN}), curlPerformData[0].CURLOPT_RESOLVE);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  EXPECT_EQ(pinnedTo("192.0.2.7"), curlPerformData[1].CURLOPT_RESOLVE);
+  EXPECT_NE(std::string::npos, stored.find("192.0.2.7"));
+
+  //Fresh again, nothing more to refresh
+  poll();
+  EXPECT_EQ(2, curlPerformData.size());
+}
+
+TEST_F(GausDnsCache, refreshes_without_a_tls_handshake) {
+  persist("192.0.2.9", 50);
+  init(SERVER_URL, 400);
+
+  poll();
+
+  ASSERT_EQ(1, curlPerformData.size());
+  //Connecting to an https url would make curl do the handshake just to learn the address
+  EXPECT_EQ(0, curlPerformData[0].CURLOPT_URL.compare(0, 7, "http://"));
+  //Still the host and port the pin is for
+  EXPECT_EQ(std::vector<std::string>({UNPIN}), curlPerformData[0].CURLOPT_RESOLVE);
+}
+
+TEST_F(GausDnsCache, does_not_refresh_early) {
+  persist("192.0.2.9", 350);
+  init(SERVER_URL, 400);
+
+  poll();
+
+  EXPECT_EQ(0, curlPerformData.size());
+}
@@ -0,0 +1,141 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "alloc_counter.h"
+
+//Access gaus internals
+#include "../src/libgaus/error.h"
+#include "../src/libgaus/gaus.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+class GausError : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    ASSERT_EQ(0, error_pool_in_use());
+  }
+
+  virtual void TearDown() {
+    EXPECT_EQ(0, error_pool_in_use());
+  }
+};
+
+TEST_F(GausError, formats_into_the_pool) {
+  gaus_error_t *error = gaus_create_error(__func__, GAUS_HTTP_ERROR, 404, "Missing %s number %d", "device", 7);
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), error);
+  EXPECT_EQ(GAUS_HTTP_ERROR, error->error_type);
+  EXPECT_EQ(404, error->http_error_code);
+  EXPECT_STREQ("Missing device number 7", error->description);
+  EXPECT_EQ(1, error_pool_in_use());
+
+  gaus_error_release(error);
+}
+
+TEST_F(GausError, releases_null) {
+  gaus_error_release(NULL);
+}
+
+TEST_F(GausError, raising_and_releasing_does_not_touch_the_heap) {
+  //The first error also sets up the buffer of stdout for its log line
+  gaus_error_release(gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Warm up"));
+
+  if (allocCounterAvailable()) {
+    allocCounterStart();
+    for (int i = 0; i < 100; i++) {
+      gaus_error_release(gaus_create_error(__func__, GAUS_TIMEOUT_ERROR, 500, "Timed out after %d ms", i));
+    }
+    EXPECT_EQ(0, allocCounterStop().allocations);
+  }
+}
+
+//The error path of a call, as taken over and over while the server can't be reached
+TEST_F(GausError, error_path_of_a_call_does_not_touch_the_heap) {
+  gaus_error_release(gaus_report_flush());
+
+  if (allocCounterAvailable()) {
+    allocCounterStart();
+    for (int i = 0; i < 100; i++) {
+      gaus_error_t *status = gaus_report_flush();
+      ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+      EXPECT_EQ(GAUS_NO_INIT_ERROR, status->error_type);
+      gaus_error_release(status);
+    }
+    EXPECT_EQ(0, allocCounterStop().allocations);
+  }
+}
+
+TEST_F(GausError, falls_back_to_the_heap_once_the_pool_is_exhausted) {
+  std::vector<gaus_error_t *> errors;
+  if (allocCounterAvailable()) {
+    allocCounterStart();
+  }
+  for (int i = 0; i < ERROR_POOL_SIZE + 2; i++) {
+    errors.push_back(gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Error %d", i));
+  }
+  if (allocCounterAvailable()) {
+    //Two errors on the heap, each with its description, next to the room of the vector
+    EXPECT_LE(4, allocCounterStop().allocations);
+  }
+  EXPECT_EQ(ERROR_POOL_SIZE, error_pool_in_use());
+  for (size_t i = 0; i < errors.size(); i++) {
+    EXPECT_EQ("Error " + std::to_string(i), errors[i]->description);
+    for (size_t j = 0; j < i; j++) {
+      EXPECT_NE(errors[j], errors[i]);
+    }
+  }
+
+  //Released in another order than raised, slots of the pool are handed out again
+  for (size_t i = 0; i < errors.size(); i += 2) {
+    gaus_error_release(errors[i]);
+  }
+  EXPECT_EQ(ERROR_POOL_SIZE / 2, error_pool_in_use());
+  for (size_t i = 1; i < errors.size(); i += 2) {
+    gaus_error_release(errors[i]);
+  }
+}
+
+TEST_F(GausError, keeps_descriptions_too_long_for_the_pool_whole) {
+  std::string detail(ERROR_DESCRIPTION_SIZE * 2, 'x');
+  gaus_error_t *error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "Long: %s", detail.c_str());
+  EXPECT_EQ("Long: " + detail, error->description);
+  EXPECT_EQ(0, error_pool_in_use());
+  gaus_error_release(error);
+
+  //Exactly filling the pool's room still fits
+  std::string fits(ERROR_DESCRIPTION_SIZE - 1, 'y');
+  error = gaus_create_error(__func__, GAUS_UNKNOWN_ERROR, 500, "%s", fits.c_str());
+  EXPECT_EQ(fits, error->description);
+  EXPECT_EQ(1, error_pool_in_use());
+  gaus_error_release(error);
+}
+
+TEST_F(GausError, errors_can_be_raised_and_released_from_many_threads) {
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([t]() {
+      for (int i = 0; i < 200; i++) {
+        gaus_error_t *first = gaus_create_error("thread", GAUS_UNKNOWN_ERROR, 500, "Thread %d error %d", t, i);
+        gaus_error_t *second = gaus_create_error("thread", GAUS_UNKNOWN_ERROR, 500, "Thread %d again %d", t, i);
+        EXPECT_EQ("Thread " + std::to_string(t) + " error " + std::to_string(i), first->description);
+        EXPECT_EQ("Thread " + std::to_string(t) + " again " + std::to_string(i), second->description);
+        gaus_error_release(second);
+        gaus_error_release(first);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
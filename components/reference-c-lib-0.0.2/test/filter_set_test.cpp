@@ -0,0 +1,165 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+#include "alloc_counter.h"
+
+//Access gaus internals
+#include "../src/libgaus/filter_set.h"
+
+#include <string>
+
+class GausFilterSet : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    //Setup a default fake response that will work for all tests.
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+};
+
+static gaus_header_filter_t fakeFilters[] = {
+    {const_cast<char *>("firmware-version"), const_cast<char *>("1.2.3")},
+    {const_cast<char *>("location"), const_cast<char *>("Lund & Tokyo")}
+};
+
+static void freeError(gaus_error_t *error) {
+  if (error) {
+    gaus_error_release(error);
+  }
+}
+
+TEST_F(GausFilterSet, compiles_encoded_query) {
+  gaus_filter_set_t *filterSet = NULL;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_filter_set_create(2, fakeFilters, &filterSet));
+  EXPECT_STREQ("?firmware-version=1.2.3&location=Lund%20%26%20Tokyo", filter_set_query(filterSet));
+
+  gaus_filter_set_free(filterSet);
+}
+
+TEST_F(GausFilterSet, empty_set_has_no_query) {
+  gaus_filter_set_t *filterSet = NULL;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_filter_set_create(0, NULL, &filterSet));
+  EXPECT_STREQ("", filter_set_query(filterSet));
+  EXPECT_STREQ("", filter_set_query(NULL));
+
+  gaus_filter_set_free(filterSet);
+  gaus_filter_set_free(NULL);
+}
+
+TEST_F(GausFilterSet, rejects_invalid_filters) {
+  gaus_filter_set_t *filterSet = NULL;
+  gaus_header_filter_t missingValue[] = {{const_cast<char *>("firmware-version"), NULL}};
+
+  gaus_error_t *status = gaus_filter_set_create(1, NULL, &filterSet);
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_UNKNOWN_ERROR, status->error_type);
+  freeError(status);
+
+  status = gaus_filter_set_create(1, missingValue, &filterSet);
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  freeError(status);
+
+  status = gaus_filter_set_create(1, fakeFilters, NULL);
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  freeError(status);
+  EXPECT_EQ(static_cast<gaus_filter_set_t *>(NULL), filterSet);
+}
+
+TEST_F(GausFilterSet, check_for_updates_and_report_use_the_compiled_query) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+  gaus_report_t report = {};
+  report.report_type = GAUS_REPORT_UPDATE;
+  report.report.update_status.type = const_cast<char *>("Status");
+  report.report.update_status.ts = const_cast<char *>("FAKE_TIME");
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  gaus_filter_set_t *filterSet = NULL;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", NULL));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_filter_set_create(2, fakeFilters, &filterSet));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_report_with_filter_set(&fakeSession, filterSet, &header, 1, &report));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates_with_filter_set(&fakeSession, NULL, &updateCount, &updates));
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/check-for-updates"
+            "?firmware-version=1.2.3&location=Lund%20%26%20Tokyo", curlPerformData[0].CURLOPT_URL);
+  EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/report"
+            "?firmware-version=1.2.3&location=Lund%20%26%20Tokyo", curlPerformData[1].CURLOPT_URL);
+  EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/check-for-updates", curlPerformData[2].CURLOPT_URL);
+
+  gaus_filter_set_free(filterSet);
+}
+
+TEST_F(GausFilterSet, filter_array_is_encoded_too) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", NULL));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates(&fakeSession, 2, fakeFilters, &updateCount, &updates));
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/check-for-updates"
+            "?firmware-version=1.2.3&location=Lund%20%26%20Tokyo", curlPerformData[0].CURLOPT_URL);
+}
+
+TEST_F(GausFilterSet, reusing_a_filter_set_builds_no_query) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+  gaus_filter_set_t *filterSet = NULL;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", NULL));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_filter_set_create(2, fakeFilters, &filterSet));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates));
+  allocCounterStart();
+  gaus_check_for_updates_with_filter_set(&fakeSession, filterSet, &updateCount, &updates);
+  size_t withSet = allocCounterStop().allocations;
+  allocCounterStart();
+  gaus_check_for_updates(&fakeSession, 2, fakeFilters, &updateCount, &updates);
+  size_t withArray = allocCounterStop().allocations;
+
+  if (allocCounterAvailable()) {
+    //Compiling the filters takes the filter set, its query string and the state of its condition
+    EXPECT_EQ(withArray - 3, withSet);
+  }
+
+  gaus_filter_set_free(filterSet);
+}
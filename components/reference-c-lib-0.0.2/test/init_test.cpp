@@ -65,8 +65,7 @@ TEST_F(GausInit, failed_global_curl_init) {
   EXPECT_EQ(500, status->http_error_code);
   EXPECT_NE(0, strlen(status->description));
 
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausInit, global_init_handles_null_proxy_in_options) {
@@ -0,0 +1,172 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "alloc_counter.h"
+
+//Access gaus internals
+#include "../src/libgaus/json_writer.h"
+
+#include <jansson.h>
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+class GausJsonWriter : public ::testing::Test {
+protected:
+  json_writer_t writer = {NULL, 0, 0, false};
+
+  virtual void TearDown() {
+    json_writer_free(&writer);
+  }
+
+  //The document written so far, or "<failed>"
+  std::string take() {
+    char *data = json_writer_take(&writer);
+    std::string result = data ? data : "<failed>";
+    free(data);
+    return result;
+  }
+
+  //What json_dumps makes of value, or "<failed>" if jansson refuses it.  Takes the reference.
+  static std::string dumps(json_t *value) {
+    char *data = value ? json_dumps(value, JSON_COMPACT | JSON_ENCODE_ANY) : NULL;
+    std::string result = data ? data : "<failed>";
+    free(data);
+    json_decref(value);
+    return result;
+  }
+
+  std::string writeString(const char *value) {
+    json_writer_reset(&writer);
+    json_writer_string(&writer, value);
+    return take();
+  }
+
+  std::string writeReal(double value) {
+    json_writer_reset(&writer);
+    json_writer_real(&writer, value);
+    return take();
+  }
+};
+
+TEST_F(GausJsonWriter, writes_strings_like_jansson) {
+  const char *values[] = {"", "plain", "quote\" backslash\\ slash/", "\b\f\n\r\t", "\x01\x1f\x7f", "caf\xc3\xa9",
+                          "\xe2\x82\xac", "\xf0\x9f\x98\x80", "2018-11-15T12:00:22.000Z"};
+
+  for (const char *value : values) {
+    EXPECT_EQ(dumps(json_string(value)), writeString(value)) << value;
+  }
+}
+
+TEST_F(GausJsonWriter, escapes_every_control_character_like_jansson) {
+  for (int c = 1; c < 0x20; c++) {
+    char value[] = {'a', static_cast<char>(c), 'b', '\0'};
+    EXPECT_EQ(dumps(json_string(value)), writeString(value)) << c;
+  }
+}
+
+TEST_F(GausJsonWriter, refuses_invalid_utf8_like_jansson) {
+  const char *values[] = {"\x80", "\xc0\x80", "\xc3", "\xc3(", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80",
+                          "\xe0\x80\xaf", "ok\xff"};
+
+  for (const char *value : values) {
+    EXPECT_EQ(static_cast<json_t *>(NULL), json_string(value)) << value;
+    EXPECT_EQ("<failed>", writeString(value)) << value;
+  }
+  EXPECT_EQ("<failed>", writeString(NULL));
+}
+
+TEST_F(GausJsonWriter, writes_reals_like_jansson) {
+  double values[] = {0.0, -0.0, 1.0, -1.5, 21.0f, 0.1f, 0.1, 23.45f, 1e21, 1e-7, 123456789.0, 1.0 / 3, DBL_MAX,
+                     DBL_MIN, FLT_MAX, -FLT_MIN, 5e-324};
+
+  for (double value : values) {
+    EXPECT_EQ(dumps(json_real(value)), writeReal(value)) << value;
+  }
+  srand(42);
+  for (int i = 0; i < 1000; i++) {
+    float value = static_cast<float>(rand() - RAND_MAX / 2) / static_cast<float>(1 + rand() % 10000);
+    EXPECT_EQ(dumps(json_real(value)), writeReal(value)) << value;
+  }
+}
+
+TEST_F(GausJsonWriter, refuses_reals_that_are_not_finite) {
+  EXPECT_EQ("<failed>", writeReal(NAN));
+  EXPECT_EQ("<failed>", writeReal(INFINITY));
+  EXPECT_EQ("<failed>", writeReal(-INFINITY));
+}
+
+TEST_F(GausJsonWriter, writes_integers_like_jansson) {
+  int values[] = {0, 1, -1, INT_MAX, INT_MIN};
+
+  for (int value : values) {
+    json_writer_reset(&writer);
+    json_writer_integer(&writer, value);
+    EXPECT_EQ(dumps(json_integer(value)), take());
+  }
+}
+
+TEST_F(GausJsonWriter, writes_a_prefixed_string_as_one) {
+  json_writer_init(&writer, 0);
+
+  json_writer_string_prefixed(&writer, "event.generic.", "Temp\"erature");
+
+  EXPECT_EQ("\"event.generic.Temp\\\"erature\"", take());
+}
+
+TEST_F(GausJsonWriter, ignores_writes_once_failed) {
+  json_writer_init(&writer, 0);
+
+  JSON_WRITER_LITERAL(&writer, "[");
+  json_writer_real(&writer, NAN);
+  JSON_WRITER_LITERAL(&writer, "]");
+
+  EXPECT_TRUE(writer.failed);
+  EXPECT_EQ("<failed>", take());
+  JSON_WRITER_LITERAL(&writer, "[]");
+  EXPECT_EQ("[]", take());
+}
+
+TEST_F(GausJsonWriter, grows_only_when_needed) {
+  json_writer_init(&writer, 64);
+  std::string expected;
+  for (int i = 0; i < 100; i++) {
+    expected += "0123456789";
+  }
+
+  if (allocCounterAvailable()) {
+    allocCounterStart();
+  }
+  for (int i = 0; i < 100; i++) {
+    JSON_WRITER_LITERAL(&writer, "0123456789");
+  }
+  if (allocCounterAvailable()) {
+    //Doubling from 64 bytes up to the 1001 needed
+    EXPECT_EQ(4, allocCounterStop().allocations);
+  }
+
+  EXPECT_EQ(expected, take());
+}
+
+TEST_F(GausJsonWriter, reuses_its_buffer_after_reset) {
+  json_writer_init(&writer, 64);
+  JSON_WRITER_LITERAL(&writer, "{}");
+  const char *data = writer.data;
+
+  json_writer_reset(&writer);
+  JSON_WRITER_LITERAL(&writer, "[]");
+
+  EXPECT_EQ(data, writer.data);
+  EXPECT_EQ("[]", take());
+}
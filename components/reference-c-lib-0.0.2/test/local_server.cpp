@@ -0,0 +1,199 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "local_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+//The string value of key in a flat json object, or an empty string
+static std::string jsonString(const std::string &json, const std::string &key) {
+  size_t at = json.find("\"" + key + "\"");
+  if (at == std::string::npos || (at = json.find(':', at)) == std::string::npos
+      || (at = json.find('"', at)) == std::string::npos) {
+    return "";
+  }
+  size_t end = json.find('"', at + 1);
+  return end == std::string::npos ? "" : json.substr(at + 1, end - at - 1);
+}
+
+//Write all of data, false if the connection broke
+static bool sendAll(int fd, const std::string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t written = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    sent += written;
+  }
+  return true;
+}
+
+LocalServer::LocalServer(unsigned int latencyMs)
+    : listenFd(-1), latencyMs(latencyMs), requests(0), connections(0), stopping(false) {
+  sockaddr_in address = {};
+  socklen_t length = sizeof(address);
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0; //Any free port
+  if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0
+      || bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, 128) != 0
+      || getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return;
+  }
+  listenFd = fd;
+  serverUrl = "http://127.0.0.1:" + std::to_string(ntohs(address.sin_port));
+  acceptor = std::thread(&LocalServer::acceptConnections, this);
+}
+
+LocalServer::~LocalServer() {
+  if (listenFd < 0) {
+    return;
+  }
+  stopping = true;
+  //Wakes the threads blocked in accept and recv
+  shutdown(listenFd, SHUT_RDWR);
+  acceptor.join();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int fd : connectionFds) {
+      shutdown(fd, SHUT_RDWR);
+    }
+  }
+  for (std::thread &thread : connectionThreads) {
+    thread.join();
+  }
+  for (int fd : connectionFds) {
+    close(fd);
+  }
+  close(listenFd);
+}
+
+void LocalServer::acceptConnections() {
+  while (!stopping) {
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      return;
+    }
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    connections++;
+    std::lock_guard<std::mutex> guard(lock);
+    if (stopping) {
+      close(fd);
+      return;
+    }
+    connectionFds.push_back(fd);
+    connectionThreads.emplace_back(&LocalServer::serve, this, fd);
+  }
+}
+
+void LocalServer::serve(int fd) {
+  std::string buffer;
+  char chunk[4096];
+
+  while (!stopping) {
+    //Read the head of a request, then its body
+    size_t headEnd;
+    while ((headEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+      if (received <= 0) {
+        return;
+      }
+      buffer.append(chunk, received);
+    }
+    std::string head = buffer.substr(0, headEnd);
+    size_t contentLength = 0;
+    bool expectContinue = false;
+    for (size_t line = head.find("\r\n"); line != std::string::npos; line = head.find("\r\n", line + 2)) {
+      const char *header = head.c_str() + line + 2;
+      if (strncasecmp(header, "Content-Length:", 15) == 0) {
+        contentLength = strtoul(header + 15, NULL, 10);
+      } else if (strncasecmp(header, "Expect: 100-continue", 20) == 0) {
+        expectContinue = true;
+      }
+    }
+    if (expectContinue && !sendAll(fd, "HTTP/1.1 100 Continue\r\n\r\n")) {
+      return;
+    }
+    while (buffer.size() < headEnd + 4 + contentLength) {
+      ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+      if (received <= 0) {
+        return;
+      }
+      buffer.append(chunk, received);
+    }
+    std::string body = buffer.substr(headEnd + 4, contentLength);
+    buffer.erase(0, headEnd + 4 + contentLength);
+
+    size_t methodEnd = head.find(' ');
+    size_t pathEnd = head.find(' ', methodEnd + 1);
+    std::string method = head.substr(0, methodEnd);
+    std::string path = head.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+    int status = 200;
+    std::string replyBody = reply(method, path.substr(0, path.find('?')), body, &status);
+    if (latencyMs > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(latencyMs));
+    }
+    requests++;
+    if (!sendAll(fd, "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Not Found")
+                     + "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(replyBody.size())
+                     + "\r\n\r\n" + replyBody)) {
+      return;
+    }
+  }
+}
+
+std::string LocalServer::reply(const std::string &method, const std::string &path, const std::string &body,
+                               int *status) {
+  if (method == "POST" && path == "/register") {
+    std::string device = jsonString(body, "deviceId");
+    return "{\"deviceAuthParameters\": {\"accessKey\": \"" + device + "\", \"secretKey\": \"secret\"},"
+           " \"pollIntervalSeconds\": 60}";
+  }
+  if (method == "POST" && path == "/authenticate") {
+    std::string device = jsonString(body, "accessKey");
+    return "{\"deviceGUID\": \"" + device + "\", \"productGUID\": \"localProductGUID\", \"token\": \"token-" + device
+           + "\"}";
+  }
+  const std::string checkForUpdates = "/check-for-updates";
+  if (method == "GET" && path.size() > checkForUpdates.size()
+      && path.compare(path.size() - checkForUpdates.size(), checkForUpdates.size(), checkForUpdates) == 0) {
+    return "{\"updates\": []}";
+  }
+  const std::string report = "/report";
+  if (method == "POST" && path.size() > report.size()
+      && path.compare(path.size() - report.size(), report.size(), report) == 0) {
+    return "{}";
+  }
+  *status = 404;
+  return "{}";
+}
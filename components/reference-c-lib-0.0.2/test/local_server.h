@@ -0,0 +1,62 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GAUS_LOCAL_SERVER_H
+#define GAUS_LOCAL_SERVER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//A gaus server on the loopback interface, for running libgaus against real curl.
+//
+//Answers register, authenticate, check for updates (never with updates) and report, keeping connections alive.  Each
+//connection is served by a thread of its own, so requests made in parallel are answered in parallel.  Every reply
+//waits latencyMs first, standing in for the time a real server takes.  Devices are told apart by the deviceId they
+//register with, which becomes their device guid.
+class LocalServer {
+public:
+  explicit LocalServer(unsigned int latencyMs = 0);
+
+  ~LocalServer();
+
+  //The url to give libgaus, e.g. "http://127.0.0.1:40123"
+  const std::string &url() const { return serverUrl; }
+
+  //Whether the server is listening, it is not if no loopback port could be had
+  bool listening() const { return listenFd >= 0; }
+
+  unsigned long requestCount() const { return requests; }
+
+  unsigned long connectionCount() const { return connections; }
+
+  void setLatencyMs(unsigned int ms) { latencyMs = ms; }
+
+private:
+  void acceptConnections();
+
+  void serve(int fd);
+
+  std::string reply(const std::string &method, const std::string &path, const std::string &body, int *status);
+
+  int listenFd;
+  std::string serverUrl;
+  std::atomic<unsigned int> latencyMs;
+  std::atomic<unsigned long> requests;
+  std::atomic<unsigned long> connections;
+  std::atomic<bool> stopping;
+  std::mutex lock;
+  std::vector<int> connectionFds;
+  std::vector<std::thread> connectionThreads;
+  std::thread acceptor;
+};
+
+#endif //GAUS_LOCAL_SERVER_H
@@ -0,0 +1,188 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "alloc_counter.h"
+
+//Access gaus internals
+#include "../src/libgaus/log.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+class GausLog : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    stream = tmpfile();
+    ASSERT_NE(static_cast<FILE *>(NULL), stream);
+    set_log_stream(stream);
+  }
+
+  virtual void TearDown() {
+    log_stop_async();
+    set_log_stream(NULL);
+    fclose(stream);
+  }
+
+  //The messages written so far, without their time
+  std::vector<std::string> messages() {
+    std::vector<std::string> lines;
+    fflush(stream);
+    rewind(stream);
+    char line[LOG_RING_LINE_SIZE * 8];
+    while (fgets(line, sizeof(line), stream)) {
+      std::string text(line);
+      if (!text.empty() && text.back() == '\n') {
+        text.pop_back();
+      }
+      size_t separator = text.find(" - ");
+      lines.push_back(separator == std::string::npos ? text : text.substr(separator + 3));
+    }
+    return lines;
+  }
+
+  //Lines reported as dropped by the messages, removing those reports
+  static unsigned int takeDropped(std::vector<std::string> &lines) {
+    unsigned int dropped = 0;
+    std::vector<std::string> kept;
+    for (const std::string &line : lines) {
+      unsigned int count = 0;
+      if (sscanf(line.c_str(), "log: Dropped %u lines", &count) == 1) {
+        dropped += count;
+      } else {
+        kept.push_back(line);
+      }
+    }
+    lines = kept;
+    return dropped;
+  }
+
+  FILE *stream = NULL;
+};
+
+TEST_F(GausLog, writes_lines_as_they_are_logged) {
+  logging(L_INFO, "Line %d of %s", 1, "sync");
+  logging(L_DEBUG, "Below the level");
+  logging(L_INFO | L_RAW, "Raw");
+
+  std::vector<std::string> lines = messages();
+  ASSERT_EQ(2, lines.size());
+  EXPECT_EQ("Line 1 of sync", lines[0]);
+  EXPECT_EQ("Raw", lines[1]);
+}
+
+TEST_F(GausLog, writes_lines_of_the_ring_in_order) {
+  ASSERT_TRUE(log_start_async(64));
+  for (int i = 0; i < 50; i++) {
+    logging(L_INFO, "Line %d", i);
+  }
+  logging(L_DEBUG, "Below the level");
+  log_stop_async();
+
+  std::vector<std::string> lines = messages();
+  ASSERT_EQ(50, lines.size());
+  for (int i = 0; i < 50; i++) {
+    EXPECT_EQ("Line " + std::to_string(i), lines[i]);
+  }
+
+  //Back to writing lines as they are logged
+  logging(L_INFO, "After");
+  EXPECT_EQ("After", messages().back());
+}
+
+TEST_F(GausLog, cuts_long_lines_in_the_ring) {
+  std::string detail(LOG_RING_LINE_SIZE * 2, 'x');
+  ASSERT_TRUE(log_start_async(4));
+  logging(L_INFO, "%s", detail.c_str());
+  log_stop_async();
+
+  std::vector<std::string> lines = messages();
+  ASSERT_EQ(1, lines.size());
+  EXPECT_EQ(detail.substr(0, LOG_RING_LINE_SIZE - 1), lines[0]);
+}
+
+TEST_F(GausLog, counts_lines_dropped_while_the_ring_is_full) {
+  ASSERT_TRUE(log_start_async(2));
+  for (int i = 0; i < 1000; i++) {
+    logging(L_WARNING, "Line %d", i);
+  }
+  log_stop_async();
+
+  std::vector<std::string> lines = messages();
+  unsigned int dropped = takeDropped(lines);
+  EXPECT_EQ(1000, lines.size() + dropped);
+  int previous = -1;
+  for (const std::string &line : lines) {
+    int number = atoi(line.c_str() + strlen("Line "));
+    EXPECT_LT(previous, number);
+    previous = number;
+  }
+}
+
+TEST_F(GausLog, takes_lines_from_many_threads) {
+  const int threadCount = 4;
+  const int linesPerThread = 500;
+  ASSERT_TRUE(log_start_async(4096));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; t++) {
+    threads.emplace_back([t]() {
+      for (int i = 0; i < linesPerThread; i++) {
+        logging(L_INFO, "Thread %d line %d", t, i);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  log_stop_async();
+
+  std::vector<std::string> lines = messages();
+  EXPECT_EQ(0, takeDropped(lines));
+  ASSERT_EQ(threadCount * linesPerThread, lines.size());
+  //In the order each thread logged them
+  std::vector<int> next(threadCount, 0);
+  for (const std::string &line : lines) {
+    int t = -1;
+    int i = -1;
+    ASSERT_EQ(2, sscanf(line.c_str(), "Thread %d line %d", &t, &i));
+    ASSERT_TRUE(t >= 0 && t < threadCount);
+    EXPECT_EQ(next[t], i);
+    next[t] = i + 1;
+  }
+}
+
+TEST_F(GausLog, logging_into_the_ring_does_not_touch_the_heap) {
+  ASSERT_TRUE(log_start_async(256));
+  if (allocCounterAvailable()) {
+    allocCounterStart();
+    for (int i = 0; i < 100; i++) {
+      logging(L_INFO, "Line %d of %s", i, "the ring");
+    }
+    EXPECT_EQ(0, allocCounterStop().allocations);
+  }
+}
+
+#undef GAUS_LOG_FLOOR
+#define GAUS_LOG_FLOOR L_WARNING
+
+TEST_F(GausLog, leaves_out_levels_below_the_floor) {
+  int evaluated = 0;
+  logging(L_INFO, "Left out %d", ++evaluated);
+  logging(L_INFO | L_RAW, "Left out %d", ++evaluated);
+  logging(L_WARNING, "Kept %d", ++evaluated);
+
+  EXPECT_EQ(1, evaluated);
+  std::vector<std::string> lines = messages();
+  ASSERT_EQ(1, lines.size());
+  EXPECT_EQ("Kept 1", lines[0]);
+}
@@ -55,8 +55,7 @@ TEST_F(GausRegister, fails_without_initialize) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, fails_without_product_secret) {
@@ -75,8 +74,7 @@ TEST_F(GausRegister, fails_without_product_secret) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, fails_without_product_access) {
@@ -95,8 +93,7 @@ TEST_F(GausRegister, fails_without_product_access) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, fails_without_product_id) {
@@ -115,8 +112,7 @@ TEST_F(GausRegister, fails_without_product_id) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, fails_without_device_access) {
@@ -134,8 +130,7 @@ TEST_F(GausRegister, fails_without_device_access) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 
@@ -154,8 +149,7 @@ TEST_F(GausRegister, fails_without_device_secret) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, fails_without_poll_interval) {
@@ -173,8 +167,7 @@ TEST_F(GausRegister, fails_without_poll_interval) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, posts_to_correct_address) {
@@ -248,8 +241,7 @@ TEST_F(GausRegister, handles_errors_on_perform_without_status) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 static CURLcode mock_curl_easy_getinfo_return_500(CURL *curl, CURLINFO info, ...) {
@@ -291,8 +283,7 @@ TEST_F(GausRegister, handles_errors_on_perform_with_status_500) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 
@@ -335,8 +326,7 @@ TEST_F(GausRegister, handles_errors_on_perform_with_status_400) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, retreives_correctly_from_server) {
@@ -390,8 +380,7 @@ TEST_F(GausRegister, handles_no_pollIntervalSeconds_from_server) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, handles_no_accessKey_from_server) {
@@ -421,8 +410,7 @@ TEST_F(GausRegister, handles_no_accessKey_from_server) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, handles_no_secretKey_from_server) {
@@ -452,8 +440,7 @@ TEST_F(GausRegister, handles_no_secretKey_from_server) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, handles_no_malformed_json_from_server) {
@@ -478,8 +465,7 @@ TEST_F(GausRegister, handles_no_malformed_json_from_server) {
   EXPECT_NE(0, strlen(status->description));
 
   //Cleanup after test
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausRegister, uses_proxy_from_init) {
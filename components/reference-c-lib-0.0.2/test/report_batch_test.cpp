@@ -0,0 +1,319 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+class GausReportBatch : public ::testing::Test {
+protected:
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("FAKE_HEADER_TS")};
+  gaus_initialization_options_t options = {};
+  char queuePath[32] = "/tmp/gaus_report_batch_XXXXXX";
+  gaus_report_queue_store_t store = {};
+
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+    if (store.user_data) {
+      remove(queuePath);
+    }
+  }
+
+  void init() {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", &options));
+  }
+
+  //Move failed batches to a report queue kept in a file
+  void useReportQueue() {
+    int fd = mkstemp(queuePath);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    store = {queuePath, 4 * 1024, 1024, gaus_report_queue_file_read, gaus_report_queue_file_write,
+             gaus_report_queue_file_erase};
+    options.report_queue_store = &store;
+  }
+
+  static gaus_report_t report(gaus_v_float_t *value, const char *ts) {
+    gaus_report_t report = {};
+    report.report_type = GAUS_REPORT_GENERIC;
+    report.report.generic.type = const_cast<char *>("Temperature");
+    report.report.generic.ts = const_cast<char *>(ts);
+    report.report.generic.v_float_count = 1;
+    report.report.generic.v_floats = value;
+    return report;
+  }
+
+  void enqueue(float value, const char *ts = "FAKE_TS", gaus_session_t *session = NULL) {
+    gaus_v_float_t floats[1] = {{const_cast<char *>("temperature"), value}};
+    gaus_report_t reports[1] = {report(floats, ts)};
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+              gaus_report_enqueue(session ? session : &fakeSession, NULL, &header, 1, reports));
+  }
+
+  //Carry out the batches in flight
+  static void poll() {
+    unsigned int pending = 1;
+    while (pending) {
+      ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, &pending));
+    }
+  }
+
+  static std::string entry(float value, const char *ts = "FAKE_TS") {
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "{\"type\":\"event.generic.Temperature\",\"ts\":\"%s\",\"v_ints\":{},"
+                                     "\"v_floats\":{\"temperature\":%.1f},\"v_strings\":{}}", ts, value);
+    return buffer;
+  }
+
+  static std::string body(const std::vector<std::string> &entries) {
+    std::string body = "{\"version\":\"1.0.0\",\"header\":{\"ts\":\"FAKE_HEADER_TS\"},\"data\":[";
+    for (size_t i = 0; i < entries.size(); i++) {
+      body += (i ? "," : "") + entries[i];
+    }
+    return body + "]}";
+  }
+
+  static CurlFailure failWith(CURLcode result, long statusCode = 0) {
+    CurlFailure failure;
+    failure.result = result;
+    failure.statusCode = statusCode;
+    return failure;
+  }
+};
+
+TEST_F(GausReportBatch, fails_without_init) {
+  gaus_v_float_t floats[1] = {{const_cast<char *>("temperature"), 21.0f}};
+  gaus_report_t reports[1] = {report(floats, "FAKE_TS")};
+
+  gaus_error_t *status = gaus_report_enqueue(&fakeSession, NULL, &header, 1, reports);
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_NO_INIT_ERROR, status->error_type);
+  gaus_error_release(status);
+}
+
+TEST_F(GausReportBatch, fails_with_invalid_parameters) {
+  init();
+
+  gaus_error_t *status = gaus_report_enqueue(&fakeSession, NULL, &header, 0, NULL);
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_UNKNOWN_ERROR, status->error_type);
+  gaus_error_release(status);
+}
+
+TEST_F(GausReportBatch, holds_reports_until_the_batch_is_full) {
+  options.report_batch.max_reports = 3;
+  init();
+
+  enqueue(21.0f, "TS_1");
+  enqueue(22.0f, "TS_2");
+  poll();
+  EXPECT_EQ(0, curlPerformData.size());
+  enqueue(23.0f, "TS_3");
+  poll();
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/report", curlPerformData[0].CURLOPT_URL);
+  EXPECT_EQ(body({entry(21.0f, "TS_1"), entry(22.0f, "TS_2"), entry(23.0f, "TS_3")}),
+            curlPerformData[0].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportBatch, batch_matches_gaus_report) {
+  gaus_v_float_t first[1] = {{const_cast<char *>("temperature"), 21.0f}};
+  gaus_v_float_t second[1] = {{const_cast<char *>("humidity"), 40.0f}};
+  gaus_report_t reports[2] = {report(first, "TS_1"), report(second, "TS_2")};
+  init();
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 2, reports));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_enqueue(&fakeSession, NULL, &header, 1, &reports[0]));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_enqueue(&fakeSession, NULL, &header, 1, &reports[1]));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_flush());
+  poll();
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(curlPerformData[0].CURLOPT_POSTFIELDS, curlPerformData[1].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportBatch, sends_a_batch_once_it_is_old) {
+  options.report_batch.max_age_ms = 20;
+  init();
+  enqueue(21.0f);
+
+  poll();
+  EXPECT_EQ(0, curlPerformData.size());
+  usleep(30 * 1000);
+  poll();
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(body({entry(21.0f)}), curlPerformData[0].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportBatch, keeps_batches_within_max_bytes) {
+  options.report_batch.max_bytes = body({entry(21.0f), entry(22.0f)}).size();
+  init();
+
+  for (int i = 0; i < 5; i++) {
+    enqueue(21.0f + i);
+  }
+  poll();
+  ASSERT_EQ(2, curlPerformData.size());
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_flush());
+  poll();
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ(body({entry(21.0f), entry(22.0f)}), curlPerformData[0].CURLOPT_POSTFIELDS);
+  EXPECT_EQ(body({entry(23.0f), entry(24.0f)}), curlPerformData[1].CURLOPT_POSTFIELDS);
+  EXPECT_EQ(body({entry(25.0f)}), curlPerformData[2].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportBatch, sends_a_large_report_by_itself) {
+  options.report_batch.max_bytes = 64;
+  init();
+
+  enqueue(21.0f);
+  enqueue(22.0f);
+  poll();
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(body({entry(21.0f)}), curlPerformData[0].CURLOPT_POSTFIELDS);
+  EXPECT_EQ(body({entry(22.0f)}), curlPerformData[1].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportBatch, flush_does_nothing_when_empty) {
+  init();
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_flush());
+  poll();
+
+  EXPECT_EQ(0, curlPerformData.size());
+}
+
+TEST_F(GausReportBatch, another_session_starts_a_new_batch) {
+  gaus_session_t otherSession = {
+      const_cast<char *>("otherDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("otherToken")
+  };
+  init();
+
+  enqueue(21.0f);
+  enqueue(22.0f, "FAKE_TS", &otherSession);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_flush());
+  poll();
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/report", curlPerformData[0].CURLOPT_URL);
+  EXPECT_EQ(body({entry(21.0f)}), curlPerformData[0].CURLOPT_POSTFIELDS);
+  EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/otherDeviceGUID/report", curlPerformData[1].CURLOPT_URL);
+  EXPECT_EQ(body({entry(22.0f)}), curlPerformData[1].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportBatch, sends_with_the_latest_token) {
+  init();
+
+  enqueue(21.0f);
+  fakeSession.token = const_cast<char *>("newFakeToken");
+  enqueue(22.0f);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_flush());
+  poll();
+
+  ASSERT_EQ(1, curlPerformData.size());
+  const std::vector<std::string> &headers = curlPerformData[0].CURLOPT_HEADER;
+  EXPECT_NE(headers.end(), std::find(headers.begin(), headers.end(), "Authorization: Bearer newFakeToken"));
+}
+
+TEST_F(GausReportBatch, moves_a_failed_batch_to_the_report_queue) {
+  useReportQueue();
+  init();
+  enqueue(21.0f);
+  enqueue(22.0f);
+  fakeFailures.push_back(failWith(CURLE_COULDNT_CONNECT));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_flush());
+  poll();
+  EXPECT_EQ(2, gaus_get_report_queue_stats().pending);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_queue_drain(&fakeSession, NULL, &header, NULL));
+  poll();
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(curlPerformData[0].CURLOPT_POSTFIELDS, curlPerformData[1].CURLOPT_POSTFIELDS);
+  EXPECT_EQ(0, gaus_get_report_queue_stats().pending);
+}
+
+TEST_F(GausReportBatch, drops_a_batch_the_server_refuses) {
+  useReportQueue();
+  init();
+  enqueue(21.0f);
+  fakeFailures.push_back(failWith(CURLE_OK, 400));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_flush());
+  poll();
+
+  EXPECT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(0, gaus_get_report_queue_stats().queued);
+}
+
+TEST_F(GausReportBatch, keeps_held_reports_across_cleanup) {
+  useReportQueue();
+  init();
+  enqueue(21.0f);
+  enqueue(22.0f);
+
+  gaus_global_cleanup();
+  init();
+
+  EXPECT_EQ(0, curlPerformData.size());
+  EXPECT_EQ(2, gaus_get_report_queue_stats().pending);
+}
+
+TEST_F(GausReportBatch, keeps_a_batch_in_flight_across_cleanup) {
+  useReportQueue();
+  init();
+  enqueue(21.0f);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_flush());
+
+  gaus_global_cleanup();
+  init();
+
+  EXPECT_EQ(1, gaus_get_report_queue_stats().pending);
+}
+
+TEST_F(GausReportBatch, sends_fewer_requests_than_reporting_each_sample) {
+  options.report_batch.max_reports = 60;
+  init();
+
+  //A minute of the demo: a temperature and a humidity sample every two seconds
+  for (int i = 0; i < 30; i++) {
+    gaus_v_float_t temperature[1] = {{const_cast<char *>("temperature"), 21.0f}};
+    gaus_v_float_t humidity[1] = {{const_cast<char *>("humidity"), 40.0f}};
+    gaus_report_t reports[2] = {report(temperature, "FAKE_TS"), report(humidity, "FAKE_TS")};
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_enqueue(&fakeSession, NULL, &header, 2, reports));
+    poll();
+  }
+
+  EXPECT_EQ(1, curlPerformData.size());
+}
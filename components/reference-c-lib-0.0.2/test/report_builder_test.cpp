@@ -0,0 +1,278 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "alloc_counter.h"
+
+//Access gaus internals
+#include "../src/libgaus/report.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAS_MALLINFO2
+#endif
+
+#define TS "2018-11-15T12:00:22.000Z"
+
+class GausReportBuilder : public ::testing::Test {
+protected:
+  char arena[1024];
+  gaus_report_builder_t builder;
+
+  virtual void SetUp() {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_builder_init(&builder, arena, sizeof(arena)));
+  }
+
+  virtual void TearDown() {
+    gaus_report_builder_free(&builder);
+  }
+
+  //The reports of main/gaus_report.c, a status report then a temperature and a humidity report
+  static void build(gaus_report_builder_t *builder) {
+    gaus_report_builder_header(builder, TS);
+    gaus_report_builder_begin(builder, GAUS_REPORT_UPDATE, "Status", TS, 0, 0, 4);
+    gaus_report_builder_string(builder, "phase", "install");
+    gaus_report_builder_string(builder, "status", "success");
+    gaus_report_builder_string(builder, "logLine", "Installed new firmware version.");
+    gaus_report_builder_string(builder, "updateId", "2c1ef3a4-5b6d-4e7f-8a9b-0c1d2e3f4a5b");
+    gaus_report_builder_begin(builder, GAUS_REPORT_GENERIC, "Temperature", TS, 0, 1, 0);
+    gaus_report_builder_float(builder, "temperature", 23.0f);
+    gaus_report_builder_begin(builder, GAUS_REPORT_GENERIC, "Humidity", TS, 1, 1, 0);
+    gaus_report_builder_float(builder, "humidity", 41.0f);
+    gaus_report_builder_int(builder, "battery", 90);
+  }
+
+  //The same reports, laid out by hand
+  static std::string expectedBody() {
+    gaus_report_header_t header = {const_cast<char *>(TS)};
+    gaus_v_string_t strings[4] = {{const_cast<char *>("phase"), const_cast<char *>("install")},
+                                  {const_cast<char *>("status"), const_cast<char *>("success")},
+                                  {const_cast<char *>("logLine"),
+                                   const_cast<char *>("Installed new firmware version.")},
+                                  {const_cast<char *>("updateId"),
+                                   const_cast<char *>("2c1ef3a4-5b6d-4e7f-8a9b-0c1d2e3f4a5b")}};
+    gaus_v_float_t temperature[1] = {{const_cast<char *>("temperature"), 23.0f}};
+    gaus_v_float_t humidity[1] = {{const_cast<char *>("humidity"), 41.0f}};
+    gaus_v_int_t battery[1] = {{const_cast<char *>("battery"), 90}};
+    gaus_report_t reports[3] = {};
+    reports[0].report_type = GAUS_REPORT_UPDATE;
+    reports[0].report.update_status.type = const_cast<char *>("Status");
+    reports[0].report.update_status.ts = header.ts;
+    reports[0].report.update_status.v_string_count = 4;
+    reports[0].report.update_status.v_strings = strings;
+    reports[1].report_type = GAUS_REPORT_GENERIC;
+    reports[1].report.generic.type = const_cast<char *>("Temperature");
+    reports[1].report.generic.ts = header.ts;
+    reports[1].report.generic.v_float_count = 1;
+    reports[1].report.generic.v_floats = temperature;
+    reports[2] = reports[1];
+    reports[2].report.generic.type = const_cast<char *>("Humidity");
+    reports[2].report.generic.v_floats = humidity;
+    reports[2].report.generic.v_int_count = 1;
+    reports[2].report.generic.v_ints = battery;
+    return encode(&header, 3, reports);
+  }
+
+  static std::string encode(const gaus_report_header_t *header, unsigned int count, const gaus_report_t *reports) {
+    char *body = NULL;
+    size_t length = 0;
+    gaus_error_t *error = report_encode_body(header, count, reports, GAUS_REPORT_FORMAT_JSON, &body, &length);
+    EXPECT_EQ(static_cast<gaus_error_t *>(NULL), error);
+    std::string result = body ? std::string(body, length) : "";
+    free(body);
+    return result;
+  }
+
+  //The body of what builder built
+  static std::string finishAndEncode(const gaus_report_builder_t *builder) {
+    const gaus_report_header_t *header = NULL;
+    unsigned int count = 0;
+    const gaus_report_t *reports = NULL;
+    gaus_error_t *error = gaus_report_builder_finish(builder, &header, &count, &reports);
+    EXPECT_EQ(static_cast<gaus_error_t *>(NULL), error);
+    return error ? "" : encode(header, count, reports);
+  }
+
+  //The error of finishing builder, which must have failed
+  static void expectFailure(const gaus_report_builder_t *builder) {
+    const gaus_report_header_t *header = NULL;
+    unsigned int count = 0;
+    const gaus_report_t *reports = NULL;
+    gaus_error_t *error = gaus_report_builder_finish(builder, &header, &count, &reports);
+    ASSERT_NE(static_cast<gaus_error_t *>(NULL), error);
+    EXPECT_EQ(GAUS_UNKNOWN_ERROR, error->error_type);
+    gaus_error_release(error);
+  }
+};
+
+TEST_F(GausReportBuilder, builds_the_same_reports_as_laid_out_by_hand) {
+  build(&builder);
+
+  EXPECT_EQ(expectedBody(), finishAndEncode(&builder));
+}
+
+TEST_F(GausReportBuilder, keeps_everything_in_the_arena) {
+  char type[] = "Temperature";
+  char name[] = "temperature";
+  gaus_report_builder_header(&builder, TS);
+  gaus_report_builder_begin(&builder, GAUS_REPORT_GENERIC, type, TS, 0, 1, 0);
+  gaus_report_builder_float(&builder, name, 23.0f);
+  strcpy(type, "Overwritten");
+  strcpy(name, "overwritten");
+
+  const gaus_report_header_t *header = NULL;
+  unsigned int count = 0;
+  const gaus_report_t *reports = NULL;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_builder_finish(&builder, &header, &count, &reports));
+
+  ASSERT_EQ(1, count);
+  EXPECT_STREQ("Temperature", reports[0].report.generic.type);
+  EXPECT_STREQ("temperature", reports[0].report.generic.v_floats[0].name);
+  const void *pointers[] = {header->ts, reports, reports[0].report.generic.type, reports[0].report.generic.ts,
+                            reports[0].report.generic.v_floats, reports[0].report.generic.v_floats[0].name};
+  for (const void *pointer : pointers) {
+    EXPECT_TRUE(pointer >= arena && pointer < arena + sizeof(arena));
+  }
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(reports) % sizeof(void *));
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(reports[0].report.generic.v_floats) % sizeof(void *));
+}
+
+TEST_F(GausReportBuilder, works_in_an_unaligned_arena) {
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_builder_init(&builder, arena + 1, sizeof(arena) - 1));
+
+  build(&builder);
+
+  EXPECT_EQ(expectedBody(), finishAndEncode(&builder));
+}
+
+TEST_F(GausReportBuilder, fails_when_the_arena_is_full) {
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_builder_init(&builder, arena, 128));
+
+  build(&builder);
+
+  expectFailure(&builder);
+}
+
+TEST_F(GausReportBuilder, fails_in_an_empty_arena) {
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_builder_init(&builder, arena, 0));
+
+  gaus_report_builder_begin(&builder, GAUS_REPORT_GENERIC, "Temperature", TS, 0, 0, 0);
+
+  expectFailure(&builder);
+}
+
+TEST_F(GausReportBuilder, reset_starts_over) {
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_builder_init(&builder, arena, 256));
+  build(&builder);
+  expectFailure(&builder);
+
+  gaus_report_builder_reset(&builder);
+  gaus_report_builder_header(&builder, TS);
+  gaus_report_builder_begin(&builder, GAUS_REPORT_GENERIC, "Temperature", TS, 0, 1, 0);
+  gaus_report_builder_float(&builder, "temperature", 23.0f);
+
+  const gaus_report_header_t *header = NULL;
+  unsigned int count = 0;
+  const gaus_report_t *reports = NULL;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_builder_finish(&builder, &header, &count, &reports));
+  EXPECT_EQ(1, count);
+  EXPECT_STREQ(TS, header->ts);
+}
+
+TEST_F(GausReportBuilder, fails_adding_more_values_than_begun_with) {
+  gaus_report_builder_header(&builder, TS);
+  gaus_report_builder_begin(&builder, GAUS_REPORT_GENERIC, "Temperature", TS, 0, 1, 0);
+  gaus_report_builder_float(&builder, "temperature", 23.0f);
+  gaus_report_builder_float(&builder, "humidity", 41.0f);
+
+  expectFailure(&builder);
+}
+
+TEST_F(GausReportBuilder, fails_adding_a_value_before_a_report) {
+  gaus_report_builder_string(&builder, "phase", "install");
+
+  expectFailure(&builder);
+}
+
+TEST_F(GausReportBuilder, fails_with_invalid_parameters) {
+  gaus_report_builder_begin(&builder, GAUS_REPORT_COUNTER, "Counter", TS, 1, 0, 0);
+  expectFailure(&builder);
+
+  gaus_report_builder_reset(&builder);
+  gaus_report_builder_begin(&builder, GAUS_REPORT_GENERIC, "Temperature", TS, 0, 1, 0);
+  gaus_report_builder_float(&builder, NULL, 23.0f);
+  expectFailure(&builder);
+
+  gaus_report_builder_reset(&builder);
+  gaus_report_builder_begin(&builder, GAUS_REPORT_GENERIC, NULL, TS, 0, 0, 0);
+  expectFailure(&builder);
+
+  gaus_error_t *error = gaus_report_builder_finish(&builder, NULL, NULL, NULL);
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), error);
+  gaus_error_release(error);
+}
+
+TEST_F(GausReportBuilder, allocates_its_own_arena_once) {
+  gaus_report_builder_t pooled;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_builder_init(&pooled, NULL, 1024));
+  build(&pooled);
+  EXPECT_EQ(expectedBody(), finishAndEncode(&pooled));
+
+  if (allocCounterAvailable()) {
+    allocCounterStart();
+    for (int i = 0; i < 100; i++) {
+      gaus_report_builder_reset(&pooled);
+      build(&pooled);
+    }
+    EXPECT_EQ(0, allocCounterStop().allocations);
+  }
+  gaus_report_builder_free(&pooled);
+}
+
+//Weeks of a report every few seconds, next to other heap users, must not make the heap grow
+TEST_F(GausReportBuilder, soak_keeps_the_heap_flat) {
+#ifdef HAS_MALLINFO2
+  if (allocCounterAvailable()) {
+    //Long lived blocks of other tasks, one of them replaced by one of another size every cycle
+    std::vector<void *> others(64, nullptr);
+    uint32_t seed = 1;
+    size_t builderAllocations = 0;
+    size_t heapAfterWarmUp = 0;
+    const int cycles = 50000;
+    for (int i = 0; i < cycles; i++) {
+      seed = seed * 1103515245u + 12345u;
+      void *&other = others[(seed >> 8) % others.size()];
+      free(other);
+      other = malloc(16 + (seed >> 16) % 512);
+
+      allocCounterStart();
+      gaus_report_builder_reset(&builder);
+      build(&builder);
+      builderAllocations += allocCounterStop().allocations;
+      ASSERT_EQ(expectedBody().size(), finishAndEncode(&builder).size());
+
+      if (i == cycles / 10) {
+        heapAfterWarmUp = mallinfo2().arena;
+      }
+    }
+    EXPECT_EQ(0, builderAllocations);
+    EXPECT_LE(mallinfo2().arena, heapAfterWarmUp);
+    for (void *other : others) {
+      free(other);
+    }
+  }
+#endif
+}
@@ -0,0 +1,373 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+#include <cmath>
+#include <cstdio>
+#include <unistd.h>
+#include <string>
+
+class GausReportDeadband : public ::testing::Test {
+protected:
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("FAKE_HEADER_TS")};
+  gaus_initialization_options_t options = {};
+  gaus_report_deadband_rule_t rules[2] = {
+      {"Temperature", "temperature", 1.0f, 0, 0},
+      {"Humidity", "humidity", 5.0f, 0, 0}
+  };
+
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    free(fakeResponse);
+    fakeResponse = strdup("{}");
+    options.report_deadband.rule_count = 2;
+    options.report_deadband.rules = rules;
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+
+  void init() {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", &options));
+  }
+
+  static gaus_report_t report(const char *type, gaus_v_float_t *value) {
+    gaus_report_t report = {};
+    report.report_type = GAUS_REPORT_GENERIC;
+    report.report.generic.type = const_cast<char *>(type);
+    report.report.generic.ts = const_cast<char *>("FAKE_TS");
+    report.report.generic.v_float_count = 1;
+    report.report.generic.v_floats = value;
+    return report;
+  }
+
+  void send(float value, const char *type = "Temperature", const char *name = "temperature") {
+    gaus_v_float_t floats[1] = {{const_cast<char *>(name), value}};
+    gaus_report_t reports[1] = {report(type, floats)};
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 1, reports));
+  }
+
+  static CurlFailure failWith(CURLcode result, long statusCode = 0) {
+    CurlFailure failure;
+    failure.result = result;
+    failure.statusCode = statusCode;
+    return failure;
+  }
+
+  void failToSend(float value) {
+    gaus_v_float_t floats[1] = {{const_cast<char *>("temperature"), value}};
+    gaus_report_t reports[1] = {report("Temperature", floats)};
+    fakeFailures.push_back(failWith(CURLE_OK, 500));
+    gaus_error_t *status = gaus_report(&fakeSession, 0, NULL, &header, 1, reports);
+    ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+    gaus_error_release(status);
+  }
+
+  static std::string entry(const char *type, const std::string &ints, const std::string &floats) {
+    return std::string("{\"type\":\"event.generic.") + type + "\",\"ts\":\"FAKE_TS\",\"v_ints\":{" + ints +
+           "},\"v_floats\":{" + floats + "},\"v_strings\":{}}";
+  }
+
+  static std::string body(const std::string &entries) {
+    return "{\"version\":\"1.0.0\",\"header\":{\"ts\":\"FAKE_HEADER_TS\"},\"data\":[" + entries + "]}";
+  }
+};
+
+struct ReportResult {
+  bool done;
+  gaus_error_t *error;
+};
+
+static void reportDone(gaus_error_t *error, void *user_data) {
+  ReportResult *result = static_cast<ReportResult *>(user_data);
+  result->done = true;
+  result->error = error;
+}
+
+TEST_F(GausReportDeadband, fails_init_with_an_invalid_rule) {
+  rules[1].name = NULL;
+
+  gaus_error_t *status = gaus_global_init("fakeServerUrl", &options);
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_BAD_INIT_ERROR, status->error_type);
+  gaus_error_release(status);
+}
+
+TEST_F(GausReportDeadband, fails_init_with_a_negative_deadband) {
+  rules[0].deadband = -1.0f;
+
+  gaus_error_t *status = gaus_global_init("fakeServerUrl", &options);
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_BAD_INIT_ERROR, status->error_type);
+  gaus_error_release(status);
+}
+
+TEST_F(GausReportDeadband, sends_the_first_value) {
+  init();
+
+  send(21.0f);
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(body(entry("Temperature", "", "\"temperature\":21.0")), curlPerformData[0].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportDeadband, holds_back_values_within_the_deadband) {
+  init();
+
+  send(21.0f);
+  send(21.0f);
+  send(21.5f);
+  send(20.5f);
+
+  EXPECT_EQ(1, curlPerformData.size());
+}
+
+TEST_F(GausReportDeadband, sends_a_value_that_moved_by_the_deadband) {
+  init();
+
+  send(21.0f);
+  send(21.5f);
+  send(22.0f);
+  send(21.5f);
+  send(21.0f);
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ(body(entry("Temperature", "", "\"temperature\":22.0")), curlPerformData[1].CURLOPT_POSTFIELDS);
+  EXPECT_EQ(body(entry("Temperature", "", "\"temperature\":21.0")), curlPerformData[2].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportDeadband, zero_deadband_sends_every_change) {
+  rules[0].deadband = 0.0f;
+  init();
+
+  send(21.0f);
+  send(21.0f);
+  send(21.25f);
+
+  EXPECT_EQ(2, curlPerformData.size());
+}
+
+TEST_F(GausReportDeadband, sends_an_unchanged_value_after_the_heartbeat) {
+  rules[0].heartbeat_ms = 20;
+  init();
+
+  send(21.0f);
+  send(21.0f);
+  usleep(30 * 1000);
+  send(21.0f);
+  send(21.0f);
+
+  EXPECT_EQ(2, curlPerformData.size());
+}
+
+TEST_F(GausReportDeadband, adds_a_summary_of_held_back_values) {
+  rules[0].summary = 1;
+  init();
+
+  send(21.0f);
+  send(21.5f);
+  send(20.5f);
+  send(21.0f);
+  send(23.0f);
+  send(25.0f);
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ(body(entry("Temperature", "\"temperature_count\":3",
+                       "\"temperature\":23.0,\"temperature_min\":20.5,\"temperature_max\":21.5,"
+                       "\"temperature_mean\":21.0")),
+            curlPerformData[1].CURLOPT_POSTFIELDS);
+  //Nothing was held back since
+  EXPECT_EQ(body(entry("Temperature", "", "\"temperature\":25.0")), curlPerformData[2].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportDeadband, sends_a_value_again_after_failing_to_send_it) {
+  init();
+  send(21.0f);
+
+  failToSend(23.0f);
+  send(23.0f);
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ(body(entry("Temperature", "", "\"temperature\":23.0")), curlPerformData[2].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportDeadband, keeps_the_summary_of_a_value_it_failed_to_send) {
+  rules[0].summary = 1;
+  init();
+  send(21.0f);
+  send(21.5f);
+  send(20.5f);
+
+  failToSend(23.0f);
+  send(23.0f);
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ(curlPerformData[1].CURLOPT_POSTFIELDS, curlPerformData[2].CURLOPT_POSTFIELDS);
+  EXPECT_EQ(body(entry("Temperature", "\"temperature_count\":2",
+                       "\"temperature\":23.0,\"temperature_min\":20.5,\"temperature_max\":21.5,"
+                       "\"temperature_mean\":21.0")),
+            curlPerformData[2].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportDeadband, keeps_each_metric_apart) {
+  init();
+
+  send(21.0f);
+  send(40.0f, "Humidity", "humidity");
+  send(21.0f);
+  send(42.0f, "Humidity", "humidity");
+  send(45.0f, "Humidity", "humidity");
+
+  EXPECT_EQ(3, curlPerformData.size());
+}
+
+TEST_F(GausReportDeadband, sends_only_the_reports_due) {
+  init();
+  send(21.0f);
+  send(40.0f, "Humidity", "humidity");
+  gaus_v_float_t temperature[1] = {{const_cast<char *>("temperature"), 21.0f}};
+  gaus_v_float_t humidity[1] = {{const_cast<char *>("humidity"), 50.0f}};
+  gaus_report_t reports[2] = {report("Temperature", temperature), report("Humidity", humidity)};
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 2, reports));
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ(body(entry("Humidity", "", "\"humidity\":50.0")), curlPerformData[2].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportDeadband, always_sends_reports_with_other_values) {
+  init();
+  send(21.0f);
+  gaus_v_float_t floats[2] = {{const_cast<char *>("temperature"), 21.0f}, {const_cast<char *>("dew_point"), 10.0f}};
+  gaus_v_int_t ints[1] = {{const_cast<char *>("battery"), 90}};
+  gaus_report_t withFloat = report("Temperature", floats);
+  withFloat.report.generic.v_float_count = 2;
+  gaus_report_t withInt = report("Temperature", floats);
+  withInt.report.generic.v_int_count = 1;
+  withInt.report.generic.v_ints = ints;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 1, &withFloat));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 1, &withInt));
+
+  EXPECT_EQ(3, curlPerformData.size());
+}
+
+TEST_F(GausReportDeadband, always_sends_reports_of_other_types) {
+  init();
+  gaus_v_string_t strings[1] = {{const_cast<char *>("state"), const_cast<char *>("Downloading")}};
+  gaus_report_t status = {};
+  status.report_type = GAUS_REPORT_UPDATE;
+  status.report.update_status.type = const_cast<char *>("Status");
+  status.report.update_status.ts = const_cast<char *>("FAKE_TS");
+  status.report.update_status.v_string_count = 1;
+  status.report.update_status.v_strings = strings;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 1, &status));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 1, &status));
+
+  EXPECT_EQ(2, curlPerformData.size());
+}
+
+TEST_F(GausReportDeadband, async_report_held_back_calls_back_at_once) {
+  init();
+  send(21.0f);
+  gaus_v_float_t floats[1] = {{const_cast<char *>("temperature"), 21.0f}};
+  gaus_report_t reports[1] = {report("Temperature", floats)};
+  ReportResult result = {false, NULL};
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_report_async(&fakeSession, 0, NULL, &header, 1, reports, reportDone, &result));
+
+  EXPECT_TRUE(result.done);
+  EXPECT_EQ(static_cast<gaus_error_t *>(NULL), result.error);
+  unsigned int pending = 1;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, &pending));
+  EXPECT_EQ(0, pending);
+  EXPECT_EQ(1, curlPerformData.size());
+}
+
+TEST_F(GausReportDeadband, async_report_that_fails_is_sent_again) {
+  init();
+  send(21.0f);
+  gaus_v_float_t floats[1] = {{const_cast<char *>("temperature"), 23.0f}};
+  gaus_report_t reports[1] = {report("Temperature", floats)};
+  ReportResult result = {false, NULL};
+  fakeFailures.push_back(failWith(CURLE_COULDNT_CONNECT));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_report_async(&fakeSession, 0, NULL, &header, 1, reports, reportDone, &result));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(100, NULL));
+  ASSERT_TRUE(result.done);
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), result.error);
+  gaus_error_release(result.error);
+  send(23.0f);
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ(curlPerformData[1].CURLOPT_POSTFIELDS, curlPerformData[2].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportDeadband, batches_only_values_due) {
+  options.report_batch.max_reports = 2;
+  init();
+  const float values[] = {21.0f, 21.5f, 21.0f, 23.0f};
+
+  for (float value : values) {
+    gaus_v_float_t floats[1] = {{const_cast<char *>("temperature"), value}};
+    gaus_report_t reports[1] = {report("Temperature", floats)};
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_enqueue(&fakeSession, NULL, &header, 1, reports));
+  }
+  unsigned int pending = 1;
+  while (pending) {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, &pending));
+  }
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(body(entry("Temperature", "", "\"temperature\":21.0") + "," +
+                 entry("Temperature", "", "\"temperature\":23.0")),
+            curlPerformData[0].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportDeadband, enqueues_a_value_again_after_failing_to_enqueue_it) {
+  options.report_batch.max_reports = 2;
+  init();
+  gaus_v_float_t first[1] = {{const_cast<char *>("temperature"), 21.0f}};
+  gaus_v_float_t humidity[1] = {{const_cast<char *>("humidity"), NAN}};
+  gaus_v_float_t temperature[1] = {{const_cast<char *>("temperature"), 23.0f}};
+  gaus_report_t firstReport = report("Temperature", first);
+  //A humidity that is not a number fails to encode, so the temperature after it is not enqueued
+  gaus_report_t reports[2] = {report("Humidity", humidity), report("Temperature", temperature)};
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_enqueue(&fakeSession, NULL, &header, 1, &firstReport));
+
+  gaus_error_t *status = gaus_report_enqueue(&fakeSession, NULL, &header, 2, reports);
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  gaus_error_release(status);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_enqueue(&fakeSession, NULL, &header, 1, &reports[1]));
+  unsigned int pending = 1;
+  while (pending) {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, &pending));
+  }
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(body(entry("Temperature", "", "\"temperature\":21.0") + "," +
+                 entry("Temperature", "", "\"temperature\":23.0")),
+            curlPerformData[0].CURLOPT_POSTFIELDS);
+}
@@ -0,0 +1,378 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+#include <cstdio>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#define SECTOR_SIZE 256
+
+//Memory behaving like NOR flash: writes only clear bits, erasing sets whole sectors back to 0xFF
+struct FakeFlash {
+  std::vector<unsigned char> memory;
+  int writes = 0;
+  int failWrite = -1; //Fail the write with this index
+
+  explicit FakeFlash(size_t size) : memory(size, 0xFF) {}
+
+  static int read(void *user_data, size_t offset, unsigned char *buffer, size_t length) {
+    FakeFlash *flash = static_cast<FakeFlash *>(user_data);
+    EXPECT_LE(offset + length, flash->memory.size());
+    memcpy(buffer, flash->memory.data() + offset, length);
+    return 0;
+  }
+
+  static int write(void *user_data, size_t offset, const unsigned char *buffer, size_t length) {
+    FakeFlash *flash = static_cast<FakeFlash *>(user_data);
+    EXPECT_LE(offset + length, flash->memory.size());
+    if (flash->writes++ == flash->failWrite) {
+      return -1;
+    }
+    for (size_t i = 0; i < length; i++) {
+      flash->memory[offset + i] &= buffer[i];
+    }
+    return 0;
+  }
+
+  static int erase(void *user_data, size_t offset, size_t length) {
+    FakeFlash *flash = static_cast<FakeFlash *>(user_data);
+    EXPECT_EQ(0, offset % SECTOR_SIZE);
+    EXPECT_EQ(0, length % SECTOR_SIZE);
+    memset(flash->memory.data() + offset, 0xFF, length);
+    return 0;
+  }
+
+  gaus_report_queue_store_t store() {
+    return {this, memory.size(), SECTOR_SIZE, read, write, erase};
+  }
+};
+
+class GausReportQueue : public ::testing::Test {
+protected:
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("FAKE_HEADER_TS")};
+  FakeFlash flash = FakeFlash(8 * SECTOR_SIZE);
+  gaus_report_queue_store_t store = flash.store();
+
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+
+  void init() {
+    gaus_initialization_options_t options = {};
+    options.report_queue_store = &store;
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", &options));
+  }
+
+  void restart() {
+    gaus_global_cleanup();
+    init();
+  }
+
+  void push(float value, const char *ts = "FAKE_TS") {
+    gaus_v_float_t floats[1] = {{const_cast<char *>("temperature"), value}};
+    gaus_report_t report = {};
+    report.report_type = GAUS_REPORT_GENERIC;
+    report.report.generic.type = const_cast<char *>("Temperature");
+    report.report.generic.ts = const_cast<char *>(ts);
+    report.report.generic.v_float_count = 1;
+    report.report.generic.v_floats = floats;
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_queue_push(1, &report));
+  }
+
+  //Start a batch and carry it out
+  void drain(const gaus_report_queue_drain_options_t *options = NULL) {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_queue_drain(&fakeSession, NULL, &header, options));
+    unsigned int pending = 1;
+    while (pending) {
+      ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, &pending));
+    }
+  }
+
+  static std::string entry(float value, const char *ts = "FAKE_TS") {
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "{\"type\":\"event.generic.Temperature\",\"ts\":\"%s\",\"v_ints\":{},"
+                                     "\"v_floats\":{\"temperature\":%.1f},\"v_strings\":{}}", ts, value);
+    return buffer;
+  }
+
+  static std::string body(const std::vector<std::string> &entries) {
+    std::string body = "{\"version\":\"1.0.0\",\"header\":{\"ts\":\"FAKE_HEADER_TS\"},\"data\":[";
+    for (size_t i = 0; i < entries.size(); i++) {
+      body += (i ? "," : "") + entries[i];
+    }
+    return body + "]}";
+  }
+
+  static CurlFailure failWith(CURLcode result, long statusCode = 0) {
+    CurlFailure failure;
+    failure.result = result;
+    failure.statusCode = statusCode;
+    return failure;
+  }
+};
+
+TEST_F(GausReportQueue, fails_without_a_store) {
+  gaus_global_init("fakeServerUrl", NULL);
+  gaus_report_t report = {};
+  report.report_type = GAUS_REPORT_GENERIC;
+
+  gaus_error_t *status = gaus_report_queue_push(1, &report);
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_BAD_INIT_ERROR, status->error_type);
+  gaus_error_release(status);
+}
+
+TEST_F(GausReportQueue, sends_queued_reports_in_one_batch) {
+  init();
+  push(21.0f, "TS_1");
+  push(22.0f, "TS_2");
+
+  drain();
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/report", curlPerformData[0].CURLOPT_URL);
+  EXPECT_EQ(body({entry(21.0f, "TS_1"), entry(22.0f, "TS_2")}), curlPerformData[0].CURLOPT_POSTFIELDS);
+  gaus_report_queue_stats_t stats = gaus_get_report_queue_stats();
+  EXPECT_EQ(0, stats.pending);
+  EXPECT_EQ(2, stats.queued);
+  EXPECT_EQ(2, stats.sent);
+  EXPECT_EQ(1, stats.batches);
+}
+
+TEST_F(GausReportQueue, batch_matches_gaus_report) {
+  gaus_v_int_t ints[1] = {{const_cast<char *>("count"), 3}};
+  gaus_v_string_t strings[1] = {{const_cast<char *>("phase"), const_cast<char *>("download")}};
+  gaus_report_t reports[2] = {};
+  reports[0].report_type = GAUS_REPORT_UPDATE;
+  reports[0].report.update_status.type = const_cast<char *>("Status");
+  reports[0].report.update_status.ts = const_cast<char *>("TS_1");
+  reports[0].report.update_status.v_string_count = 1;
+  reports[0].report.update_status.v_strings = strings;
+  reports[1].report_type = GAUS_REPORT_GENERIC;
+  reports[1].report.generic.type = const_cast<char *>("Counter");
+  reports[1].report.generic.ts = const_cast<char *>("TS_2");
+  reports[1].report.generic.v_int_count = 1;
+  reports[1].report.generic.v_ints = ints;
+  init();
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 2, reports));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_queue_push(2, reports));
+  drain();
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(curlPerformData[0].CURLOPT_POSTFIELDS, curlPerformData[1].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportQueue, does_nothing_when_empty) {
+  init();
+
+  drain();
+
+  EXPECT_EQ(0, curlPerformData.size());
+}
+
+TEST_F(GausReportQueue, keeps_reports_until_the_server_takes_them) {
+  init();
+  push(21.0f);
+  fakeFailures.push_back(failWith(CURLE_COULDNT_CONNECT));
+
+  drain();
+  EXPECT_EQ(1, gaus_get_report_queue_stats().pending);
+  EXPECT_EQ(1, gaus_get_report_queue_stats().failed_batches);
+  push(22.0f);
+  drain();
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(body({entry(21.0f), entry(22.0f)}), curlPerformData[1].CURLOPT_POSTFIELDS);
+  EXPECT_EQ(0, gaus_get_report_queue_stats().pending);
+}
+
+TEST_F(GausReportQueue, waits_after_a_failed_batch) {
+  gaus_report_queue_drain_options_t options = {0, 0, {0, 60000, 60000}};
+  init();
+  push(21.0f);
+  fakeFailures.push_back(failWith(CURLE_OK, 503));
+
+  drain(&options);
+  drain(&options);
+
+  EXPECT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(1, gaus_get_report_queue_stats().pending);
+}
+
+TEST_F(GausReportQueue, drops_reports_the_server_refuses) {
+  init();
+  push(21.0f);
+  fakeFailures.push_back(failWith(CURLE_OK, 400));
+
+  drain();
+  drain();
+
+  EXPECT_EQ(1, curlPerformData.size());
+  gaus_report_queue_stats_t stats = gaus_get_report_queue_stats();
+  EXPECT_EQ(0, stats.pending);
+  EXPECT_EQ(1, stats.rejected);
+  EXPECT_EQ(0, stats.sent);
+}
+
+TEST_F(GausReportQueue, keeps_reports_across_restarts) {
+  init();
+  push(21.0f);
+  push(22.0f);
+  drain();
+  push(23.0f);
+  push(24.0f);
+
+  restart();
+  EXPECT_EQ(2, gaus_get_report_queue_stats().pending);
+  drain();
+  restart();
+  drain();
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(body({entry(23.0f), entry(24.0f)}), curlPerformData[1].CURLOPT_POSTFIELDS);
+  EXPECT_EQ(0, gaus_get_report_queue_stats().pending);
+}
+
+TEST_F(GausReportQueue, skips_a_report_cut_short) {
+  init();
+  push(21.0f);
+  //Writes are the header, the report and its state: fail the last one as if the device restarted in between
+  flash.failWrite = flash.writes + 2;
+  gaus_report_t report = {};
+  gaus_v_float_t floats[1] = {{const_cast<char *>("temperature"), 22.0f}};
+  report.report_type = GAUS_REPORT_GENERIC;
+  report.report.generic.type = const_cast<char *>("Temperature");
+  report.report.generic.ts = const_cast<char *>("FAKE_TS");
+  report.report.generic.v_float_count = 1;
+  report.report.generic.v_floats = floats;
+  gaus_error_t *status = gaus_report_queue_push(1, &report);
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  gaus_error_release(status);
+  flash.failWrite = -1;
+
+  restart();
+  push(23.0f);
+  drain();
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(body({entry(21.0f), entry(23.0f)}), curlPerformData[0].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportQueue, splits_a_backlog_into_batches) {
+  gaus_report_queue_drain_options_t options = {400, 0, {0, 0, 0}};
+  init();
+  for (int i = 0; i < 10; i++) {
+    push(20.0f + i);
+  }
+
+  while (gaus_get_report_queue_stats().pending > 0 && curlPerformData.size() < 10) {
+    drain(&options);
+  }
+
+  ASSERT_LT(1, curlPerformData.size());
+  std::string data;
+  for (const CurlOptionsData &batch : curlPerformData) {
+    EXPECT_GE(400, batch.CURLOPT_POSTFIELDS.size());
+    std::string entries = batch.CURLOPT_POSTFIELDS.substr(body({}).size() - 2);
+    data += (data.empty() ? "" : ",") + entries.substr(0, entries.size() - 2);
+  }
+  std::vector<std::string> expected;
+  for (int i = 0; i < 10; i++) {
+    expected.push_back(entry(20.0f + i));
+  }
+  EXPECT_EQ(body(expected), body({data}));
+  EXPECT_EQ(curlPerformData.size(), gaus_get_report_queue_stats().batches);
+}
+
+TEST_F(GausReportQueue, limits_the_upload_rate) {
+  gaus_report_queue_drain_options_t options = {400, 1, {0, 0, 0}};
+  init();
+  for (int i = 0; i < 20; i++) {
+    push(20.0f + i);
+  }
+
+  drain(&options);
+  drain(&options);
+
+  EXPECT_EQ(1, curlPerformData.size());
+  EXPECT_LT(0, gaus_get_report_queue_stats().pending);
+}
+
+TEST_F(GausReportQueue, drops_the_oldest_reports_when_full) {
+  init();
+  for (int i = 0; i < 40; i++) {
+    push(20.0f + i);
+  }
+
+  gaus_report_queue_stats_t stats = gaus_get_report_queue_stats();
+  EXPECT_LT(0, stats.dropped);
+  EXPECT_EQ(40, stats.pending + stats.dropped);
+  drain();
+
+  ASSERT_EQ(1, curlPerformData.size());
+  std::string sent = curlPerformData[0].CURLOPT_POSTFIELDS;
+  EXPECT_EQ(std::string::npos, sent.find(entry(20.0f)));
+  EXPECT_NE(std::string::npos, sent.find(entry(59.0f)));
+  EXPECT_EQ(stats.pending, gaus_get_report_queue_stats().sent);
+}
+
+TEST_F(GausReportQueue, keeps_reports_queued_while_a_batch_is_in_flight) {
+  init();
+  push(21.0f);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_queue_drain(&fakeSession, NULL, &header, NULL));
+  push(22.0f);
+  //Only one batch at a time
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report_queue_drain(&fakeSession, NULL, &header, NULL));
+  unsigned int pending = 1;
+  while (pending) {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, &pending));
+  }
+  EXPECT_EQ(1, gaus_get_report_queue_stats().pending);
+
+  drain();
+
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_EQ(body({entry(22.0f)}), curlPerformData[1].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReportQueue, keeps_reports_in_a_file) {
+  char path[] = "/tmp/gaus_report_queue_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(-1, fd);
+  close(fd);
+  store = {path, 4 * SECTOR_SIZE, SECTOR_SIZE, gaus_report_queue_file_read, gaus_report_queue_file_write,
+           gaus_report_queue_file_erase};
+  init();
+  push(21.0f);
+
+  restart();
+  drain();
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ(body({entry(21.0f)}), curlPerformData[0].CURLOPT_POSTFIELDS);
+  remove(path);
+}
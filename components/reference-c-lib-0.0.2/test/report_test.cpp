@@ -9,10 +9,16 @@
 //THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <gtest/gtest.h>
 #include "gaus/gaus_client.h"
+#include "cbor_decode.h"
 #include "curl_mock.h"
 
 //Access gaus curl wrapper
 #include "../src/libgaus/curl_wrapper.h"
+//Access gaus internals
+#include "../src/libgaus/report.h"
+
+#include <algorithm>
+#include <climits>
 
 #include <cstdarg>
 
@@ -114,8 +120,7 @@ TEST_F(GausReport, fails_without_initialize) {
   free(fakeSession.token);
   freeReports(reportCount, report);
   free(header.ts);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausReport, fails_without_session) {
@@ -153,10 +158,9 @@ TEST_F(GausReport, fails_without_session) {
   EXPECT_NE(strlen(status->description), 0);
 
   //Cleanup after test
-  free(status->description);
+  gaus_error_release(status);
   freeReports(reportCount, report);
   free(header.ts);
-  free(status);
 }
 
 
@@ -205,8 +209,7 @@ TEST_F(GausReport, fails_without_device_guid) {
   free(fakeSession.token);
   freeReports(reportCount, report);
   free(header.ts);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausReport, fails_without_product_guid) {
@@ -254,8 +257,7 @@ TEST_F(GausReport, fails_without_product_guid) {
   free(fakeSession.token);
   freeReports(reportCount, report);
   free(header.ts);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausReport, fails_without_token) {
@@ -303,8 +305,7 @@ TEST_F(GausReport, fails_without_token) {
   free(fakeSession.token);
   freeReports(reportCount, report);
   free(header.ts);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 
@@ -353,8 +354,7 @@ TEST_F(GausReport, fails_if_filter_count_and_no_filter) {
   free(fakeSession.token);
   freeReports(reportCount, report);
   free(header.ts);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausReport, fails_if_no_header) {
@@ -398,8 +398,7 @@ TEST_F(GausReport, fails_if_no_header) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   freeReports(reportCount, report);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 
@@ -449,8 +448,7 @@ TEST_F(GausReport, fails_if_report_count_lt_1) {
   free(fakeSession.token);
   freeReports(1, report); //Report count is "wrong" here for test
   free(header.ts);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausReport, fails_if_no_report) {
@@ -479,8 +477,7 @@ TEST_F(GausReport, fails_if_no_report) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   free(header.ts);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausReport, posts_to_correct_address) {
@@ -876,8 +873,7 @@ TEST_F(GausReport, handles_errors_on_perform_without_status) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   free(header.ts);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 
@@ -953,8 +949,7 @@ TEST_F(GausReport, handles_errors_on_perform_with_status_500) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   free(header.ts);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 static CURLcode mock_curl_easy_getinfo_return_400(CURL *curl, CURLINFO info, ...) {
@@ -1029,8 +1024,7 @@ TEST_F(GausReport, handles_errors_on_perform_with_status_400) {
   free(fakeSession.product_guid);
   free(fakeSession.token);
   free(header.ts);
-  free(status->description);
-  free(status);
+  gaus_error_release(status);
 }
 
 TEST_F(GausReport, has_correct_auth_header) {
@@ -1300,6 +1294,233 @@ TEST_F(GausReport, posts_correct_json_for_generic_report) {
   free(status);
 }
 
+TEST_F(GausReport, posts_first_value_of_repeated_names_and_escapes_strings) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+  gaus_v_int_t vints[3] = {{const_cast<char *>("a"), 1}, {const_cast<char *>("b"), -2}, {const_cast<char *>("a"), 3}};
+  gaus_v_float_t vfloats[2] = {{const_cast<char *>("t"), 21.0f}, {const_cast<char *>("t"), 22.0f}};
+  gaus_v_string_t vstrings[1] = {{const_cast<char *>("line\n"), const_cast<char *>("\"caf\xc3\xa9\"\x01")}};
+  gaus_report_t report = {};
+  report.report_type = GAUS_REPORT_GENERIC;
+  report.report.generic.type = const_cast<char *>("Multi");
+  report.report.generic.ts = const_cast<char *>("FAKE_TIME");
+  report.report.generic.v_int_count = 3;
+  report.report.generic.v_ints = vints;
+  report.report.generic.v_float_count = 2;
+  report.report.generic.v_floats = vfloats;
+  report.report.generic.v_string_count = 1;
+  report.report.generic.v_strings = vstrings;
+  gaus_global_init("fakeServerUrl", NULL);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 1, &report));
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ("{\"version\":\"1.0.0\",\"header\":{\"ts\":\"FAKE_TIMESTAMP\"},\"data\":[{\"type\":\"event.generic.Multi\","
+            "\"ts\":\"FAKE_TIME\",\"v_ints\":{\"a\":1,\"b\":-2},\"v_floats\":{\"t\":21.0},"
+            "\"v_strings\":{\"line\\n\":\"\\\"caf\xc3\xa9\\\"\\u0001\"}}]}", curlPerformData[0].CURLOPT_POSTFIELDS);
+}
+
+TEST_F(GausReport, fails_for_a_string_that_is_not_utf8) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+  gaus_v_string_t vstrings[1] = {{const_cast<char *>("key"), const_cast<char *>("\xff")}};
+  gaus_report_t report = {};
+  report.report_type = GAUS_REPORT_UPDATE;
+  report.report.update_status.type = const_cast<char *>("Status");
+  report.report.update_status.ts = const_cast<char *>("FAKE_TIME");
+  report.report.update_status.v_string_count = 1;
+  report.report.update_status.v_strings = vstrings;
+  gaus_global_init("fakeServerUrl", NULL);
+
+  gaus_error_t *status = gaus_report(&fakeSession, 0, NULL, &header, 1, &report);
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_UNKNOWN_ERROR, status->error_type);
+  EXPECT_EQ(0, curlPerformData.size());
+  gaus_error_release(status);
+}
+
+//What a server taking application/cbor reads from body, as compact json
+static std::string decodeToJson(const std::string &body) {
+  json_t *decoded = cborDecode(body);
+  char *json = decoded ? json_dumps(decoded, JSON_COMPACT | JSON_PRESERVE_ORDER) : NULL;
+  std::string result = json ? json : "<not cbor>";
+  free(json);
+  json_decref(decoded);
+  return result;
+}
+
+static bool hasHeader(const CurlOptionsData &request, const std::string &header) {
+  const std::vector<std::string> &headers = request.CURLOPT_HEADER;
+  return std::find(headers.begin(), headers.end(), header) != headers.end();
+}
+
+static void initWithFormat(gaus_report_format_t format) {
+  gaus_initialization_options_t options = {};
+  options.report_format = format;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", &options));
+}
+
+TEST_F(GausReport, cbor_body_decodes_to_the_json_body) {
+  gaus_report_header_t header = {const_cast<char *>("2018-11-15T12:00:22.000Z")};
+  gaus_v_float_t temperature[1] = {{const_cast<char *>("temperature"), 23.4f}};
+  gaus_v_float_t humidity[1] = {{const_cast<char *>("humidity"), 41.0f}};
+  gaus_v_int_t vints[3] = {{const_cast<char *>("a"), INT_MIN}, {const_cast<char *>("b"), INT_MAX},
+                           {const_cast<char *>("a"), 3}};
+  gaus_v_string_t status[4] = {{const_cast<char *>("phase"), const_cast<char *>("install")},
+                               {const_cast<char *>("status"), const_cast<char *>("success")},
+                               {const_cast<char *>("logLine"), const_cast<char *>("\"Installed\"\n caf\xc3\xa9")},
+                               {const_cast<char *>("updateId"), const_cast<char *>("1234-5678")}};
+  gaus_report_t reports[4] = {};
+  reports[0].report_type = GAUS_REPORT_GENERIC;
+  reports[0].report.generic.type = const_cast<char *>("Temperature");
+  reports[0].report.generic.ts = header.ts;
+  reports[0].report.generic.v_float_count = 1;
+  reports[0].report.generic.v_floats = temperature;
+  reports[1] = reports[0];
+  reports[1].report.generic.type = const_cast<char *>("Humidity");
+  reports[1].report.generic.v_floats = humidity;
+  reports[2].report_type = GAUS_REPORT_UPDATE;
+  reports[2].report.update_status.type = const_cast<char *>("Status");
+  reports[2].report.update_status.ts = header.ts;
+  reports[2].report.update_status.v_string_count = 4;
+  reports[2].report.update_status.v_strings = status;
+  reports[3] = reports[0];
+  reports[3].report.generic.type = const_cast<char *>("Counters");
+  reports[3].report.generic.v_int_count = 3;
+  reports[3].report.generic.v_ints = vints;
+  char *json = NULL;
+  char *cbor = NULL;
+  size_t jsonLength = 0;
+  size_t cborLength = 0;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            report_encode_body(&header, 4, reports, GAUS_REPORT_FORMAT_JSON, &json, &jsonLength));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            report_encode_body(&header, 4, reports, GAUS_REPORT_FORMAT_CBOR, &cbor, &cborLength));
+
+  EXPECT_EQ(strlen(json), jsonLength);
+  EXPECT_EQ(json, decodeToJson(std::string(cbor, cborLength)));
+  EXPECT_LT(cborLength, jsonLength);
+  free(json);
+  free(cbor);
+}
+
+TEST_F(GausReport, posts_cbor_when_asked_to) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+  gaus_v_float_t vfloats[1] = {{const_cast<char *>("temperature"), 21.5f}};
+  gaus_report_t report = {};
+  report.report_type = GAUS_REPORT_GENERIC;
+  report.report.generic.type = const_cast<char *>("Temperature");
+  report.report.generic.ts = const_cast<char *>("FAKE_TIME");
+  report.report.generic.v_float_count = 1;
+  report.report.generic.v_floats = vfloats;
+  initWithFormat(GAUS_REPORT_FORMAT_CBOR);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 1, &report));
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_TRUE(hasHeader(curlPerformData[0], "Content-Type: application/cbor"));
+  EXPECT_FALSE(hasHeader(curlPerformData[0], "Content-Type: application/json"));
+  EXPECT_TRUE(hasHeader(curlPerformData[0], "Authorization: Bearer fakeToken"));
+  EXPECT_EQ("{\"version\":\"1.0.0\",\"header\":{\"ts\":\"FAKE_TIMESTAMP\"},\"data\":["
+            "{\"type\":\"event.generic.Temperature\",\"ts\":\"FAKE_TIME\",\"v_ints\":{},\"v_floats\":{\"temperature\":21.5},\"v_strings\":{}}]}",
+            decodeToJson(curlPerformData[0].CURLOPT_POSTFIELDS));
+}
+
+TEST_F(GausReport, resends_as_json_and_keeps_to_json_once_cbor_is_refused) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+  gaus_v_float_t vfloats[1] = {{const_cast<char *>("temperature"), 21.5f}};
+  gaus_report_t report = {};
+  report.report_type = GAUS_REPORT_GENERIC;
+  report.report.generic.type = const_cast<char *>("Temperature");
+  report.report.generic.ts = const_cast<char *>("FAKE_TIME");
+  report.report.generic.v_float_count = 1;
+  report.report.generic.v_floats = vfloats;
+  CurlFailure unsupported;
+  unsupported.statusCode = 415;
+  fakeFailures.push_back(unsupported);
+  initWithFormat(GAUS_REPORT_FORMAT_CBOR);
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 1, &report));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&fakeSession, 0, NULL, &header, 1, &report));
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_TRUE(hasHeader(curlPerformData[0], "Content-Type: application/cbor"));
+  std::string json = decodeToJson(curlPerformData[0].CURLOPT_POSTFIELDS);
+  for (int i = 1; i < 3; i++) {
+    EXPECT_TRUE(hasHeader(curlPerformData[i], "Content-Type: application/json"));
+    EXPECT_FALSE(hasHeader(curlPerformData[i], "Content-Type: application/cbor"));
+    EXPECT_EQ(json, curlPerformData[i].CURLOPT_POSTFIELDS);
+  }
+}
+
+static void reportDone(gaus_error_t *error, void *user_data) {
+  *static_cast<gaus_error_t **>(user_data) = error;
+}
+
+TEST_F(GausReport, async_report_refused_for_cbor_fails_and_later_reports_use_json) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+  gaus_v_string_t vstrings[1] = {{const_cast<char *>("phase"), const_cast<char *>("download")}};
+  gaus_report_t report = {};
+  report.report_type = GAUS_REPORT_UPDATE;
+  report.report.update_status.type = const_cast<char *>("Status");
+  report.report.update_status.ts = const_cast<char *>("FAKE_TIME");
+  report.report.update_status.v_string_count = 1;
+  report.report.update_status.v_strings = vstrings;
+  CurlFailure unsupported;
+  unsupported.statusCode = 415;
+  fakeFailures.push_back(unsupported);
+  initWithFormat(GAUS_REPORT_FORMAT_CBOR);
+  gaus_error_t *errors[2] = {NULL, NULL};
+  unsigned int pending = 1;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_report_async(&fakeSession, 0, NULL, &header, 1, &report, reportDone, &errors[0]));
+  while (pending) {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, &pending));
+  }
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_report_async(&fakeSession, 0, NULL, &header, 1, &report, reportDone, &errors[1]));
+  pending = 1;
+  while (pending) {
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(0, &pending));
+  }
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), errors[0]);
+  EXPECT_EQ(GAUS_HTTP_ERROR, errors[0]->error_type);
+  EXPECT_EQ(415, errors[0]->http_error_code);
+  EXPECT_EQ(static_cast<gaus_error_t *>(NULL), errors[1]);
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_TRUE(hasHeader(curlPerformData[0], "Content-Type: application/cbor"));
+  EXPECT_TRUE(hasHeader(curlPerformData[1], "Content-Type: application/json"));
+  EXPECT_EQ(decodeToJson(curlPerformData[0].CURLOPT_POSTFIELDS), curlPerformData[1].CURLOPT_POSTFIELDS);
+  gaus_error_release(errors[0]);
+}
+
 //Test against a real backend
 //#define TEST_GAUS_REAL
 #ifdef TEST_GAUS_REAL
@@ -0,0 +1,247 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+//Access gaus internals
+#include "../src/libgaus/retry.h"
+
+#include <set>
+
+class GausRetry : public ::testing::Test {
+protected:
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    //Setup a default fake response that will work for all tests.
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+
+  //Retry up to maxAttempts times with short waits, within timeoutMs (0 for no limit)
+  void init(unsigned int maxAttempts, unsigned long timeoutMs = 0) {
+    gaus_initialization_options_t options = {};
+    options.call_options.timeout_ms = timeoutMs;
+    options.call_options.retry.max_attempts = maxAttempts;
+    options.call_options.retry.base_delay_ms = 1;
+    options.call_options.retry.max_delay_ms = 10;
+    gaus_global_init("fakeServerUrl", &options);
+  }
+
+  gaus_error_t *checkForUpdates() {
+    unsigned int updateCount = 0;
+    gaus_update_t *updates = NULL;
+    return gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates);
+  }
+
+  static CurlFailure replyWith(long statusCode, std::vector<std::string> headers = {}) {
+    CurlFailure failure;
+    failure.statusCode = statusCode;
+    failure.headers = headers;
+    return failure;
+  }
+
+  static CurlFailure failWith(CURLcode result) {
+    CurlFailure failure;
+    failure.result = result;
+    return failure;
+  }
+
+  static void expectHttpError(long statusCode, gaus_error_t *status) {
+    ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+    EXPECT_EQ(GAUS_HTTP_ERROR, status->error_type);
+    EXPECT_EQ(statusCode, status->http_error_code);
+    gaus_error_release(status);
+  }
+};
+
+TEST_F(GausRetry, classifies_failures) {
+  EXPECT_TRUE(retry_is_transient(CURLE_OK, 500));
+  EXPECT_TRUE(retry_is_transient(CURLE_OK, 503));
+  EXPECT_TRUE(retry_is_transient(CURLE_OK, 429));
+  EXPECT_TRUE(retry_is_transient(CURLE_OK, 408));
+  EXPECT_TRUE(retry_is_transient(CURLE_COULDNT_CONNECT, 0));
+  EXPECT_TRUE(retry_is_transient(CURLE_COULDNT_RESOLVE_HOST, 0));
+  EXPECT_TRUE(retry_is_transient(CURLE_RECV_ERROR, 0));
+
+  EXPECT_FALSE(retry_is_transient(CURLE_OK, 200));
+  EXPECT_FALSE(retry_is_transient(CURLE_OK, 400));
+  EXPECT_FALSE(retry_is_transient(CURLE_OK, 401));
+  EXPECT_FALSE(retry_is_transient(CURLE_OK, 404));
+  EXPECT_FALSE(retry_is_transient(CURLE_ABORTED_BY_CALLBACK, 0));
+  EXPECT_FALSE(retry_is_transient(CURLE_WRITE_ERROR, 0));
+  EXPECT_FALSE(retry_is_transient(CURLE_OUT_OF_MEMORY, 0));
+}
+
+TEST_F(GausRetry, parses_retry_after_seconds) {
+  EXPECT_EQ(0, retry_after_ms("0", 1));
+  EXPECT_EQ(120000, retry_after_ms("120", 3));
+  EXPECT_EQ(0, retry_after_ms("", 0));
+  //An HTTP date
+  EXPECT_EQ(0, retry_after_ms("Wed, 21 Oct 2015 07:28:00 GMT", 29));
+}
+
+TEST_F(GausRetry, delays_grow_exponentially_up_to_the_cap_with_full_jitter) {
+  gaus_retry_policy_t policy = {0, 100, 1000};
+  const unsigned long ceilings[] = {100, 200, 400, 800, 1000, 1000};
+
+  for (unsigned int failures = 1; failures <= 6; failures++) {
+    std::set<unsigned long> delays;
+    unsigned long largest = 0;
+    for (int i = 0; i < 1000; i++) {
+      unsigned long delay = gaus_retry_delay_ms(&policy, failures);
+      delays.insert(delay);
+      largest = std::max(largest, delay);
+    }
+    EXPECT_LE(largest, ceilings[failures - 1]);
+    //Spread over the whole range rather than clustered
+    EXPECT_GT(largest, ceilings[failures - 1] * 9 / 10);
+    EXPECT_GT(delays.size(), 50);
+  }
+}
+
+TEST_F(GausRetry, delays_do_not_overflow) {
+  gaus_retry_policy_t uncapped = {0, 1000, 0};
+  gaus_retry_policy_t capped = {0, 1000, 5000};
+
+  for (int i = 0; i < 100; i++) {
+    gaus_retry_delay_ms(&uncapped, 200);
+    EXPECT_LE(gaus_retry_delay_ms(&capped, 200), 5000);
+  }
+}
+
+TEST_F(GausRetry, does_not_retry_by_default) {
+  gaus_global_init("fakeServerUrl", NULL);
+  fakeFailures.push_back(replyWith(503));
+
+  expectHttpError(503, checkForUpdates());
+
+  EXPECT_EQ(1, curlPerformData.size());
+}
+
+TEST_F(GausRetry, retries_check_for_updates_after_a_server_error) {
+  init(3);
+  fakeFailures.push_back(replyWith(503));
+  fakeFailures.push_back(replyWith(500));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  EXPECT_EQ(3, curlPerformData.size());
+  //All attempts reuse the same handle and headers
+  EXPECT_EQ(curlPerformData[0].CURLOPT_HEADER, curlPerformData[2].CURLOPT_HEADER);
+  EXPECT_EQ(curlPerformData[0].CURLOPT_URL, curlPerformData[2].CURLOPT_URL);
+}
+
+TEST_F(GausRetry, retries_transport_errors) {
+  init(2);
+  fakeFailures.push_back(failWith(CURLE_COULDNT_CONNECT));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  EXPECT_EQ(2, curlPerformData.size());
+}
+
+TEST_F(GausRetry, gives_up_after_max_attempts) {
+  init(3);
+  for (int i = 0; i < 4; i++) {
+    fakeFailures.push_back(replyWith(503));
+  }
+
+  expectHttpError(503, checkForUpdates());
+
+  EXPECT_EQ(3, curlPerformData.size());
+}
+
+TEST_F(GausRetry, reports_the_last_failure) {
+  init(2);
+  fakeFailures.push_back(replyWith(503));
+  fakeFailures.push_back(failWith(CURLE_COULDNT_CONNECT));
+
+  gaus_error_t *status = checkForUpdates();
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(GAUS_UNKNOWN_ERROR, status->error_type);
+  gaus_error_release(status);
+}
+
+TEST_F(GausRetry, does_not_retry_client_errors) {
+  init(3);
+  fakeFailures.push_back(replyWith(404));
+
+  expectHttpError(404, checkForUpdates());
+
+  EXPECT_EQ(1, curlPerformData.size());
+}
+
+TEST_F(GausRetry, does_not_retry_reports) {
+  init(3);
+  fakeFailures.push_back(replyWith(503));
+  gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+  gaus_report_t report = {};
+  report.report_type = GAUS_REPORT_UPDATE;
+  report.report.update_status.type = const_cast<char *>("Status");
+  report.report.update_status.ts = const_cast<char *>("FAKE_TIME");
+
+  expectHttpError(503, gaus_report(&fakeSession, 0, NULL, &header, 1, &report));
+
+  //A report that reached the server before it failed would be made twice
+  EXPECT_EQ(1, curlPerformData.size());
+}
+
+TEST_F(GausRetry, honours_retry_after) {
+  init(2);
+  fakeFailures.push_back(replyWith(429, {"Retry-After: 0"}));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  EXPECT_EQ(2, curlPerformData.size());
+}
+
+TEST_F(GausRetry, gives_up_if_the_server_asks_to_wait_too_long) {
+  init(2);
+  fakeFailures.push_back(replyWith(429, {"Retry-After: 3600"}));
+
+  expectHttpError(429, checkForUpdates());
+
+  EXPECT_EQ(1, curlPerformData.size());
+}
+
+TEST_F(GausRetry, gives_up_rather_than_wait_past_the_deadline) {
+  gaus_initialization_options_t options = {};
+  options.call_options.timeout_ms = 200;
+  options.call_options.retry = {2, 1, 5000};
+  gaus_global_init("fakeServerUrl", &options);
+  fakeFailures.push_back(replyWith(503, {"Retry-After: 1"}));
+
+  expectHttpError(503, checkForUpdates());
+
+  EXPECT_EQ(1, curlPerformData.size());
+}
+
+TEST_F(GausRetry, retries_a_connect_timeout_without_failing_the_call) {
+  init(2, 5000);
+  fakeFailures.push_back(failWith(CURLE_OPERATION_TIMEDOUT));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+
+  EXPECT_EQ(2, curlPerformData.size());
+}
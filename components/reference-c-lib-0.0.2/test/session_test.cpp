@@ -0,0 +1,244 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+#include <algorithm>
+
+#define AUTHENTICATE_REPLY(token) \
+  "{\"deviceGUID\": \"FAKEDEVICEGUID\", \"productGUID\": \"FAKEPRODUCTGUID\", \"token\": \"" token "\"}"
+
+class GausSessionRefresh : public ::testing::Test {
+protected:
+  gaus_session_t session = {NULL, NULL, NULL};
+  gaus_report_header_t header = {const_cast<char *>("FAKE_TIMESTAMP")};
+  gaus_report_t report = {};
+
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    setFakeResponse();
+    gaus_global_init("fakeServerUrl", NULL);
+    report.report_type = GAUS_REPORT_UPDATE;
+    report.report.update_status.type = const_cast<char *>("Status");
+    report.report.update_status.ts = const_cast<char *>("FAKE_TIME");
+  }
+
+  virtual void TearDown() {
+    freeSession(&session);
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+
+  //Setup a default fake response that will work for all tests.
+  static void setFakeResponse() {
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+  }
+
+  static CurlFailure replyWith(long statusCode, const char *body = NULL) {
+    CurlFailure reply;
+    reply.statusCode = statusCode;
+    reply.body = body;
+    return reply;
+  }
+
+  static void freeSession(gaus_session_t *session) {
+    free(session->device_guid);
+    free(session->product_guid);
+    free(session->token);
+  }
+
+  //Authenticate session, which gets the token "OLDTOKEN"
+  void authenticate() {
+    fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("OLDTOKEN")));
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_authenticate("fakeDeviceAccess", "fakeDeviceSecret", &session));
+    resetCurlMockHistory();
+    setFakeResponse();
+  }
+
+  gaus_error_t *checkForUpdates(gaus_session_t *session) {
+    unsigned int updateCount = 0;
+    gaus_update_t *updates = NULL;
+    return gaus_check_for_updates(session, 0, NULL, &updateCount, &updates);
+  }
+
+  static bool sentToken(const CurlOptionsData &transfer, const std::string &token) {
+    const std::vector<std::string> &headers = transfer.CURLOPT_HEADER;
+    return std::find(headers.begin(), headers.end(), "Authorization: Bearer " + token) != headers.end();
+  }
+
+  static void expectHttpError(long statusCode, gaus_error_t *status) {
+    ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+    EXPECT_EQ(GAUS_HTTP_ERROR, status->error_type);
+    EXPECT_EQ(statusCode, status->http_error_code);
+    gaus_error_release(status);
+  }
+};
+
+TEST_F(GausSessionRefresh, renews_an_expired_session_and_checks_again) {
+  authenticate();
+  fakeFailures.push_back(replyWith(401));
+  fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("NEWTOKEN")));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(&session));
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_TRUE(sentToken(curlPerformData[0], "OLDTOKEN"));
+  EXPECT_EQ("fakeServerUrl/authenticate", curlPerformData[1].CURLOPT_URL);
+  EXPECT_EQ(curlPerformData[0].CURLOPT_URL, curlPerformData[2].CURLOPT_URL);
+  EXPECT_TRUE(sentToken(curlPerformData[2], "NEWTOKEN"));
+  //The token of the session is the caller's, the renewed one is kept by libgaus
+  EXPECT_STREQ("OLDTOKEN", session.token);
+}
+
+TEST_F(GausSessionRefresh, renews_an_expired_session_and_reports_again) {
+  authenticate();
+  fakeFailures.push_back(replyWith(401));
+  fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("NEWTOKEN")));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_report(&session, 0, NULL, &header, 1, &report));
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_EQ(curlPerformData[0].CURLOPT_POSTFIELDS, curlPerformData[2].CURLOPT_POSTFIELDS);
+  EXPECT_TRUE(sentToken(curlPerformData[2], "NEWTOKEN"));
+}
+
+TEST_F(GausSessionRefresh, renews_only_once) {
+  authenticate();
+  fakeFailures.push_back(replyWith(401));
+  fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("NEWTOKEN")));
+  fakeFailures.push_back(replyWith(401));
+
+  expectHttpError(401, checkForUpdates(&session));
+
+  EXPECT_EQ(3, curlPerformData.size());
+}
+
+TEST_F(GausSessionRefresh, fails_if_authenticating_again_fails) {
+  authenticate();
+  fakeFailures.push_back(replyWith(401));
+  fakeFailures.push_back(replyWith(403));
+
+  expectHttpError(403, checkForUpdates(&session));
+
+  EXPECT_EQ(2, curlPerformData.size());
+  EXPECT_STREQ("OLDTOKEN", session.token);
+}
+
+TEST_F(GausSessionRefresh, shares_a_renewed_session) {
+  authenticate();
+  gaus_session_t copy = {strdup(session.device_guid), strdup(session.product_guid), strdup(session.token)};
+  fakeFailures.push_back(replyWith(401));
+  fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("NEWTOKEN")));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(&session));
+  resetCurlMockHistory();
+  setFakeResponse();
+
+  //The copy still has the old token, but is sent the new one
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(&copy));
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_TRUE(sentToken(curlPerformData[0], "NEWTOKEN"));
+  freeSession(&copy);
+}
+
+TEST_F(GausSessionRefresh, renews_a_copied_session) {
+  authenticate();
+  //Shares its strings with session
+  gaus_session_t copy = session;
+  fakeFailures.push_back(replyWith(401));
+  fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("NEWTOKEN")));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(&copy));
+  fakeFailures.push_back(replyWith(401));
+  fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("NEWERTOKEN")));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(&session));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(&copy));
+
+  ASSERT_EQ(7, curlPerformData.size());
+  EXPECT_TRUE(sentToken(curlPerformData[2], "NEWTOKEN"));
+  EXPECT_TRUE(sentToken(curlPerformData[3], "NEWTOKEN"));
+  EXPECT_TRUE(sentToken(curlPerformData[5], "NEWERTOKEN"));
+  EXPECT_TRUE(sentToken(curlPerformData[6], "NEWERTOKEN"));
+  //Neither was freed nor replaced
+  EXPECT_EQ(session.token, copy.token);
+  EXPECT_STREQ("OLDTOKEN", session.token);
+}
+
+TEST_F(GausSessionRefresh, renews_a_session_it_does_not_own_the_token_of) {
+  authenticate();
+  char token[] = "OLDTOKEN";
+  gaus_session_t stackSession = {session.device_guid, session.product_guid, token};
+  fakeFailures.push_back(replyWith(401));
+  fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("NEWTOKEN")));
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(&stackSession));
+
+  ASSERT_EQ(3, curlPerformData.size());
+  EXPECT_TRUE(sentToken(curlPerformData[2], "NEWTOKEN"));
+  EXPECT_STREQ("OLDTOKEN", token);
+}
+
+static void asyncReportDone(gaus_error_t *error, void *userData) {
+  *static_cast<gaus_error_t **>(userData) = error;
+}
+
+static void asyncCheckDone(gaus_error_t *error, unsigned int updateCount, gaus_update_t *updates, void *userData) {
+  *static_cast<gaus_error_t **>(userData) = error;
+  free(updates);
+}
+
+TEST_F(GausSessionRefresh, asynchronous_calls_send_the_renewed_token) {
+  authenticate();
+  fakeFailures.push_back(replyWith(401));
+  fakeFailures.push_back(replyWith(200, AUTHENTICATE_REPLY("NEWTOKEN")));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates(&session));
+  resetCurlMockHistory();
+  setFakeResponse();
+  gaus_error_t *reportError = NULL;
+  gaus_error_t *checkError = NULL;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_report_async(&session, 0, NULL, &header, 1, &report, asyncReportDone, &reportError));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates_async(&session, 0, NULL, asyncCheckDone, &checkError));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_client_poll(100, NULL));
+
+  EXPECT_EQ(static_cast<gaus_error_t *>(NULL), reportError);
+  EXPECT_EQ(static_cast<gaus_error_t *>(NULL), checkError);
+  ASSERT_EQ(2, curlPerformData.size());
+  EXPECT_TRUE(sentToken(curlPerformData[0], "NEWTOKEN"));
+  EXPECT_TRUE(sentToken(curlPerformData[1], "NEWTOKEN"));
+}
+
+TEST_F(GausSessionRefresh, does_not_renew_sessions_it_did_not_authenticate) {
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+  fakeFailures.push_back(replyWith(401));
+
+  expectHttpError(401, checkForUpdates(&fakeSession));
+
+  EXPECT_EQ(1, curlPerformData.size());
+}
+
+TEST_F(GausSessionRefresh, forgets_credentials_on_cleanup) {
+  authenticate();
+  gaus_global_cleanup();
+  gaus_global_init("fakeServerUrl", NULL);
+  fakeFailures.push_back(replyWith(401));
+
+  expectHttpError(401, checkForUpdates(&session));
+
+  EXPECT_EQ(1, curlPerformData.size());
+}
@@ -0,0 +1,156 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+//Access gaus internals
+#include "../src/libgaus/stats.h"
+
+#include <thread>
+#include <vector>
+
+class GausStats : public ::testing::Test {
+protected:
+  gaus_session_t fakeSession = {
+      const_cast<char *>("fakeDeviceGUID"),
+      const_cast<char *>("fakeProductGUID"),
+      const_cast<char *>("fakeToken")
+  };
+
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    //Setup a default fake response that will work for all tests.
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+
+  gaus_error_t *checkForUpdates() {
+    unsigned int updateCount = 0;
+    gaus_update_t *updates = NULL;
+    return gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates);
+  }
+};
+
+static CURLcode mock_curl_easy_perform_failed(CURL *curl) {
+  return CURLE_OPERATION_TIMEDOUT;
+}
+
+TEST_F(GausStats, tells_endpoints_apart_by_url) {
+  EXPECT_EQ(GAUS_ENDPOINT_REGISTER, stats_endpoint("https://fake.server/register"));
+  EXPECT_EQ(GAUS_ENDPOINT_AUTHENTICATE, stats_endpoint("https://fake.server/authenticate"));
+  EXPECT_EQ(GAUS_ENDPOINT_CHECK_FOR_UPDATES,
+            stats_endpoint("https://fake.server/device/product/device/check-for-updates?firmware-version=1.2.3/4"));
+  EXPECT_EQ(GAUS_ENDPOINT_REPORT, stats_endpoint("https://fake.server/device/product/device/report"));
+  EXPECT_EQ(GAUS_ENDPOINT_OTHER, stats_endpoint("https://fake.server/download/report.bin"));
+  EXPECT_EQ(GAUS_ENDPOINT_OTHER, stats_endpoint("https://fake.server/other"));
+  EXPECT_EQ(GAUS_ENDPOINT_OTHER, stats_endpoint(""));
+
+  EXPECT_STREQ("check-for-updates", gaus_endpoint_name(GAUS_ENDPOINT_CHECK_FOR_UPDATES));
+  EXPECT_STREQ("other", gaus_endpoint_name(GAUS_ENDPOINT_OTHER));
+  EXPECT_EQ(nullptr, gaus_endpoint_name(GAUS_ENDPOINT_COUNT));
+}
+
+TEST_F(GausStats, summarizes_the_most_recent_requests) {
+  gaus_global_init("fakeServerUrl", NULL);
+
+  for (int i = 1; i <= GAUS_STATS_WINDOW + 8; i++) {
+    fakeTransferInfo.nameLookupTime = 10;
+    fakeTransferInfo.connectTime = 20;
+    fakeTransferInfo.appConnectTime = 30;
+    fakeTransferInfo.startTransferTime = 40;
+    fakeTransferInfo.totalTime = i * 1000;
+    fakeTransferInfo.sizeDownload = i;
+    ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  }
+  gaus_endpoint_stats_t stats = gaus_get_stats().endpoints[GAUS_ENDPOINT_CHECK_FOR_UPDATES];
+
+  EXPECT_EQ(GAUS_STATS_WINDOW + 8, stats.count);
+  EXPECT_EQ(0, stats.failures);
+  //Only the last GAUS_STATS_WINDOW requests, 9 to 40, are summarized
+  EXPECT_EQ(9000, stats.total_us.min);
+  EXPECT_EQ(40000, stats.total_us.max);
+  EXPECT_EQ(24500, stats.total_us.mean);
+  //The 31st of 32 samples
+  EXPECT_EQ(39000, stats.total_us.p95);
+  EXPECT_EQ(10, stats.name_lookup_us.p95);
+  EXPECT_EQ(20, stats.connect_us.mean);
+  EXPECT_EQ(30, stats.tls_connect_us.max);
+  EXPECT_EQ(40, stats.start_transfer_us.min);
+  EXPECT_EQ(40, stats.bytes_down.max);
+  EXPECT_EQ(0, stats.bytes_up.max);
+}
+
+TEST_F(GausStats, counts_requests_per_endpoint) {
+  gaus_global_init("fakeServerUrl", NULL);
+  fakeTransferInfo.totalTime = 1500;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  gaus_stats_t stats = gaus_get_stats();
+
+  EXPECT_EQ(1, stats.endpoints[GAUS_ENDPOINT_CHECK_FOR_UPDATES].count);
+  EXPECT_EQ(1500, stats.endpoints[GAUS_ENDPOINT_CHECK_FOR_UPDATES].total_us.p95);
+  EXPECT_EQ(0, stats.endpoints[GAUS_ENDPOINT_REPORT].count);
+  EXPECT_EQ(0, stats.endpoints[GAUS_ENDPOINT_REPORT].total_us.max);
+  EXPECT_EQ(0, stats.endpoints[GAUS_ENDPOINT_REGISTER].count);
+}
+
+TEST_F(GausStats, counts_requests_without_reply_as_failures) {
+  gaus_global_init("fakeServerUrl", NULL);
+  fakeTransferInfo.totalTime = 1500;
+
+  gaus_curl_easy_perform = mock_curl_easy_perform_failed;
+  gaus_error_t *status = checkForUpdates();
+  gaus_endpoint_stats_t stats = gaus_get_stats().endpoints[GAUS_ENDPOINT_CHECK_FOR_UPDATES];
+
+  ASSERT_NE(static_cast<gaus_error_t *>(NULL), status);
+  EXPECT_EQ(1, stats.count);
+  EXPECT_EQ(1, stats.failures);
+  //Times of a request that never completed would only skew the summaries
+  EXPECT_EQ(0, stats.total_us.max);
+  gaus_error_release(status);
+}
+
+TEST_F(GausStats, counts_requests_recorded_from_many_threads) {
+  std::vector<std::thread> threads;
+  stats_init();
+
+  //Failed requests are recorded without asking curl, the mocks of which are not thread safe
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([]() {
+      for (int request = 0; request < 1000; request++) {
+        stats_record(NULL, "https://fake.server/device/product/device/report", CURLE_OPERATION_TIMEDOUT);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  gaus_stats_t stats = gaus_get_stats();
+  EXPECT_EQ(8000, stats.endpoints[GAUS_ENDPOINT_REPORT].count);
+  EXPECT_EQ(8000, stats.endpoints[GAUS_ENDPOINT_REPORT].failures);
+}
+
+TEST_F(GausStats, are_reset_by_init) {
+  gaus_global_init("fakeServerUrl", NULL);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), checkForUpdates());
+  gaus_global_cleanup();
+
+  gaus_global_init("fakeServerUrl", NULL);
+
+  EXPECT_EQ(0, gaus_get_stats().endpoints[GAUS_ENDPOINT_CHECK_FOR_UPDATES].count);
+}
@@ -0,0 +1,107 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+
+//Access gaus internals
+#include "../src/libgaus/timestamp.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+class GausTimestamp : public ::testing::Test {
+protected:
+  static std::string format(int64_t unixMs) {
+    char buffer[GAUS_TIMESTAMP_SIZE];
+    timestamp_format(unixMs, buffer);
+    return buffer;
+  }
+
+  //The same timestamp by strftime, as the demo used to make it but with milliseconds
+  static std::string expected(int64_t unixMs) {
+    time_t seconds = static_cast<time_t>(unixMs / 1000 - (unixMs % 1000 < 0 ? 1 : 0));
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    char date[20];
+    strftime(date, sizeof(date), "%FT%T", &tm);
+    char buffer[GAUS_TIMESTAMP_SIZE];
+    snprintf(buffer, sizeof(buffer), "%s.%03dZ", date, static_cast<int>(unixMs - seconds * static_cast<int64_t>(1000)));
+    return buffer;
+  }
+};
+
+TEST_F(GausTimestamp, formats_milliseconds) {
+  EXPECT_EQ("2018-11-15T12:00:22.000Z", format(1542283222000));
+  EXPECT_EQ("2018-11-15T12:00:22.001Z", format(1542283222001));
+  EXPECT_EQ("2018-11-15T12:00:22.999Z", format(1542283222999));
+  EXPECT_EQ("2018-11-15T12:00:23.000Z", format(1542283223000));
+}
+
+TEST_F(GausTimestamp, formats_the_epoch) {
+  EXPECT_EQ("1970-01-01T00:00:00.000Z", format(0));
+  EXPECT_EQ("1969-12-31T23:59:59.999Z", format(-1));
+}
+
+TEST_F(GausTimestamp, crosses_hours_days_and_years) {
+  //A minute on either side of the end of 2019, of the 28th of February 2100 and of the leap day of 2020
+  const int64_t ends[] = {1577836800000, 4107542400000, 1583020800000};
+  for (int64_t end : ends) {
+    for (int64_t ms = end - 60000; ms < end + 60000; ms += 7) {
+      ASSERT_EQ(expected(ms), format(ms));
+    }
+  }
+}
+
+TEST_F(GausTimestamp, matches_strftime_going_back_and_forth) {
+  uint32_t seed = 1;
+  for (int i = 0; i < 100000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    //Anywhere between 1970 and 2106, in any order
+    int64_t ms = static_cast<int64_t>(seed) * 1000 + seed % 1000;
+    ASSERT_EQ(expected(ms), format(ms));
+  }
+}
+
+TEST_F(GausTimestamp, follows_the_wall_clock) {
+  char before[GAUS_TIMESTAMP_SIZE];
+  char now[GAUS_TIMESTAMP_SIZE];
+  char after[GAUS_TIMESTAMP_SIZE];
+  struct timespec wall;
+
+  clock_gettime(CLOCK_REALTIME, &wall);
+  timestamp_format(static_cast<int64_t>(wall.tv_sec) * 1000 + wall.tv_nsec / 1000000, before);
+  gaus_timestamp(now);
+  clock_gettime(CLOCK_REALTIME, &wall);
+  timestamp_format(static_cast<int64_t>(wall.tv_sec) * 1000 + wall.tv_nsec / 1000000 + 1, after);
+
+  //Timestamps of the same length sort by time
+  EXPECT_EQ(GAUS_TIMESTAMP_SIZE - 1, strlen(now));
+  EXPECT_LE(std::string(before), std::string(now));
+  EXPECT_LE(std::string(now), std::string(after));
+}
+
+TEST_F(GausTimestamp, is_safe_to_use_from_threads) {
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([t]() {
+      for (int64_t ms = 0; ms < 20000; ms++) {
+        int64_t value = 1542283222000 + t * 3600000 + ms * 997;
+        ASSERT_EQ(expected(value), format(value));
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
@@ -0,0 +1,129 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+//Access gaus curl wrapper
+#include "../src/libgaus/curl_wrapper.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <unistd.h>
+
+#include <map>
+#include <iostream>
+
+class GausTlsSession : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    //Setup a default fake response that will work for all tests.
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+};
+
+static int loadCalls = 0;
+
+static int counting_load(void *user_data, unsigned char *buffer, size_t *length) {
+  loadCalls++;
+  return -1;
+}
+
+static int counting_save(void *user_data, const unsigned char *buffer, size_t length) {
+  return 0;
+}
+
+TEST_F(GausTlsSession, counts_only_new_connections_as_handshakes) {
+  gaus_session_t fakeSession = {
+      strdup("fakeDeviceGUID"),
+      strdup("fakeProductGUID"),
+      strdup("fakeToken")
+  };
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+
+  gaus_global_init("fakeServerUrl", NULL);
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates(&fakeSession, 0, NULL, &updateCount, &updates));
+
+  gaus_tls_session_stats_t stats = gaus_get_tls_session_stats();
+  EXPECT_EQ(1, stats.handshakes);
+  EXPECT_EQ(0, stats.resumed);
+
+  //Cleanup after test
+  free(fakeSession.device_guid);
+  free(fakeSession.product_guid);
+  free(fakeSession.token);
+}
+
+TEST_F(GausTlsSession, stats_reset_on_init) {
+  gaus_global_init("fakeServerUrl", NULL);
+  gaus_tls_session_stats_t stats = gaus_get_tls_session_stats();
+  EXPECT_EQ(0, stats.handshakes);
+  EXPECT_EQ(0, stats.resumed);
+}
+
+TEST_F(GausTlsSession, accepts_store_in_options) {
+  gaus_tls_session_store_t store = {
+      NULL,
+      counting_load,
+      counting_save
+  };
+  gaus_initialization_options_t options = {
+      NULL,
+      &store
+  };
+  loadCalls = 0;
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", &options));
+#ifdef GAUS_USE_MBEDTLS
+  EXPECT_EQ(1, loadCalls);
+#else
+  //Sessions can not be exported without mbedTLS, so the store is never used
+  EXPECT_EQ(0, loadCalls);
+#endif
+}
+
+TEST_F(GausTlsSession, file_store_round_trip) {
+  char path[] = "/tmp/gaus_tls_session_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(-1, fd);
+  close(fd);
+
+  unsigned char session[GAUS_TLS_SESSION_MAX_SIZE];
+  for (size_t i = 0; i < sizeof(session); i++) {
+    session[i] = static_cast<unsigned char>(i);
+  }
+  ASSERT_EQ(0, gaus_tls_session_file_save(path, session, 95));
+
+  unsigned char loaded[GAUS_TLS_SESSION_MAX_SIZE] = {};
+  size_t length = sizeof(loaded);
+  ASSERT_EQ(0, gaus_tls_session_file_load(path, loaded, &length));
+  EXPECT_EQ(95, length);
+  EXPECT_EQ(0, memcmp(session, loaded, 95));
+
+  remove(path);
+}
+
+TEST_F(GausTlsSession, file_store_load_fails_without_file) {
+  unsigned char loaded[GAUS_TLS_SESSION_MAX_SIZE];
+  size_t length = sizeof(loaded);
+  char path[] = "/tmp/gaus_tls_session_does_not_exist";
+  EXPECT_NE(0, gaus_tls_session_file_load(path, loaded, &length));
+}
@@ -0,0 +1,128 @@
+//The MIT License (MIT)
+//
+//Copyright 2018, Sony Mobile Communications Inc.
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gtest/gtest.h>
+#include "gaus/gaus_client.h"
+#include "curl_mock.h"
+
+//Access gaus internals
+#include "../src/libgaus/url.h"
+
+#include <string>
+
+class GausUrl : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    setupMocks();
+    resetCurlMockHistory();
+    //Setup a default fake response that will work for all tests.
+    free(fakeResponse);
+    fakeResponse = strdup("{\"updates\": []}");
+  }
+
+  virtual void TearDown() {
+    gaus_global_cleanup();
+    cleanupMocks();
+  }
+};
+
+TEST_F(GausUrl, encodes_all_but_unreserved_characters) {
+  char *url = url_create("%s/register/%e", "https://fake.server:8080", "AZaz09-._~ /?&=%\xc3\xa5");
+
+  ASSERT_NE(nullptr, url);
+  EXPECT_STREQ("https://fake.server:8080/register/AZaz09-._~%20%2F%3F%26%3D%25%C3%A5", url);
+  free(url);
+}
+
+TEST_F(GausUrl, supports_literal_percent_and_rejects_unknown_directives) {
+  char *url = url_create("%s/100%%", "fakeServerUrl");
+
+  ASSERT_NE(nullptr, url);
+  EXPECT_STREQ("fakeServerUrl/100%", url);
+  free(url);
+
+  EXPECT_EQ(nullptr, url_create("%d/register", 1));
+}
+
+TEST_F(GausUrl, does_not_use_curl) {
+  char *url = url_create("%s/device/%e", "fakeServerUrl", "fake guid");
+
+  free(url);
+  EXPECT_EQ(0, curlCallCounter.easyInit);
+  EXPECT_EQ(0, curlCallCounter.easyCleanup);
+}
+
+TEST_F(GausUrl, long_urls_are_not_truncated) {
+  std::string longValue(1000, ' ');
+  std::string expected = "fakeServerUrl/";
+  for (size_t i = 0; i < longValue.size(); i++) {
+    expected += "%20";
+  }
+
+  char *url = url_create("%s/%e", "fakeServerUrl", longValue.c_str());
+
+  ASSERT_NE(nullptr, url);
+  EXPECT_EQ(expected, url);
+  free(url);
+}
+
+TEST_F(GausUrl, device_prefix_is_built_once_per_session) {
+  UrlPrefixCache cache;
+  gaus_session_t session = {
+      const_cast<char *>("fake/device"),
+      const_cast<char *>("fakeProduct"),
+      const_cast<char *>("fakeToken")
+  };
+  gaus_session_t otherSession = {
+      const_cast<char *>("otherDevice"),
+      const_cast<char *>("fakeProduct"),
+      const_cast<char *>("fakeToken")
+  };
+  url_prefix_cache_init(&cache);
+
+  char *report = url_create_for_device(&cache, "fakeServerUrl", &session, "/report", NULL);
+  char *prefix = cache.prefix;
+  char *check = url_create_for_device(&cache, "fakeServerUrl", &session, "/check-for-updates", "?a=b");
+
+  EXPECT_STREQ("fakeServerUrl/device/fakeProduct/fake%2Fdevice/report", report);
+  EXPECT_STREQ("fakeServerUrl/device/fakeProduct/fake%2Fdevice/check-for-updates?a=b", check);
+  EXPECT_EQ(prefix, cache.prefix);
+
+  char *other = url_create_for_device(&cache, "fakeServerUrl", &otherSession, "/report", NULL);
+  EXPECT_STREQ("fakeServerUrl/device/fakeProduct/otherDevice/report", other);
+
+  free(report);
+  free(check);
+  free(other);
+  url_prefix_cache_cleanup(&cache);
+}
+
+TEST_F(GausUrl, check_for_updates_sends_long_urls_whole) {
+  gaus_session_t fakeSession = {
+      strdup("fakeDeviceGUID"),
+      strdup("fakeProductGUID"),
+      strdup("fakeToken")
+  };
+  std::string longValue(400, 'v');
+  gaus_header_filter_t filters[] = {{const_cast<char *>("firmware-version"), const_cast<char *>(longValue.c_str())}};
+  unsigned int updateCount = 0;
+  gaus_update_t *updates = NULL;
+
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL), gaus_global_init("fakeServerUrl", NULL));
+  ASSERT_EQ(static_cast<gaus_error_t *>(NULL),
+            gaus_check_for_updates(&fakeSession, 1, filters, &updateCount, &updates));
+
+  ASSERT_EQ(1, curlPerformData.size());
+  EXPECT_EQ("fakeServerUrl/device/fakeProductGUID/fakeDeviceGUID/check-for-updates?firmware-version=" + longValue,
+            curlPerformData[0].CURLOPT_URL);
+
+  free(fakeSession.device_guid);
+  free(fakeSession.product_guid);
+  free(fakeSession.token);
+}
@@ -57,6 +57,34 @@ static const char *TAG = "gaus-demo";
 #define GAUS_PRODUCT_ACCESS CONFIG_GAUS_PRODUCT_ACCESS
 #define GAUS_PRODUCT_SECRET CONFIG_GAUS_PRODUCT_SECRET
 
+#ifdef CONFIG_GAUS_REPORT_CBOR
+#define GAUS_REPORT_FORMAT GAUS_REPORT_FORMAT_CBOR
+#else
+#define GAUS_REPORT_FORMAT GAUS_REPORT_FORMAT_JSON
+#endif
+
+//Longest a single gaus call may block the update loop, and the part of it allowed for connecting to the server
+#define GAUS_CALL_TIMEOUT_MS 30000
+#define GAUS_CONNECT_TIMEOUT_MS 10000
+//How often, and how patiently, the library retries a check for updates that failed on its way to or from the server
+#define GAUS_RETRY_ATTEMPTS 3
+#define GAUS_RETRY_BASE_DELAY_MS 500
+#define GAUS_RETRY_MAX_DELAY_MS 8000
+//Pause before reconnecting after the server couldn't be reached, growing up to the max with each failure in a row
+#define GAUS_RECONNECT_BASE_DELAY_MS 5000
+#define GAUS_RECONNECT_MAX_DELAY_MS (15 * 60 * 1000)
+//Failures in a row after which the device restarts rather than keep trying
+#define GAUS_MAX_RECONNECTS 20
+//Readings are sent a cycle's worth at a time, saving a request (and the radio time it takes) per sample
+#define GAUS_REPORT_BATCH_MAX_REPORTS 60
+#define GAUS_REPORT_BATCH_MAX_AGE_MS 60000
+//Readings are only sent once they move past the DHT11 flickering between neighbouring steps, or every 15 minutes,
+//with the least, greatest and mean of those held back
+#define GAUS_REPORT_DEADBAND 2.0f
+#define GAUS_REPORT_HEARTBEAT_MS (15 * 60 * 1000)
+//Lines of the library's log written out in the background, so writing to the UART doesn't hold up the update loop
+#define GAUS_LOG_RING_LINES 32
+
 //Returns a strong pointer to a null terminated version string
 static char *version_string(void);
 
@@ -66,6 +94,20 @@ static char *get_device_id(void);
 //Returns a strong pointer to a null terminated location string
 static char *get_device_location(void);
 
+static int load_tls_session(void *user_data, unsigned char *buffer, size_t *length);
+
+static int save_tls_session(void *user_data, const unsigned char *buffer, size_t length);
+
+static void log_tls_session_stats(void);
+
+static int load_dns_cache(void *user_data, unsigned char *buffer, size_t *length);
+
+static int save_dns_cache(void *user_data, const unsigned char *buffer, size_t length);
+
+//Log and free err, then wait out a jittered pause before the next try. Returns false once failures says it's time to
+//restart instead.
+static bool back_off(const char *action, gaus_error_t **err, unsigned int failures);
+
 //FIXME: Use mac address or something
 //Should be unique to this device (MAC or similar)
 #define GAUS_DEVICE_ID CONFIG_GAUS_DEVICE_ID
@@ -87,7 +129,8 @@ void gaus_communication_task(void *taskData) {
   char *device_location = get_device_location();
 
   uint32_t poll_interval;
-  gaus_session_t session;
+  gaus_session_t session = {NULL, NULL, NULL};
+  unsigned int failures = 0;
 
   unsigned int filterCount = 2;
   gaus_header_filter_t filters[2] = {
@@ -100,6 +143,8 @@ void gaus_communication_task(void *taskData) {
           strdup(device_location)
       }
   };
+  //Filters stay the same for the life of the task, so their query string is only built once
+  gaus_filter_set_t *filter_set = NULL;
   unsigned int updateCount = 0;
   gaus_update_t *updates = NULL;
 
@@ -115,13 +160,67 @@ void gaus_communication_task(void *taskData) {
   // GAUS LIBRARY STEP 1: Initalize library
   // Only required if using library
   display_text_small(0, BOTTOM, STATUS_COLOR, "Init library...\r");
-  gaus_error_t *err = gaus_global_init(GAUS_SERVER_URL, NULL);
+  //Persist the TLS session in NVS so the first request after a restart can skip the full handshake.
+  gaus_tls_session_store_t tls_session_store = {
+      NULL,
+      load_tls_session,
+      save_tls_session
+  };
+  //And the address of the server, so a restart doesn't have to wait on DNS or fail while it is down.
+  gaus_dns_cache_store_t dns_cache_store = {
+      NULL,
+      load_dns_cache,
+      save_dns_cache
+  };
+  //Queue sensor reports in flash, so they are sent once the network is back, even after a restart.
+  gaus_report_queue_store_t report_queue_store;
+  bool has_report_queue = get_report_queue_store(&report_queue_store);
+  static const gaus_report_deadband_rule_t report_deadband_rules[] = {
+      {"Temperature", "temperature", GAUS_REPORT_DEADBAND, GAUS_REPORT_HEARTBEAT_MS, 1},
+      {"Humidity", "humidity", GAUS_REPORT_DEADBAND, GAUS_REPORT_HEARTBEAT_MS, 1}
+  };
+  //Bound every call, so a server that stops answering can't stall the loop for minutes, and ride out short blips.
+  gaus_initialization_options_t options = {
+      NULL,
+      &tls_session_store,
+      {
+          GAUS_CONNECT_TIMEOUT_MS,
+          GAUS_CALL_TIMEOUT_MS,
+          NULL,
+          {
+              GAUS_RETRY_ATTEMPTS,
+              GAUS_RETRY_BASE_DELAY_MS,
+              GAUS_RETRY_MAX_DELAY_MS
+          }
+      },
+      &dns_cache_store,
+      0,
+      has_report_queue ? &report_queue_store : NULL,
+      {
+          0,
+          GAUS_REPORT_BATCH_MAX_REPORTS,
+          GAUS_REPORT_BATCH_MAX_AGE_MS
+      },
+      GAUS_REPORT_FORMAT,
+      {
+          sizeof(report_deadband_rules) / sizeof(report_deadband_rules[0]),
+          report_deadband_rules
+      },
+      GAUS_UPDATE_LAYOUT_ONE_BLOCK,
+      GAUS_LOG_RING_LINES
+  };
+  gaus_error_t *err = gaus_global_init(GAUS_SERVER_URL, &options);
   if (err) {
     ESP_LOGE(TAG, "An error occurred initializing!");
     goto FAIL;
   } else {
     ESP_LOGI(TAG, "Gaus library initialized!");
   }
+  err = gaus_filter_set_create(filterCount, filters, &filter_set);
+  if (err) {
+    ESP_LOGE(TAG, "An error occurred creating filters!");
+    goto FAIL;
+  }
   //Retrieve device access, device secret, poll interval from NonVolatileStorage (NVS)
   esp_err_t pi_error = get_nvs_u32("poll_interval", &poll_interval);
   esp_err_t da_error = get_nvs_str("device_access", &device_access);
@@ -153,32 +252,39 @@ void gaus_communication_task(void *taskData) {
     set_nvs_str("device_secret", device_secret);
   }
 
-  // GAUS LIBRARY STEP 3: Authenticate device
-  // We need to collect a "session" to use for all future communications with Gaus system.
-  display_text_small(0, BOTTOM, STATUS_COLOR, "Authenticate device...\r");
-  err = gaus_authenticate(device_access, device_secret, &session);
-  if (err) {
-    ESP_LOGE(TAG, "An error occurred authenticating!");
-    ESP_LOGE(TAG, "error_type: %d, http_error_code: %d, description: %s", err->error_type, err->http_error_code,
-             err->description);
-    goto FAIL;
-  } else {
-    ESP_LOGI(TAG, "Gaus authenticated!");
-  }
-
   //Main Loop
   while (1) {
+    // GAUS LIBRARY STEP 3: Authenticate device
+    // We need to collect a "session" to use for all future communications with Gaus system.
+    if (!session.token) {
+      display_text_small(0, BOTTOM, STATUS_COLOR, "Authenticate device...\r");
+      err = gaus_authenticate(device_access, device_secret, &session);
+      if (err) {
+        freeSession(&session);
+        if (!back_off("authenticating", &err, ++failures)) {
+          goto FAIL;
+        }
+        continue;
+      }
+      ESP_LOGI(TAG, "Gaus authenticated!");
+    }
+
     // GAUS LIBRARY STEP 4: Check for updates
-    // Use session to check for updates.  If session has expired, we should aquire a new session
-    // by calling gaus_authenticate() again.
+    // Use session to check for updates.  If session has expired, the library authenticates again by itself and
+    // swaps the new token into session.
     display_text_small(0, BOTTOM, STATUS_COLOR, "Check for updates...\r");
-    err = gaus_check_for_updates(&session, filterCount, filters, &updateCount, &updates);
+    err = gaus_check_for_updates_with_filter_set(&session, filter_set, &updateCount, &updates);
     if (err) {
-      ESP_LOGE(TAG, "An error occurred checking for updates!");
-      ESP_LOGE(TAG, "error_type: %d, http_error_code: %d, description: %s", err->error_type, err->http_error_code,
-               err->description);
-      goto FAIL;
+      //Renewing the expired session failed, so start over with a new one before the next check
+      if (err->error_type == GAUS_HTTP_ERROR && err->http_error_code == 401) {
+        freeSession(&session);
+      }
+      if (!back_off("checking for updates", &err, ++failures)) {
+        goto FAIL;
+      }
+      continue;
     } else {
+      failures = 0;
       ESP_LOGI(TAG, "Gaus check for update successful!");
       if (updateCount > 0) {
         display_text_small(0, BOTTOM, STATUS_COLOR, "Found %d Updates!\r", updateCount);
@@ -225,28 +331,36 @@ void gaus_communication_task(void *taskData) {
                              "T: %.1fC   H: %.1f\r", temperature, humidity);
         }
       }
+      //Carry on with reports started in the background, without waiting for the server.
+      send_queued_reports(&session);
+      gaus_error_t *poll_err = gaus_client_poll(0, NULL);
+      if (poll_err) {
+        ESP_LOGE(TAG, "Polling gaus failed: %s", poll_err->description);
+        gaus_error_release(poll_err);
+      }
       vTaskDelay(1000 / portTICK_PERIOD_MS);
     }
+    //Ship the latency breakdown gathered over the last cycle, to tell DNS, TLS and server time apart.
+    send_gaus_stats_report(&session);
   }
 
   INSTALL_SUCCESS:
   FAIL:
-  freeUpdates(updateCount, &updates);
+  log_tls_session_stats();
+  gaus_updates_free(updates);
   free(filters[0].filter_name);
   free(filters[0].filter_value);
   free(filters[1].filter_name);
   free(filters[1].filter_value);
-  if (err) {
-    free(err->description);
-  }
+  gaus_filter_set_free(filter_set);
+  gaus_error_release(err);
   free(device_access);
   free(device_secret);
   free(device_id);
   free(device_location);
-  free(session.device_guid);
-  free(session.product_guid);
-  free(session.token);
-  free(err);
+  freeSession(&session);
+  //Readings still waiting for their batch are moved to flash rather than lost
+  gaus_global_cleanup();
   esp_restart();
 }
 
@@ -334,3 +448,47 @@ static char *get_device_location(void) {
   }
   return device_location;
 }
+
+static int load_tls_session(void *user_data, unsigned char *buffer, size_t *length) {
+  return get_nvs_blob("tls_session", buffer, length) == ESP_OK ? 0 : -1;
+}
+
+static int save_tls_session(void *user_data, const unsigned char *buffer, size_t length) {
+  return set_nvs_blob("tls_session", buffer, length) == ESP_OK ? 0 : -1;
+}
+
+static int load_dns_cache(void *user_data, unsigned char *buffer, size_t *length) {
+  return get_nvs_blob("dns_cache", buffer, length) == ESP_OK ? 0 : -1;
+}
+
+static int save_dns_cache(void *user_data, const unsigned char *buffer, size_t length) {
+  return set_nvs_blob("dns_cache", buffer, length) == ESP_OK ? 0 : -1;
+}
+
+static bool back_off(const char *action, gaus_error_t **err, unsigned int failures) {
+  //Full jitter spreads devices that lost the server together over the whole pause, so they don't return together.
+  static const gaus_retry_policy_t reconnect_policy = {
+      GAUS_MAX_RECONNECTS,
+      GAUS_RECONNECT_BASE_DELAY_MS,
+      GAUS_RECONNECT_MAX_DELAY_MS
+  };
+  ESP_LOGE(TAG, "An error occurred %s!", action);
+  ESP_LOGE(TAG, "error_type: %d, http_error_code: %d, description: %s", (*err)->error_type, (*err)->http_error_code,
+           (*err)->description);
+  gaus_error_release(*err);
+  *err = NULL;
+  if (failures >= reconnect_policy.max_attempts) {
+    ESP_LOGE(TAG, "Failed %u times in a row, restarting!", failures);
+    return false;
+  }
+  unsigned long delay_ms = gaus_retry_delay_ms(&reconnect_policy, failures);
+  ESP_LOGW(TAG, "Trying again in %lu ms...", delay_ms);
+  display_text_small(0, BOTTOM, STATUS_COLOR, "Retry in %lus...\r", delay_ms / 1000);
+  vTaskDelay(delay_ms / portTICK_PERIOD_MS);
+  return true;
+}
+
+static void log_tls_session_stats(void) {
+  gaus_tls_session_stats_t tls_stats = gaus_get_tls_session_stats();
+  ESP_LOGI(TAG, "TLS handshakes: %d, resumed: %d", tls_stats.handshakes, tls_stats.resumed);
+}
@@ -20,62 +20,11 @@
 
 #define TAG "gaus-helpers"
 
-void freeUpdate(gaus_update_t update) {
-  for (int i = 0; i < update.metadata_count; i++) {
-    free(update.metadata[i].key);
-    free(update.metadata[i].value);
-  }
-  update.metadata_count = 0;
-  update.size = 0;
-  free(update.metadata);
-  free(update.update_type);
-  free(update.package_type);
-  free(update.md5);
-  free(update.update_id);
-  free(update.version);
-  free(update.download_url);
-}
-
-void freeUpdates(unsigned int updateCount, gaus_update_t **updates) {
-  for (int i = 0; i < updateCount; i++) {
-    freeUpdate((*updates)[i]);
-  }
-  free(*updates);
-}
-
-void freeReport(gaus_report_t report) {
-  switch (report.report_type) {
-    case GAUS_REPORT_UPDATE:
-      for (int i = 0; i < report.report.update_status.v_string_count; i++) {
-        free(report.report.update_status.v_strings[i].name);
-        free(report.report.update_status.v_strings[i].value);
-      }
-      free(report.report.update_status.type);
-      free(report.report.update_status.ts);
-      break;
-    case GAUS_REPORT_GENERIC:
-      for (int i = 0; i < report.report.generic.v_int_count; i++) {
-        free(report.report.generic.v_ints[i].name);
-      }
-      for (int i = 0; i < report.report.generic.v_float_count; i++) {
-        free(report.report.generic.v_floats[i].name);
-      }
-      for (int i = 0; i < report.report.generic.v_string_count; i++) {
-        free(report.report.generic.v_strings[i].name);
-        free(report.report.generic.v_strings[i].value);
-      }
-      free(report.report.generic.type);
-      free(report.report.generic.ts);
-      break;
-    default:
-
-      break;
-  }
-}
-
-
-void freeReports(unsigned int reportCount, gaus_report_t *reports) {
-  for (int i = 0; i < reportCount; i++) {
-    freeReport(reports[i]);
-  }
+void freeSession(gaus_session_t *session) {
+  free(session->device_guid);
+  free(session->product_guid);
+  free(session->token);
+  session->device_guid = NULL;
+  session->product_guid = NULL;
+  session->token = NULL;
 }
@@ -19,13 +19,7 @@
 
 #include "gaus/gaus_client.h"
 
-//Deep free updates
-void freeUpdate(gaus_update_t update);
-
-void freeUpdates(unsigned int updateCount, gaus_update_t **updates);
-
-void freeReport(gaus_report_t report);
-
-void freeReports(unsigned int reportCount, gaus_report_t *reports);
+//Free the strings of a session, leaving it empty so it can be authenticated again
+void freeSession(gaus_session_t *session);
 
 #endif
@@ -14,153 +14,234 @@
 //WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
 //COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
 //OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
-#include <time.h>
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_spi_flash.h>
 #include <gaus/gaus_client.h>
 
 #include "gaus_report.h"
-#include "gaus_helpers.h"
 
 #define TAG "gaus_report"
 
-void send_update_status_report(gaus_session_t *session, char *phase, char *status, char *logLine, char *updateId) {
+//Custom data partition subtype of the "reports" partition in partitions.csv
+#define REPORT_QUEUE_PARTITION_SUBTYPE 0x40
+//A batch of up to 8 KB at most every 4 s, so a backlog doesn't crowd out update checks
+#define REPORT_BATCH_BYTES 8192
+#define REPORT_UPLOAD_BYTES_PER_S 2048
+#define REPORT_RETRY_BASE_DELAY_MS 5000
+#define REPORT_RETRY_MAX_DELAY_MS (5 * 60 * 1000)
 
-  time_t now = 0;
-  time(&now);
-  char time[25];  //Time is always 25 chars with null (Format: 2018-11-15T12:00:22.000Z)
-  strftime(time, sizeof(time), "%FT%T.000Z", gmtime(&now));
+//Room for the reports of a call with all their names and values, on the stack of the task making it
+#define REPORT_ARENA_BYTES 1024
 
-  gaus_report_header_t header = {
-      strdup(time)
-  };
+void send_update_status_report(gaus_session_t *session, char *phase, char *status, char *logLine, char *updateId) {
 
-  unsigned int reportCount = 1;
-  gaus_v_string_t vstrings[4] = {
-      {
-          strdup("phase"),
-          strdup(phase)
-      },
-      {
-          strdup("status"),
-          strdup(status)
-      },
-      {
-          strdup("logLine"),
-          strdup(logLine)
-      },
-      {
-          strdup("updateId"),
-          strdup(updateId)
-      }
-  };
+  char time[GAUS_TIMESTAMP_SIZE];  //Format: 2018-11-15T12:00:22.123Z, with the milliseconds of the sample
+  gaus_timestamp(time);
 
-  gaus_report_t report[1] = {
-      {
-          .report = {
-              .update_status = {
-                  .type = strdup("Status"),
-                  .ts = strdup(time),
-                  .v_int_count = 0,
-                  .v_ints = NULL,
-                  .v_float_count = 0,
-                  .v_floats = NULL,
-                  .v_string_count = 4,
-                  .v_strings = vstrings,
-                  .tag_count = 0,
-                  .tags = NULL
-              }
-          },
-          .report_type = GAUS_REPORT_UPDATE
-      }
-  };
+  //Laid out in one arena rather than allocated field by field, so reporting doesn't fragment the heap over weeks
+  char arena[REPORT_ARENA_BYTES];
+  gaus_report_builder_t builder;
+  const gaus_report_header_t *header = NULL;
+  unsigned int reportCount = 0;
+  const gaus_report_t *report = NULL;
+  gaus_error_t *err = gaus_report_builder_init(&builder, arena, sizeof(arena));
+  if (!err) {
+    gaus_report_builder_header(&builder, time);
+    gaus_report_builder_begin(&builder, GAUS_REPORT_UPDATE, "Status", time, 0, 0, 4);
+    gaus_report_builder_string(&builder, "phase", phase);
+    gaus_report_builder_string(&builder, "status", status);
+    gaus_report_builder_string(&builder, "logLine", logLine);
+    gaus_report_builder_string(&builder, "updateId", updateId);
+    err = gaus_report_builder_finish(&builder, &header, &reportCount, &report);
+  }
 
-  gaus_error_t *err = gaus_report(session, 0, NULL, &header, reportCount, report);
+  if (!err) {
+    err = gaus_report(session, 0, NULL, header, reportCount, report);
+  }
   if (err) {
     ESP_LOGE(TAG, "An error occurred making a report!");
     ESP_LOGE(TAG, "error_type: %d, http_error_code: %d, description: %s", err->error_type, err->http_error_code,
              err->description);
-    free(err->description);
+    gaus_error_release(err);
+  } else {
+    ESP_LOGI(TAG, "Report made successfully!");
+  }
+}
+
+static void temperature_and_humidity_report_done(gaus_error_t *err, void *user_data) {
+  if (err) {
+    ESP_LOGE(TAG, "An error occurred making a temperature and humidity report!");
+    ESP_LOGE(TAG, "error_type: %d, http_error_code: %d, description: %s", err->error_type, err->http_error_code,
+             err->description);
+    gaus_error_release(err);
   } else {
     ESP_LOGI(TAG, "Report made successfully!");
   }
-  freeReports(reportCount, report);
-  free(header.ts);
 }
 
 void send_update_temperature_and_humidity_report(gaus_session_t *session, float temperature, float humidity) {
 
-  time_t now = 0;
-  time(&now);
-  char time[25];  //Time is always 25 chars with null (Format: 2018-11-15T12:00:22.000Z)
-  strftime(time, sizeof(time), "%FT%T.000Z", gmtime(&now));
+  char time[GAUS_TIMESTAMP_SIZE];  //Format: 2018-11-15T12:00:22.123Z, with the milliseconds of the sample
+  gaus_timestamp(time);
+
+  char arena[REPORT_ARENA_BYTES];
+  gaus_report_builder_t builder;
+  const gaus_report_header_t *header = NULL;
+  unsigned int reportCount = 0;
+  const gaus_report_t *report = NULL;
+  gaus_error_t *err = gaus_report_builder_init(&builder, arena, sizeof(arena));
+  if (!err) {
+    gaus_report_builder_header(&builder, time);
+    gaus_report_builder_begin(&builder, GAUS_REPORT_GENERIC, "Temperature", time, 0, 1, 0);
+    gaus_report_builder_float(&builder, "temperature", temperature);
+    gaus_report_builder_begin(&builder, GAUS_REPORT_GENERIC, "Humidity", time, 0, 1, 0);
+    gaus_report_builder_float(&builder, "humidity", humidity);
+    err = gaus_report_builder_finish(&builder, &header, &reportCount, &report);
+  }
+  if (err) {
+    temperature_and_humidity_report_done(err, NULL);
+    return;
+  }
+
+  //Sent together with the other samples of the cycle by gaus_client_poll.  A batch that doesn't get through is kept in
+  //flash until send_queued_reports gets it to the server, so samples taken while offline are not lost.
+  err = gaus_report_enqueue(session, NULL, header, reportCount, report);
+  if (err) {
+    ESP_LOGW(TAG, "Unable to batch report, sending it right away: %s", err->description);
+    gaus_error_release(err);
+    //Sent in the background by gaus_client_poll, so a slow server doesn't hold up sampling.
+    err = gaus_report_async(session, 0, NULL, header, reportCount, report, temperature_and_humidity_report_done,
+                            NULL);
+    if (err) {
+      temperature_and_humidity_report_done(err, NULL);
+    }
+  }
+}
+
+#define STATS_VALUE_COUNT 11
+
+void send_gaus_stats_report(gaus_session_t *session) {
+
+  char time[GAUS_TIMESTAMP_SIZE];  //Format: 2018-11-15T12:00:22.123Z, with the milliseconds of the sample
+  gaus_timestamp(time);
 
   gaus_report_header_t header = {
-      strdup(time)
+      time
   };
 
-  unsigned int reportCount = 2;
-  gaus_v_float_t temperature_data[1] = {
-      {
-          strdup("temperature"),
-          temperature
-      }
+  gaus_stats_t stats = gaus_get_stats();
+  //Names and values live on the stack, so these reports need no freeing.
+  gaus_v_int_t values[GAUS_ENDPOINT_COUNT][STATS_VALUE_COUNT];
+  gaus_report_tag_t tags[GAUS_ENDPOINT_COUNT];
+  gaus_report_t report[GAUS_ENDPOINT_COUNT];
+  unsigned int reportCount = 0;
+  for (int i = 0; i < GAUS_ENDPOINT_COUNT; i++) {
+    gaus_endpoint_stats_t *endpoint = &stats.endpoints[i];
+    if (endpoint->count == 0) {
+      continue;
+    }
+    gaus_v_int_t *v = values[reportCount];
+    v[0] = (gaus_v_int_t) {"count", (int) endpoint->count};
+    v[1] = (gaus_v_int_t) {"failures", (int) endpoint->failures};
+    v[2] = (gaus_v_int_t) {"totalMeanUs", (int) endpoint->total_us.mean};
+    v[3] = (gaus_v_int_t) {"totalP95Us", (int) endpoint->total_us.p95};
+    v[4] = (gaus_v_int_t) {"totalMaxUs", (int) endpoint->total_us.max};
+    v[5] = (gaus_v_int_t) {"nameLookupP95Us", (int) endpoint->name_lookup_us.p95};
+    v[6] = (gaus_v_int_t) {"connectP95Us", (int) endpoint->connect_us.p95};
+    v[7] = (gaus_v_int_t) {"tlsConnectP95Us", (int) endpoint->tls_connect_us.p95};
+    v[8] = (gaus_v_int_t) {"startTransferP95Us", (int) endpoint->start_transfer_us.p95};
+    v[9] = (gaus_v_int_t) {"bytesUpMean", (int) endpoint->bytes_up.mean};
+    v[10] = (gaus_v_int_t) {"bytesDownMean", (int) endpoint->bytes_down.mean};
+    tags[reportCount] = (gaus_report_tag_t) {"endpoint", (char *) gaus_endpoint_name((gaus_endpoint_t) i)};
+    report[reportCount] = (gaus_report_t) {
+        .report = {
+            .generic = {
+                .type = "GausStats",
+                .ts = time,
+                .v_int_count = STATS_VALUE_COUNT,
+                .v_ints = v,
+                .v_float_count = 0,
+                .v_floats = NULL,
+                .v_string_count = 0,
+                .v_strings = NULL,
+                .tag_count = 1,
+                .tags = &tags[reportCount]
+            }
+        },
+        .report_type = GAUS_REPORT_GENERIC
+    };
+    reportCount++;
+  }
+  if (reportCount == 0) {
+    return;
+  }
+
+  gaus_error_t *err = gaus_report(session, 0, NULL, &header, reportCount, report);
+  if (err) {
+    ESP_LOGE(TAG, "An error occurred making a stats report!");
+    ESP_LOGE(TAG, "error_type: %d, http_error_code: %d, description: %s", err->error_type, err->http_error_code,
+             err->description);
+    gaus_error_release(err);
+  } else {
+    ESP_LOGI(TAG, "Stats report made successfully!");
+  }
+}
+
+static int read_report_queue(void *user_data, size_t offset, unsigned char *buffer, size_t length) {
+  return esp_partition_read(user_data, offset, buffer, length) == ESP_OK ? 0 : -1;
+}
+
+static int write_report_queue(void *user_data, size_t offset, const unsigned char *buffer, size_t length) {
+  return esp_partition_write(user_data, offset, buffer, length) == ESP_OK ? 0 : -1;
+}
+
+static int erase_report_queue(void *user_data, size_t offset, size_t length) {
+  return esp_partition_erase_range(user_data, offset, length) == ESP_OK ? 0 : -1;
+}
+
+bool get_report_queue_store(gaus_report_queue_store_t *store) {
+  const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                              REPORT_QUEUE_PARTITION_SUBTYPE, "reports");
+  if (!partition) {
+    ESP_LOGW(TAG, "No reports partition, reports are not queued");
+    return false;
+  }
+  *store = (gaus_report_queue_store_t) {
+      (void *) partition,
+      partition->size,
+      SPI_FLASH_SEC_SIZE,
+      read_report_queue,
+      write_report_queue,
+      erase_report_queue
   };
+  return true;
+}
 
-  gaus_v_float_t humidity_data[1] = {
+void send_queued_reports(gaus_session_t *session) {
+  static const gaus_report_queue_drain_options_t options = {
+      REPORT_BATCH_BYTES,
+      REPORT_UPLOAD_BYTES_PER_S,
       {
-          strdup("humidity"),
-          humidity
+          0,
+          REPORT_RETRY_BASE_DELAY_MS,
+          REPORT_RETRY_MAX_DELAY_MS
       }
   };
 
-  gaus_report_t report[2] = {
-      {
-          .report = {
-              .generic = {
-                  .type = strdup("Temperature"),
-                  .ts = strdup(time),
-                  .v_int_count = 0,
-                  .v_ints = NULL,
-                  .v_float_count = 1,
-                  .v_floats = temperature_data,
-                  .v_string_count = 0,
-                  .v_strings = NULL,
-                  .tag_count = 0,
-                  .tags = NULL
-              }
-          },
-          .report_type = GAUS_REPORT_GENERIC
-      },
-      {
-          .report = {
-              .generic = {
-                  .type = strdup("Humidity"),
-                  .ts = strdup(time),
-                  .v_int_count = 0,
-                  .v_ints = NULL,
-                  .v_float_count = 1,
-                  .v_floats = humidity_data,
-                  .v_string_count = 0,
-                  .v_strings = NULL,
-                  .tag_count = 0,
-                  .tags = NULL
-              }
-          },
-          .report_type = GAUS_REPORT_GENERIC
-      }
+  char time[GAUS_TIMESTAMP_SIZE];  //Format: 2018-11-15T12:00:22.123Z, with the milliseconds of the sample
+  gaus_timestamp(time);
+
+  gaus_report_header_t header = {
+      time
   };
 
-  gaus_error_t *err = gaus_report(session, 0, NULL, &header, reportCount, report);
+  gaus_error_t *err = gaus_report_queue_drain(session, NULL, &header, &options);
   if (err) {
-    ESP_LOGE(TAG, "An error occurred making a temperature and humidity report!");
-    ESP_LOGE(TAG, "error_type: %d, http_error_code: %d, description: %s", err->error_type, err->http_error_code,
-             err->description);
-    free(err->description);
-  } else {
-    ESP_LOGI(TAG, "Report made successfully!");
+    ESP_LOGE(TAG, "Unable to send queued reports: %s", err->description);
+    gaus_error_release(err);
   }
-  freeReports(reportCount, report);
-  free(header.ts);
 }
@@ -17,10 +17,19 @@
 #ifndef ESP32_FREERTOS_DEMO_GAUS_REPORT_H
 #define ESP32_FREERTOS_DEMO_GAUS_REPORT_H
 
+#include <stdbool.h>
 #include <gaus/gaus_client_types.h>
 
 void send_update_status_report(gaus_session_t *session, char *phase, char *status, char *logLine, char *updateId);
 
 void send_update_temperature_and_humidity_report(gaus_session_t *session, float temperature, float humidity);
 
+void send_gaus_stats_report(gaus_session_t *session);
+
+//Point store at the "reports" partition, returns false if there is none.
+bool get_report_queue_store(gaus_report_queue_store_t *store);
+
+//Start sending the oldest queued reports, if the rate limit allows and none are on their way already.
+void send_queued_reports(gaus_session_t *session);
+
 #endif
@@ -89,3 +89,38 @@ esp_err_t get_nvs_str(const char *name, char **value) {
   }
   return err;
 }
+
+esp_err_t set_nvs_blob(const char *name, const void *value, size_t length) {
+  nvs_handle my_handle;
+  esp_err_t err = nvs_open(PAGE, NVS_READWRITE, &my_handle);
+  if (err == ESP_OK) {
+    err = nvs_set_blob(my_handle, name, value, length);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "An error (%d) occurred setting blob %s", err, name);
+    }
+    err = nvs_commit(my_handle);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "An error (%d) occurred committing changes to page:name %s:%s", err, PAGE, name);
+    }
+    nvs_close(my_handle);
+  } else {
+    ESP_LOGE(TAG, "An error (%d) opening page %s", err, PAGE);
+  }
+  return err;
+}
+
+//Expects value to point to a buffer of *length bytes, on success *length is set to the size of the blob read.
+esp_err_t get_nvs_blob(const char *name, void *value, size_t *length) {
+  nvs_handle my_handle;
+  esp_err_t err = nvs_open(PAGE, NVS_READWRITE, &my_handle);
+  if (err == ESP_OK) {
+    err = nvs_get_blob(my_handle, name, value, length);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "An error (%d) occurred getting %s", err, name);
+    }
+    nvs_close(my_handle);
+  } else {
+    ESP_LOGE(TAG, "An error (%d) opening page %s", err, PAGE);
+  }
+  return err;
+}
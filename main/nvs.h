@@ -23,4 +23,8 @@ esp_err_t set_nvs_str(const char *name, const char *value);
 
 esp_err_t get_nvs_str(const char *name, char **value);
 
+esp_err_t set_nvs_blob(const char *name, const void *value, size_t length);
+
+esp_err_t get_nvs_blob(const char *name, void *value, size_t *length);
+
 #endif